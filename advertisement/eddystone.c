@@ -41,6 +41,14 @@ void eddystone_adv(const char* url_str, const ble_advdata_t* scan_response_data)
 
     // Physical Web data
     uint8_t url_frame_length = 3 + strlen((char*)url_str); // Change to 4 if URLEND is applied
+
+    // ble_advdata doesn't check service data against the packet size, so a
+    // URL that doesn't fit would overrun its buffer. Flags, the UUID list and
+    // the service data header take 11 of the 31 bytes.
+    if (strlen((char*)url_str) > BLE_GAP_ADV_MAX_SIZE - 11 - 3) {
+        APP_ERROR_CHECK(NRF_ERROR_DATA_SIZE);
+        return;
+    }
     uint8_t m_url_frame[url_frame_length];
     m_url_frame[0] = PHYSWEB_URL_TYPE;
     m_url_frame[1] = PHYSWEB_TX_POWER;
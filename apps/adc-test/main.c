@@ -1,124 +1,172 @@
 /* ADC-test
+ *
+ * Sample AIN7 at 1 kHz, timed by hardware, and stream the samples over BLE
+ * notifications. The min, max, mean and RMS of every buffer are notified
+ * too, for a central that only needs those. A third characteristic reports
+ * how regular the sampling is and how often the CPU woke up for it.
  */
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 #include "led.h"
 #include "nordic_common.h"
-#include "app_timer.h"
-#include "softdevice_handler.h"
-#include "nrf_drv_adc.h"
 #include "app_util_platform.h"
+#include "softdevice_handler.h"
 
-#define ADC_BUFFER_SIZE 10                                /**< Size of buffer for ADC samples.  */
-static nrf_adc_value_t       adc_buffer[ADC_BUFFER_SIZE]; /**< ADC buffer. */
-static nrf_drv_adc_channel_t m_channel_config = NRF_DRV_ADC_DEFAULT_CHANNEL(NRF_ADC_CONFIG_INPUT_7); /**< Channel instance. Default configuration used. */
-
-#define LED 20
-
-// Some constants about timers
-#define ADC_TIMER_PRESCALER              0  // Value of the RTC1 PRESCALER register.
-#define ADC_TIMER_OP_QUEUE_SIZE          4  // Size of timer operation queues.
+#include "adc_stream.h"
+#include "dsp.h"
+#include "simple_adv.h"
+#include "simple_ble.h"
+#include "spsc_queue.h"
 
-// How long before the timer fires.
-#define ADC_TIMER_RATE     APP_TIMER_TICKS(500, ADC_TIMER_PRESCALER) // Blink every 0.5 seconds
+#define DEVICE_NAME "adc-test"
 
-// Timer data structure
-APP_TIMER_DEF(adc_timer);
+#define LED 20
 
-/**
- * @brief ADC interrupt handler.
- */
-static void adc_event_handler(nrf_drv_adc_evt_t const * p_event)
-{
-    if (p_event->type == NRF_DRV_ADC_EVT_DONE)
-    {
-        uint32_t i;
-        for (i = 0; i < p_event->data.done.size; i++)
-        {
-            if(p_event->data.done.p_buffer[i] > 512)
-                led_on(LED);
-            else
-                led_off(LED);
-            //NRF_LOG_PRINTF("Current sample value: %d\r\n", p_event->data.done.p_buffer[i]);
-        }
-    }
+#define ADC_INPUT        7
+#define ADC_RATE_HZ      1000
+#define ADC_BUFFER_LEN   100
+#ifdef NRF52
+#define ADC_HALF_SCALE   2048
+#else
+#define ADC_HALF_SCALE   512
+#endif
+
+// One notification: ten little endian 16 bit samples
+#define SAMPLES_PER_PACKET 10
+typedef struct {
+    int16_t samples[SAMPLES_PER_PACKET];
+} packet_t;
+
+static int16_t adc_buffers[2][ADC_BUFFER_LEN];
+
+// Samples wait here, from the ADC interrupt, until the radio can take them.
+// 64 packets is 0.64 s at 1 kHz.
+SPSC_QUEUE_DEFINE(packets, packet_t, 64);
+
+static volatile uint32_t dropped_packets = 0;
+static volatile bool new_buffer = false;
+static dsp_features_t features;
+
+static simple_ble_config_t ble_config = {
+    .platform_id       = 0x00,
+    .device_id         = DEVICE_ID_DEFAULT,
+    .adv_name          = DEVICE_NAME,
+    .adv_interval      = MSEC_TO_UNITS(500, UNIT_0_625_MS),
+    .min_conn_interval = MSEC_TO_UNITS(10, UNIT_1_25_MS),
+    .max_conn_interval = MSEC_TO_UNITS(20, UNIT_1_25_MS)
+};
+
+//  16-bit short uuid is 0xadc0 (bytes 12 and 13 of 128-bit UUID)
+static simple_ble_service_t adc_service = {
+    .uuid128 = {{0x3e, 0x1b, 0x49, 0x57, 0x0c, 0x2f, 0x4d, 0x8a,
+                 0x9b, 0x61, 0x52, 0x07, 0xc0, 0xad, 0x24, 0x6f}}
+};
+static simple_ble_char_t samples_char = {.uuid16 = 0xadc1};
+static simple_ble_char_t stats_char = {.uuid16 = 0xadc2};
+static simple_ble_char_t features_char = {.uuid16 = 0xadc3};
+
+static packet_t samples_value;
+static dsp_features_t features_value;
+static struct __attribute__ ((packed)) {
+    uint32_t samples;
+    uint32_t wakeups_per_1000;  // ADC interrupts per 1000 samples
+    uint32_t jitter_ns;         // spread of conversion times after their trigger
+    uint32_t overruns;
+    uint32_t dropped_packets;   // samples the radio did not keep up with, in tens
+} stats_value;
+
+void services_init (void) {
+    simple_ble_add_service(&adc_service);
+
+    simple_ble_add_characteristic(0, 0, 1, 0, // read, write, notify, vlen
+            sizeof(samples_value), (uint8_t*) &samples_value,
+            &adc_service, &samples_char);
+
+    simple_ble_add_characteristic(1, 0, 0, 0, // read, write, notify, vlen
+            sizeof(stats_value), (uint8_t*) &stats_value,
+            &adc_service, &stats_char);
+
+    simple_ble_add_characteristic(1, 0, 1, 0, // read, write, notify, vlen
+            sizeof(features_value), (uint8_t*) &features_value,
+            &adc_service, &features_char);
 }
 
-// Timer callback
-static void timer_handler (void* p_context) {
-    APP_ERROR_CHECK(nrf_drv_adc_buffer_convert(adc_buffer,ADC_BUFFER_SIZE));
-    uint32_t i;
-    for (i = 0; i < ADC_BUFFER_SIZE; i++)
-    {
-        // manually trigger ADC conversion
-        nrf_drv_adc_sample();
+// ADC interrupt: queue the buffer for the radio and summarize it
+static void samples_ready (const int16_t* samples, uint16_t count) {
+    for (uint16_t i = 0; i + SAMPLES_PER_PACKET <= count; i += SAMPLES_PER_PACKET) {
+        if (!spsc_queue_push(&packets, samples + i)) dropped_packets++;
     }
-}
-
-/**
- * @brief ADC initialization.
- */
-static void adc_config(void)
-{
-    ret_code_t ret_code;
-    nrf_drv_adc_config_t config = NRF_DRV_ADC_DEFAULT_CONFIG;
-
-    ret_code = nrf_drv_adc_init(&config, adc_event_handler);
-    APP_ERROR_CHECK(ret_code);
 
-    nrf_drv_adc_channel_enable(&m_channel_config);
+    dsp_features(samples, count, &features);
+    if (features.mean > ADC_HALF_SCALE) {
+        led_on(LED);
+    } else {
+        led_off(LED);
+    }
+    new_buffer = true;
 }
 
-// Setup timer
-static void timer_init(void)
-{
-    uint32_t err_code;
-
-    // Initialize timer module.
-    APP_TIMER_INIT(ADC_TIMER_PRESCALER,
-                   ADC_TIMER_OP_QUEUE_SIZE,
-                   false);
+// Notify until the SoftDevice is out of packets. TX_COMPLETE wakes the main
+// loop to carry on.
+static void send_samples (void) {
+    packet_t* packet;
 
-    // Create a timer
-    err_code = app_timer_create(&adc_timer,
-                                APP_TIMER_MODE_REPEATED,
-                                timer_handler);
-    APP_ERROR_CHECK(err_code);
+    while ((packet = spsc_queue_peek(&packets)) != NULL) {
+        memcpy(&samples_value, packet, sizeof(samples_value));
+        if (simple_ble_notify_char(&samples_char) == BLE_ERROR_NO_TX_PACKETS) return;
+        spsc_queue_drop(&packets);
+    }
 }
 
-// Start the blink timer
-static void timer_start(void) {
-    uint32_t err_code;
+static void update_stats (void) {
+    adc_stream_stats_t stats;
 
-    // Start application timers.
-    err_code = app_timer_start(adc_timer, ADC_TIMER_RATE, NULL);
-    APP_ERROR_CHECK(err_code);
+    adc_stream_get_stats(&stats);
+    stats_value.samples          = stats.samples;
+    stats_value.wakeups_per_1000 = stats.samples ? (uint64_t) stats.interrupts * 1000 / stats.samples : 0;
+    stats_value.jitter_ns        = (uint64_t) (stats.phase_max - stats.phase_min) * 1000000000 / stats.tick_hz;
+    stats_value.overruns         = stats.overruns;
+    stats_value.dropped_packets  = dropped_packets;
 }
 
 int main(void) {
+    uint32_t err_code;
 
     // Initialize.
     led_init(LED);
     led_off(LED);
 
-    adc_config();
-
-    // Need to set the clock to something
-    nrf_clock_lf_cfg_t clock_lf_cfg = {
-        .source        = NRF_CLOCK_LF_SRC_RC,
-        .rc_ctiv       = 16,
-        .rc_temp_ctiv  = 2,
-        .xtal_accuracy = NRF_CLOCK_LF_XTAL_ACCURACY_250_PPM};
-
-    // Initialize the SoftDevice handler module.
-    SOFTDEVICE_HANDLER_INIT(&clock_lf_cfg, NULL);
-
-    timer_init();
-    timer_start();
+    simple_ble_init(&ble_config);
+    simple_adv_only_name();
+
+    // The crystal, so that the sample rate is accurate
+    sd_clock_hfclk_request();
+
+    const adc_stream_config_t adc_config = {
+        .input          = ADC_INPUT,
+        .sample_rate_hz = ADC_RATE_HZ,
+        .irq_priority   = APP_IRQ_PRIORITY_LOW,
+        .buffers        = adc_buffers[0],
+        .buffer_len     = ADC_BUFFER_LEN,
+        .handler        = samples_ready,
+    };
+    err_code = adc_stream_init(&adc_config);
+    APP_ERROR_CHECK(err_code);
+    adc_stream_start();
 
     // Enter main loop.
     while (1) {
-        sd_app_evt_wait();
+        send_samples();
+        if (new_buffer) {
+            new_buffer = false;
+            update_stats();
+
+            // The next buffer, and so the next update, is 100 ms away
+            features_value = features;
+            simple_ble_notify_char(&features_char);
+        }
+        power_manage();
     }
 }
@@ -8,6 +8,8 @@
 #include "softdevice_handler.h"
 #include "nrf_drv_spi.h"
 #include "app_gpiote.h"
+#include "app_util_platform.h"
+#include "spi_bus.h"
 
 #include "board.h"
 #include "adxl362.h"
@@ -18,6 +20,7 @@
 #define ACCELEROMETER_INTERRUPT_PIN 5
 
 static nrf_drv_spi_t _spi = NRF_DRV_SPI_INSTANCE(SPI_INSTANCE);
+static spi_bus_t _spi_bus;
 
 app_gpiote_user_id_t gpiote_user_acc;
 
@@ -52,7 +55,8 @@ int main(void) {
     led_init(13);
     led_off(13);
 
-    adxl362_accelerometer_init(&_spi, adxl362_NOISE_NORMAL, true, false, false);
+    spi_bus_init(&_spi_bus, &_spi, APP_IRQ_PRIORITY_LOW, false);
+    adxl362_accelerometer_init(&_spi_bus, adxl362_NOISE_NORMAL, true, false, false);
 
     uint16_t act_thresh = 0x0222;
     adxl362_set_activity_threshold(act_thresh);
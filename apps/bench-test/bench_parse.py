@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""Read the results lib/bench.c reports, and compare two runs.
+
+    bench_parse.py run.log              min, median and max of each benchmark
+    bench_parse.py old.log new.log      median change from old to new
+
+The log is whatever came over RTT (JLinkRTTLogger, or JLinkRTTClient's
+output saved to a file) or from a BENCH_HOST build; lines that aren't
+results are skipped. When comparing, a median more than --threshold percent
+slower is a regression, and the exit status is 1 if there was any.
+"""
+
+import argparse
+import re
+import sys
+
+LINE = re.compile(r'(bench-start|bench-end|bench),(.*)$')
+
+
+class Run:
+    def __init__(self, path):
+        self.path = path
+        self.platforms = set()
+        self.benches = {}           # name -> (iterations, min, median, max) in cycles
+        self.clock_hz = {}          # name -> clock the cycles are of
+
+        clock_hz = None
+        with open(path, errors='replace') as f:
+            for text in f:
+                match = LINE.search(text.rstrip('\r\n'))
+                if not match:
+                    continue
+                kind, fields = match.group(1), match.group(2).split(',')
+                try:
+                    if kind == 'bench-start':
+                        self.platforms.add(fields[0])
+                        clock_hz = int(fields[1])
+                    elif kind == 'bench' and clock_hz:
+                        name = fields[0]
+                        values = tuple(int(v) for v in fields[1:5])
+                        if len(values) == 4:
+                            self.benches[name] = values
+                            self.clock_hz[name] = clock_hz
+                except (IndexError, ValueError):
+                    # A line cut short, RTT drops the rest when it overflows
+                    continue
+
+    def us(self, name, index):
+        return self.benches[name][index] * 1e6 / self.clock_hz[name]
+
+
+def show(run):
+    print('{:<20} {:>6} {:>12} {:>12} {:>12} {:>10}'.format(
+        'benchmark', 'n', 'min', 'median', 'max', 'median us'))
+    for name, (n, lo, median, hi) in run.benches.items():
+        print('{:<20} {:>6} {:>12} {:>12} {:>12} {:>10.2f}'.format(
+            name, n, lo, median, hi, run.us(name, 2)))
+
+
+def compare(old, new, threshold):
+    regressions = 0
+
+    if old.platforms != new.platforms:
+        print('note: comparing {} with {}, in microseconds'.format(
+            '/'.join(sorted(old.platforms)), '/'.join(sorted(new.platforms))))
+
+    print('{:<20} {:>12} {:>12} {:>9}'.format('benchmark', 'old us', 'new us', 'change'))
+    for name in list(old.benches) + [n for n in new.benches if n not in old.benches]:
+        if name not in new.benches:
+            print('{:<20} {:>12.2f} {:>12} {:>9}'.format(name, old.us(name, 2), '-', 'gone'))
+            continue
+        if name not in old.benches:
+            print('{:<20} {:>12} {:>12.2f} {:>9}'.format(name, '-', new.us(name, 2), 'new'))
+            continue
+
+        before, after = old.us(name, 2), new.us(name, 2)
+        change = (after - before) * 100 / before if before else 0.0
+        mark = ''
+        if change > threshold:
+            mark = '  slower'
+            regressions += 1
+        elif change < -threshold:
+            mark = '  faster'
+        print('{:<20} {:>12.2f} {:>12.2f} {:>+8.1f}%{}'.format(name, before, after, change, mark))
+
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('logs', nargs='+', metavar='log', help='one run to show, or two to compare')
+    parser.add_argument('--threshold', type=float, default=5.0,
+                        help='percent change in a median that counts (default 5)')
+    args = parser.parse_args()
+
+    if len(args.logs) > 2:
+        parser.error('at most two logs')
+
+    runs = [Run(path) for path in args.logs]
+    for run in runs:
+        if not run.benches:
+            sys.exit('{}: no benchmark results'.format(run.path))
+
+    if len(runs) == 1:
+        show(runs[0])
+        return 0
+    return 1 if compare(runs[0], runs[1], args.threshold) else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,136 @@
+/*
+ * Library benchmarks that need no peripherals. main.c runs them on the
+ * chip; built with BENCH_HOST this file runs them natively on its own:
+ *
+ *   bench_host > host.log
+ *   ./bench_parse.py host.log
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "bench.h"
+#include "benches.h"
+#include "dsp.h"
+#include "nmea.h"
+#include "qrencode.h"
+#include "simple_logger_compress.h"
+#include "tcmp441_blit.h"
+
+#define QR_URL "https://lab11.eecs.umich.edu"
+
+// A corner of the TCM-P441, big enough for QR_URL at scale 3
+#define FB_WIDTH  128
+#define FB_HEIGHT 128
+
+static const char rmc[] =
+    "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n";
+
+static const char log_line[] =
+    "1490000000,0.982,-0.014,0.051,23.41,1013.2,48.7,3.31\n";
+
+/****** NMEA ******/
+
+static nmea_parser_t parser;
+
+static void nmea_setup (void* context) {
+    nmea_init(&parser, NULL, NULL);
+}
+
+static void nmea_run (void* context) {
+    nmea_parse(&parser, rmc, sizeof(rmc) - 1);
+}
+
+/****** DSP ******/
+
+#define FIR_TAPS    16
+#define FIR_SAMPLES 64
+#define FFT_SIZE    128
+
+static q15_t samples[FFT_SIZE] __attribute__ ((aligned (4)));
+static q15_t filtered[FIR_SAMPLES];
+static q15_t fir_coeffs[FIR_TAPS];
+static q15_t fir_state[DSP_FIR_STATE_LEN(FIR_TAPS)];
+static dsp_fir_t fir;
+
+// A ramp, nothing special about it
+static void dsp_setup (void* context) {
+    for (uint16_t i = 0; i < FFT_SIZE; i++) {
+        samples[i] = (q15_t)(i * 397 - 20000);
+    }
+    for (uint16_t i = 0; i < FIR_TAPS; i++) {
+        fir_coeffs[i] = DSP_Q15_MAX / FIR_TAPS;
+    }
+    dsp_fir_init(&fir, fir_coeffs, FIR_TAPS, 1, fir_state);
+}
+
+static void fir_run (void* context) {
+    dsp_fir(&fir, samples, FIR_SAMPLES, filtered);
+}
+
+static void fft_run (void* context) {
+    dsp_rfft(samples, FFT_SIZE);
+}
+
+/****** Logger compression ******/
+
+static simple_logger_lz_t lz;
+static uint32_t compressed;
+
+static int count_bytes (void* context, const uint8_t* data, uint32_t len) {
+    compressed += len;
+    return 0;
+}
+
+static void lz_setup (void* context) {
+    simple_logger_lz_reset(&lz, count_bytes, NULL);
+    simple_logger_lz_encode(&lz, (const uint8_t*) log_line, sizeof(log_line) - 1);
+}
+
+// A line like the one before it, as a log mostly is
+static void lz_run (void* context) {
+    simple_logger_lz_encode(&lz, (const uint8_t*) log_line, sizeof(log_line) - 1);
+    simple_logger_lz_flush(&lz);
+}
+
+/****** QR codes ******/
+
+static QRcode* qr;
+static uint8_t fb_buf[FB_WIDTH / 8 * FB_HEIGHT];
+static tcmp441_fb_t fb = {fb_buf, NULL, FB_WIDTH, FB_HEIGHT, FB_WIDTH / 8};
+
+static void qr_encode_run (void* context) {
+    qr = QRcode_encodeString(QR_URL, 0, QR_ECLEVEL_M, QR_MODE_8, 1);
+    QRcode_free(qr);
+    qr = NULL;
+}
+
+static void qr_render_setup (void* context) {
+    if (qr == NULL) {
+        qr = QRcode_encodeString(QR_URL, 0, QR_ECLEVEL_M, QR_MODE_8, 1);
+    }
+    memset(fb_buf, 0, sizeof(fb_buf));
+}
+
+static void qr_render_run (void* context) {
+    if (qr) tcmp441_blit_qr(&fb, 0, 0, qr->data, qr->width, 3, 2);
+}
+
+const bench_t library_benches[] = {
+    {"nmea_rmc",       nmea_setup,      nmea_run,      NULL, 0},
+    {"dsp_fir_16x64",  dsp_setup,       fir_run,       NULL, 0},
+    {"dsp_rfft_128",   dsp_setup,       fft_run,       NULL, 0},
+    {"lz_log_line",    lz_setup,        lz_run,        NULL, 0},
+    {"qr_encode",      NULL,            qr_encode_run, NULL, 16},
+    {"qr_render",      qr_render_setup, qr_render_run, NULL, 16},
+};
+
+const uint16_t num_library_benches = sizeof(library_benches) / sizeof(library_benches[0]);
+
+#ifdef BENCH_HOST
+int main (void) {
+    if (!bench_init()) return 1;
+    bench_run(library_benches, num_library_benches);
+    return 0;
+}
+#endif
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "bench.h"
+
+// Benchmarks of code that needs no peripherals, the same on the chip and
+// the host
+extern const bench_t library_benches[];
+extern const uint16_t num_library_benches;
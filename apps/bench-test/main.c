@@ -0,0 +1,109 @@
+/*
+ * Cycle counts of library hot paths, streamed over RTT.
+ *  Runs the benchmarks in benches.c, then the ones that need the
+ *  SoftDevice or a peripheral: advertisement encoding and SPI transfers.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ble_advdata.h"
+#include "app_util_platform.h"
+#include "nordic_common.h"
+#include "nrf_drv_spi.h"
+
+#include "simple_ble.h"
+#include "spi_bus.h"
+#include "bench.h"
+#include "benches.h"
+
+// Nothing needs to be on the SPI bus, the transfers time the same
+#define SPI_SCK_PIN  2
+#define SPI_MOSI_PIN 3
+#define SPI_MISO_PIN 4
+#define SPI_CS_PIN   5
+
+// Intervals for advertising and connections
+static simple_ble_config_t ble_config = {
+    .platform_id       = 0x00,              // used as 4th octect in device BLE address
+    .device_id         = DEVICE_ID_DEFAULT,
+    .adv_name          = "BENCH",           // used in advertisements if there is room
+    .adv_interval      = MSEC_TO_UNITS(500, UNIT_0_625_MS),
+    .min_conn_interval = MSEC_TO_UNITS(500, UNIT_1_25_MS),
+    .max_conn_interval = MSEC_TO_UNITS(1000, UNIT_1_25_MS)
+};
+
+/****** Advertisement encoding ******/
+
+static uint8_t manuf[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+// Encoded and handed to the SoftDevice, but never started, so the radio
+// stays out of the numbers
+static void adv_name_run (void* context) {
+    ble_advdata_t advdata;
+
+    memset(&advdata, 0, sizeof(advdata));
+    advdata.name_type = BLE_ADVDATA_FULL_NAME;
+    advdata.flags     = BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE;
+    ble_advdata_set(&advdata, NULL);
+}
+
+static void adv_manuf_run (void* context) {
+    ble_advdata_t advdata;
+    ble_advdata_manuf_data_t manuf_data = {0x02E0, {sizeof(manuf), manuf}};
+
+    memset(&advdata, 0, sizeof(advdata));
+    advdata.name_type             = BLE_ADVDATA_FULL_NAME;
+    advdata.flags                 = BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE;
+    advdata.p_manuf_specific_data = &manuf_data;
+    ble_advdata_set(&advdata, NULL);
+}
+
+/****** SPI ******/
+
+static spi_bus_t spi_bus;
+static nrf_drv_spi_t spi0 = NRF_DRV_SPI_INSTANCE(0);
+static spi_bus_device_t spi_device = {
+    .sck_pin   = SPI_SCK_PIN,
+    .mosi_pin  = SPI_MOSI_PIN,
+    .miso_pin  = SPI_MISO_PIN,
+    .cs_pin    = SPI_CS_PIN,
+    .frequency = NRF_DRV_SPI_FREQ_8M,
+    .mode      = NRF_DRV_SPI_MODE_0,
+    .bit_order = NRF_DRV_SPI_BIT_ORDER_MSB_FIRST,
+};
+static uint8_t spi_tx[32];
+static uint8_t spi_rx[32];
+
+// Bytes per transfer in the context
+static void spi_run (void* context) {
+    uint8_t len = (uint8_t)(uintptr_t) context;
+
+    spi_bus_transfer(&spi_device, spi_tx, len, spi_rx, len);
+}
+
+static const bench_t chip_benches[] = {
+    {"adv_name",       NULL, adv_name_run,  NULL,       0},
+    {"adv_name_manuf", NULL, adv_manuf_run, NULL,       0},
+    {"spi_1B_8MHz",    NULL, spi_run,       (void*) 1,  0},
+    {"spi_32B_8MHz",   NULL, spi_run,       (void*) 32, 0},
+};
+
+int main (void) {
+    // The SoftDevice, for ble_advdata_set(). No advertising.
+    simple_ble_init(&ble_config);
+
+    spi_bus_init(&spi_bus, &spi0, APP_IRQ_PRIORITY_LOW, false);
+    spi_bus_add_device(&spi_bus, &spi_device);
+
+    if (bench_init()) {
+        bench_run(library_benches, num_library_benches);
+        bench_run(chip_benches, sizeof(chip_benches) / sizeof(chip_benches[0]));
+        bench_print("done");
+    }
+
+    while (1) {
+        power_manage();
+    }
+}
@@ -1,58 +1,69 @@
 /* Test interrupt on a pin
+ *
+ * The pin is watched with pin_input: the chip sleeps on the GPIO SENSE
+ * mechanism, and presses arrive debounced, after the contact has settled.
  */
 
 #include <stdbool.h>
 #include <stdint.h>
 #include "led.h"
+#include "pin_group.h"
+#include "pin_input.h"
 #include "nordic_common.h"
 #include "softdevice_handler.h"
-#include "nrf_drv_gpiote.h"
-#include "simple_ble.h"
+#include "app_timer.h"
+#include "app_error.h"
 
 
 // Setup LEDs correctly for the platform
 #define LED_RED 18
 #define LED_BLUE 19
 
+static const pin_group_t leds = LED_GROUP(LED_RED, LED_BLUE);
+
 // Interrupt pin number
 #define INTERRUPT_PIN 23
 
-static void interrupt_handler (nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action) {
-    if (pin == INTERRUPT_PIN) {
-        led_toggle(LED_BLUE);
+static const pin_input_config_t inputs[] = {
+    {INTERRUPT_PIN, NRF_GPIO_PIN_PULLUP, 20},
+};
+
+// Called with every change that settled since the last call
+static void input_handler (const pin_input_event_t* events, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        if (events[i].pin == INTERRUPT_PIN && events[i].level == 0) {
+            led_toggle(LED_BLUE);
+        }
     }
 }
 
 int main (void) {
     uint32_t err_code;
 
-    // Initialize.
-    led_init(LED_RED);
-    led_init(LED_BLUE);
-    led_off(LED_RED);
-
-    // Initialize GPIOTE driver
-    // configuration values can be found in nrf_drv_config.h under GPIOTE_ENABLED
-    if (!nrf_drv_gpiote_is_init()) {
-        err_code = nrf_drv_gpiote_init();
-        if (err_code != NRF_SUCCESS) {
-            led_on(LED_RED);
-        }
-    }
+    // Initialize. Both LEDs off in one write.
+    pin_group_init(&leds);
+
+    // Need to set the clock to something
+    nrf_clock_lf_cfg_t clock_lf_cfg = {
+        .source        = NRF_CLOCK_LF_SRC_RC,
+        .rc_ctiv       = 16,
+        .rc_temp_ctiv  = 2,
+        .xtal_accuracy = NRF_CLOCK_LF_XTAL_ACCURACY_250_PPM};
+
+    // Initialize the SoftDevice handler module.
+    SOFTDEVICE_HANDLER_INIT(&clock_lf_cfg, NULL);
+
+    // The debounce timer is an app_timer
+    APP_TIMER_INIT(0, 3, NULL);
 
-    // Initialize interrupt on pin INTERRUPT_PIN.
-    nrf_drv_gpiote_in_config_t test_config = GPIOTE_CONFIG_IN_SENSE_HITOLO(false);
-    test_config.pull = NRF_GPIO_PIN_PULLUP;
-    err_code = nrf_drv_gpiote_in_init(INTERRUPT_PIN, &test_config, interrupt_handler);
+    // Watch the pin, 20 ms debounce
+    err_code = pin_input_init(inputs, 1, input_handler);
     if (err_code != NRF_SUCCESS) {
         led_on(LED_RED);
     }
-    
-    // And enable the interrupt
-    nrf_drv_gpiote_in_event_enable(INTERRUPT_PIN, true);
 
     // Enter main loop.
     while (1) {
-        power_manage();
+        sd_app_evt_wait();
     }
 }
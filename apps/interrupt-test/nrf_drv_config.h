@@ -20,7 +20,7 @@
 #define CLOCK_CONFIG_IRQ_PRIORITY       APP_IRQ_PRIORITY_LOW
 
 /* GPIOTE */
-#define GPIOTE_ENABLED 1
+#define GPIOTE_ENABLED 0
 
 #if (GPIOTE_ENABLED == 1)
 #define GPIOTE_CONFIG_USE_SWI_EGU false
@@ -1,42 +1,18 @@
-/* PWM an LED.
+/* Breathe an LED with the PWM done in hardware.
  */
 
 #include <stdbool.h>
 #include <stdint.h>
-#include "led.h"
 #include "nordic_common.h"
 #include "softdevice_handler.h"
-#include "low_power_pwm.h"
+#include "app_timer.h"
+#include "led_pattern.h"
 
 // Need pin number for LED
 #define LED0 13
 
-static low_power_pwm_t pwm;
-
-void pwm_init () {
-    uint32_t err_code;
-    low_power_pwm_config_t low_power_pwm_config;
-
-    APP_TIMER_DEF(timer);
-    low_power_pwm_config.active_high = false;
-    low_power_pwm_config.period = 255;
-    low_power_pwm_config.bit_mask = 1 << LED0;
-    low_power_pwm_config.p_timer_id = &timer;
-
-    err_code = low_power_pwm_init(&pwm, &low_power_pwm_config, NULL);
-    APP_ERROR_CHECK(err_code);
-    err_code = low_power_pwm_duty_set(&pwm, 10);
-    APP_ERROR_CHECK(err_code);
-
-    err_code = low_power_pwm_start(&pwm, pwm.bit_mask);
-    APP_ERROR_CHECK(err_code);
-}
-
 int main(void) {
-
-    // Initialize.
-    led_init(LED0);
-    led_off(LED0);
+    uint32_t err_code;
 
     // Need to set the clock to something
     nrf_clock_lf_cfg_t clock_lf_cfg = {
@@ -51,7 +27,12 @@ int main(void) {
     // Start APP_TIMER to generate timeouts.
     APP_TIMER_INIT(0, 3, NULL);
 
-    pwm_init();
+    // The pattern plays with TIMER2, GPIOTE and PPI, and the app_timer only
+    // fires when the brightness changes
+    err_code = led_pattern_init(LED0);
+    APP_ERROR_CHECK(err_code);
+    err_code = led_pattern_play(&led_pattern_breathe);
+    APP_ERROR_CHECK(err_code);
 
     // Enter main loop.
     while (1) {
@@ -1,6 +1,7 @@
 /*
  * Create an example service for providing 4 bytes of random data 
- *  Demonstrates use of RNG
+ *  Demonstrates use of the rand library: random bytes without waiting on
+ *  the RNG, and how long getting them takes
  */
 
 // Global libraries
@@ -14,7 +15,8 @@
 #include "simple_adv.h"
 #include "led.h"
 #include "device_info_service.h"
-#include "nrf_drv_rng.h"
+#include "nrf_timer.h"
+#include "rand.h"
 
 // Define constants about this beacon.
 #define DEVICE_NAME "RANDOM"
@@ -25,6 +27,10 @@
 // Length of random data to notify
 #define RAND_NOTIFY_LEN 4
 
+// Generated in requests of RAND_BURST_LEN to measure throughput
+#define RAND_BURST_BYTES 8192
+#define RAND_BURST_LEN   256
+
 // Intervals for advertising and connections
 static simple_ble_config_t ble_config = {
     .platform_id       = 0x00,              // used as 4th octect in device BLE address
@@ -44,9 +50,20 @@ static simple_ble_service_t rand_service = {
 };
 static simple_ble_char_t rand_update_char = {.uuid16 = 0xdc37};
 static simple_ble_char_t rand_notify_char = {.uuid16 = 0xdc38};
+static simple_ble_char_t rand_stats_char = {.uuid16 = 0xdc39};
 static uint8_t random [RAND_NOTIFY_LEN] = {0x76, 0x54, 0x32, 0x10};
 static uint8_t rand_update_value = 0;
 
+// What getting random bytes costs, measured on this chip
+static struct {
+    uint32_t bytes_per_sec;     // in RAND_BURST_LEN requests, 0 until measured
+    uint32_t notify_max_us;     // slowest RAND_NOTIFY_LEN request
+    uint32_t notify_last_us;
+    uint32_t requests;
+    uint32_t not_ready;         // requests before the first seed
+    uint32_t reseeds;
+} __attribute__ ((packed)) rand_stats;
+
 void ble_error(uint32_t error_code) {
   led_on(LED0);
 }
@@ -65,18 +82,74 @@ void services_init (void) {
     simple_ble_add_characteristic(1, 0, 1, 0, // read, write, notify, vlen
             RAND_NOTIFY_LEN, (uint8_t *) random,
             &rand_service, &rand_notify_char);
+
+    // add stats characteristic
+    simple_ble_add_characteristic(1, 0, 0, 0, // read, write, notify, vlen
+            sizeof(rand_stats), (uint8_t *) &rand_stats,
+            &rand_service, &rand_stats_char);
+}
+
+// Microseconds from TIMER1, which is 16 bit on the nRF51: enough for one
+// request
+static uint16_t clock_us (void) {
+    nrf_timer_task_trigger(NRF_TIMER1, NRF_TIMER_TASK_CAPTURE0);
+    return nrf_timer_cc_read(NRF_TIMER1, NRF_TIMER_CC_CHANNEL0);
+}
+
+static void clock_init (void) {
+    nrf_timer_mode_set(NRF_TIMER1, NRF_TIMER_MODE_TIMER);
+    nrf_timer_bit_width_set(NRF_TIMER1, NRF_TIMER_BIT_WIDTH_16);
+    nrf_timer_frequency_set(NRF_TIMER1, NRF_TIMER_FREQ_1MHz);
+    nrf_timer_task_trigger(NRF_TIMER1, NRF_TIMER_TASK_START);
+}
+
+// Once, when the generator is first seeded
+static void measure_throughput (void) {
+    static uint8_t burst[RAND_BURST_LEN];
+    uint32_t total_us = 0;
+
+    for (uint32_t done = 0; done < RAND_BURST_BYTES; done += RAND_BURST_LEN) {
+        uint16_t start = clock_us();
+        rand_get(burst, RAND_BURST_LEN);
+        total_us += (uint16_t)(clock_us() - start);
+    }
+    rand_stats.bytes_per_sec = (uint64_t) RAND_BURST_BYTES * 1000000 / total_us;
+}
+
+static void update_stats (void) {
+    rand_stats_t stats;
+
+    rand_get_stats(&stats);
+    rand_stats.reseeds = stats.reseeds;
 }
 
 void ble_evt_write(ble_evt_t* p_ble_evt) {
 
     if (simple_ble_is_char_event(p_ble_evt, &rand_update_char)) {
         // user wrote to rand characteristic
-        // use the blocking function to ensure randomness
-        nrf_drv_rng_block_rand(random, RAND_NOTIFY_LEN);
-        
+        // never waits for the RNG, but fails until there was enough
+        // entropy for the first seed
+        uint16_t start = clock_us();
+        bool ready = rand_get(random, RAND_NOTIFY_LEN);
+        uint16_t elapsed = clock_us() - start;
+
+        rand_stats.requests++;
+        if (!ready) {
+            rand_stats.not_ready++;
+            update_stats();
+            return;
+        }
+        rand_stats.notify_last_us = elapsed;
+        if (elapsed > rand_stats.notify_max_us) {
+            rand_stats.notify_max_us = elapsed;
+        }
+        if (rand_stats.bytes_per_sec == 0) {
+            measure_throughput();
+        }
+        update_stats();
+
         // notify new random value
         simple_ble_notify_char(&rand_notify_char);
-
     }
 }
 
@@ -88,8 +161,9 @@ int main(void) {
     simple_ble_init(&ble_config);
     led_init(LED0);
    
-    // initialize rng
-    nrf_drv_rng_init(NULL);
+    // start collecting entropy, after the SoftDevice is up
+    rand_init();
+    clock_init();
 
     // Advertise name
     simple_adv_only_name();
@@ -2,61 +2,68 @@
 #include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
-#include <stdio.h>
-#include "app_uart.h"
 #include "app_error.h"
+#include "app_util_platform.h"
 #include "nrf_delay.h"
 #include "nrf_drv_config.h"
+#include "nrf_timer.h"
 
+#include "console.h"
 #include "led.h"
+#include "uart_stream.h"
 
 #define LED0 13
 
-#define MAX_TEST_DATA_BYTES  (15U)
-#define UART_TX_BUF_SIZE     256
-#define UART_RX_BUF_SIZE     256
+// Received frames wait here until the main loop gets to them
+#define UART_BUFFERS     4
+#define UART_BUFFER_SIZE 64
+static uint8_t uart_buffers[UART_BUFFERS][UART_BUFFER_SIZE];
 
-#define CMD_BUFFER_LEN 256
-char cmd_buf[CMD_BUFFER_LEN];
-int cmd_index = 0;
+static console_t console;
 
-void check_cmd () {
-    if (strncmp(cmd_buf, "on", CMD_BUFFER_LEN) == 0) {
-        led_on(LED0);
-    } else if (strncmp(cmd_buf, "off", CMD_BUFFER_LEN) == 0) {
-        led_off(LED0);
-    }
+static void cmd_on (console_t* c, const console_arg_t* args, uint8_t argc) {
+    led_on(LED0);
 }
 
-void uart_error_handle (app_uart_evt_t * p_event) {
-    if (p_event->evt_type == APP_UART_COMMUNICATION_ERROR) {
-        // ignore
-    } else if (p_event->evt_type == APP_UART_FIFO_ERROR) {
-        // ignore
-    } else if (p_event->evt_type == APP_UART_DATA_READY) {
-
-        // Read the UART character
-        char cr;
-        app_uart_get((uint8_t*) &cr);
-        app_uart_put(cr);
-
-        // Check array bounds
-        if (cmd_index > 255) {
-            cmd_index = 0;
-        }
+static void cmd_off (console_t* c, const console_arg_t* args, uint8_t argc) {
+    led_off(LED0);
+}
 
-        // Check character
-        if (cr == '\r') {
-            // ignore
-        } else if (cr == '\n') {
-            cmd_buf[cmd_index] = '\0';
-            cmd_index = 0;
-            check_cmd();
-        } else {
-            cmd_buf[cmd_index] = cr;
-            cmd_index++;
-        }
-    }
+static void cmd_toggle (console_t* c, const console_arg_t* args, uint8_t argc) {
+    led_toggle(LED0);
+}
+
+static const console_command_t commands[] = {
+    {"on",     cmd_on,     "", "turn the LED on"},
+    {"off",    cmd_off,    "", "turn the LED off"},
+    {"toggle", cmd_toggle, "", "toggle the LED"},
+    CONSOLE_BUILTIN_COMMANDS,
+};
+
+static uint16_t uart_write (void* ctx, const uint8_t* data, uint16_t len) {
+    uart_stream_write(data, len);
+    return len;
+}
+
+// Microseconds from TIMER1, which is 16 bit on the nRF51. Wraps are counted
+// when they are seen, which is enough to time one command.
+static uint32_t clock_us (void) {
+    static uint32_t high = 0;
+    static uint16_t last = 0;
+    uint16_t now;
+
+    nrf_timer_task_trigger(NRF_TIMER1, NRF_TIMER_TASK_CAPTURE0);
+    now = nrf_timer_cc_read(NRF_TIMER1, NRF_TIMER_CC_CHANNEL0);
+    if (now < last) high += 0x10000;
+    last = now;
+    return high | now;
+}
+
+static void clock_init (void) {
+    nrf_timer_mode_set(NRF_TIMER1, NRF_TIMER_MODE_TIMER);
+    nrf_timer_bit_width_set(NRF_TIMER1, NRF_TIMER_BIT_WIDTH_16);
+    nrf_timer_frequency_set(NRF_TIMER1, NRF_TIMER_FREQ_1MHz);
+    nrf_timer_task_trigger(NRF_TIMER1, NRF_TIMER_TASK_START);
 }
 
 int main (void) {
@@ -64,23 +71,31 @@ int main (void) {
     led_off(LED0);
 
     uint32_t err_code;
-    const app_uart_comm_params_t comm_params = {
-          RX_PIN_NUMBER,
-          TX_PIN_NUMBER,
-          0,
-          0,
-          APP_UART_FLOW_CONTROL_DISABLED,
-          false,
-          UART_BAUDRATE_BAUDRATE_Baud115200
-      };
-
-    APP_UART_FIFO_INIT(&comm_params,
-                         UART_RX_BUF_SIZE,
-                         UART_TX_BUF_SIZE,
-                         uart_error_handle,
-                         APP_IRQ_PRIORITY_LOW,
-                         err_code);
+    const uart_stream_config_t uart_config = {
+        .rx_pin          = RX_PIN_NUMBER,
+        .tx_pin          = TX_PIN_NUMBER,
+        .baudrate        = UART_BAUDRATE_BAUDRATE_Baud115200,
+        .irq_priority    = APP_IRQ_PRIORITY_LOW,
+        .idle_timeout_us = 1000,
+        .buffers         = uart_buffers[0],
+        .buffer_size     = UART_BUFFER_SIZE,
+        .num_buffers     = UART_BUFFERS,
+    };
+
+    err_code = uart_stream_init(&uart_config);
     APP_ERROR_CHECK(err_code);
 
-    while (true) { }
+    clock_init();
+    console_init(&console, commands, CONSOLE_NUM_COMMANDS(commands), uart_write, NULL);
+    console.clock = clock_us;
+    console.echo  = true;
+
+    while (true) {
+        uart_stream_frame_t frame;
+        while (uart_stream_get(&frame)) {
+            console_input(&console, (const char*) frame.data, frame.len);
+            uart_stream_release();
+        }
+        __WFE();
+    }
 }
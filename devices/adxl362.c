@@ -7,6 +7,7 @@
 #include "nrf_gpio.h"
 #include "app_util_platform.h"
 #include "nrf_drv_spi.h"
+#include "spi_bus.h"
 
 #include "board.h"
 
@@ -72,20 +73,23 @@
 #define WRITE_REG 0x0A
 #define READ_REG  0x0B
 
-static nrf_drv_spi_t* _spi;
-
-static void spi_init () {
-	uint32_t err;
+static spi_bus_device_t _spi;
 
+static void spi_init (spi_bus_t* bus) {
 	// Get some default settings
 	nrf_drv_spi_config_t spi_config = NRF_DRV_SPI_DEFAULT_CONFIG(SPI_INSTANCE);
-	spi_config.frequency = NRF_DRV_SPI_FREQ_1M;
+
+	_spi.sck_pin   = spi_config.sck_pin;
+	_spi.mosi_pin  = spi_config.mosi_pin;
+	_spi.miso_pin  = spi_config.miso_pin;
+	_spi.orc       = spi_config.orc;
+	_spi.mode      = spi_config.mode;
+	_spi.bit_order = spi_config.bit_order;
+	_spi.frequency = NRF_DRV_SPI_FREQ_1M;
 	// We do need CS pin
-	spi_config.ss_pin = ADXL362_CS_PIN;
+	_spi.cs_pin = ADXL362_CS_PIN;
 
-	// We want blocking mode
-	err = nrf_drv_spi_init(_spi, &spi_config, NULL);
-	APP_ERROR_CHECK(err);
+	spi_bus_add_device(bus, &_spi);
 }
 
 static void spi_write_reg (uint8_t reg_addr, uint8_t* data, uint8_t num_bytes) {
@@ -100,7 +104,7 @@ static void spi_write_reg (uint8_t reg_addr, uint8_t* data, uint8_t num_bytes) {
 	memcpy(buf+2, data, num_bytes);
 
 	// And write to the chip
-	nrf_drv_spi_transfer(_spi, buf, num_bytes+2, NULL, 0);
+	spi_bus_transfer(&_spi, buf, num_bytes+2, NULL, 0);
 }
 
 void spi_read_reg (uint8_t reg_addr, uint8_t* data, uint8_t num_bytes) {
@@ -114,7 +118,7 @@ void spi_read_reg (uint8_t reg_addr, uint8_t* data, uint8_t num_bytes) {
 	out[1] = reg_addr;
 
 	// Do the transfer
-	nrf_drv_spi_transfer(_spi, out, 2, in, num_bytes+2);
+	spi_bus_transfer(&_spi, out, 2, in, num_bytes+2);
 
 	// And setup return buffer
 	memcpy(data, in+2, num_bytes);
@@ -348,15 +352,13 @@ void adxl362_sample_accel_byte (uint8_t* x_data, uint8_t* y_data, uint8_t* z_dat
 }
 
 // If measure = 0 standby mode, if measure = 1, measurement mode
-void adxl362_accelerometer_init (nrf_drv_spi_t* spi,
+void adxl362_accelerometer_init (spi_bus_t* bus,
                                  adxl362_noise_mode n_mode,
                                  bool measure,
                                  bool autosleep_en,
                                  bool wakeup_en) {
 
-	_spi = spi;
-
-	spi_init();
+	spi_init(bus);
 
     // send a soft reset to the accelerometer
     uint8_t data[1] = {RESET_CODE};
@@ -2,7 +2,7 @@
 
 #include <stdint.h>
 
-#include "nrf_drv_spi.h"
+#include "spi_bus.h"
 
 typedef enum {
     adxl362_DISABLE_FIFO,
@@ -42,7 +42,7 @@ typedef struct {
 
 } adxl362_interrupt_map_t;
 
-void adxl362_accelerometer_init(nrf_drv_spi_t* spi,
+void adxl362_accelerometer_init(spi_bus_t* bus,
                                 adxl362_noise_mode n_mode,
                                 bool measure,
                                 bool autosleep_en,
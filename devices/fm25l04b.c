@@ -4,34 +4,54 @@
 #include "nrf_drv_spi.h"
 #include "app_util_platform.h"
 
+#include "spi_bus.h"
 #include "fm25l04b.h"
 
+// nrf_drv_spi transfers are limited to 255 bytes, so a full 512 byte access
+// is a header followed by up to three data segments.
+#define MAX_CHUNK    255
+#define MAX_SEGMENTS (1 + (FM25L04B_SIZE + MAX_CHUNK - 1) / MAX_CHUNK)
 
-static void spi_init (fm25l04b_t* dev) {
-    uint32_t err;
+// Split buf into segments after the header segment. Returns the total
+// number of segments.
+static uint8_t build_segments (spi_bus_segment_t* segs, uint8_t* buf, uint16_t len, bool read) {
+    uint8_t n = 1;
+
+    while (len > 0 && n < MAX_SEGMENTS) {
+        uint8_t chunk = (len > MAX_CHUNK) ? MAX_CHUNK : len;
+
+        segs[n].tx     = read ? NULL : buf;
+        segs[n].tx_len = read ? 0 : chunk;
+        segs[n].rx     = read ? buf : NULL;
+        segs[n].rx_len = read ? chunk : 0;
 
-    // Configure !CS pin
-    nrf_gpio_cfg_output(dev->ss_pin);
-    nrf_gpio_pin_set(dev->ss_pin);
-
-    // Un init the SPI just in case. It doesn't like being re-inited.
-    nrf_drv_spi_uninit(dev->spi);
-
-    nrf_drv_spi_config_t spi_config = {
-        .sck_pin      = dev->sck_pin,
-        .mosi_pin     = dev->mosi_pin,
-        .miso_pin     = dev->miso_pin,
-        .ss_pin       = 0,
-        .irq_priority = APP_IRQ_PRIORITY_LOW,
-        .orc          = 0xff,
-        .frequency    = NRF_DRV_SPI_FREQ_1M,
-        .mode         = NRF_DRV_SPI_MODE_3,
-        .bit_order    = NRF_DRV_SPI_BIT_ORDER_MSB_FIRST
-    };
-
-    // We want blocking mode
-    err = nrf_drv_spi_init(dev->spi, &spi_config, NULL);
-    APP_ERROR_CHECK(err);
+        buf += chunk;
+        len -= chunk;
+        n++;
+    }
+
+    return n;
+}
+
+/**
+ * \brief         Register the FRAM chip with its SPI bus.
+ *
+ *                Must be called once before reading or writing. The bus
+ *                only reconfigures the SPI peripheral if another device with
+ *                different settings used it in between.
+ */
+void fm25l04b_init (fm25l04b_t* dev) {
+    dev->spi.sck_pin        = dev->sck_pin;
+    dev->spi.mosi_pin       = dev->mosi_pin;
+    dev->spi.miso_pin       = dev->miso_pin;
+    dev->spi.cs_pin         = dev->ss_pin;
+    dev->spi.cs_active_high = false;
+    dev->spi.orc            = 0xff;
+    dev->spi.frequency      = NRF_DRV_SPI_FREQ_1M;
+    dev->spi.mode           = NRF_DRV_SPI_MODE_3;
+    dev->spi.bit_order      = NRF_DRV_SPI_BIT_ORDER_MSB_FIRST;
+
+    spi_bus_add_device(dev->bus, &dev->spi);
 }
 
 /**
@@ -45,30 +65,24 @@ static void spi_init (fm25l04b_t* dev) {
  */
 int fm25l04b_read (fm25l04b_t* dev, uint16_t address, uint8_t *buf, uint16_t len) {
     uint32_t err;
+    uint8_t header[2];
+    spi_bus_segment_t segs[MAX_SEGMENTS];
+    uint8_t num_segs;
 
-    // Init in case something else used this spi bus
-    spi_init(dev);
-
-    nrf_gpio_pin_clear(dev->ss_pin);
+    if (len > FM25L04B_SIZE) return -1;
 
     // Setup that we want a read and to the correct address
-    uint8_t header[2];
     header[0] = FM25L04B_ADD_ADDRESS_BIT(address, FM25L04B_READ_COMMAND);
     header[1] = address & 0xFF;
 
-    err = nrf_drv_spi_transfer(dev->spi, header, 2, NULL, 0);
-    if (err != NRF_SUCCESS) goto err;
+    segs[0] = (spi_bus_segment_t) {.tx = header, .tx_len = 2};
+    num_segs = build_segments(segs, buf, len, true);
 
-    // Now do the actual read
-    err = nrf_drv_spi_transfer(dev->spi, NULL, 0, buf, len);
-    if (err != NRF_SUCCESS) goto err;
+    // Header and data all go out under one chip select
+    err = spi_bus_transfer_segments(&dev->spi, segs, num_segs);
+    if (err != NRF_SUCCESS) return -1;
 
-    nrf_gpio_pin_set(dev->ss_pin);
     return 0;
-
-err:
-    nrf_gpio_pin_set(dev->ss_pin);
-    return -1;
 }
 
 /**
@@ -82,39 +96,26 @@ err:
  */
 int fm25l04b_write(fm25l04b_t* dev, uint16_t address, uint8_t *buf, uint16_t len) {
     uint32_t err;
+    uint8_t wren = FM25L04B_WRITE_ENABLE_COMMAND;
     uint8_t header[2];
+    spi_bus_segment_t segs[MAX_SEGMENTS];
+    uint8_t num_segs;
 
-    // Init in case something else used this spi bus
-    spi_init(dev);
-
-    nrf_gpio_pin_clear(dev->ss_pin);
+    if (len > FM25L04B_SIZE) return -1;
 
-    // Enable writing to flash
-    header[0] = FM25L04B_WRITE_ENABLE_COMMAND;
-    err = nrf_drv_spi_transfer(dev->spi, header, 1, NULL, 0);
-    if (err != NRF_SUCCESS) goto err;
+    // Enable writing. This has to be its own chip select cycle.
+    err = spi_bus_transfer(&dev->spi, &wren, 1, NULL, 0);
+    if (err != NRF_SUCCESS) return -1;
 
-    nrf_gpio_pin_set(dev->ss_pin);
-
-    // Setup that we want a read and to the correct address
+    // Setup that this is a write and the address
     header[0] = FM25L04B_ADD_ADDRESS_BIT(address, FM25L04B_WRITE_COMMAND);
     header[1] = address & 0xFF;
 
-    nrf_gpio_pin_clear(dev->ss_pin);
-
-    // Setup that this is a write and the address
-    err = nrf_drv_spi_transfer(dev->spi, header, 2, NULL, 0);
-    if (err != NRF_SUCCESS) goto err;
+    segs[0] = (spi_bus_segment_t) {.tx = header, .tx_len = 2};
+    num_segs = build_segments(segs, buf, len, false);
 
-    // Now do the actual write
-    err = nrf_drv_spi_transfer(dev->spi, buf, len, NULL, 0);
-    if (err != NRF_SUCCESS) goto err;
+    err = spi_bus_transfer_segments(&dev->spi, segs, num_segs);
+    if (err != NRF_SUCCESS) return -1;
 
-
-    nrf_gpio_pin_set(dev->ss_pin);
     return 0;
-
-err:
-    nrf_gpio_pin_set(dev->ss_pin);
-    return -1;
 }
@@ -0,0 +1,248 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "fm25l04b.h"
+#include "fm25l04b_log.h"
+
+#define SLOT_SIZE(log)  ((log)->payload_size + FM25L04B_LOG_RECORD_OVERHEAD)
+#define MAX_SLOT_SIZE   (FM25L04B_LOG_MAX_PAYLOAD + FM25L04B_LOG_RECORD_OVERHEAD)
+
+// CRC-16/CCITT, same as the SDK's crc16_compute() but kept here so the log
+// does not pull in another SDK library and builds on the host for tests.
+static uint16_t crc16 (const uint8_t* data, uint16_t len) {
+    uint16_t crc = 0xFFFF;
+
+    while (len--) {
+        crc  = (uint8_t)(crc >> 8) | (crc << 8);
+        crc ^= *data++;
+        crc ^= (uint8_t)(crc & 0xFF) >> 4;
+        crc ^= (crc << 8) << 4;
+        crc ^= ((crc & 0xFF) << 4) << 1;
+    }
+    return crc;
+}
+
+static uint16_t slot_address (fm25l04b_log_t* log, uint8_t slot) {
+    return log->base + FM25L04B_LOG_HEADER_SIZE + (slot * SLOT_SIZE(log));
+}
+
+// Read a slot and check it. Returns true if it holds a valid record.
+static bool read_slot (fm25l04b_log_t* log, uint8_t slot, uint8_t* buf) {
+    uint8_t  crc_offset = 3 + log->payload_size;
+    uint16_t crc;
+
+    if (fm25l04b_read(log->dev, slot_address(log, slot), buf, SLOT_SIZE(log)) != 0) {
+        return false;
+    }
+
+    crc = crc16(buf, crc_offset);
+    if ((buf[crc_offset] | (buf[crc_offset+1] << 8)) != crc) return false;
+    if (buf[2] > log->payload_size) return false;
+
+    return true;
+}
+
+static int write_zeros (fm25l04b_log_t* log, uint16_t address, uint16_t len) {
+    uint8_t zeros[32] = {0};
+
+    while (len > 0) {
+        uint16_t chunk = (len > sizeof(zeros)) ? sizeof(zeros) : len;
+        if (fm25l04b_write(log->dev, address, zeros, chunk) != 0) return -1;
+        address += chunk;
+        len -= chunk;
+    }
+    return 0;
+}
+
+static void build_header (fm25l04b_log_t* log, uint8_t* header) {
+    uint16_t crc;
+
+    header[0] = FM25L04B_LOG_MAGIC & 0xFF;
+    header[1] = FM25L04B_LOG_MAGIC >> 8;
+    header[2] = FM25L04B_LOG_VERSION;
+    header[3] = log->payload_size;
+    header[4] = log->num_slots;
+
+    crc = crc16(header, 5);
+    header[5] = crc & 0xFF;
+    header[6] = crc >> 8;
+}
+
+// Invalidate the header first so a power cut part way through leaves a
+// region that gets formatted again on the next init.
+static int format (fm25l04b_log_t* log) {
+    uint8_t header[FM25L04B_LOG_HEADER_SIZE];
+
+    if (write_zeros(log, log->base, FM25L04B_LOG_HEADER_SIZE) != 0) return -1;
+    if (write_zeros(log, slot_address(log, 0), log->num_slots * SLOT_SIZE(log)) != 0) return -1;
+
+    build_header(log, header);
+    if (fm25l04b_write(log->dev, log->base, header, FM25L04B_LOG_HEADER_SIZE) != 0) return -1;
+
+    log->head     = 0;
+    log->count    = 0;
+    log->next_seq = 0;
+    return 0;
+}
+
+// One pass over every slot. Records are written in slot order with
+// consecutive sequence numbers, so the valid slots always form one chain
+// and the newest record is the one with the highest sequence number.
+static int recover (fm25l04b_log_t* log) {
+    uint8_t  buf[MAX_SLOT_SIZE];
+    bool     found = false;
+    uint8_t  newest = 0;
+    uint16_t newest_seq = 0;
+    uint8_t  i;
+
+    log->count = 0;
+
+    for (i = 0; i < log->num_slots; i++) {
+        uint16_t seq;
+
+        if (!read_slot(log, i, buf)) continue;
+
+        seq = buf[0] | (buf[1] << 8);
+        log->count++;
+
+        // Serial number comparison handles seq wrapping around
+        if (!found || (int16_t)(seq - newest_seq) > 0) {
+            found      = true;
+            newest     = i;
+            newest_seq = seq;
+        }
+    }
+
+    if (found) {
+        log->head     = (newest + 1) % log->num_slots;
+        log->next_seq = newest_seq + 1;
+    } else {
+        log->head     = 0;
+        log->next_seq = 0;
+    }
+    return 0;
+}
+
+/**
+ * \brief         Attach to (or create) a record log in the FRAM.
+ * \param base    First FRAM address the log may use.
+ * \param size    Number of bytes the log may use.
+ * \param payload_size Maximum bytes per record.
+ * \return        0 on success, -1 on error
+ */
+int fm25l04b_log_init (fm25l04b_log_t* log, fm25l04b_t* dev,
+                       uint16_t base, uint16_t size, uint8_t payload_size) {
+    uint8_t  header[FM25L04B_LOG_HEADER_SIZE];
+    uint8_t  expected[FM25L04B_LOG_HEADER_SIZE];
+    uint16_t slots;
+
+    if (payload_size == 0 || payload_size > FM25L04B_LOG_MAX_PAYLOAD) return -1;
+    if (base + size > FM25L04B_SIZE) return -1;
+    if (size < FM25L04B_LOG_HEADER_SIZE + 2 * (payload_size + FM25L04B_LOG_RECORD_OVERHEAD)) return -1;
+
+    slots = (size - FM25L04B_LOG_HEADER_SIZE) / (payload_size + FM25L04B_LOG_RECORD_OVERHEAD);
+    if (slots > 255) slots = 255;
+
+    log->dev          = dev;
+    log->base         = base;
+    log->payload_size = payload_size;
+    log->num_slots    = slots;
+
+    if (fm25l04b_read(dev, base, header, FM25L04B_LOG_HEADER_SIZE) != 0) return -1;
+
+    build_header(log, expected);
+    if (memcmp(header, expected, FM25L04B_LOG_HEADER_SIZE) != 0) {
+        return format(log);
+    }
+
+    return recover(log);
+}
+
+/**
+ * \brief         Add a record, replacing the oldest if the log is full.
+ * \return        0 on success, -1 on error
+ *
+ *                The whole slot goes out in one write so an interrupted
+ *                append can only damage the slot being written.
+ */
+int fm25l04b_log_append (fm25l04b_log_t* log, const uint8_t* data, uint8_t len) {
+    uint8_t  buf[MAX_SLOT_SIZE];
+    uint8_t  crc_offset = 3 + log->payload_size;
+    uint16_t crc;
+
+    if (len > log->payload_size) return -1;
+
+    buf[0] = log->next_seq & 0xFF;
+    buf[1] = log->next_seq >> 8;
+    buf[2] = len;
+    memcpy(buf+3, data, len);
+    memset(buf+3+len, 0, log->payload_size - len);
+
+    crc = crc16(buf, crc_offset);
+    buf[crc_offset]   = crc & 0xFF;
+    buf[crc_offset+1] = crc >> 8;
+
+    if (fm25l04b_write(log->dev, slot_address(log, log->head), buf, SLOT_SIZE(log)) != 0) {
+        return -1;
+    }
+
+    log->head = (log->head + 1) % log->num_slots;
+    log->next_seq++;
+    if (log->count < log->num_slots) log->count++;
+
+    return 0;
+}
+
+/**
+ * \brief         Read a record back.
+ * \param index   0 is the oldest record, count-1 the newest.
+ * \param data    Buffer of at least payload_size bytes.
+ * \return        0 on success, -1 on error
+ */
+int fm25l04b_log_read (fm25l04b_log_t* log, uint8_t index,
+                       uint8_t* data, uint8_t* len, uint16_t* seq) {
+    uint8_t buf[MAX_SLOT_SIZE];
+    uint8_t slot;
+
+    if (index >= log->count) return -1;
+
+    slot = (log->head + log->num_slots - log->count + index) % log->num_slots;
+    if (!read_slot(log, slot, buf)) return -1;
+
+    *len = buf[2];
+    memcpy(data, buf+3, buf[2]);
+    if (seq) *seq = buf[0] | (buf[1] << 8);
+
+    return 0;
+}
+
+int fm25l04b_log_read_latest (fm25l04b_log_t* log,
+                              uint8_t* data, uint8_t* len, uint16_t* seq) {
+    if (log->count == 0) return -1;
+    return fm25l04b_log_read(log, log->count - 1, data, len, seq);
+}
+
+uint8_t fm25l04b_log_count (fm25l04b_log_t* log) {
+    return log->count;
+}
+
+/**
+ * \brief         Remove all records.
+ * \return        0 on success, -1 on error
+ *
+ *                Records are wiped newest first so that an interrupted clear
+ *                still leaves a single chain of the oldest records.
+ */
+int fm25l04b_log_clear (fm25l04b_log_t* log) {
+    while (log->count > 0) {
+        log->head = (log->head + log->num_slots - 1) % log->num_slots;
+        if (write_zeros(log, slot_address(log, log->head), SLOT_SIZE(log)) != 0) {
+            return -1;
+        }
+        log->count--;
+    }
+
+    log->head = 0;
+    return 0;
+}
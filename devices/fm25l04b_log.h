@@ -0,0 +1,63 @@
+#ifndef FM25L04B_LOG_H_
+#define FM25L04B_LOG_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "fm25l04b.h"
+
+// Circular record log stored in (part of) the FM25L04B FRAM.
+//
+// Layout of the region, starting at `base`:
+//
+//   header: magic[2] version payload_size num_slots crc16[2]
+//   slot 0: seq[2] len payload[payload_size] crc16[2]
+//   slot 1: ...
+//
+// Every append writes one whole slot in a single SPI transaction, in slot
+// order, with a sequence number one higher than the last. A power cut in the
+// middle of a write leaves at most that one slot with a bad CRC, so on
+// startup a single scan over the slots finds the newest record and the
+// number of records still valid.
+
+#define FM25L04B_LOG_MAGIC          0x4C46  // "FL"
+#define FM25L04B_LOG_VERSION        1
+#define FM25L04B_LOG_HEADER_SIZE    7
+#define FM25L04B_LOG_RECORD_OVERHEAD 5
+#define FM25L04B_LOG_MAX_PAYLOAD    64
+
+typedef struct {
+    fm25l04b_t* dev;
+    uint16_t    base;          // first FRAM address used by the log
+    uint8_t     payload_size;  // max bytes of user data per record
+    uint8_t     num_slots;
+
+    // Recovered on init, then kept up to date in RAM
+    uint8_t     head;          // slot the next record goes in
+    uint8_t     count;         // number of valid records
+    uint16_t    next_seq;
+} fm25l04b_log_t;
+
+// Attach to the log in [base, base+size). If the region holds a log with the
+// same geometry it is recovered, otherwise it is formatted.
+// Returns 0 on success, -1 on error.
+int fm25l04b_log_init(fm25l04b_log_t* log, fm25l04b_t* dev,
+                      uint16_t base, uint16_t size, uint8_t payload_size);
+
+// Append a record, overwriting the oldest one if the log is full.
+int fm25l04b_log_append(fm25l04b_log_t* log, const uint8_t* data, uint8_t len);
+
+// Read a record. Index 0 is the oldest, count-1 the newest. seq may be NULL.
+int fm25l04b_log_read(fm25l04b_log_t* log, uint8_t index,
+                      uint8_t* data, uint8_t* len, uint16_t* seq);
+
+// Read the newest record.
+int fm25l04b_log_read_latest(fm25l04b_log_t* log,
+                             uint8_t* data, uint8_t* len, uint16_t* seq);
+
+uint8_t fm25l04b_log_count(fm25l04b_log_t* log);
+
+// Drop all records.
+int fm25l04b_log_clear(fm25l04b_log_t* log);
+
+#endif
@@ -0,0 +1,430 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nmea.h"
+
+enum {
+    STATE_WAIT,         // for a '$'
+    STATE_ADDRESS,      // talker and sentence type
+    STATE_FIELDS,
+    STATE_HEX1,
+    STATE_HEX2,
+};
+
+// What each field of a sentence holds
+enum {
+    F_SKIP,
+    F_TIME,
+    F_DATE,
+    F_STATUS,
+    F_LAT,
+    F_NS,
+    F_LON,
+    F_EW,
+    F_SPEED,
+    F_COURSE,
+    F_QUALITY,
+    F_SATS,
+    F_HDOP,
+    F_ALT,
+};
+
+// Field 0 is the address. A sentence must have at least the fields listed,
+// later ones are skipped.
+static const uint8_t rmc_fields[] = {F_SKIP, F_TIME, F_STATUS, F_LAT, F_NS, F_LON, F_EW, F_SPEED, F_COURSE, F_DATE};
+static const uint8_t gga_fields[] = {F_SKIP, F_TIME, F_LAT, F_NS, F_LON, F_EW, F_QUALITY, F_SATS, F_HDOP, F_ALT};
+static const uint8_t gll_fields[] = {F_SKIP, F_LAT, F_NS, F_LON, F_EW, F_TIME, F_STATUS};
+
+static const uint8_t* const sentence_fields[] = {
+    [NMEA_RMC] = rmc_fields,
+    [NMEA_GGA] = gga_fields,
+    [NMEA_GLL] = gll_fields,
+};
+static const uint8_t sentence_num_fields[] = {
+    [NMEA_RMC] = sizeof(rmc_fields),
+    [NMEA_GGA] = sizeof(gga_fields),
+    [NMEA_GLL] = sizeof(gll_fields),
+};
+
+// The last three characters of the address, as parsed into ipart
+#define TYPE(a, b, c) (((uint32_t)(a) << 16) | ((uint32_t)(b) << 8) | (c))
+
+// parser->flags, about the field being parsed
+#define FIELD_DOT      0x01
+#define FIELD_NEG      0x02
+#define FIELD_NONNUM   0x04     // something other than a number
+#define FIELD_OVERFLOW 0x08
+
+// parser->got, about the sentence being parsed
+#define GOT_LAT        0x01
+#define GOT_LON        0x02
+#define GOT_BAD        0x80
+
+// Digits kept, enough for any receiver
+#define MAX_IDIGITS    9
+#define MAX_FDIGITS    7
+
+static const uint32_t powers_of_ten[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000};
+
+static void start_field (nmea_parser_t* p) {
+    p->ipart   = 0;
+    p->fpart   = 0;
+    p->idigits = 0;
+    p->fdigits = 0;
+    p->flags   = 0;
+    p->first   = 0;
+}
+
+// The field as an integer in units of 10^-n, false if it isn't a plain
+// unsigned number or doesn't fit
+static bool field_scaled (nmea_parser_t* p, uint8_t n, uint32_t* out) {
+    uint32_t frac = p->fpart;
+    uint8_t  digits = p->fdigits;
+
+    if (p->flags & (FIELD_NONNUM | FIELD_OVERFLOW)) return false;
+    if (p->idigits == 0 && digits == 0) return false;
+
+    if (digits > n) {
+        frac /= powers_of_ten[digits - n];
+    } else {
+        frac *= powers_of_ten[n - digits];
+    }
+    if (p->ipart > (UINT32_MAX - frac) / powers_of_ten[n]) return false;
+
+    *out = p->ipart * powers_of_ten[n] + frac;
+    return true;
+}
+
+static bool field_uint (nmea_parser_t* p, uint32_t* out) {
+    if (p->flags & FIELD_NEG) return false;
+    return field_scaled(p, 0, out);
+}
+
+// ddmm.mmmm or dddmm.mmmm in 1e-7 degrees
+static bool field_angle (nmea_parser_t* p, uint32_t max_degrees, int32_t* out) {
+    uint32_t minutes, degrees, value;
+
+    if ((p->flags & FIELD_NEG) || !field_scaled(p, 5, &value)) return false;
+
+    degrees = value / 10000000;
+    minutes = value % 10000000;     // 1e-5 minutes
+    if (minutes >= 6000000 || degrees > max_degrees) return false;
+
+    *out = degrees * 10000000 + (minutes * 10 + 3) / 6;
+    if (*out > (int32_t)(max_degrees * 10000000)) return false;
+    return true;
+}
+
+// A field is complete. Returns false if it holds something it can't.
+static bool end_field (nmea_parser_t* p) {
+    nmea_fix_t* fix = &p->next;
+    bool empty = (p->first == 0);
+    uint32_t value;
+
+    if (p->field >= sentence_num_fields[p->sentence]) return true;
+
+    switch (sentence_fields[p->sentence][p->field]) {
+        case F_TIME:
+            if (empty) {
+                fix->has &= ~NMEA_HAS_TIME;
+                return true;
+            }
+            if (p->idigits != 6 || (p->flags & FIELD_NEG) || !field_scaled(p, 3, &value)) return false;
+            {
+                uint32_t hhmmss = value / 1000;
+                uint32_t h = hhmmss / 10000, m = hhmmss / 100 % 100, s = hhmmss % 100;
+
+                if (h > 23 || m > 59 || s > 60) return false;
+                fix->time = ((h * 60 + m) * 60 + s) * 1000 + value % 1000;
+            }
+            fix->has |= NMEA_HAS_TIME;
+            return true;
+
+        case F_DATE:
+            if (empty) {
+                fix->has &= ~NMEA_HAS_DATE;
+                return true;
+            }
+            if (p->idigits != 6 || p->fdigits != 0 || !field_uint(p, &value)) return false;
+            fix->day   = value / 10000;
+            fix->month = value / 100 % 100;
+            fix->year  = 2000 + value % 100;
+            if (fix->day < 1 || fix->day > 31 || fix->month < 1 || fix->month > 12) return false;
+            fix->has |= NMEA_HAS_DATE;
+            return true;
+
+        case F_STATUS:
+            fix->valid = (p->first == 'A');
+            return true;
+
+        case F_LAT:
+            if (empty) return true;
+            if (!field_angle(p, 90, &fix->latitude)) return false;
+            p->got |= GOT_LAT;
+            return true;
+
+        case F_NS:
+            if (p->first == 'S') {
+                fix->latitude = -fix->latitude;
+            } else if (p->first != 'N') {
+                p->got &= ~GOT_LAT;
+            }
+            return true;
+
+        case F_LON:
+            if (empty) return true;
+            if (!field_angle(p, 180, &fix->longitude)) return false;
+            p->got |= GOT_LON;
+            return true;
+
+        case F_EW:
+            if (p->first == 'W') {
+                fix->longitude = -fix->longitude;
+            } else if (p->first != 'E') {
+                p->got &= ~GOT_LON;
+            }
+            return true;
+
+        case F_SPEED:
+            if (empty) {
+                fix->has &= ~NMEA_HAS_SPEED;
+                return true;
+            }
+            if ((p->flags & FIELD_NEG) || !field_scaled(p, 3, &fix->speed)) return false;
+            fix->has |= NMEA_HAS_SPEED;
+            return true;
+
+        case F_COURSE:
+            if (empty) {
+                fix->has &= ~NMEA_HAS_COURSE;
+                return true;
+            }
+            if ((p->flags & FIELD_NEG) || !field_scaled(p, 2, &value) || value >= 36000) return false;
+            fix->course = value;
+            fix->has |= NMEA_HAS_COURSE;
+            return true;
+
+        case F_QUALITY:
+            if (empty) {
+                value = 0;
+            } else if (!field_uint(p, &value) || value > 9) {
+                return false;
+            }
+            fix->quality = value;
+            fix->valid = (value != 0);
+            return true;
+
+        case F_SATS:
+            if (empty) {
+                fix->has &= ~NMEA_HAS_SATELLITES;
+                return true;
+            }
+            if (!field_uint(p, &value) || value > 255) return false;
+            fix->satellites = value;
+            fix->has |= NMEA_HAS_SATELLITES;
+            return true;
+
+        case F_HDOP:
+            if (empty) {
+                fix->has &= ~NMEA_HAS_HDOP;
+                return true;
+            }
+            if ((p->flags & FIELD_NEG) || !field_scaled(p, 2, &value) || value > UINT16_MAX) return false;
+            fix->hdop = value;
+            fix->has |= NMEA_HAS_HDOP;
+            return true;
+
+        case F_ALT:
+            if (empty) {
+                fix->has &= ~NMEA_HAS_ALTITUDE;
+                return true;
+            }
+            if (!field_scaled(p, 3, &value) || value > INT32_MAX) return false;
+            fix->altitude = (p->flags & FIELD_NEG) ? -(int32_t)value : (int32_t)value;
+            fix->has |= NMEA_HAS_ALTITUDE;
+            return true;
+    }
+    return true;
+}
+
+// The address is complete, returns the sentence if it's one we parse
+static uint8_t end_address (nmea_parser_t* p) {
+    if (p->idigits != 5) return NMEA_NONE;
+
+    switch (p->ipart) {
+        case TYPE('R', 'M', 'C'): return NMEA_RMC;
+        case TYPE('G', 'G', 'A'): return NMEA_GGA;
+        case TYPE('G', 'L', 'L'): return NMEA_GLL;
+    }
+    return NMEA_NONE;
+}
+
+static void add_char (nmea_parser_t* p, char c) {
+    if (p->first == 0) p->first = c;
+
+    if (c >= '0' && c <= '9') {
+        if (p->flags & FIELD_DOT) {
+            if (p->fdigits < MAX_FDIGITS) {
+                p->fpart = p->fpart * 10 + (c - '0');
+                p->fdigits++;
+            }
+        } else if (p->idigits < MAX_IDIGITS) {
+            p->ipart = p->ipart * 10 + (c - '0');
+            p->idigits++;
+        } else {
+            p->flags |= FIELD_OVERFLOW;
+        }
+    } else if (c == '.' && !(p->flags & FIELD_DOT)) {
+        p->flags |= FIELD_DOT;
+    } else if (c == '-' && p->first == c && p->idigits == 0 && !(p->flags & (FIELD_DOT | FIELD_NEG))) {
+        p->flags |= FIELD_NEG;
+    } else {
+        p->flags |= FIELD_NONNUM;
+    }
+}
+
+static int hex_value (char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+static bool end_sentence (nmea_parser_t* p) {
+    nmea_fix_t* fix = &p->next;
+
+    p->state = STATE_WAIT;
+
+    if (p->checksum != p->expected) {
+        p->checksum_errors++;
+        return false;
+    }
+    if ((p->got & GOT_BAD) || p->field < sentence_num_fields[p->sentence] - 1) {
+        p->dropped++;
+        return false;
+    }
+
+    if ((p->got & (GOT_LAT | GOT_LON)) == (GOT_LAT | GOT_LON)) {
+        fix->has |= NMEA_HAS_POSITION;
+    } else {
+        fix->has &= ~NMEA_HAS_POSITION;
+    }
+    fix->sentence = p->sentence;
+
+    p->fix = *fix;
+    p->sentences++;
+    if (p->handler) p->handler(&p->fix, p->ctx);
+    return true;
+}
+
+/**
+ * \brief         Reset the parser and forget the fix.
+ * \param handler Called after every good RMC, GGA or GLL sentence, may be NULL.
+ */
+void nmea_init (nmea_parser_t* parser, nmea_handler_t handler, void* ctx) {
+    memset(parser, 0, sizeof(*parser));
+    parser->handler = handler;
+    parser->ctx     = ctx;
+    parser->state   = STATE_WAIT;
+}
+
+/**
+ * \brief         Feed one received character to the parser.
+ * \return        true if it completed a good RMC, GGA or GLL sentence
+ *
+ *                Cheap enough to call from the UART interrupt. The handler
+ *                runs from inside this call.
+ */
+bool nmea_parse_char (nmea_parser_t* p, char c) {
+    int hex;
+
+    if (c == '$') {
+        // Whatever came before was cut short
+        if (p->state != STATE_WAIT && p->sentence != NMEA_NONE) p->dropped++;
+        p->state    = STATE_ADDRESS;
+        p->sentence = NMEA_NONE;
+        p->field    = 0;
+        p->length   = 1;
+        p->checksum = 0;
+        p->got      = 0;
+        start_field(p);
+        return false;
+    }
+    if (p->state == STATE_WAIT) return false;
+
+    // Only printable characters belong in a sentence, and not too many
+    if (c < 0x20 || c > 0x7E || ++p->length > NMEA_MAX_SENTENCE - 2) {
+        if (p->sentence != NMEA_NONE) p->dropped++;
+        p->state = STATE_WAIT;
+        return false;
+    }
+
+    switch (p->state) {
+        case STATE_ADDRESS:
+            p->checksum ^= c;
+            if (c == ',') {
+                p->sentence = end_address(p);
+                if (p->sentence == NMEA_NONE) {
+                    p->state = STATE_WAIT;
+                    return false;
+                }
+                p->next  = p->fix;
+                p->field = 1;
+                p->state = STATE_FIELDS;
+                start_field(p);
+            } else {
+                p->ipart = ((p->ipart << 8) | (uint8_t)c) & 0xFFFFFF;
+                p->idigits++;
+            }
+            return false;
+
+        case STATE_FIELDS:
+            if (c == '*') {
+                if (!end_field(p)) p->got |= GOT_BAD;
+                p->state = STATE_HEX1;
+                return false;
+            }
+            p->checksum ^= c;
+            if (c == ',') {
+                if (!end_field(p)) p->got |= GOT_BAD;
+                if (p->field < UINT8_MAX) p->field++;
+                start_field(p);
+            } else {
+                add_char(p, c);
+            }
+            return false;
+
+        case STATE_HEX1:
+        case STATE_HEX2:
+            hex = hex_value(c);
+            if (hex < 0) {
+                p->dropped++;
+                p->state = STATE_WAIT;
+                return false;
+            }
+            p->expected = (p->expected << 4) | hex;
+            if (p->state == STATE_HEX1) {
+                p->state = STATE_HEX2;
+                return false;
+            }
+            return end_sentence(p);
+    }
+    return false;
+}
+
+uint32_t nmea_parse (nmea_parser_t* parser, const char* data, uint32_t len) {
+    uint32_t sentences = 0;
+
+    while (len--) {
+        if (nmea_parse_char(parser, *data++)) sentences++;
+    }
+    return sentences;
+}
+
+uint8_t nmea_checksum (const char* body, uint32_t len) {
+    uint8_t sum = 0;
+
+    while (len--) sum ^= *body++;
+    return sum;
+}
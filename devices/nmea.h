@@ -0,0 +1,104 @@
+#ifndef NMEA_H_
+#define NMEA_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Streaming parser for the NMEA 0183 sentences a GPS module sends.
+//
+// Characters go in one at a time as the UART delivers them; nothing is
+// buffered beyond the field being parsed and nothing is allocated. RMC,
+// GGA and GLL sentences from any talker (GP, GN, GL, ...) are understood,
+// everything else is skipped. A sentence only counts once its `*hh`
+// checksum matches, then its fields are merged into the fix and the fix is
+// handed to the handler. Numbers are kept in fixed point:
+//
+//   latitude, longitude   1e-7 degrees, north and east positive
+//   altitude              millimeters above mean sea level
+//   speed                 thousandths of a knot
+//   course, hdop          hundredths
+//   time                  milliseconds since midnight UTC
+
+#define NMEA_MAX_SENTENCE 82
+
+// Fields of nmea_fix_t that hold a value. A sentence that carries a field
+// but leaves it empty (no fix yet) clears its flag.
+#define NMEA_HAS_TIME       0x01
+#define NMEA_HAS_DATE       0x02
+#define NMEA_HAS_POSITION   0x04
+#define NMEA_HAS_ALTITUDE   0x08
+#define NMEA_HAS_SPEED      0x10
+#define NMEA_HAS_COURSE     0x20
+#define NMEA_HAS_SATELLITES 0x40
+#define NMEA_HAS_HDOP       0x80
+
+typedef enum {
+    NMEA_NONE = 0,
+    NMEA_RMC,
+    NMEA_GGA,
+    NMEA_GLL,
+} nmea_sentence_t;
+
+typedef struct {
+    int32_t  latitude;
+    int32_t  longitude;
+    int32_t  altitude;
+    uint32_t time;
+    uint32_t speed;
+    uint16_t course;
+    uint16_t hdop;
+    uint16_t year;
+    uint8_t  month;
+    uint8_t  day;
+    uint8_t  quality;       // GGA fix quality, 0 is no fix
+    uint8_t  satellites;
+    uint8_t  has;           // NMEA_HAS_ flags
+    bool     valid;         // the last sentence reported a valid fix
+    nmea_sentence_t sentence;  // the sentence that last updated the fix
+} nmea_fix_t;
+
+// Called with the updated fix after every good RMC, GGA or GLL sentence
+typedef void (*nmea_handler_t)(const nmea_fix_t* fix, void* ctx);
+
+typedef struct {
+    nmea_fix_t     fix;     // as of the last good sentence
+    nmea_fix_t     next;    // fix with the sentence being parsed merged in
+    nmea_handler_t handler;
+    void*          ctx;
+
+    uint8_t  state;
+    uint8_t  sentence;
+    uint8_t  field;         // index of the field being parsed, 0 is the address
+    uint8_t  length;        // characters since '$'
+    uint8_t  checksum;      // xor of the characters between '$' and '*'
+    uint8_t  expected;      // checksum from the sentence
+    uint8_t  got;           // what the sentence has had so far
+
+    // The field being parsed
+    uint32_t ipart;
+    uint32_t fpart;
+    uint8_t  idigits;
+    uint8_t  fdigits;
+    uint8_t  flags;
+    char     first;
+
+    // Counters, for diagnostics
+    uint32_t sentences;     // good RMC, GGA and GLL sentences
+    uint32_t checksum_errors;
+    uint32_t dropped;       // malformed, overlong or cut short
+} nmea_parser_t;
+
+// handler may be NULL, the last fix is always in parser->fix
+void nmea_init(nmea_parser_t* parser, nmea_handler_t handler, void* ctx);
+
+// Feed one character. Returns true if it completed a good RMC, GGA or GLL
+// sentence (and the handler has been called).
+bool nmea_parse_char(nmea_parser_t* parser, char c);
+
+// Feed len characters, returns how many good sentences they completed
+uint32_t nmea_parse(nmea_parser_t* parser, const char* data, uint32_t len);
+
+// Checksum of a sentence body, the characters between '$' and '*'
+uint8_t nmea_checksum(const char* body, uint32_t len);
+
+#endif
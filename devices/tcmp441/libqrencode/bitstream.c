@@ -27,6 +27,7 @@
 #include <string.h>
 
 #include "bitstream.h"
+#include "qrarena.h"
 
 #define DEFAULT_BUFSIZE (128)
 
@@ -30,6 +30,7 @@
 #include "qrencode.h"
 #include "qrspec.h"
 #include "mask.h"
+#include "qrarena.h"
 
 int Mask_writeFormatInformation(int width, unsigned char *frame, int mask, QRecLevel level)
 {
@@ -30,6 +30,7 @@
 #include "qrencode.h"
 #include "mqrspec.h"
 #include "mmask.h"
+#include "qrarena.h"
 
 void MMask_writeFormatInformation(int version, int width, unsigned char *frame, int mask, QRecLevel level)
 {
@@ -34,6 +34,7 @@
 #include <errno.h>
 
 #include "mqrspec.h"
+#include "qrarena.h"
 
 /******************************************************************************
  * Version and capacity
@@ -0,0 +1,164 @@
+/*
+ * qrencode - QR Code encoder
+ *
+ * Optional bump arena allocator for embedded builds.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#if HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "qrencode.h"
+#include "qrarena.h"
+
+#ifdef QRENCODE_ARENA
+
+/* Every block starts with a header holding its size, so that realloc() knows
+ * how much to copy. The header also keeps the block 8 byte aligned. */
+#define ALIGN (8)
+#define HEADER (ALIGN)
+#define ROUND(x) (((x) + ALIGN - 1) & ~(size_t)(ALIGN - 1))
+
+static union {
+	unsigned char bytes[QRENCODE_ARENA_SIZE];
+	double align;
+} pool;
+
+static size_t used = 0;
+static size_t peak = 0;
+static size_t last = (size_t)-1;	/* offset of the most recent block */
+
+#define BLOCK_SIZE(off) (*(size_t *)&pool.bytes[off])
+
+void *QRarena_malloc(size_t size)
+{
+	size_t need = HEADER + ROUND(size);
+
+	if(need > QRENCODE_ARENA_SIZE - used) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	BLOCK_SIZE(used) = size;
+	last = used;
+	used += need;
+	if(used > peak) peak = used;
+
+	return &pool.bytes[last + HEADER];
+}
+
+void *QRarena_calloc(size_t nmemb, size_t size)
+{
+	void *p;
+
+	if(size != 0 && nmemb > (size_t)-1 / size) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	p = QRarena_malloc(nmemb * size);
+	if(p != NULL) memset(p, 0, nmemb * size);
+
+	return p;
+}
+
+static int is_last(void *ptr)
+{
+	return last != (size_t)-1 && ptr == &pool.bytes[last + HEADER];
+}
+
+void QRarena_free(void *ptr)
+{
+	if(ptr == NULL || !is_last(ptr)) return;
+
+	/* Only the newest block can be handed back. Which block is newest
+	 * before it is unknown, so further frees wait for the next reset. */
+	used = last;
+	last = (size_t)-1;
+}
+
+void *QRarena_realloc(void *ptr, size_t size)
+{
+	void *p;
+	size_t old;
+
+	if(ptr == NULL) return QRarena_malloc(size);
+
+	if(is_last(ptr)) {
+		size_t need = HEADER + ROUND(size);
+		if(need > QRENCODE_ARENA_SIZE - last) {
+			errno = ENOMEM;
+			return NULL;
+		}
+		BLOCK_SIZE(last) = size;
+		used = last + need;
+		if(used > peak) peak = used;
+		return ptr;
+	}
+
+	old = *(size_t *)((unsigned char *)ptr - HEADER);
+	p = QRarena_malloc(size);
+	if(p == NULL) return NULL;
+	memcpy(p, ptr, old < size ? old : size);
+
+	return p;
+}
+
+void QRcode_arenaReset(void)
+{
+	used = 0;
+	last = (size_t)-1;
+}
+
+size_t QRcode_arenaUsed(void)
+{
+	return used;
+}
+
+size_t QRcode_arenaPeak(void)
+{
+	return peak;
+}
+
+void QRcode_arenaResetPeak(void)
+{
+	peak = used;
+}
+
+#else
+
+void QRcode_arenaReset(void)
+{
+}
+
+size_t QRcode_arenaUsed(void)
+{
+	return 0;
+}
+
+size_t QRcode_arenaPeak(void)
+{
+	return 0;
+}
+
+void QRcode_arenaResetPeak(void)
+{
+}
+
+#endif /* QRENCODE_ARENA */
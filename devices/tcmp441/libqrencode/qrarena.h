@@ -0,0 +1,60 @@
+/*
+ * qrencode - QR Code encoder
+ *
+ * Optional bump arena allocator for embedded builds.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef __QRARENA_H__
+#define __QRARENA_H__
+
+#include <stddef.h>
+
+/**
+ * Build with QRENCODE_ARENA defined to take every allocation of the library
+ * from a static buffer of QRENCODE_ARENA_SIZE bytes instead of the heap.
+ *
+ * The arena is a bump allocator. free() and realloc() only give memory back
+ * (or grow in place) for the most recent allocation, everything else is
+ * reclaimed at once when the arena is reset. Each of the string and data
+ * encoding functions resets the arena before it starts, so the QRcode it
+ * returns stays valid until the next encode.
+ *
+ * This header must be included after the system headers, since it replaces
+ * malloc() and friends with macros.
+ */
+
+#ifdef QRENCODE_ARENA
+
+#ifndef QRENCODE_ARENA_SIZE
+/* Enough for any version 1-5 symbol at any level, which is as large as the
+ * TCM-P441 can show with 8x8 pixel modules. */
+#define QRENCODE_ARENA_SIZE 6144
+#endif
+
+extern void *QRarena_malloc(size_t size);
+extern void *QRarena_calloc(size_t nmemb, size_t size);
+extern void *QRarena_realloc(void *ptr, size_t size);
+extern void QRarena_free(void *ptr);
+
+#define malloc(size)         QRarena_malloc(size)
+#define calloc(nmemb, size)  QRarena_calloc(nmemb, size)
+#define realloc(ptr, size)   QRarena_realloc(ptr, size)
+#define free(ptr)            QRarena_free(ptr)
+
+#endif /* QRENCODE_ARENA */
+
+#endif /* __QRARENA_H__ */
@@ -35,6 +35,7 @@
 #include "split.h"
 #include "mask.h"
 #include "mmask.h"
+#include "qrarena.h"
 
 /******************************************************************************
  * Raw code
@@ -600,6 +601,8 @@ static QRcode *QRcode_encodeStringReal(const char *string, int version, QRecLeve
 	QRcode *code;
 	int ret;
 
+	QRcode_arenaReset();
+
 	if(string == NULL) {
 		errno = EINVAL;
 		return NULL;
@@ -643,6 +646,8 @@ static QRcode *QRcode_encodeDataReal(const unsigned char *data, int length, int
 	QRcode *code;
 	int ret;
 
+	QRcode_arenaReset();
+
 	if(data == NULL || length == 0) {
 		errno = EINVAL;
 		return NULL;
@@ -813,6 +818,8 @@ static QRcode_List *QRcode_encodeDataStructuredReal(
 	QRcode_List *codes;
 	int ret;
 
+	QRcode_arenaReset();
+
 	if(version <= 0) {
 		errno = EINVAL;
 		return NULL;
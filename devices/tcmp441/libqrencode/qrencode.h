@@ -99,6 +99,8 @@
 #ifndef __QRENCODE_H__
 #define __QRENCODE_H__
 
+#include <stddef.h>
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -533,6 +535,30 @@ extern int QRcode_List_size(QRcode_List *qrlist);
 extern void QRcode_List_free(QRcode_List *qrlist);
 
 
+/******************************************************************************
+ * Arena allocator (see qrarena.h)
+ *****************************************************************************/
+
+/**
+ * Discard everything allocated by the library, including previously returned
+ * QRcode objects. The string and data encoding functions do this themselves.
+ * Call it before QRinput_new() when building the input by hand. Does nothing
+ * unless the library was built with QRENCODE_ARENA.
+ */
+extern void QRcode_arenaReset(void);
+
+/**
+ * Bytes of the arena in use right now, and the most that was ever in use.
+ * Both are 0 unless the library was built with QRENCODE_ARENA.
+ */
+extern size_t QRcode_arenaUsed(void);
+extern size_t QRcode_arenaPeak(void);
+
+/**
+ * Restart peak tracking from the current usage.
+ */
+extern void QRcode_arenaResetPeak(void);
+
 /******************************************************************************
  * System utilities
  *****************************************************************************/
@@ -32,6 +32,7 @@
 #include "mqrspec.h"
 #include "bitstream.h"
 #include "qrinput.h"
+#include "qrarena.h"
 
 /******************************************************************************
  * Utilities
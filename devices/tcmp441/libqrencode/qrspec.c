@@ -35,6 +35,7 @@
 
 #include "qrspec.h"
 #include "qrinput.h"
+#include "qrarena.h"
 
 /******************************************************************************
  * Version and capacity
@@ -35,6 +35,7 @@
 #include "qrinput.h"
 #include "qrspec.h"
 #include "split.h"
+#include "qrarena.h"
 
 #define isdigit(__c__) ((unsigned char)((signed char)(__c__) - '0') < 10)
 #define isalnum(__c__) (QRinput_lookAnTable(__c__) >= 0)
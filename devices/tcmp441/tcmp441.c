@@ -3,11 +3,15 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "led.h"
+#include "pin_group.h"
 #include "nordic_common.h"
 #include "softdevice_handler.h"
 #include "nrf_drv_spi.h"
+#include "spi_bus.h"
 #include "nrf_delay.h"
 #include "app_gpiote.h"
+#include "app_timer.h"
+#include "nrf_drv_gpiote.h"
 #include "app_util_platform.h"
 #include "math.h"
 #include <string.h>
@@ -15,6 +19,8 @@
 
 //qrcode + text
 #include "font8x8_basic.h"
+#include "tcmp441_blit.h"
+#include "tcmp441_image.h"
 #include "qrencode.h"
 
 int LED0 = 18;
@@ -53,22 +59,26 @@ static void wait_for_not_busy () {
 }
 
 static nrf_drv_spi_t _spi = NRF_DRV_SPI_INSTANCE(SPI_INSTANCE);
+static spi_bus_t _own_bus;
+static spi_bus_device_t _display;
 
-static void spi_init () {
-    uint32_t err;
-
+static void spi_init (spi_bus_t* bus) {
     nrf_drv_spi_config_t spi_config = NRF_DRV_SPI_DEFAULT_CONFIG(SPI_INSTANCE);
+
+    _display.sck_pin   = spi_config.sck_pin;
+    _display.mosi_pin  = spi_config.mosi_pin;
+    _display.miso_pin  = spi_config.miso_pin;
+    _display.orc       = spi_config.orc;
+    _display.bit_order = spi_config.bit_order;
     // Datasheet says we can do 3 MHz, but 4 also seems to work.
-    spi_config.frequency = NRF_DRV_SPI_FREQ_4M;
+    _display.frequency = NRF_DRV_SPI_FREQ_4M;
     // We do need CS pin
-    spi_config.ss_pin = nTC_CS;
+    _display.cs_pin = nTC_CS;
     // Datasheet claims we need CPOL=1 CPHA=1.
     // However, I did not get that to work. MODE 2 does seem to work.
-    spi_config.mode = NRF_DRV_SPI_MODE_2;
+    _display.mode = NRF_DRV_SPI_MODE_2;
 
-    // We want blocking mode
-    err = nrf_drv_spi_init(&_spi, &spi_config, NULL);
-    APP_ERROR_CHECK(err);
+    spi_bus_add_device(bus, &_display);
 
     //check and set the correct CS polarity
     nrf_delay_ms(10);
@@ -76,34 +86,22 @@ static void spi_init () {
     uint8_t rx[28] = {0};
 
     //write
-    nrf_drv_spi_transfer(&_spi, tx, 4, NULL, 0);
+    spi_bus_transfer(&_display, tx, 4, NULL, 0);
     wait_for_not_busy();
 
     //read
-    nrf_drv_spi_transfer(&_spi, NULL, 0, rx, 28);
+    spi_bus_transfer(&_display, NULL, 0, rx, 28);
     nrf_delay_ms(1);
 
     
     char version0[] = "MpicoSys TC-P441-230_v1.0";
 
-    if(strcmp(version0, rx) != 0)
+    if(strcmp(version0, (char*) rx) != 0)
     {
         //switch it to version 1
-        //uninit
-        nrf_drv_spi_uninit(&_spi);
-
-        nrf_drv_spi_config_t spi_config = NRF_DRV_SPI_DEFAULT_CONFIG(SPI_INSTANCE);
-        // Datasheet says we can do 3 MHz, but 4 also seems to work.
-        spi_config.frequency = NRF_DRV_SPI_FREQ_4M;
-        // We do need CS pin
-        spi_config.ss_pin = nTC_CS;
-        // Datasheet claims we need CPOL=1 CPHA=1.
-        // However, I did not get that to work. MODE 2 does seem to work.
-        spi_config.mode = NRF_DRV_SPI_MODE_0;
-
-        // We want blocking mode
-        err = nrf_drv_spi_init(&_spi, &spi_config, NULL);
-        APP_ERROR_CHECK(err);
+        //The bus notices the changed mode and reconfigures on the next
+        //transfer.
+        _display.mode = NRF_DRV_SPI_MODE_0;
     }
 }
 
@@ -410,66 +408,86 @@ uint8_t screen[15000] = {
 130,144,82,9,40,74,128,74,255,255,239,251,126,251,215,245,255,255,255,255,253,255,222,219,237,255,123,127,239,127,223,255,162,0,64,0,16,2,182,202,148,137,0,0,17,32,8,0,32,0,
 };
 
+// One bit per screen row that changed since the last upload. The image goes
+// to the controller as 60 packets of 5 rows, so a packet is sent again only
+// if one of its rows is dirty.
+static uint8_t dirty_rows[(TCMP441_HEIGHT + 7) / 8];
+static tcmp441_refresh_stats_t refresh_stats;
+
+static bool packet_dirty(int packet)
+{
+    for(int y = packet * TCMP441_ROWS_PER_PACKET; y < (packet + 1) * TCMP441_ROWS_PER_PACKET; y++){
+        if(dirty_rows[y >> 3] & (1 << (y & 7))) return true;
+    }
+    return false;
+}
+
+static tcmp441_fb_t fb = {
+    .buf    = screen,
+    .dirty  = dirty_rows,
+    .width  = TCMP441_WIDTH,
+    .height = TCMP441_HEIGHT,
+    .stride = TCMP441_ROW_BYTES,
+};
+
+//mark the whole screen as changed, e.g. after writing to screen[] directly
+void tcmp441_markAllDirty()
+{
+    memset(dirty_rows, 0xFF, sizeof(dirty_rows));
+}
+
 //set pixel value at x and y coordinate
 void tcmp441_setPixel(int x, int y, int on/*1 or 0*/){
+    if(x < 0 || x >= TCMP441_WIDTH || y < 0 || y >= TCMP441_HEIGHT) return;
+
     //index in screen array
-    int index = (y * 50) + ((50 * x)/400);
-    int bitsIntoByte = 7 - (x % 8);
+    int index = (y * TCMP441_ROW_BYTES) + (x >> 3);
+    int bitsIntoByte = 7 - (x & 7);
 
     //turns the nth bit on or off
+    uint8_t old = screen[index];
     screen[index] ^= (-on ^ screen[index]) & (1 << bitsIntoByte); //jeremy ruten stack overflow
+
+    if(screen[index] != old){
+        dirty_rows[y >> 3] |= 1 << (y & 7);
+    }
 }
 
 //clears the screen by setting all elements to 0
 void tcmp441_clearScreen(){
     memset(screen, 0, 15000 * sizeof(uint8_t));
+    tcmp441_markAllDirty();
 }
 
 //inserts a grid of pixels into the image - NOTE - coordinate is @ uper left
 //the grid of pixels is in the form of 0s and 1s, a 0 representing pixel off and 1 representing pixel on
 void tcmp441_insertPixelGrid(int width, int height, uint8_t grid[height][width], int xcoord, int ycoord){
-    for(int y = 0; y < height; y++){
-        for(int x = 0; x < width; x++){
-            if(grid[y][x] == 1){
-                tcmp441_setPixel(x + xcoord, y + ycoord, 1);//pixel on
-            }
-            else{
-                tcmp441_setPixel(x + xcoord, y + ycoord, 0);//pixel off
-            }
-        }
-    }
+    tcmp441_blit_grid(&fb, xcoord, ycoord, &grid[0][0], width, height);
 }
 
 //writes a single character at (x,y) with a given scale
 //a scale of 1 produces an 8x8 pixel character
 //each character in font8x8_basic.h is written in 8 lines of 8 hex bytes where each bit of the 8 bytes represents a single pixel
 void tcmp441_writeCharacterAtLocation(char character, int xcoord, int ycoord, uint8_t scale){
-    //convert the 8 hex bytes from font8x8_basic.h into an 8x8 pixel array
-    uint8_t grid[8][8];
-    char *bitmap = font8x8_basic[character];//selects array of 8 hex bytes from font8x8_basic.h based on character code
-
-    //loop over each row in the character
-    for(int i = 0; i < 8; i++){
-        //loop over each bit in the character
-        for(int j = 0; j < 8; j++){
-            //select the jth bit from the hex byte to add to the 8x8 pixel array
-            grid[i][j] = (bitmap[i] & (1 << j)) >> j;
-        }
-    }
+    //selects array of 8 hex bytes from font8x8_basic.h based on character code
+    uint8_t *bitmap = (uint8_t*) font8x8_basic[character & 0x7F];
 
-    //scale the character by the scale multiplier
-    if(scale != 1){
-        //loop over a scaled version of the character
-        for(int y = 0; y < 8 * scale; y++){
-            for(int x = 0; x < 8 * scale; x++){
-                tcmp441_setPixel(xcoord + x, ycoord + y, grid[y/scale][x/scale]);
-            }
-        }
+    tcmp441_blit_glyph(&fb, xcoord, ycoord, bitmap, scale);
+}
 
-        return;
-    }
+//set or clear a filled rectangle
+void tcmp441_fillRect(int x, int y, int width, int height, int on){
+    tcmp441_blit_fill(&fb, x, y, width, height, on);
+}
+
+//set or clear a horizontal line from x0 to x1
+void tcmp441_drawHLine(int x0, int x1, int y, int on){
+    tcmp441_blit_span(&fb, x0, x1, y, on);
+}
 
-    tcmp441_insertPixelGrid(8, 8, grid, xcoord, ycoord);
+//copy a packed bitmap (1 bit per pixel, msb leftmost) to the screen
+void tcmp441_drawBitmap(const uint8_t* bits, int stride, int width, int height, int xcoord, int ycoord){
+    tcmp441_blit_bits(&fb, xcoord, ycoord, bits, stride, width, height);
 }
 
 //writes a string of ascii characters at an x,y coordinate with a given scale
@@ -487,15 +505,7 @@ void tcmp441_writeStringAtLocation(char *str, int x, int y, int scale){
 //sets a block of 8x8 pixels on or off. x < 50 & y < 38
 void tcmp441_setBlock(int x, int y, int on)
 {
-    for(int i = 0; i < 8; i++)
-    {
-        if(on == 1){
-            screen[x + (50 * i) + (50 * y * 8)] = 255;
-        }else{
-            screen[x + (50 * i) + (50 * y * 8)] = 0;
-        }
-        
-    }
+    tcmp441_blit_fill(&fb, x * 8, y * 8, 8, 8, on == 1);
 }
 
 //inserts a grid of pixels, but much larger
@@ -517,58 +527,98 @@ void tcmp441_insertBigPixelGrid(int width, int height, uint8_t grid[height][widt
     }
 }
 
-//write a qr code to the screen. Can handle up to 52 characters
-void tcmp441_writeQRcode(char *str)
+//write a qr code with its upper left corner (including the quiet zone) at
+//(x,y). every module is scale x scale pixels, with quiet modules of blank
+//space around the code. returns the size of the drawn square in pixels, or
+//-1 if the string could not be encoded or the code would be wider than 512
+//pixels
+int tcmp441_writeQRcodeAt(char *str, int x, int y, int scale, int quiet)
 {
     QRcode *qrcode;
+    int size;
+
     qrcode = QRcode_encodeString8bit(str, 0, 0);
-    uint8_t width = qrcode->width;
+    if(qrcode == NULL) return -1;
 
-    /*
-    for(int i = 0; i < 17; i++)
-    {
-        char stuff[50];
+    //modules go straight from the encoder output into the screen
+    size = tcmp441_blit_qr(&fb, x, y, qrcode->data, qrcode->width, scale, quiet);
 
-        sprintf(stuff, "%x", (*qrcode).data[i]);
-        writeStringAtLocation(stuff, 0, i * 8 * 2, 2);
-    }
-    */
+    QRcode_free(qrcode);
+    return size;
+}
 
-    uint8_t grid[width][width];
+//write a qr code to the screen in the upper left corner, 8x8 pixels per
+//module. Can handle up to 106 characters
+void tcmp441_writeQRcode(char *str)
+{
+    tcmp441_writeQRcodeAt(str, 0, 0, 8, 0);
+}
 
-    for(int i = 0; i < width * width; i++)
-    {
-        int x = i % width;
-        int y = i / width;
+uint8_t tx[6] = {0x30, 0x01, 0x01, 0x00, 0x00, 0x00};
+uint8_t rx[256] = {0};
 
-        grid[x][y] = (*qrcode).data[i] & 1;
-    }
-    
-    tcmp441_insertBigPixelGrid(width, width, grid, 10, 10);
+// RTC1 is running whenever app_timer is, use it to time refreshes
+static uint32_t rtc_ticks()
+{
+    return NRF_RTC1->COUNTER;
+}
 
+static uint32_t rtc_ticks_to_ms(uint32_t start, uint32_t end)
+{
+    return (((end - start) & 0x00FFFFFF) * 1000) / 32768;
 }
 
-//update display
-uint8_t tx[6] = {0x30, 0x01, 0x01, 0x00, 0x00, 0x00};
-uint8_t rx[256] = {0};
-void tcmp441_updateDisplay()
-{   
+static bool display_enabled = false;
+
+// Returns true if the controller was off and still needs time to start
+static bool power_display()
+{
+    if(display_enabled) return false;
+
     nrf_gpio_pin_clear(nTC_EN);
+    display_enabled = true;
+    return true;
+}
 
-    // Need to wait 6.5 ms per datasheet (section 5.5)
-    // Up that a little to be safe and who cares about a couple ms
-    nrf_delay_ms(10);
+static void enable_display()
+{
+    if(power_display()){
+        // Need to wait 6.5 ms per datasheet (section 5.5)
+        // Up that a little to be safe and who cares about a couple ms
+        nrf_delay_ms(10);
+    }
+}
 
-    memset(rx, 0, 256 * sizeof(uint8_t));
-    tx[0] = 0x30;
-    tx[1] = 0x01;
-    tx[2] = 0x01;
-    tx[3] = 0x00;
-    tx[4] = 0x00;
-    tx[5] = 0x00;
+static void disable_display()
+{
+#ifndef TCMP441_KEEP_ENABLED
+    nrf_gpio_pin_set(nTC_EN);
+    display_enabled = false;
+#endif
+}
 
-    uint8_t pic[255];
+// Works out what needs to go to the controller. Returns the last image
+// packet to send, or -1 if nothing changed.
+static int plan_upload()
+{
+    int last_packet = -1;
+
+    for(int p = 0; p < TCMP441_PACKETS; p++){
+        if(packet_dirty(p)){
+#ifdef TCMP441_KEEP_ENABLED
+            last_packet = p;
+#else
+            // The controller lost the old image, it all goes out
+            return TCMP441_PACKETS - 1;
+#endif
+        }
+    }
+    return last_packet;
+}
 
+// Upload command with the 16 byte image header
+static void build_image_header(uint8_t* pic)
+{
     // Setup spi comm header
     pic[0] = 0x20;
     pic[1] = 0x01;
@@ -586,54 +636,464 @@ void tcmp441_updateDisplay()
     pic[9] = 0x01; // 1 bit
     // pic[10] = 0x02; // image pixel data format type 2
     pic[10] = 0x00; // image pixel data format type 0
-    pic[11] = 0; // reserved
-    pic[12] = 0;
-    pic[13] = 0;
-    pic[14] = 0;
-    pic[15] = 0;
-    pic[16] = 0;
-    pic[17] = 0;
-    pic[18] = 0;
-    pic[19] = 0;
+    memset(pic + 11, 0, 9); // reserved
+}
 
-    // Send header
-    nrf_drv_spi_transfer(&_spi, pic, 20, NULL, 0);
-    wait_for_not_busy();//THIS LINE FRICKEN MESSES EVERYTHING UP
+// Set while a compressed image is being shown instead of the screen
+static bool from_image = false;
+static tcmp441_image_decoder_t image_source;
 
-    nrf_drv_spi_transfer(&_spi, NULL, 0, rx, 2);
+// Upload command with one packet of the screen, or of the image being shown.
+// Packets always go out in order, so the image decodes straight into them.
+static void build_image_packet(uint8_t* pic, int packet)
+{
+    pic[0] = 0x20;
+    pic[1] = 0x01;
+    pic[2] = 0x00;
+    pic[3] = TCMP441_PACKET_BYTES;
+
+    if(from_image){
+        int n = tcmp441_image_read(&image_source, pic + 4, TCMP441_PACKET_BYTES);
+        if(n < 0) n = 0;
+        memset(pic + 4 + n, 0, TCMP441_PACKET_BYTES - n);
+        return;
+    }
+
+    memcpy(pic + 4, screen + (packet * TCMP441_PACKET_BYTES), TCMP441_PACKET_BYTES);
+}
+
+// Send a command and read back its 2 byte status
+static void send_command(uint8_t* buf, uint8_t len)
+{
+    spi_bus_transfer(&_display, buf, len, NULL, 0);
+    wait_for_not_busy();
+    spi_bus_transfer(&_display, NULL, 0, rx, 2);
     wait_for_not_busy();
 
-    uint8_t i;
+    refresh_stats.bytes_sent += len + 2;
+}
+
+static bool upload_running();
+
+// Send packets 0 to last_packet and refresh, waiting for every step
+static void upload_blocking(int last_packet)
+{
+    uint8_t pic[255];
+
+    enable_display();
+
+#ifdef TCMP441_KEEP_ENABLED
+    // The controller still holds the last image. Upload data has no address,
+    // it always starts at the data pointer, so rewind it and stop after the
+    // last changed packet.
+    tx[0] = 0x20;
+    tx[1] = 0x0D;
+    tx[2] = 0x00;
+    send_command(tx, 3);
+#endif
+
+    // Send header
+    build_image_header(pic);
+    send_command(pic, 20);
 
     // display an image
-    pic[3] = 250;
-    for (i=0; i<60; i++) {
-        memcpy(pic+4, screen+(i*250), 250); // screen logo
-        //memset(pic+4, 0xFF, 250); // Black screen
-        //memset(pic+4, 0x00, 250); // White screen
-
-        nrf_drv_spi_transfer(&_spi, pic, 254, NULL, 0);
-        wait_for_not_busy();
-        nrf_drv_spi_transfer(&_spi, NULL, 0, rx, 2);
-        wait_for_not_busy();
+    for (int i=0; i<=last_packet; i++) {
+        build_image_packet(pic, i);
+        send_command(pic, 254);
+        refresh_stats.packets_sent++;
     }
 
     // Actually render the image
     tx[0] = 0x24;
     tx[1] = 0x01;
     tx[2] = 0x00;
+    send_command(tx, 3);
 
-    nrf_drv_spi_transfer(&_spi, tx, 3, NULL, 0);
-    wait_for_not_busy();
-    nrf_drv_spi_transfer(&_spi, NULL, 0, rx, 2);
-    wait_for_not_busy();
+    disable_display();
+}
 
+//update display
+void tcmp441_updateDisplay()
+{   
+    uint32_t start = rtc_ticks();
+    int last_packet;
 
-    nrf_gpio_pin_set(nTC_EN);
+    if(upload_running()) return;
+
+    memset(&refresh_stats, 0, sizeof(refresh_stats));
+
+    // Find what changed. Nothing changed means nothing to do.
+    last_packet = plan_upload();
+    if(last_packet < 0){
+        refresh_stats.skipped = true;
+        return;
+    }
+
+    upload_blocking(last_packet);
+
+    memset(dirty_rows, 0, sizeof(dirty_rows));
+    refresh_stats.time_ms = rtc_ticks_to_ms(start, rtc_ticks());
+}
+
+//show a compressed image (see tcmp441_image.h) without touching the screen
+//buffer. returns 0, or -1 if the image is not valid
+int tcmp441_showImage(const uint8_t* image)
+{
+    uint32_t start = rtc_ticks();
+
+    if(upload_running()) return -1;
+    if(tcmp441_image_open(&image_source, image) != 0) return -1;
+
+    memset(&refresh_stats, 0, sizeof(refresh_stats));
+
+    from_image = true;
+    upload_blocking(TCMP441_PACKETS - 1);
+    from_image = false;
+
+    // The display no longer matches the screen buffer
+    tcmp441_markAllDirty();
+    refresh_stats.time_ms = rtc_ticks_to_ms(start, rtc_ticks());
+    return 0;
+}
+
+//decode a compressed image into the screen buffer, to draw on top of it
+int tcmp441_loadImage(const uint8_t* image)
+{
+    tcmp441_image_decoder_t dec;
+
+    if(tcmp441_image_open(&dec, image) != 0) return -1;
+    if(tcmp441_image_read(&dec, screen, TCMP441_SCREEN_BYTES) != TCMP441_SCREEN_BYTES) return -1;
+
+    tcmp441_markAllDirty();
+    return 0;
+}
+
+// Background upload
+//
+// The same command sequence as tcmp441_updateDisplay(), driven by events
+// instead of waiting. Every command is sent, then the controller pulses BUSY
+// low while it works, then the 2 byte status is read, and BUSY pulses again.
+// BUSY going back high is caught by GPIOTE, transfers finish in the SPI
+// interrupt, and the 10 ms power up wait runs on an app_timer. While one
+// packet is going out, the next one is copied into the other buffer.
+
+#ifndef TCMP441_BUSY_TIMEOUT_MS
+#define TCMP441_BUSY_TIMEOUT_MS 5000
+#endif
+
+#define STEP_RESET_POINTER (-2)
+#define STEP_HEADER        (-1)
+// Steps 0 to last_packet are the image, last_packet+1 is the display update
+
+typedef enum {
+    UPLOAD_IDLE,
+    UPLOAD_POWER_UP,
+    UPLOAD_COMMAND,
+    UPLOAD_STATUS,
+} upload_state_t;
+
+static struct {
+    volatile upload_state_t state;
+    int                     step;
+    int                     last_packet;
+
+    // Double buffered commands, one sending and one being prepared
+    uint8_t                 buf[2][254];
+    uint8_t                 len[2];
+    uint8_t                 current;
+    uint8_t                 status[2];
+
+    // A command or status read is finished once both of these are set
+    volatile bool           spi_done;
+    volatile bool           busy_done;
+
+    spi_bus_segment_t       segment;
+    spi_bus_transaction_t   transaction;
+    tcmp441_callback_t      callback;
+    uint32_t                start;
+} upload;
+
+APP_TIMER_DEF(upload_timer);
+static bool upload_initialized = false;
+
+static bool upload_running()
+{
+    return upload.state != UPLOAD_IDLE;
+}
+
+static int upload_first_step()
+{
+#ifdef TCMP441_KEEP_ENABLED
+    return STEP_RESET_POINTER;
+#else
+    return STEP_HEADER;
+#endif
+}
+
+// Fill a buffer with the command for a step. Returns its length, or 0 if
+// the upload is past its last step.
+static uint8_t upload_prepare(int step, uint8_t* buf)
+{
+    if(step == STEP_RESET_POINTER){
+        buf[0] = 0x20;
+        buf[1] = 0x0D;
+        buf[2] = 0x00;
+        return 3;
+    }
+    if(step == STEP_HEADER){
+        build_image_header(buf);
+        return 20;
+    }
+    if(step <= upload.last_packet){
+        build_image_packet(buf, step);
+        return 254;
+    }
+    if(step == upload.last_packet + 1){
+        // Actually render the image
+        buf[0] = 0x24;
+        buf[1] = 0x01;
+        buf[2] = 0x00;
+        return 3;
+    }
+    return 0;
+}
+
+static void upload_spi_done(spi_bus_transaction_t* transaction);
+
+// Start a command or status transfer and watch for the BUSY pulse after it.
+// BUSY idles high, so a rising edge can only come after the pulse.
+static void upload_transfer(const uint8_t* tx, uint8_t tx_len, uint8_t* rx, uint8_t rx_len)
+{
+    upload.spi_done = false;
+    upload.busy_done = false;
+
+    nrf_drv_gpiote_in_event_enable(nTC_BUSY, true);
+    app_timer_start(upload_timer, APP_TIMER_TICKS(TCMP441_BUSY_TIMEOUT_MS, 0), NULL);
+
+    upload.segment.tx     = tx;
+    upload.segment.tx_len = tx_len;
+    upload.segment.rx     = rx;
+    upload.segment.rx_len = rx_len;
+
+    upload.transaction.device       = &_display;
+    upload.transaction.segments     = &upload.segment;
+    upload.transaction.num_segments = 1;
+    upload.transaction.callback     = upload_spi_done;
+
+    spi_bus_queue(&upload.transaction);
+}
+
+// Send the command in the current buffer and get the next one ready
+static void upload_send_current()
+{
+    upload.state = UPLOAD_COMMAND;
+    upload_transfer(upload.buf[upload.current], upload.len[upload.current], NULL, 0);
+
+    upload.len[upload.current ^ 1] = upload_prepare(upload.step + 1, upload.buf[upload.current ^ 1]);
+}
+
+static void upload_finish()
+{
+    tcmp441_callback_t callback = upload.callback;
+
+    disable_display();
+    refresh_stats.time_ms = rtc_ticks_to_ms(upload.start, rtc_ticks());
+
+    if(from_image){
+        from_image = false;
+        tcmp441_markAllDirty();
+    }
+
+    led_off(LED2);
+    upload.state = UPLOAD_IDLE;
+
+    if(callback) callback();
+}
+
+// Called whenever a transfer or BUSY pulse finishes, moves on once both have
+static void upload_event()
+{
+    bool both;
+
+    CRITICAL_REGION_ENTER();
+    both = upload.spi_done && upload.busy_done;
+    if(both){
+        upload.spi_done = false;
+        upload.busy_done = false;
+    }
+    CRITICAL_REGION_EXIT();
+
+    if(!both) return;
+
+    if(upload.state == UPLOAD_COMMAND){
+        upload.state = UPLOAD_STATUS;
+        upload_transfer(NULL, 0, upload.status, 2);
+        return;
+    }
+
+    // Status is in, that command is done
+    refresh_stats.bytes_sent += upload.len[upload.current] + 2;
+    if(upload.step >= 0 && upload.step <= upload.last_packet){
+        refresh_stats.packets_sent++;
+    }
+
+    upload.step++;
+    upload.current ^= 1;
+
+    if(upload.len[upload.current] == 0){
+        upload_finish();
+    }else{
+        upload_send_current();
+    }
+}
+
+static void upload_spi_done(spi_bus_transaction_t* transaction)
+{
+    upload.spi_done = true;
+    upload_event();
+}
+
+static void upload_busy_handler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
+{
+    if(upload.state != UPLOAD_COMMAND && upload.state != UPLOAD_STATUS) return;
+
+    nrf_drv_gpiote_in_event_disable(nTC_BUSY);
+    app_timer_stop(upload_timer);
+
+    // Then wait a little longer so we don't violate the T_NS time.
+    nrf_delay_us(5);
+
+    upload.busy_done = true;
+    upload_event();
+}
+
+static void upload_timer_handler(void* context)
+{
+    if(upload.state == UPLOAD_POWER_UP){
+        // Controller is up, start sending
+        upload_send_current();
+        return;
+    }
+
+    // BUSY never came back. Carry on like wait_for_not_busy() does.
+    nrf_drv_gpiote_in_event_disable(nTC_BUSY);
+    upload.busy_done = true;
+    upload_event();
+}
+
+static uint32_t upload_init()
+{
+    uint32_t err;
+    nrf_drv_gpiote_in_config_t busy_config = GPIOTE_CONFIG_IN_SENSE_LOTOHI(true);
+
+    if(upload_initialized) return NRF_SUCCESS;
+
+    if(!nrf_drv_gpiote_is_init()){
+        err = nrf_drv_gpiote_init();
+        if(err != NRF_SUCCESS) return err;
+    }
+
+    busy_config.pull = NRF_GPIO_PIN_NOPULL;
+    err = nrf_drv_gpiote_in_init(nTC_BUSY, &busy_config, upload_busy_handler);
+    if(err != NRF_SUCCESS) return err;
+
+    err = app_timer_create(&upload_timer, APP_TIMER_MODE_SINGLE_SHOT, upload_timer_handler);
+    if(err != NRF_SUCCESS) return err;
+
+    upload_initialized = true;
+    return NRF_SUCCESS;
 }
 
-//set up led and spi
+static uint32_t upload_start(int last_packet, tcmp441_callback_t callback)
+{
+    upload.last_packet = last_packet;
+    upload.callback = callback;
+    upload.step = upload_first_step();
+    upload.current = 0;
+    upload.len[0] = upload_prepare(upload.step, upload.buf[0]);
+
+    led_on(LED2);
+
+    if(power_display()){
+        upload.state = UPLOAD_POWER_UP;
+        app_timer_start(upload_timer, APP_TIMER_TICKS(10, 0), NULL);
+    }else{
+        upload_send_current();
+    }
+
+    return NRF_SUCCESS;
+}
+
+static uint32_t upload_check()
+{
+    if(upload_running()) return NRF_ERROR_BUSY;
+    if(!_display.bus->async) return NRF_ERROR_INVALID_STATE;
+
+    return upload_init();
+}
+
+//update the display in the background
+uint32_t tcmp441_updateDisplayAsync(tcmp441_callback_t callback)
+{
+    uint32_t err;
+    int last_packet;
+
+    err = upload_check();
+    if(err != NRF_SUCCESS) return err;
+
+    memset(&refresh_stats, 0, sizeof(refresh_stats));
+    upload.start = rtc_ticks();
+
+    last_packet = plan_upload();
+    if(last_packet < 0){
+        refresh_stats.skipped = true;
+        if(callback) callback();
+        return NRF_SUCCESS;
+    }
+
+    // Anything drawn from now on goes out with the next update
+    memset(dirty_rows, 0, sizeof(dirty_rows));
+
+    return upload_start(last_packet, callback);
+}
+
+//show a compressed image in the background
+uint32_t tcmp441_showImageAsync(const uint8_t* image, tcmp441_callback_t callback)
+{
+    uint32_t err;
+
+    err = upload_check();
+    if(err != NRF_SUCCESS) return err;
+
+    if(tcmp441_image_open(&image_source, image) != 0) return NRF_ERROR_INVALID_DATA;
+
+    memset(&refresh_stats, 0, sizeof(refresh_stats));
+    upload.start = rtc_ticks();
+
+    from_image = true;
+    return upload_start(TCMP441_PACKETS - 1, callback);
+}
+
+bool tcmp441_isUpdating()
+{
+    return upload_running();
+}
+
+//what the last tcmp441_updateDisplay() did
+void tcmp441_getRefreshStats(tcmp441_refresh_stats_t* stats)
+{
+    *stats = refresh_stats;
+}
+
+//set up led and spi on a private spi bus
 void tcmp441_init(int led0, int led1, int led2, int ntc_en, int ntc_busy, int ntc_cs)
+{
+    spi_bus_init(&_own_bus, &_spi, APP_IRQ_PRIORITY_LOW, true);
+    tcmp441_init_with_bus(&_own_bus, led0, led1, led2, ntc_en, ntc_busy, ntc_cs);
+}
+
+//set up led and spi, sharing an spi bus with other devices
+void tcmp441_init_with_bus(spi_bus_t* bus, int led0, int led1, int led2, int ntc_en, int ntc_busy, int ntc_cs)
 {
     //define
     LED0 = led0;
@@ -646,12 +1106,9 @@ void tcmp441_init(int led0, int led1, int led2, int ntc_en, int ntc_busy, int nt
 
     tcmp441_clearScreen();
 
-    led_init(LED0);
-    led_off(LED0);
-    led_init(LED1);
-    led_off(LED1);
-    led_init(LED2);
-    led_off(LED2);
+    // All three off with one write
+    const pin_group_t leds = LED_GROUP(LED0, LED1, LED2);
+    pin_group_init(&leds);
 
     // Setup input for busy
     nrf_gpio_cfg_input(nTC_BUSY, NRF_GPIO_PIN_NOPULL);
@@ -661,20 +1118,20 @@ void tcmp441_init(int led0, int led1, int led2, int ntc_en, int ntc_busy, int nt
     
 
     // Setup SPI
-    spi_init();
+    spi_init(bus);
 
     //uint8_t tx[6] = {0x30, 0x01, 0x01, 0x00, 0x00, 0x00};
     //uint8_t rx[256] = {0};
 
     // Get device id to check that we can comm with this display
     // Send the command
-    nrf_drv_spi_transfer(&_spi, tx, 4, NULL, 0);
+    spi_bus_transfer(&_display, tx, 4, NULL, 0);
 
     // Wait until no longer busy
     wait_for_not_busy();
 
     // Receive response
-    nrf_drv_spi_transfer(&_spi, NULL, 0, rx, 28);
+    spi_bus_transfer(&_display, NULL, 0, rx, 28);
 
     // Not sure, sometimes busy signal, sometimes not?
     // Just wait for a hot sec for now
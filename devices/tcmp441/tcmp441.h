@@ -4,21 +4,55 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "spi_bus.h"
+
+#define TCMP441_WIDTH           400
+#define TCMP441_HEIGHT          300
+#define TCMP441_ROW_BYTES       (TCMP441_WIDTH / 8)
+#define TCMP441_SCREEN_BYTES    (TCMP441_ROW_BYTES * TCMP441_HEIGHT)
+#define TCMP441_PACKET_BYTES    250
+#define TCMP441_PACKETS         (TCMP441_SCREEN_BYTES / TCMP441_PACKET_BYTES)
+#define TCMP441_ROWS_PER_PACKET (TCMP441_PACKET_BYTES / TCMP441_ROW_BYTES)
+
+typedef struct {
+    bool     skipped;      // nothing changed, so nothing was sent
+    uint8_t  packets_sent; // image packets, out of TCMP441_PACKETS
+    uint32_t bytes_sent;   // all SPI bytes, including commands and status
+    uint32_t time_ms;      // only valid if app_timer (RTC1) is running
+} tcmp441_refresh_stats_t;
+
+// Called from interrupt context when a background update is done
+typedef void (*tcmp441_callback_t)(void);
+
 void tcmp441_clearScreen();
 
 void tcmp441_init(int led0, int led1, int led2, int ntc_en, int ntc_busy, int ntc_cs);
+void tcmp441_init_with_bus(spi_bus_t* bus, int led0, int led1, int led2, int ntc_en, int ntc_busy, int ntc_cs);
 
 void tcmp441_updateDisplay();
+uint32_t tcmp441_updateDisplayAsync(tcmp441_callback_t callback);
+bool tcmp441_isUpdating();
+
+// Compressed images, see tcmp441_image.h and tools/epd_image
+int tcmp441_showImage(const uint8_t* image);
+uint32_t tcmp441_showImageAsync(const uint8_t* image, tcmp441_callback_t callback);
+int tcmp441_loadImage(const uint8_t* image);
+void tcmp441_getRefreshStats(tcmp441_refresh_stats_t* stats);
+void tcmp441_markAllDirty();
 
 //on = 1 or 0
 void tcmp441_setPixel(int x, int y, int on);
 
 void tcmp441_insertPixelGrid(int width, int height, uint8_t grid[height][width], int xcoord, int ycoord);
 void tcmp441_setBlock(int x, int y, int on);
+void tcmp441_fillRect(int x, int y, int width, int height, int on);
+void tcmp441_drawHLine(int x0, int x1, int y, int on);
+void tcmp441_drawBitmap(const uint8_t* bits, int stride, int width, int height, int xcoord, int ycoord);
 void tcmp441_insertBigPixelGrid(int width, int height, uint8_t grid[height][width], int xcoord, int ycoord);
 
 void tcmp441_writeCharacterAtLocation(char character, int xcoord, int ycoord, uint8_t scale);
 void tcmp441_writeStringAtLocation(char *str, int x, int y, int scale);
 
 void tcmp441_writeQRcode(char *str);
+int tcmp441_writeQRcodeAt(char *str, int x, int y, int scale, int quiet);
 
@@ -0,0 +1,286 @@
+// Blitter for the TCM-P441 framebuffer
+//
+// Everything is done a row at a time on whole bytes. Only the first and last
+// byte of a row segment need a read-modify-write, everything in between is a
+// plain byte store, and when source and destination line up a straight copy.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "tcmp441_blit.h"
+
+// Widest row the glyph and grid paths pack at once
+#define MAX_ROW_BYTES 64
+
+// Mask of bits [lo, hi) in a byte, bit 0 being the MSB
+static inline uint8_t bit_mask (int lo, int hi) {
+    return (uint8_t)((0xFF >> lo) & (0xFF << (8 - hi)));
+}
+
+static inline void mark_dirty (tcmp441_fb_t* fb, int y) {
+    if (fb->dirty) fb->dirty[y >> 3] |= 1 << (y & 7);
+}
+
+// Store v into *d under mask, returns the bits that changed
+static inline uint8_t merge (uint8_t* d, uint8_t v, uint8_t mask) {
+    uint8_t old = *d;
+    *d = (old & ~mask) | (v & mask);
+    return old ^ *d;
+}
+
+// Clip a rectangle to the framebuffer. Returns false if nothing is left.
+// sx and sy are how much was cut off the left and top.
+static bool clip (tcmp441_fb_t* fb, int* x, int* y, int* w, int* h, int* sx, int* sy) {
+    *sx = 0;
+    *sy = 0;
+
+    if (*x < 0) { *sx = -*x; *w += *x; *x = 0; }
+    if (*y < 0) { *sy = -*y; *h += *y; *y = 0; }
+    if (*x + *w > fb->width)  *w = fb->width - *x;
+    if (*y + *h > fb->height) *h = fb->height - *y;
+
+    return *w > 0 && *h > 0;
+}
+
+// Fill bits [x, x+w) of a row. Returns nonzero if anything changed.
+static uint8_t fill_row (uint8_t* row, int x, int w, uint8_t v) {
+    uint8_t* d = row + (x >> 3);
+    int lo = x & 7;
+    uint8_t changed = 0;
+
+    if (lo + w <= 8) {
+        return merge(d, v, bit_mask(lo, lo + w));
+    }
+
+    if (lo) {
+        changed |= merge(d++, v, bit_mask(lo, 8));
+        w -= 8 - lo;
+    }
+    for (; w >= 8; w -= 8, d++) {
+        changed |= *d ^ v;
+        *d = v;
+    }
+    if (w) {
+        changed |= merge(d, v, bit_mask(0, w));
+    }
+    return changed;
+}
+
+// Copy w bits starting at bit sx of src to bit dx of dst. Returns nonzero
+// if anything changed.
+static uint8_t copy_row (uint8_t* dst, int dx, const uint8_t* src, int sx, int w) {
+    uint8_t changed = 0;
+    int dlo = dx & 7;
+    int slo = sx & 7;
+
+    dst += dx >> 3;
+    src += sx >> 3;
+
+    if (dlo == slo) {
+        // Source and destination line up, whole bytes copy straight over
+        int n;
+
+        if (dlo + w <= 8) {
+            return merge(dst, *src, bit_mask(dlo, dlo + w));
+        }
+        if (dlo) {
+            changed |= merge(dst++, *src++, bit_mask(dlo, 8));
+            w -= 8 - dlo;
+        }
+        n = w >> 3;
+        if (memcmp(dst, src, n) != 0) {
+            memcpy(dst, src, n);
+            changed = 1;
+        }
+        dst += n;
+        src += n;
+        w &= 7;
+        if (w) {
+            changed |= merge(dst, *src, bit_mask(0, w));
+        }
+        return changed;
+    }
+
+    // Shifted copy. Each destination byte comes out of a 16 bit window over
+    // two neighbouring source bytes. Source bytes outside the ones holding
+    // our w bits are never read.
+    {
+        int end = dlo + w;
+        int nsrc = (slo + w + 7) >> 3;
+        int shift = slo - dlo;
+        int k;
+
+        for (k = 0; k * 8 < end; k++) {
+            uint16_t window;
+            int lo = (k == 0) ? dlo : 0;
+            int hi = (end - k * 8 < 8) ? end - k * 8 : 8;
+            int s;
+
+            if (shift > 0) {
+                // Source runs ahead: byte k of dst starts inside src[k]
+                s = k;
+                window = (uint16_t)(src[s] << 8);
+                if (s + 1 < nsrc) window |= src[s + 1];
+                window <<= shift;
+            } else {
+                // Source lags: byte k of dst starts inside src[k-1]
+                s = k - 1;
+                window = 0;
+                if (s >= 0) window = (uint16_t)(src[s] << 8);
+                if (s + 1 < nsrc) window |= src[s + 1];
+                window <<= 8 + shift;
+            }
+
+            if (lo == 0 && hi == 8) {
+                changed |= dst[k] ^ (uint8_t)(window >> 8);
+                dst[k] = window >> 8;
+            } else {
+                changed |= merge(&dst[k], window >> 8, bit_mask(lo, hi));
+            }
+        }
+    }
+    return changed;
+}
+
+
+void tcmp441_blit_span (tcmp441_fb_t* fb, int x0, int x1, int y, int on) {
+    tcmp441_blit_fill(fb, x0, y, x1 - x0 + 1, 1, on);
+}
+
+void tcmp441_blit_fill (tcmp441_fb_t* fb, int x, int y, int w, int h, int on) {
+    int sx, sy;
+    uint8_t v = on ? 0xFF : 0x00;
+
+    if (!clip(fb, &x, &y, &w, &h, &sx, &sy)) return;
+
+    for (int row = y; row < y + h; row++) {
+        if (fill_row(fb->buf + row * fb->stride, x, w, v)) mark_dirty(fb, row);
+    }
+}
+
+void tcmp441_blit_bits (tcmp441_fb_t* fb, int x, int y,
+                        const uint8_t* src, int src_stride, int w, int h) {
+    int sx, sy;
+
+    if (!clip(fb, &x, &y, &w, &h, &sx, &sy)) return;
+
+    src += sy * src_stride;
+    for (int row = y; row < y + h; row++, src += src_stride) {
+        if (copy_row(fb->buf + row * fb->stride, x, src, sx, w)) mark_dirty(fb, row);
+    }
+}
+
+// Pack n one-byte-per-pixel values into bits
+static void pack_row (uint8_t* packed, const uint8_t* g, int n) {
+    uint8_t v = 0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        v = (v << 1) | (g[i] == 1);
+        if ((i & 7) == 7) packed[i >> 3] = v;
+    }
+    if (n & 7) packed[n >> 3] = v << (8 - (n & 7));
+}
+
+void tcmp441_blit_grid (tcmp441_fb_t* fb, int x, int y,
+                        const uint8_t* grid, int w, int h) {
+    uint8_t packed[MAX_ROW_BYTES];
+    int sx, sy;
+    int cw = w, ch = h;
+
+    if (!clip(fb, &x, &y, &cw, &ch, &sx, &sy)) return;
+
+    for (int row = 0; row < ch; row++) {
+        const uint8_t* g = grid + (sy + row) * w + sx;
+
+        // Pack what is visible of the row, MAX_ROW_BYTES*8 pixels at a time
+        for (int done = 0; done < cw; done += MAX_ROW_BYTES * 8) {
+            int n = cw - done;
+            if (n > MAX_ROW_BYTES * 8) n = MAX_ROW_BYTES * 8;
+
+            pack_row(packed, g + done, n);
+
+            if (copy_row(fb->buf + (y + row) * fb->stride, x + done, packed, 0, n)) {
+                mark_dirty(fb, y + row);
+            }
+        }
+    }
+}
+
+// Font rows have the leftmost pixel in bit 0, the framebuffer in bit 7
+static inline uint8_t reverse_bits (uint8_t b) {
+    b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
+    b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
+    b = (b & 0xAA) >> 1 | (b & 0x55) << 1;
+    return b;
+}
+
+void tcmp441_blit_glyph (tcmp441_fb_t* fb, int x, int y,
+                         const uint8_t glyph[8], int scale) {
+    uint8_t rows[8][MAX_ROW_BYTES];
+    int sx, sy;
+    int w = 8 * scale, h = 8 * scale;
+
+    if (scale < 1 || scale > MAX_ROW_BYTES) return;
+    if (!clip(fb, &x, &y, &w, &h, &sx, &sy)) return;
+
+    // Expand every glyph row horizontally once, then stamp each of them
+    // scale times. A glyph row of 8 pixels becomes exactly `scale` bytes.
+    for (int r = sy / scale; r <= (sy + h - 1) / scale; r++) {
+        uint8_t bits = reverse_bits(glyph[r]);
+
+        if (scale == 1) {
+            rows[r][0] = bits;
+            continue;
+        }
+
+        memset(rows[r], 0, scale);
+        for (int i = 0; i < 8; i++) {
+            if (bits & (0x80 >> i)) fill_row(rows[r], i * scale, scale, 0xFF);
+        }
+    }
+
+    for (int r = 0; r < h; r++) {
+        if (copy_row(fb->buf + (y + r) * fb->stride, x, rows[(sy + r) / scale], sx, w)) {
+            mark_dirty(fb, y + r);
+        }
+    }
+}
+
+int tcmp441_blit_qr (tcmp441_fb_t* fb, int x, int y,
+                     const uint8_t* modules, int width, int scale, int quiet) {
+    uint8_t row[MAX_ROW_BYTES];
+    int size = (width + 2 * quiet) * scale;
+
+    if (scale < 1 || quiet < 0 || size > MAX_ROW_BYTES * 8) return -1;
+
+    // Quiet zone above and below, the sides are part of every row
+    tcmp441_blit_fill(fb, x, y, size, quiet * scale, 0);
+    tcmp441_blit_fill(fb, x, y + size - quiet * scale, size, quiet * scale, 0);
+
+    for (int my = 0; my < width; my++) {
+        const uint8_t* m = modules + my * width;
+        int ry = y + (quiet + my) * scale;
+
+        if (ry + scale <= 0 || ry >= fb->height) continue;
+
+        // Build the row once with runs of dark modules filled in whole
+        // bytes where they can be, then repeat it for all `scale` rows
+        memset(row, 0, (size + 7) >> 3);
+        for (int mx = 0; mx < width; ) {
+            int start;
+
+            if (!(m[mx] & 1)) {
+                mx++;
+                continue;
+            }
+            for (start = mx; mx < width && (m[mx] & 1); mx++);
+            fill_row(row, (quiet + start) * scale, (mx - start) * scale, 0xFF);
+        }
+
+        tcmp441_blit_bits(fb, x, ry, row, 0, size, scale);
+    }
+
+    return size;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// 1 bit per pixel framebuffer, most significant bit is the leftmost pixel,
+// rows are `stride` bytes apart. Matches what the TCM-P441 expects.
+//
+// `dirty`, if not NULL, is a bitmap with one bit per row. The blit functions
+// set the bit of every row in which they actually changed a byte.
+typedef struct {
+    uint8_t* buf;
+    uint8_t* dirty;
+    int      width;
+    int      height;
+    int      stride;
+} tcmp441_fb_t;
+
+// Set or clear the pixels [x0, x1] of row y. Clipped to the framebuffer.
+void tcmp441_blit_span(tcmp441_fb_t* fb, int x0, int x1, int y, int on);
+
+// Set or clear a w x h rectangle. Clipped to the framebuffer.
+void tcmp441_blit_fill(tcmp441_fb_t* fb, int x, int y, int w, int h, int on);
+
+// Copy a packed 1 bit per pixel bitmap (same bit order as the framebuffer,
+// rows `src_stride` bytes apart) to (x, y). Clipped to the framebuffer.
+void tcmp441_blit_bits(tcmp441_fb_t* fb, int x, int y,
+                       const uint8_t* src, int src_stride, int w, int h);
+
+// Copy a grid with one byte per pixel (0 off, 1 on) to (x, y).
+void tcmp441_blit_grid(tcmp441_fb_t* fb, int x, int y,
+                       const uint8_t* grid, int w, int h);
+
+// Draw an 8x8 font glyph, each pixel becoming a scale x scale block.
+// Glyph rows use bit 0 as the leftmost pixel, like font8x8_basic.h.
+void tcmp441_blit_glyph(tcmp441_fb_t* fb, int x, int y,
+                        const uint8_t glyph[8], int scale);
+
+// Draw a QR code from libqrencode's module data (bit 0 of each byte set for
+// dark modules, `width` x `width` of them). Every module becomes a scale x
+// scale block, with `quiet` light modules of margin all around. The whole
+// code is (width + 2*quiet) * scale pixels wide, at most 512. Returns that
+// size, or -1 without drawing anything if it is larger.
+int tcmp441_blit_qr(tcmp441_fb_t* fb, int x, int y,
+                    const uint8_t* modules, int width, int scale, int quiet);
@@ -0,0 +1,80 @@
+// Decoder for compressed TCM-P441 images
+//
+// Streams, so the display driver can decode straight into each SPI packet
+// without a second 15 KB buffer.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "tcmp441_image.h"
+
+int tcmp441_image_open (tcmp441_image_decoder_t* dec, const uint8_t* image) {
+    uint16_t size;
+
+    if (image[0] != 'E' || image[1] != 'P') return -1;
+    if (image[2] != TCMP441_IMAGE_RAW && image[2] != TCMP441_IMAGE_PACKBITS) return -1;
+
+    dec->format    = image[2];
+    dec->remaining = image[4] | (image[5] << 8);
+    size           = image[6] | (image[7] << 8);
+    dec->src       = image + TCMP441_IMAGE_HEADER_SIZE;
+    dec->end       = dec->src + size;
+    dec->run       = 0;
+
+    if (dec->format == TCMP441_IMAGE_RAW && size < dec->remaining) return -1;
+    return 0;
+}
+
+int tcmp441_image_read (tcmp441_image_decoder_t* dec, uint8_t* out, uint16_t len) {
+    uint16_t done = 0;
+
+    if (len > dec->remaining) len = dec->remaining;
+
+    if (dec->format == TCMP441_IMAGE_RAW) {
+        memcpy(out, dec->src, len);
+        dec->src += len;
+        dec->remaining -= len;
+        return len;
+    }
+
+    while (done < len) {
+        uint16_t n;
+
+        if (dec->run == 0) {
+            uint8_t control;
+
+            if (dec->src >= dec->end) return -1;
+            control = *dec->src++;
+
+            if (control == 128) continue;
+            if (control < 128) {
+                dec->literal = true;
+                dec->run = control + 1;
+            } else {
+                if (dec->src >= dec->end) return -1;
+                dec->literal = false;
+                dec->run = 257 - control;
+                dec->value = *dec->src++;
+            }
+        }
+
+        // Whole runs (or what is left of one) at a time
+        n = len - done;
+        if (n > dec->run) n = dec->run;
+
+        if (dec->literal) {
+            if (dec->end - dec->src < n) return -1;
+            memcpy(out + done, dec->src, n);
+            dec->src += n;
+        } else {
+            memset(out + done, dec->value, n);
+        }
+
+        dec->run -= n;
+        done += n;
+    }
+
+    dec->remaining -= done;
+    return done;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Full screen images for the TCM-P441, as written by tools/epd_image.
+//
+//   magic[2]  'E' 'P'
+//   format    TCMP441_IMAGE_RAW or TCMP441_IMAGE_PACKBITS
+//   reserved
+//   length[2] bytes of image once decoded (little endian, 15000)
+//   size[2]   bytes of data that follow (little endian)
+//   data
+//
+// PackBits data is a series of runs, each starting with a control byte n:
+// 0 to 127 means the next n+1 bytes are copied as they are, 129 to 255
+// means the next byte is repeated 257-n times, and 128 is skipped.
+
+#define TCMP441_IMAGE_HEADER_SIZE 8
+#define TCMP441_IMAGE_RAW         0
+#define TCMP441_IMAGE_PACKBITS    1
+
+typedef struct {
+    const uint8_t* src;
+    const uint8_t* end;
+    uint8_t        format;
+    uint16_t       remaining;  // decoded bytes still to come
+    uint8_t        run;        // bytes left in the current run
+    bool           literal;    // current run is copied, not repeated
+    uint8_t        value;      // byte being repeated
+} tcmp441_image_decoder_t;
+
+// Start decoding an image. Returns 0, or -1 if the header is not valid.
+int tcmp441_image_open(tcmp441_image_decoder_t* dec, const uint8_t* image);
+
+// Decode the next len bytes of the image. Returns the number of bytes
+// written, which is less than len at the end of the image, or -1 if the
+// data is corrupt.
+int tcmp441_image_read(tcmp441_image_decoder_t* dec, uint8_t* out, uint16_t len);
@@ -0,0 +1,135 @@
+// Dithering and compression for TCM-P441 images
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tcmp441_image.h"
+#include "epd_encode.h"
+
+static const uint8_t bayer8[8][8] = {
+    { 0, 32,  8, 40,  2, 34, 10, 42},
+    {48, 16, 56, 24, 50, 18, 58, 26},
+    {12, 44,  4, 36, 14, 46,  6, 38},
+    {60, 28, 52, 20, 62, 30, 54, 22},
+    { 3, 35, 11, 43,  1, 33,  9, 41},
+    {51, 19, 59, 27, 49, 17, 57, 25},
+    {15, 47,  7, 39, 13, 45,  5, 37},
+    {63, 31, 55, 23, 61, 29, 53, 21},
+};
+
+static void set_black (uint8_t* screen, int x, int y) {
+    screen[y * (EPD_WIDTH / 8) + (x >> 3)] |= 0x80 >> (x & 7);
+}
+
+void epd_dither (const uint8_t* gray, int w, int h, epd_dither_t mode,
+                 int threshold, uint8_t* screen) {
+    int cw = w < EPD_WIDTH ? w : EPD_WIDTH;
+    int ch = h < EPD_HEIGHT ? h : EPD_HEIGHT;
+
+    memset(screen, 0, EPD_BYTES);
+
+    if (mode == EPD_DITHER_FLOYD) {
+        // Two rows of error, with a pixel of slack on either side
+        int* err  = calloc(cw + 2, sizeof(int));
+        int* next = calloc(cw + 2, sizeof(int));
+
+        for (int y = 0; y < ch; y++) {
+            memset(next, 0, (cw + 2) * sizeof(int));
+
+            for (int x = 0; x < cw; x++) {
+                int v = gray[y * w + x] + err[x + 1] / 16;
+                int e;
+
+                if (v < threshold) {
+                    set_black(screen, x, y);
+                    e = v;
+                } else {
+                    e = v - 255;
+                }
+
+                err[x + 2]  += e * 7;
+                next[x]     += e * 3;
+                next[x + 1] += e * 5;
+                next[x + 2] += e * 1;
+            }
+
+            int* t = err;
+            err = next;
+            next = t;
+        }
+
+        free(err);
+        free(next);
+        return;
+    }
+
+    for (int y = 0; y < ch; y++) {
+        for (int x = 0; x < cw; x++) {
+            int t = threshold;
+
+            if (mode == EPD_DITHER_ORDERED) {
+                t = bayer8[y & 7][x & 7] * 4 + 2;
+            }
+            if (gray[y * w + x] < t) set_black(screen, x, y);
+        }
+    }
+}
+
+size_t epd_packbits (const uint8_t* in, size_t len, uint8_t* out) {
+    size_t i = 0;
+    size_t o = 0;
+
+    while (i < len) {
+        size_t run = 1;
+
+        while (i + run < len && run < 128 && in[i + run] == in[i]) run++;
+
+        if (run >= 2) {
+            out[o++] = (uint8_t)(257 - run);
+            out[o++] = in[i];
+            i += run;
+            continue;
+        }
+
+        // Literal bytes, up to the start of the next run of 3 or more. A run
+        // of 2 costs as much either way and would split the literal.
+        size_t start = i++;
+        while (i < len && i - start < 128) {
+            if (i + 2 < len && in[i] == in[i + 1] && in[i] == in[i + 2]) break;
+            i++;
+        }
+
+        out[o++] = (uint8_t)(i - start - 1);
+        memcpy(out + o, in + start, i - start);
+        o += i - start;
+    }
+
+    return o;
+}
+
+size_t epd_make_image (const uint8_t* screen, int compress, uint8_t* out) {
+    size_t size = EPD_BYTES;
+    uint8_t format = TCMP441_IMAGE_RAW;
+
+    if (compress) {
+        size = epd_packbits(screen, EPD_BYTES, out + TCMP441_IMAGE_HEADER_SIZE);
+        format = TCMP441_IMAGE_PACKBITS;
+    }
+    if (size >= EPD_BYTES) {
+        memcpy(out + TCMP441_IMAGE_HEADER_SIZE, screen, EPD_BYTES);
+        size = EPD_BYTES;
+        format = TCMP441_IMAGE_RAW;
+    }
+
+    out[0] = 'E';
+    out[1] = 'P';
+    out[2] = format;
+    out[3] = 0;
+    out[4] = EPD_BYTES & 0xFF;
+    out[5] = EPD_BYTES >> 8;
+    out[6] = size & 0xFF;
+    out[7] = size >> 8;
+
+    return TCMP441_IMAGE_HEADER_SIZE + size;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+// Dithering and compression for TCM-P441 images. Host side only.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define EPD_WIDTH  400
+#define EPD_HEIGHT 300
+#define EPD_BYTES  (EPD_WIDTH / 8 * EPD_HEIGHT)
+
+typedef enum {
+    EPD_DITHER_NONE,     // plain threshold
+    EPD_DITHER_ORDERED,  // 8x8 Bayer matrix
+    EPD_DITHER_FLOYD,    // Floyd-Steinberg error diffusion
+} epd_dither_t;
+
+// Turn a w x h 8 bit grayscale image (0 black, 255 white) into the 1 bit
+// screen format, 1 for black, most significant bit leftmost. The image is
+// placed in the top left corner; anything outside the screen is cut off and
+// any uncovered screen is white.
+void epd_dither(const uint8_t* gray, int w, int h, epd_dither_t mode,
+                int threshold, uint8_t* screen);
+
+// PackBits compress len bytes. out needs room for len + len/128 + 1 bytes.
+// Returns the compressed size.
+size_t epd_packbits(const uint8_t* in, size_t len, uint8_t* out);
+
+// Build a complete image (header and data) from a screen. out needs room for
+// TCMP441_IMAGE_HEADER_SIZE + EPD_BYTES + EPD_BYTES/128 + 1 bytes. Falls
+// back to raw if compressing would not save anything. Returns the size.
+size_t epd_make_image(const uint8_t* screen, int compress, uint8_t* out);
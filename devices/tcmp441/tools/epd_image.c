@@ -0,0 +1,196 @@
+// Convert an image to the TCM-P441 screen format
+//
+// Reads a netpbm image (PBM, PGM or PPM, ascii or binary), dithers it to
+// 1 bit and writes it out compressed, either as C source to build into an
+// app or as a binary file. Anything else can be converted to netpbm first,
+// for example with ImageMagick:
+//
+//   convert friends.jpg friends.pgm
+//   ./epd_image -n friends friends.pgm friends.c
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tcmp441_image.h"
+#include "epd_encode.h"
+
+static void usage (void) {
+    fprintf(stderr,
+        "usage: epd_image [options] input.pnm [output]\n"
+        "  -d none|ordered|floyd  dithering (default ordered)\n"
+        "  -t 0-255               threshold for -d none/floyd (default 128)\n"
+        "  -i                     invert\n"
+        "  -r                     do not compress\n"
+        "  -b                     write a binary image instead of C source\n"
+        "  -n name                C array name (default img)\n");
+    exit(1);
+}
+
+// Next number in a netpbm header, skipping whitespace and comments
+static int pnm_number (FILE* f) {
+    int c, n = 0;
+
+    do {
+        c = fgetc(f);
+        if (c == '#') while (c != '\n' && c != EOF) c = fgetc(f);
+    } while (isspace(c));
+
+    if (!isdigit(c)) return -1;
+    while (isdigit(c)) {
+        n = n * 10 + (c - '0');
+        c = fgetc(f);
+    }
+    return n;
+}
+
+// Load any netpbm image as 8 bit gray, 0 black and 255 white
+static uint8_t* load_pnm (const char* path, int* w, int* h) {
+    FILE* f = fopen(path, "rb");
+    uint8_t* gray;
+    int type, maxval = 1, bad;
+
+    if (f == NULL) {
+        perror(path);
+        return NULL;
+    }
+    if (fgetc(f) != 'P' || (type = fgetc(f) - '0') < 1 || type > 6) {
+        fprintf(stderr, "%s: not a netpbm image\n", path);
+        fclose(f);
+        return NULL;
+    }
+
+    *w = pnm_number(f);
+    *h = pnm_number(f);
+    if (type != 1 && type != 4) maxval = pnm_number(f);
+    if (*w <= 0 || *h <= 0 || maxval <= 0 || maxval > 65535) {
+        fprintf(stderr, "%s: bad header\n", path);
+        fclose(f);
+        return NULL;
+    }
+
+    gray = malloc((size_t)*w * *h);
+    bad = 0;
+
+    for (int y = 0; y < *h; y++) {
+        int bits = 0, byte = 0;
+
+        for (int x = 0; x < *w; x++) {
+            int v = 0;
+
+            if (type == 1) {
+                v = pnm_number(f);
+                v = (v < 0) ? -1 : v ? 0 : maxval;
+            } else if (type == 4) {
+                if (bits == 0) { byte = fgetc(f); bits = 8; }
+                v = (byte < 0) ? -1 : (byte & 0x80) ? 0 : maxval;
+                byte <<= 1;
+                bits--;
+            } else {
+                int channels = (type == 3 || type == 6) ? 3 : 1;
+                int c[3];
+
+                for (int i = 0; i < channels; i++) {
+                    if (type <= 3) {
+                        c[i] = pnm_number(f);
+                    } else if (maxval > 255) {
+                        int hi = fgetc(f), lo = fgetc(f);
+                        c[i] = (hi < 0 || lo < 0) ? -1 : (hi << 8) | lo;
+                    } else {
+                        c[i] = fgetc(f);
+                    }
+                }
+                // Rec. 601 luma
+                v = c[0];
+                if (channels == 3) {
+                    v = (299 * c[0] + 587 * c[1] + 114 * c[2]) / 1000;
+                    if (c[0] < 0 || c[1] < 0 || c[2] < 0) v = -1;
+                }
+            }
+
+            if (v < 0) bad = 1;
+            gray[y * *w + x] = (uint8_t)((v * 255 + maxval / 2) / maxval);
+        }
+    }
+
+    if (bad) {
+        fprintf(stderr, "%s: image is cut short\n", path);
+        free(gray);
+        gray = NULL;
+    }
+    fclose(f);
+    return gray;
+}
+
+static void write_c (FILE* out, const char* name, const uint8_t* data, size_t len) {
+    fprintf(out, "// Generated by epd_image, decode with tcmp441_image_open()\n");
+    fprintf(out, "#include <stdint.h>\n\n");
+    fprintf(out, "const uint8_t %s[%zu] = {\n", name, len);
+    for (size_t i = 0; i < len; i++) {
+        fprintf(out, "%s0x%02x,%s", (i % 16) ? " " : "    ", data[i],
+                (i % 16 == 15 || i == len - 1) ? "\n" : "");
+    }
+    fprintf(out, "};\n");
+}
+
+int main (int argc, char** argv) {
+    epd_dither_t dither = EPD_DITHER_ORDERED;
+    int threshold = 128;
+    int invert = 0, compress = 1, binary = 0;
+    const char* name = "img";
+    uint8_t screen[EPD_BYTES];
+    uint8_t image[TCMP441_IMAGE_HEADER_SIZE + EPD_BYTES + EPD_BYTES / 128 + 1];
+    uint8_t* gray;
+    size_t size;
+    int opt, w, h;
+    FILE* out = stdout;
+
+    while ((opt = getopt(argc, argv, "d:t:irbn:")) != -1) {
+        switch (opt) {
+            case 'd':
+                if (strcmp(optarg, "none") == 0)         dither = EPD_DITHER_NONE;
+                else if (strcmp(optarg, "ordered") == 0) dither = EPD_DITHER_ORDERED;
+                else if (strcmp(optarg, "floyd") == 0)   dither = EPD_DITHER_FLOYD;
+                else usage();
+                break;
+            case 't': threshold = atoi(optarg); break;
+            case 'i': invert = 1; break;
+            case 'r': compress = 0; break;
+            case 'b': binary = 1; break;
+            case 'n': name = optarg; break;
+            default: usage();
+        }
+    }
+    if (optind >= argc || argc - optind > 2) usage();
+
+    gray = load_pnm(argv[optind], &w, &h);
+    if (gray == NULL) return 1;
+
+    if (invert) {
+        for (int i = 0; i < w * h; i++) gray[i] = 255 - gray[i];
+    }
+
+    epd_dither(gray, w, h, dither, threshold, screen);
+    size = epd_make_image(screen, compress, image);
+    free(gray);
+
+    if (argc - optind == 2) {
+        out = fopen(argv[optind + 1], binary ? "wb" : "w");
+        if (out == NULL) {
+            perror(argv[optind + 1]);
+            return 1;
+        }
+    }
+
+    if (binary) fwrite(image, 1, size, out);
+    else        write_c(out, name, image, size);
+
+    if (out != stdout) fclose(out);
+
+    fprintf(stderr, "%s: %dx%d, %d bytes -> %zu bytes%s\n", argv[optind], w, h,
+            EPD_BYTES, size, image[2] == TCMP441_IMAGE_RAW ? " (raw)" : "");
+    return 0;
+}
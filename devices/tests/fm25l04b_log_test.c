@@ -0,0 +1,188 @@
+// Host test for the FM25L04B record log, including power cuts mid-write
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "fm25l04b.h"
+#include "fm25l04b_log.h"
+#include "fm25l04b_mock.h"
+
+#define PAYLOAD 12
+
+static fm25l04b_t     dev;
+static fm25l04b_log_t flog;
+static int            failures = 0;
+
+#define CHECK(cond) do {                                              \
+    if (!(cond)) {                                                    \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+        failures++;                                                   \
+    }                                                                 \
+} while (0)
+
+static void make_record (uint8_t* buf, uint16_t n) {
+    int i;
+    for (i = 0; i < PAYLOAD; i++) buf[i] = (uint8_t)(n * 7 + i);
+}
+
+static void append_n (uint16_t first, uint16_t n) {
+    uint8_t buf[PAYLOAD];
+    uint16_t i;
+    for (i = first; i < first + n; i++) {
+        make_record(buf, i);
+        CHECK(fm25l04b_log_append(&flog, buf, PAYLOAD) == 0);
+    }
+}
+
+// Every record present must be intact and the sequence numbers consecutive
+static void check_chain (void) {
+    uint8_t  buf[PAYLOAD], expect[PAYLOAD], len;
+    uint16_t seq, prev = 0;
+    uint8_t  i;
+
+    for (i = 0; i < fm25l04b_log_count(&flog); i++) {
+        CHECK(fm25l04b_log_read(&flog, i, buf, &len, &seq) == 0);
+        CHECK(len == PAYLOAD);
+        make_record(expect, seq);
+        CHECK(memcmp(buf, expect, PAYLOAD) == 0);
+        if (i > 0) CHECK(seq == (uint16_t)(prev + 1));
+        prev = seq;
+    }
+}
+
+static void reboot (void) {
+    fm25l04b_mock_power_on();
+    CHECK(fm25l04b_log_init(&flog, &dev, 0, FM25L04B_SIZE, PAYLOAD) == 0);
+}
+
+static void test_format (void) {
+    fm25l04b_mock_fill(0xA5);
+    reboot();
+    CHECK(fm25l04b_log_count(&flog) == 0);
+    CHECK(flog.num_slots == (FM25L04B_SIZE - FM25L04B_LOG_HEADER_SIZE) / (PAYLOAD + FM25L04B_LOG_RECORD_OVERHEAD));
+}
+
+static void test_persist (void) {
+    uint8_t  buf[PAYLOAD], len;
+    uint16_t seq;
+
+    fm25l04b_mock_fill(0x00);
+    reboot();
+    append_n(0, 3);
+    reboot();
+
+    CHECK(fm25l04b_log_count(&flog) == 3);
+    CHECK(fm25l04b_log_read_latest(&flog, buf, &len, &seq) == 0);
+    CHECK(seq == 2);
+    check_chain();
+}
+
+static void test_wrap (void) {
+    uint8_t  buf[PAYLOAD], len;
+    uint16_t seq;
+
+    fm25l04b_mock_fill(0x00);
+    reboot();
+    append_n(0, flog.num_slots + 5);
+    reboot();
+
+    CHECK(fm25l04b_log_count(&flog) == flog.num_slots);
+    CHECK(fm25l04b_log_read(&flog, 0, buf, &len, &seq) == 0);
+    CHECK(seq == 5);
+    check_chain();
+}
+
+// Cut power after every possible number of bytes of an append to a full
+// log. Afterwards the log must hold either the old or the new newest
+// record, with every remaining record intact.
+static void test_cut_append (void) {
+    uint8_t  buf[PAYLOAD], len;
+    uint16_t seq;
+    int      cut;
+    int      slot_size = PAYLOAD + FM25L04B_LOG_RECORD_OVERHEAD;
+
+    for (cut = 0; cut <= slot_size; cut++) {
+        fm25l04b_mock_fill(0x00);
+        reboot();
+        append_n(0, flog.num_slots + 2);
+
+        fm25l04b_mock_cut_after(cut);
+        make_record(buf, flog.num_slots + 2);
+        fm25l04b_log_append(&flog, buf, PAYLOAD);
+
+        reboot();
+        CHECK(fm25l04b_log_read_latest(&flog, buf, &len, &seq) == 0);
+        if (cut == 0) {
+            // Nothing landed, the oldest record is still there
+            CHECK(seq == flog.num_slots + 1);
+            CHECK(fm25l04b_log_count(&flog) == flog.num_slots);
+        } else if (cut < slot_size) {
+            CHECK(seq == flog.num_slots + 1);
+            CHECK(fm25l04b_log_count(&flog) == flog.num_slots - 1);
+        } else {
+            CHECK(seq == flog.num_slots + 2);
+            CHECK(fm25l04b_log_count(&flog) == flog.num_slots);
+        }
+        check_chain();
+
+        // And the log keeps going afterwards
+        append_n(seq + 1, 1);
+        reboot();
+        CHECK(fm25l04b_log_read_latest(&flog, buf, &len, &seq) == 0);
+        CHECK(fm25l04b_log_count(&flog) == flog.num_slots);
+        check_chain();
+    }
+}
+
+static void test_cut_clear (void) {
+    int cut;
+
+    for (cut = 0; cut < 200; cut += 7) {
+        fm25l04b_mock_fill(0x00);
+        reboot();
+        append_n(0, 10);
+
+        fm25l04b_mock_cut_after(cut);
+        fm25l04b_log_clear(&flog);
+
+        reboot();
+        CHECK(fm25l04b_log_count(&flog) <= 10);
+        check_chain();
+        if (fm25l04b_log_count(&flog) > 0) {
+            uint8_t  buf[PAYLOAD], len;
+            uint16_t seq;
+            CHECK(fm25l04b_log_read(&flog, 0, buf, &len, &seq) == 0);
+            CHECK(seq == 0);
+        }
+    }
+}
+
+static void test_region (void) {
+    uint8_t before[100];
+
+    fm25l04b_mock_fill(0x5A);
+    memcpy(before, fm25l04b_mock_mem, sizeof(before));
+
+    fm25l04b_mock_power_on();
+    CHECK(fm25l04b_log_init(&flog, &dev, 100, 200, PAYLOAD) == 0);
+    append_n(0, 30);
+
+    CHECK(memcmp(before, fm25l04b_mock_mem, sizeof(before)) == 0);
+    CHECK(fm25l04b_mock_mem[300] == 0x5A);
+    check_chain();
+}
+
+int main (int argc, char** argv) {
+    fm25l04b_init(&dev);
+
+    test_format();
+    test_persist();
+    test_wrap();
+    test_cut_append();
+    test_cut_clear();
+    test_region();
+
+    printf("fm25l04b_log: %s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
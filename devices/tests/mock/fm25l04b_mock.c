@@ -0,0 +1,62 @@
+// RAM backed FM25L04B for host tests
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "fm25l04b.h"
+#include "fm25l04b_mock.h"
+
+uint8_t  fm25l04b_mock_mem[FM25L04B_SIZE];
+uint32_t fm25l04b_mock_bytes_read = 0;
+uint32_t fm25l04b_mock_bytes_written = 0;
+
+static int  _cut_after = -1;
+static bool _powered = true;
+
+void fm25l04b_mock_fill (uint8_t value) {
+    memset(fm25l04b_mock_mem, value, FM25L04B_SIZE);
+}
+
+void fm25l04b_mock_cut_after (int bytes) {
+    _cut_after = bytes;
+}
+
+void fm25l04b_mock_power_on (void) {
+    _cut_after = -1;
+    _powered = true;
+}
+
+void fm25l04b_init (fm25l04b_t* dev) {
+    dev->spi.bus = dev->bus;
+}
+
+int fm25l04b_read (fm25l04b_t* dev, uint16_t address, uint8_t *buf, uint16_t len) {
+    if (!_powered) return -1;
+    if (address + len > FM25L04B_SIZE) return -1;
+
+    memcpy(buf, fm25l04b_mock_mem + address, len);
+    fm25l04b_mock_bytes_read += len;
+    return 0;
+}
+
+// Bytes land one at a time, like on the real bus, so a cut can leave a
+// partial write behind.
+int fm25l04b_write (fm25l04b_t* dev, uint16_t address, uint8_t *buf, uint16_t len) {
+    uint16_t i;
+
+    if (!_powered) return -1;
+    if (address + len > FM25L04B_SIZE) return -1;
+
+    for (i = 0; i < len; i++) {
+        if (_cut_after == 0) {
+            _powered = false;
+            return -1;
+        }
+        if (_cut_after > 0) _cut_after--;
+
+        fm25l04b_mock_mem[address + i] = buf[i];
+        fm25l04b_mock_bytes_written++;
+    }
+    return 0;
+}
@@ -0,0 +1,21 @@
+// RAM backed FM25L04B for host tests
+
+#pragma once
+
+#include <stdint.h>
+
+#include "fm25l04b.h"
+
+extern uint8_t fm25l04b_mock_mem[FM25L04B_SIZE];
+
+// Fill the whole chip with a value
+void fm25l04b_mock_fill(uint8_t value);
+
+// Cut power after this many more bytes have been written. Everything after
+// that fails until fm25l04b_mock_power_on() is called. -1 never cuts.
+void fm25l04b_mock_cut_after(int bytes);
+void fm25l04b_mock_power_on(void);
+
+// Totals since start, for benchmarks
+extern uint32_t fm25l04b_mock_bytes_read;
+extern uint32_t fm25l04b_mock_bytes_written;
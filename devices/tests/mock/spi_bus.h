@@ -0,0 +1,15 @@
+// Host stand-in for peripherals/spi_bus.h. Only the types that device
+// headers embed are needed; the device functions themselves are mocked.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    int unused;
+} spi_bus_t;
+
+typedef struct {
+    spi_bus_t* bus;
+} spi_bus_device_t;
@@ -0,0 +1,191 @@
+// Throughput of the streaming NMEA parser against the strtok and atof
+// parsing apps/gps-test used to do, over an NMEA log.
+//
+// Every argument is a recorded log to run, for example a capture from
+// `cat /dev/ttyUSB0 > gps.nmea`. Without arguments it makes up a log like a
+// receiver sends at 1 Hz: RMC, GGA, GSA, three GSV, GLL and VTG each second.
+//
+// The host has an FPU, the nRF51 doesn't, so on the chip the atof parsing
+// costs far more than here.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "nmea.h"
+
+#define LOG_SIZE (4 * 1024 * 1024)
+#define ROUNDS   5
+
+static char     nmea_log[LOG_SIZE];
+static uint32_t fixes;
+
+static double now (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t add_sentence (uint32_t len, const char* body) {
+    return len + sprintf(nmea_log + len, "$%s*%02X\r\n", body, nmea_checksum(body, strlen(body)));
+}
+
+static uint32_t make_log (void) {
+    uint32_t len = 0;
+    char body[100];
+
+    for (uint32_t i = 0; len < LOG_SIZE - 1000; i++) {
+        uint32_t s = (12 * 3600 + i) % 86400;
+        uint32_t lat = 1728100 + i / 7 + rand() % 30;      // 1e-5 minutes
+        uint32_t lon = 4731200 + i / 11 + rand() % 30;
+        uint32_t h = s / 3600, m = s / 60 % 60;
+
+        sprintf(body, "GPRMC,%02u%02u%02u.00,A,42%02u.%05u,N,083%02u.%05u,W,0.%03u,%u.%02u,190217,,,A",
+                h, m, s % 60, lat / 100000, lat % 100000, lon / 100000, lon % 100000,
+                rand() % 1000, rand() % 360, rand() % 100);
+        len = add_sentence(len, body);
+        sprintf(body, "GPGGA,%02u%02u%02u.00,42%02u.%05u,N,083%02u.%05u,W,1,%02u,0.%u,%u.%u,M,-34.0,M,,",
+                h, m, s % 60, lat / 100000, lat % 100000, lon / 100000, lon % 100000,
+                4 + rand() % 9, 7 + rand() % 3, 250 + rand() % 10, rand() % 10);
+        len = add_sentence(len, body);
+        len = add_sentence(len, "GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1");
+        len = add_sentence(len, "GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00");
+        len = add_sentence(len, "GPGSV,3,2,11,14,25,170,00,16,57,208,39,18,67,296,40,19,40,246,00");
+        len = add_sentence(len, "GPGSV,3,3,11,22,42,067,42,24,14,311,43,27,05,244,00,,,,");
+        sprintf(body, "GPGLL,42%02u.%05u,N,083%02u.%05u,W,%02u%02u%02u.00,A,A",
+                lat / 100000, lat % 100000, lon / 100000, lon % 100000, h, m, s % 60);
+        len = add_sentence(len, body);
+        len = add_sentence(len, "GPVTG,054.7,T,034.4,M,005.5,N,010.2,K,A");
+    }
+    return len;
+}
+
+static uint32_t load_log (const char* path) {
+    FILE* f = fopen(path, "rb");
+    uint32_t len;
+
+    if (f == NULL) {
+        perror(path);
+        exit(1);
+    }
+    len = fread(nmea_log, 1, LOG_SIZE, f);
+    fclose(f);
+    return len;
+}
+
+
+// What apps/gps-test did: a line at a time, strtok and atof. Kept to
+// compare against, with the bounds checks it was missing.
+
+typedef struct {
+    double UTCtime;
+    char   status;
+    double latitude;
+    double longitude;
+    double altitude;
+    int    date;
+} old_data_t;
+
+static old_data_t old_data;
+static char       cmd_buf[256];
+static int        cmd_index = 0;
+
+static int split (char** array) {
+    int i = 0;
+    char* p = strtok(cmd_buf, ",");
+
+    while (p != NULL && i < 14) {
+        array[i++] = p;
+        p = strtok(NULL, ",");
+    }
+    return i;
+}
+
+static void old_check_cmd (void) {
+    char* array[14];
+
+    if (strncmp(cmd_buf, "$GPRMC", 6) == 0) {
+        if (split(array) < 10) return;
+        old_data.UTCtime = atof(array[1]);
+        old_data.status = array[2][0];
+        old_data.latitude = atof(array[3]);
+        old_data.longitude = atof(array[5]);
+        old_data.date = atoi(array[9]);
+        fixes++;
+    } else if (strncmp(cmd_buf, "$GPGLL", 6) == 0) {
+        if (split(array) < 7) return;
+        old_data.latitude = atof(array[1]);
+        old_data.longitude = atof(array[3]);
+        old_data.status = array[6][0];
+        fixes++;
+    } else if (strncmp(cmd_buf, "$GPGGA", 6) == 0) {
+        if (split(array) < 10) return;
+        old_data.UTCtime = atof(array[1]);
+        old_data.latitude = atof(array[2]);
+        old_data.longitude = atof(array[4]);
+        old_data.altitude = atof(array[9]);
+        fixes++;
+    }
+}
+
+static void old_parse (const char* data, uint32_t len) {
+    for (uint32_t i = 0; i < len; i++) {
+        char cr = data[i];
+
+        if (cmd_index > 255) cmd_index = 0;
+        if (cr == '\r') {
+            // ignore
+        } else if (cr == '\n') {
+            cmd_buf[cmd_index] = '\0';
+            cmd_index = 0;
+            old_check_cmd();
+        } else {
+            cmd_buf[cmd_index++] = cr;
+        }
+    }
+}
+
+
+static void handler (const nmea_fix_t* fix, void* ctx) {
+    fixes++;
+}
+
+static void bench (const char* name, uint32_t len) {
+    nmea_parser_t parser;
+    double t_old, t_new;
+    uint32_t old_fixes;
+
+    fixes = 0;
+    t_old = now();
+    for (int r = 0; r < ROUNDS; r++) old_parse(nmea_log, len);
+    t_old = (now() - t_old) / ROUNDS;
+    old_fixes = fixes / ROUNDS;
+
+    fixes = 0;
+    t_new = now();
+    for (int r = 0; r < ROUNDS; r++) {
+        nmea_init(&parser, handler, NULL);
+        nmea_parse(&parser, nmea_log, len);
+    }
+    t_new = (now() - t_new) / ROUNDS;
+
+    printf("%-16s %8u bytes\n", name, len);
+    printf("  strtok/atof    %7.1f MB/s  %6.1f ns/byte  %7u sentences\n",
+           len / t_old / 1e6, t_old * 1e9 / len, old_fixes);
+    printf("  nmea           %7.1f MB/s  %6.1f ns/byte  %7u sentences  %u bad checksums  %u dropped\n",
+           len / t_new / 1e6, t_new * 1e9 / len, parser.sentences,
+           parser.checksum_errors, parser.dropped);
+}
+
+int main (int argc, char** argv) {
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) bench(argv[i], load_log(argv[i]));
+        return 0;
+    }
+
+    srand(1);
+    bench("generated", make_log());
+    return 0;
+}
@@ -0,0 +1,246 @@
+// Host test for the streaming NMEA parser: values, checksums, and sentences
+// broken up, corrupted, or mixed with noise
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nmea.h"
+
+static nmea_parser_t parser;
+static nmea_fix_t    last;
+static int           handled = 0;
+static int           failures = 0;
+
+#define CHECK(cond) do {                                              \
+    if (!(cond)) {                                                    \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+        failures++;                                                   \
+    }                                                                 \
+} while (0)
+
+static void handler (const nmea_fix_t* fix, void* ctx) {
+    CHECK(ctx == &parser);
+    last = *fix;
+    handled++;
+}
+
+static uint32_t feed (const char* s) {
+    return nmea_parse(&parser, s, strlen(s));
+}
+
+// "$body*hh\r\n" with the right checksum, or a wrong one if bad is set
+static uint32_t feed_body (const char* body, int bad) {
+    char sentence[200];
+
+    sprintf(sentence, "$%s*%02X\r\n", body, nmea_checksum(body, strlen(body)) ^ (bad ? 0x10 : 0));
+    return feed(sentence);
+}
+
+static void reset (void) {
+    nmea_init(&parser, handler, &parser);
+    memset(&last, 0, sizeof(last));
+    handled = 0;
+}
+
+static void test_sentences (void) {
+    reset();
+
+    // The usual examples, with their checksums as received
+    CHECK(feed("$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n") == 1);
+    CHECK(handled == 1);
+    CHECK(last.sentence == NMEA_RMC);
+    CHECK(last.valid);
+    CHECK(last.time == (12 * 3600 + 35 * 60 + 19) * 1000);
+    CHECK(last.latitude == 481173000);
+    CHECK(last.longitude == 115166667);
+    CHECK(last.speed == 22400);
+    CHECK(last.course == 8440);
+    CHECK(last.day == 23 && last.month == 3 && last.year == 2094);
+    CHECK(last.has == (NMEA_HAS_TIME | NMEA_HAS_DATE | NMEA_HAS_POSITION | NMEA_HAS_SPEED | NMEA_HAS_COURSE));
+
+    CHECK(feed("$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n") == 1);
+    CHECK(last.sentence == NMEA_GGA);
+    CHECK(last.quality == 1 && last.valid);
+    CHECK(last.satellites == 8);
+    CHECK(last.hdop == 90);
+    CHECK(last.altitude == 545400);
+    // Merged with what RMC said
+    CHECK(last.speed == 22400 && (last.has & NMEA_HAS_DATE));
+
+    CHECK(feed("$GPGLL,4916.45,N,12311.12,W,225444,A,*1D\r\n") == 1);
+    CHECK(last.sentence == NMEA_GLL);
+    CHECK(last.latitude == 492741667);
+    CHECK(last.longitude == -1231853333);
+    CHECK(last.time == (22 * 3600 + 54 * 60 + 44) * 1000);
+    CHECK(last.valid);
+    CHECK(memcmp(&last, &parser.fix, sizeof(last)) == 0);
+    CHECK(parser.sentences == 3);
+
+    // Southern and western, fractional seconds, negative altitude, other
+    // talkers and a lower case checksum
+    CHECK(feed_body("GNGGA,235959.250,3352.1277,S,15112.7654,W,2,12,1.25,-12.75,M,,M,,", 0) == 1);
+    CHECK(last.time == (23 * 3600 + 59 * 60 + 59) * 1000 + 250);
+    CHECK(last.latitude == -338687950);
+    CHECK(last.longitude == -1512127567);
+    CHECK(last.altitude == -12750);
+    CHECK(last.hdop == 125 && last.quality == 2 && last.satellites == 12);
+    CHECK(feed("$GPGLL,4916.45,N,12311.12,W,225444,A,*1d\r\n") == 1);
+
+    // Longest fractions are cut to what the fix holds
+    CHECK(feed_body("GPRMC,000000.1234,A,0000.0000006,N,17959.9999999,E,0.0001,359.999,010100", 0) == 1);
+    CHECK(last.time == 123);
+    CHECK(last.latitude == 0);
+    CHECK(last.longitude == 1799999998);
+    CHECK(last.speed == 0 && last.course == 35999);
+    CHECK(last.day == 1 && last.month == 1 && last.year == 2000);
+}
+
+static void test_no_fix (void) {
+    reset();
+
+    CHECK(feed("$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n") == 1);
+
+    // Receivers send empty fields until they have a fix
+    CHECK(feed_body("GPRMC,123520,V,,,,,,,230394,,,N", 0) == 1);
+    CHECK(!last.valid);
+    CHECK(!(last.has & NMEA_HAS_POSITION));
+    CHECK(!(last.has & NMEA_HAS_SPEED));
+    CHECK(last.has & NMEA_HAS_TIME);
+
+    CHECK(feed_body("GPGGA,,,,,,0,00,,,M,,M,,", 0) == 1);
+    CHECK(!last.valid && last.quality == 0);
+    CHECK(!(last.has & (NMEA_HAS_TIME | NMEA_HAS_ALTITUDE | NMEA_HAS_HDOP)));
+    CHECK(last.has & NMEA_HAS_SATELLITES);
+
+    // A position without a hemisphere isn't one
+    CHECK(feed_body("GPGLL,4916.45,,12311.12,W,225444,A,", 0) == 1);
+    CHECK(!(last.has & NMEA_HAS_POSITION));
+}
+
+static void test_rejected (void) {
+    nmea_fix_t before;
+
+    reset();
+    CHECK(feed("$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n") == 1);
+    before = parser.fix;
+
+    // Bad checksums, every single bit flipped
+    const char* good = "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n";
+    char bad[100];
+    uint32_t len = strlen(good);
+    for (uint32_t i = 1; i < len - 2; i++) {
+        for (int bit = 0; bit < 7; bit++) {
+            strcpy(bad, good);
+            bad[i] ^= 1 << bit;
+            // '$' starts over, and the checksum may be in either case
+            if (bad[i] == '$' || (i > len - 5 && (bad[i] ^ good[i]) == 0x20)) continue;
+            CHECK(feed(bad) == 0);
+        }
+    }
+    CHECK(feed_body("GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W", 1) == 0);
+    CHECK(parser.checksum_errors > 0);
+    CHECK(memcmp(&parser.fix, &before, sizeof(before)) == 0);
+    CHECK(handled == 1);
+
+    // No checksum, or half of one
+    CHECK(feed("$GPGLL,4916.45,N,12311.12,W,225444,A,\r\n") == 0);
+    CHECK(feed("$GPGLL,4916.45,N,12311.12,W,225444,A,*1\r\n") == 0);
+
+    // Cut short by the next sentence
+    CHECK(feed("$GPRMC,123519,A,4807.0$GPGLL,4916.45,N,12311.12,W,225444,A,*1D\r\n") == 1);
+    CHECK(last.sentence == NMEA_GLL);
+
+    // Checksum fine but the fields aren't
+    CHECK(feed_body("GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4", 0) == 0);
+    CHECK(feed_body("GPRMC,1235,A,4807.038,N,01131.000,E,022.4,084.4,230394,,", 0) == 0);
+    CHECK(feed_body("GPRMC,253519,A,4807.038,N,01131.000,E,022.4,084.4,230394,,", 0) == 0);
+    CHECK(feed_body("GPRMC,123519,A,4867.038,N,01131.000,E,022.4,084.4,230394,,", 0) == 0);
+    CHECK(feed_body("GPRMC,123519,A,9107.038,N,01131.000,E,022.4,084.4,230394,,", 0) == 0);
+    CHECK(feed_body("GPRMC,123519,A,4807.0.38,N,01131.000,E,022.4,084.4,230394,,", 0) == 0);
+    CHECK(feed_body("GPRMC,123519,A,4807.038,N,01131.000,E,-22.4,084.4,230394,,", 0) == 0);
+    CHECK(feed_body("GPRMC,123519,A,4807.038,N,01131.000,E,022.4,360.0,230394,,", 0) == 0);
+    CHECK(feed_body("GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,320394,,", 0) == 0);
+    CHECK(feed_body("GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,1x5.4,M,46.9,M,,", 0) == 0);
+    CHECK(feed_body("GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,99999999999,M,46.9,M,,", 0) == 0);
+    CHECK(parser.dropped >= 11);
+    CHECK(last.sentence == NMEA_GLL);
+
+    // Too long, even with the right checksum
+    char body[120];
+    strcpy(body, "GPGLL,4916.45,N,12311.12,W,225444,A,");
+    while (strlen(body) < 90) strcat(body, "0");
+    CHECK(feed_body(body, 0) == 0);
+
+    // Other sentences are skipped without a word
+    uint32_t dropped = parser.dropped, errors = parser.checksum_errors;
+    CHECK(feed_body("GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00", 0) == 0);
+    CHECK(feed_body("GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1", 0) == 0);
+    CHECK(feed_body("PMTK001,314,3", 0) == 0);
+    CHECK(feed_body("GPRMCX,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,,", 0) == 0);
+    CHECK(parser.dropped == dropped && parser.checksum_errors == errors);
+    CHECK(handled == 2);
+}
+
+// The same stream fed in random pieces, with noise between sentences,
+// gives the same fixes as fed in one go
+static void test_stream (void) {
+    static char stream[20000];
+    nmea_fix_t  fixes[500];
+    uint32_t    len = 0, n = 0, pos = 0;
+    int         i;
+
+    srand(7);
+    for (i = 0; len < sizeof(stream) - 200; i++) {
+        char body[100];
+        uint32_t lat = rand() % 6000000, lon = rand() % 6000000;   // 1e-5 minutes
+        uint32_t s = (12 * 3600 + i) % 86400;
+
+        switch (i % 3) {
+            case 0:
+                sprintf(body, "GPRMC,%02u%02u%02u.00,A,42%02u.%05u,N,083%02u.%05u,W,0.%03u,%u.%02u,190217,,,A",
+                        s / 3600, s / 60 % 60, s % 60, lat / 100000, lat % 100000, lon / 100000, lon % 100000,
+                        rand() % 1000, rand() % 360, rand() % 100);
+                break;
+            case 1:
+                sprintf(body, "GPGGA,%02u%02u%02u.00,42%02u.%05u,N,083%02u.%05u,W,1,%02u,0.%u,%d.%u,M,-34.0,M,,",
+                        s / 3600, s / 60 % 60, s % 60, lat / 100000, lat % 100000, lon / 100000, lon % 100000,
+                        rand() % 13, rand() % 10, rand() % 400 - 50, rand() % 10);
+                break;
+            case 2:
+                sprintf(body, "GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00");
+                break;
+        }
+        len += sprintf(stream + len, "$%s*%02X\r\n", body, nmea_checksum(body, strlen(body)));
+        // Line noise now and then
+        if (rand() % 10 == 0) stream[len++] = rand() % 256;
+    }
+
+    reset();
+    for (i = 0; i < (int)len; i++) {
+        if (nmea_parse_char(&parser, stream[i])) fixes[n++] = parser.fix;
+    }
+    CHECK(n == (uint32_t)handled);
+    CHECK(n > 150);
+
+    reset();
+    while (pos < len) {
+        uint32_t chunk = 1 + rand() % 50;
+        if (chunk > len - pos) chunk = len - pos;
+        nmea_parse(&parser, stream + pos, chunk);
+        pos += chunk;
+    }
+    CHECK((uint32_t)handled == n);
+    CHECK(memcmp(&last, &fixes[n - 1], sizeof(last)) == 0);
+}
+
+int main (int argc, char** argv) {
+    test_sentences();
+    test_no_fix();
+    test_rejected();
+    test_stream();
+
+    printf("nmea: %s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,85 @@
+// Host test for the libqrencode arena build: every symbol up to version 5
+// has to fit the default arena, and encoding over and over must not leak.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "qrencode.h"
+#include "qrspec.h"
+#include "qrarena.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do {                                              \
+    if (!(cond)) {                                                    \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+        failures++;                                                   \
+    }                                                                 \
+} while (0)
+
+static int capacity (int version, QRecLevel level) {
+    int bits = QRspec_getDataLength(version, level) * 8;
+    return (bits - 4 - QRspec_lengthIndicator(QR_MODE_8, version)) / 8;
+}
+
+static void test_fits (void) {
+    char str[200];
+
+    for (int v = 1; v <= 5; v++) {
+        for (QRecLevel level = QR_ECLEVEL_L; level <= QR_ECLEVEL_H; level++) {
+            int len = capacity(v, level);
+            QRcode* code;
+
+            memset(str, 'x', len);
+            str[len] = '\0';
+
+            code = QRcode_encodeString8bit(str, 0, level);
+            CHECK(code != NULL);
+            if (code) CHECK(code->version == v);
+            QRcode_free(code);
+
+            // Mixed mode input goes through the splitter, which allocates more
+            code = QRcode_encodeString(str, 0, level, QR_MODE_8, 1);
+            CHECK(code != NULL);
+            QRcode_free(code);
+        }
+    }
+    CHECK(QRcode_arenaPeak() <= QRENCODE_ARENA_SIZE);
+}
+
+static void test_reuse (void) {
+    size_t used;
+    QRcode* code;
+
+    code = QRcode_encodeString8bit("https://github.com/lab11/nrf5x-base", 0, QR_ECLEVEL_M);
+    CHECK(code != NULL);
+    used = QRcode_arenaUsed();
+
+    // Not freeing the result is fine, the next encode starts over
+    for (int i = 0; i < 1000; i++) {
+        code = QRcode_encodeString8bit("https://github.com/lab11/nrf5x-base", 0, QR_ECLEVEL_M);
+        CHECK(code != NULL);
+    }
+    CHECK(QRcode_arenaUsed() == used);
+}
+
+static void test_too_big (void) {
+    char str[400];
+
+    memset(str, 'x', sizeof(str) - 1);
+    str[sizeof(str) - 1] = '\0';
+
+    // Fails cleanly instead of running off the end of the arena
+    CHECK(QRcode_encodeString8bit(str, 0, QR_ECLEVEL_H) == NULL);
+    CHECK(QRcode_encodeString8bit("still works", 0, QR_ECLEVEL_L) != NULL);
+}
+
+int main (int argc, char** argv) {
+    test_fits();
+    test_reuse();
+    test_too_big();
+
+    printf("qrencode_arena: %s (peak %zu of %d bytes)\n",
+           failures ? "FAILED" : "OK", QRcode_arenaPeak(), QRENCODE_ARENA_SIZE);
+    return failures ? 1 : 0;
+}
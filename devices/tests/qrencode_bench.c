@@ -0,0 +1,120 @@
+// Encode time and peak memory of the bundled libqrencode, for the largest
+// 8 bit string that fits each version. Build it once against the heap and
+// once with -DQRENCODE_ARENA to compare the two.
+//
+// Heap usage is tracked by wrapping malloc and friends with -Wl,--wrap.
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "qrencode.h"
+#include "qrspec.h"
+#include "qrarena.h"
+
+static size_t heap_used = 0;
+static size_t heap_peak = 0;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t nmemb, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void  __real_free(void* ptr);
+
+static void track (void* p, long sign) {
+    if (p == NULL) return;
+    heap_used += sign * (long) malloc_usable_size(p);
+    if (heap_used > heap_peak) heap_peak = heap_used;
+}
+
+void* __wrap_malloc (size_t size) {
+    void* p = __real_malloc(size);
+    track(p, 1);
+    return p;
+}
+
+void* __wrap_calloc (size_t nmemb, size_t size) {
+    void* p = __real_calloc(nmemb, size);
+    track(p, 1);
+    return p;
+}
+
+void* __wrap_realloc (void* ptr, size_t size) {
+    void* p;
+    track(ptr, -1);
+    p = __real_realloc(ptr, size);
+    track(p ? p : ptr, 1);
+    return p;
+}
+
+void __wrap_free (void* ptr) {
+    track(ptr, -1);
+    __real_free(ptr);
+}
+
+static double now (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Longest 8 bit string that still fits the version
+static int capacity (int version, QRecLevel level) {
+    int bits = QRspec_getDataLength(version, level) * 8;
+    return (bits - 4 - QRspec_lengthIndicator(QR_MODE_8, version)) / 8;
+}
+
+int main (int argc, char** argv) {
+    int max_version = (argc > 1) ? atoi(argv[1]) : 10;
+    int iterations  = (argc > 2) ? atoi(argv[2]) : 200;
+    char str[3000];
+
+#ifdef QRENCODE_ARENA
+    printf("arena build, %d byte arena\n", QRENCODE_ARENA_SIZE);
+#else
+    printf("heap build\n");
+#endif
+    printf("version level  bytes  encode us  peak bytes  checksum\n");
+
+    for (int v = 1; v <= max_version; v++) {
+        for (QRecLevel level = QR_ECLEVEL_L; level <= QR_ECLEVEL_H; level++) {
+            int len = capacity(v, level);
+            unsigned long sum = 0;
+            size_t peak;
+            double start;
+            QRcode* code;
+
+            for (int i = 0; i < len; i++) str[i] = 'A' + (i * 7) % 26 + (i & 32);
+            str[len] = '\0';
+
+            heap_used = heap_peak = 0;
+            QRcode_arenaResetPeak();
+
+            code = QRcode_encodeString8bit(str, v, level);
+            if (code == NULL || code->version != v) {
+                printf("%7d %5d  %5d  failed\n", v, level, len);
+                QRcode_free(code);
+                continue;
+            }
+            for (int i = 0; i < code->width * code->width; i++) sum = sum * 31 + (code->data[i] & 1);
+            QRcode_free(code);
+
+#ifdef QRENCODE_ARENA
+            peak = QRcode_arenaPeak();
+#else
+            peak = heap_peak;
+#endif
+
+            start = now();
+            for (int i = 0; i < iterations; i++) {
+                code = QRcode_encodeString8bit(str, v, level);
+                QRcode_free(code);
+            }
+
+            printf("%7d %5d  %5d  %9.1f  %10zu  %08lx\n", v, level, len,
+                   (now() - start) / iterations * 1e6, peak, sum & 0xFFFFFFFF);
+        }
+    }
+    return 0;
+}
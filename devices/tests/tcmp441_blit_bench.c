@@ -0,0 +1,107 @@
+// Compare the blitter against the original per-pixel drawing code on the
+// kinds of screens the eink apps draw.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tcmp441_blit.h"
+#include "tcmp441_ref.h"
+
+#define W 400
+#define H 300
+
+static uint8_t      screen[W/8 * H];
+static uint8_t      dirty[(H + 7) / 8];
+static tcmp441_fb_t fb = {screen, dirty, W, H, W/8};
+
+static const char* text = "The quick brown fox jumps over the lazy dog 0123456789";
+
+static uint8_t qr[57 * 57];
+
+static double now (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void ref_text (int scale) {
+    for (int y = 0; y + 8*scale <= H; y += 8*scale) {
+        for (int i = 0; text[i] && (i+1)*8*scale <= W; i++) {
+            ref_writeCharacter(screen, text[i], i*8*scale + 3, y, scale);
+        }
+    }
+}
+
+static void blit_text (int scale) {
+    for (int y = 0; y + 8*scale <= H; y += 8*scale) {
+        for (int i = 0; text[i] && (i+1)*8*scale <= W; i++) {
+            tcmp441_blit_glyph(&fb, i*8*scale + 3, y,
+                               (uint8_t*) font8x8_basic[(int)text[i]], scale);
+        }
+    }
+}
+
+static void ref_qr (void)  { ref_insertPixelGrid(screen, 57, 57, qr, 11, 20); }
+static void blit_qr (void) { tcmp441_blit_grid(&fb, 11, 20, qr, 57, 57); }
+
+// libqrencode module data for a version 5 code, drawn like
+// tcmp441_writeQRcode: 8x8 pixel modules in the corner. The old code already
+// wrote whole bytes here, so this mostly measures the grid copy.
+static uint8_t qr37[37 * 37];
+
+static void ref_qr37 (void) { ref_writeQRcode(screen, qr37, 37); }
+
+static void blit_qr37 (void) { tcmp441_blit_qr(&fb, 0, 0, qr37, 37, 8, 0); }
+
+// The same at 3x3 pixels with a quiet zone, so modules are not byte aligned.
+// The old code could not do this, so compare with setting every pixel.
+static void ref_qr37_3 (void) {
+    ref_fill(screen, 5, 5, 45 * 3, 45 * 3, 0);
+    for (int y = 0; y < 37; y++) {
+        for (int x = 0; x < 37; x++) {
+            ref_fill(screen, 5 + (x + 4) * 3, 5 + (y + 4) * 3, 3, 3, qr37[y*37 + x] & 1);
+        }
+    }
+}
+
+static void blit_qr37_3 (void) { tcmp441_blit_qr(&fb, 5, 5, qr37, 37, 3, 4); }
+
+static void ref_clear (void)  { ref_fill(screen, 0, 0, W, H, 0); }
+static void blit_clear (void) { tcmp441_blit_fill(&fb, 0, 0, W, H, 0); }
+
+static void ref_text1 (void)  { ref_text(1); }
+static void blit_text1 (void) { blit_text(1); }
+static void ref_text3 (void)  { ref_text(3); }
+static void blit_text3 (void) { blit_text(3); }
+
+static double run (void (*fn)(void), int iterations) {
+    double start = now();
+    for (int i = 0; i < iterations; i++) fn();
+    return (now() - start) / iterations * 1e6;
+}
+
+static void bench (const char* name, void (*ref)(void), void (*blit)(void), int iterations) {
+    double t_ref  = run(ref, iterations);
+    double t_blit = run(blit, iterations);
+    printf("%-22s %10.1f us %10.1f us %8.1fx\n", name, t_ref, t_blit, t_ref / t_blit);
+}
+
+int main (int argc, char** argv) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 200;
+
+    srand(441);
+    for (int i = 0; i < (int)sizeof(qr); i++) qr[i] = rand() & 1;
+    for (int i = 0; i < (int)sizeof(qr37); i++) qr37[i] = rand();
+
+    printf("%-22s %13s %13s %9s\n", "", "per-pixel", "blit", "speedup");
+    bench("clear screen",       ref_clear, blit_clear, iterations);
+    bench("full screen text x1", ref_text1, blit_text1, iterations);
+    bench("full screen text x3", ref_text3, blit_text3, iterations);
+    bench("57x57 grid",         ref_qr,    blit_qr,    iterations);
+    bench("QR v5, 8px modules", ref_qr37,  blit_qr37,  iterations);
+    bench("QR v5, 3px + quiet", ref_qr37_3, blit_qr37_3, iterations);
+    return 0;
+}
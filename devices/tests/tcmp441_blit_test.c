@@ -0,0 +1,192 @@
+// Host test for the TCM-P441 blitter. Every operation is checked pixel for
+// pixel against the original per-pixel drawing code.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tcmp441_blit.h"
+#include "tcmp441_ref.h"
+
+#define W 400
+#define H 300
+#define STRIDE 50
+
+static uint8_t      screen[W/8 * H];
+static uint8_t      expect[W/8 * H];
+static uint8_t      before[W/8 * H];
+static uint8_t      dirty[(H + 7) / 8];
+static tcmp441_fb_t fb = {screen, dirty, W, H, STRIDE};
+static int          failures = 0;
+
+#define CHECK(cond) do {                                              \
+    if (!(cond)) {                                                    \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+        failures++;                                                   \
+    }                                                                 \
+} while (0)
+
+static void start (void) {
+    memcpy(before, screen, sizeof(screen));
+    memset(dirty, 0, sizeof(dirty));
+}
+
+// The blitter and the reference must agree, and the dirty bitmap must hold
+// exactly the rows that changed.
+static int compare (const char* what) {
+    int y;
+
+    if (memcmp(screen, expect, sizeof(screen)) != 0) {
+        printf("FAIL %s: image differs\n", what);
+        failures++;
+        memcpy(screen, expect, sizeof(screen));
+        return -1;
+    }
+    for (y = 0; y < H; y++) {
+        int changed = memcmp(screen + y*STRIDE, before + y*STRIDE, STRIDE) != 0;
+        int marked  = (dirty[y >> 3] >> (y & 7)) & 1;
+        if (changed != marked) {
+            printf("FAIL %s: row %d dirty=%d changed=%d\n", what, y, marked, changed);
+            failures++;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void test_fill (void) {
+    int i;
+
+    for (i = 0; i < 2000; i++) {
+        int x  = rand() % (W + 40) - 20;
+        int y  = rand() % (H + 40) - 20;
+        int w  = rand() % 70;
+        int h  = rand() % 20;
+        int on = rand() & 1;
+
+        start();
+        tcmp441_blit_fill(&fb, x, y, w, h, on);
+        ref_fill(expect, x, y, w, h, on);
+        compare("fill");
+    }
+}
+
+static void test_grid (void) {
+    static uint8_t grid[40 * 500];
+    int i, j;
+
+    for (i = 0; i < 1000; i++) {
+        int w = 1 + rand() % ((i % 10 == 0) ? 500 : 40);
+        int h = 1 + rand() % 40;
+        int x = rand() % (W + 60) - 30;
+        int y = rand() % (H + 60) - 30;
+
+        for (j = 0; j < w * h; j++) grid[j] = rand() % 3 == 0;
+
+        start();
+        tcmp441_blit_grid(&fb, x, y, grid, w, h);
+        ref_insertPixelGrid(expect, w, h, grid, x, y);
+        compare("grid");
+    }
+}
+
+static void test_bits (void) {
+    uint8_t bits[40 * 12];
+    uint8_t grid[40 * 96];
+    int i, j;
+
+    for (i = 0; i < 1000; i++) {
+        int stride = 12;
+        int w = 1 + rand() % (stride * 8);
+        int h = 1 + rand() % 40;
+        int x = rand() % (W + 60) - 30;
+        int y = rand() % (H + 60) - 30;
+
+        for (j = 0; j < (int)sizeof(bits); j++) bits[j] = rand();
+        for (j = 0; j < w * h; j++) {
+            int r = j / w, c = j % w;
+            grid[j] = (bits[r*stride + c/8] >> (7 - c%8)) & 1;
+        }
+
+        start();
+        tcmp441_blit_bits(&fb, x, y, bits, stride, w, h);
+        ref_insertPixelGrid(expect, w, h, grid, x, y);
+        compare("bits");
+    }
+}
+
+static void test_glyph (void) {
+    int i;
+
+    for (i = 0; i < 3000; i++) {
+        char c = rand() % 128;
+        int scale = 1 + rand() % 6;
+        int x = rand() % (W + 40) - 20;
+        int y = rand() % (H + 40) - 20;
+
+        start();
+        tcmp441_blit_glyph(&fb, x, y, (uint8_t*) font8x8_basic[(int)c], scale);
+        ref_writeCharacter(expect, c, x, y, scale);
+        compare("glyph");
+    }
+}
+
+static void test_qr (void) {
+    static uint8_t modules[57 * 57];
+    int i, j;
+
+    for (i = 0; i < 500; i++) {
+        int width = 21 + 4 * (rand() % 10);
+        int scale = 1 + rand() % 9;
+        int quiet = rand() % 5;
+        int size  = (width + 2 * quiet) * scale;
+        int x = rand() % (W + 100) - 50;
+        int y = rand() % (H + 100) - 50;
+
+        // Only bit 0 counts, the encoder uses the others for bookkeeping
+        for (j = 0; j < width * width; j++) modules[j] = rand();
+
+        start();
+        if (size > 512) {
+            // Too wide to draw at all
+            CHECK(tcmp441_blit_qr(&fb, x, y, modules, width, scale, quiet) == -1);
+            compare("qr too wide");
+            continue;
+        }
+        CHECK(tcmp441_blit_qr(&fb, x, y, modules, width, scale, quiet) == size);
+        ref_fill(expect, x, y, size, size, 0);
+        for (j = 0; j < width * width; j++) {
+            if (modules[j] & 1) {
+                ref_fill(expect, x + (quiet + j % width) * scale,
+                         y + (quiet + j / width) * scale, scale, scale, 1);
+            }
+        }
+        compare("qr");
+    }
+}
+
+// Drawing the same thing twice must not mark anything dirty the second time
+static void test_redraw_clean (void) {
+    tcmp441_blit_glyph(&fb, 13, 17, (uint8_t*) font8x8_basic['A'], 3);
+    start();
+    tcmp441_blit_glyph(&fb, 13, 17, (uint8_t*) font8x8_basic['A'], 3);
+    for (int i = 0; i < (int)sizeof(dirty); i++) CHECK(dirty[i] == 0);
+    memcpy(expect, screen, sizeof(screen));
+}
+
+int main (int argc, char** argv) {
+    srand(441);
+    for (int i = 0; i < (int)sizeof(screen); i++) screen[i] = rand();
+    memcpy(expect, screen, sizeof(screen));
+
+    test_fill();
+    test_grid();
+    test_bits();
+    test_glyph();
+    test_qr();
+    test_redraw_clean();
+
+    printf("tcmp441_blit: %s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,88 @@
+// Decode speed of compressed TCM-P441 images, a packet at a time the way the
+// driver does it, against copying the same packets out of a raw screen.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "tcmp441_image.h"
+#include "epd_encode.h"
+
+#define PACKET 250
+#define RUNS   2000
+
+static uint8_t gray[EPD_WIDTH * EPD_HEIGHT];
+static uint8_t screen[EPD_BYTES];
+static uint8_t image[TCMP441_IMAGE_HEADER_SIZE + EPD_BYTES + EPD_BYTES/128 + 1];
+static uint8_t packet[PACKET];
+
+static double now (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double bench_decode (void) {
+    tcmp441_image_decoder_t dec;
+    double t = now();
+
+    for (int r = 0; r < RUNS; r++) {
+        tcmp441_image_open(&dec, image);
+        while (tcmp441_image_read(&dec, packet, PACKET) == PACKET) {
+            __asm__ volatile("" : : "r"(packet) : "memory");
+        }
+    }
+    return now() - t;
+}
+
+static double bench_copy (void) {
+    double t = now();
+
+    for (int r = 0; r < RUNS; r++) {
+        for (int p = 0; p < EPD_BYTES; p += PACKET) {
+            memcpy(packet, screen + p, PACKET);
+            __asm__ volatile("" : : "r"(packet) : "memory");
+        }
+    }
+    return now() - t;
+}
+
+static void run (const char* name) {
+    size_t size = epd_make_image(screen, 1, image);
+    double dec = bench_decode();
+    double copy = bench_copy();
+    double mb = (double) EPD_BYTES * RUNS / 1e6;
+
+    printf("%-10s %6zu bytes %5.1f%%  decode %7.1f MB/s  memcpy %7.1f MB/s\n",
+           name, size, 100.0 * size / (EPD_BYTES + TCMP441_IMAGE_HEADER_SIZE),
+           mb / dec, mb / copy);
+}
+
+int main (int argc, char** argv) {
+    // Text-like screen: a few lines of black bars on white
+    memset(screen, 0, sizeof(screen));
+    for (int y = 20; y < EPD_HEIGHT; y += 24) {
+        for (int r = 0; r < 12; r++) {
+            for (int b = 2; b < EPD_WIDTH/8 - 2; b++) {
+                screen[(y + r) * EPD_WIDTH/8 + b] = (b * 37 + r * 11) & 0x7E;
+            }
+        }
+    }
+    run("text");
+
+    // A smooth diagonal gradient through every dither
+    for (int y = 0; y < EPD_HEIGHT; y++) {
+        for (int x = 0; x < EPD_WIDTH; x++) {
+            gray[y*EPD_WIDTH + x] = (x + y) * 255 / (EPD_WIDTH + EPD_HEIGHT);
+        }
+    }
+    epd_dither(gray, EPD_WIDTH, EPD_HEIGHT, EPD_DITHER_NONE, 128, screen);
+    run("threshold");
+    epd_dither(gray, EPD_WIDTH, EPD_HEIGHT, EPD_DITHER_ORDERED, 128, screen);
+    run("ordered");
+    epd_dither(gray, EPD_WIDTH, EPD_HEIGHT, EPD_DITHER_FLOYD, 128, screen);
+    run("floyd");
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+// Host test for the TCM-P441 image format: what tools/epd_image writes must
+// decode back exactly, in any chunk size, and bad data must not overrun.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tcmp441_image.h"
+#include "epd_encode.h"
+
+#define MAX_IMAGE (TCMP441_IMAGE_HEADER_SIZE + EPD_BYTES + EPD_BYTES/128 + 1)
+
+static uint8_t screen[EPD_BYTES];
+static uint8_t decoded[EPD_BYTES + 16];
+static uint8_t image[MAX_IMAGE];
+static int     failures = 0;
+
+#define CHECK(cond) do {                                              \
+    if (!(cond)) {                                                    \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+        failures++;                                                   \
+    }                                                                 \
+} while (0)
+
+// Decode the whole image chunk bytes at a time
+static int decode (const uint8_t* img, int chunk) {
+    tcmp441_image_decoder_t dec;
+    int total = 0;
+
+    if (tcmp441_image_open(&dec, img) != 0) return -1;
+
+    memset(decoded, 0xEE, sizeof(decoded));
+    for (;;) {
+        int n = tcmp441_image_read(&dec, decoded + total, chunk);
+        if (n < 0) return -1;
+        total += n;
+        if (n < chunk) break;
+    }
+    return total;
+}
+
+static void round_trip (const char* name, int compress) {
+    static const int chunks[] = {1, 7, 127, 128, 129, 250, EPD_BYTES};
+    size_t size = epd_make_image(screen, compress, image);
+
+    for (unsigned i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+        int n = decode(image, chunks[i]);
+        CHECK(n == EPD_BYTES);
+        CHECK(memcmp(decoded, screen, EPD_BYTES) == 0);
+        if (n != EPD_BYTES || memcmp(decoded, screen, EPD_BYTES) != 0) {
+            printf("  %s, chunk %d\n", name, chunks[i]);
+        }
+    }
+    // Nothing past the end of the image gets written
+    CHECK(decoded[EPD_BYTES] == 0xEE);
+    CHECK(size <= MAX_IMAGE);
+}
+
+static void test_patterns (void) {
+    memset(screen, 0, sizeof(screen));
+    round_trip("white", 1);
+    CHECK(image[2] == TCMP441_IMAGE_PACKBITS);
+
+    memset(screen, 0xFF, sizeof(screen));
+    round_trip("black", 1);
+
+    for (int i = 0; i < EPD_BYTES; i++) screen[i] = i;
+    round_trip("ramp", 1);
+
+    // Noise does not compress, so it goes out raw
+    srand(1);
+    for (int i = 0; i < EPD_BYTES; i++) screen[i] = rand();
+    round_trip("noise", 1);
+    CHECK(image[2] == TCMP441_IMAGE_RAW);
+
+    round_trip("noise raw", 0);
+
+    // Mixed runs and literals of every length around the 128 byte limits
+    srand(2);
+    for (int i = 0; i < EPD_BYTES; ) {
+        int len = 1 + rand() % 300;
+        int repeat = rand() & 1;
+        uint8_t v = rand();
+        for (int j = 0; j < len && i < EPD_BYTES; j++, i++) {
+            screen[i] = repeat ? v : rand();
+        }
+    }
+    round_trip("mixed", 1);
+}
+
+static void test_dither (void) {
+    static uint8_t gray[EPD_WIDTH * EPD_HEIGHT];
+    static const epd_dither_t modes[] = {EPD_DITHER_NONE, EPD_DITHER_ORDERED, EPD_DITHER_FLOYD};
+
+    for (int y = 0; y < EPD_HEIGHT; y++) {
+        for (int x = 0; x < EPD_WIDTH; x++) gray[y*EPD_WIDTH + x] = x * 255 / EPD_WIDTH;
+    }
+
+    for (unsigned m = 0; m < 3; m++) {
+        epd_dither(gray, EPD_WIDTH, EPD_HEIGHT, modes[m], 128, screen);
+        // Black on the left, white on the right
+        CHECK(screen[0] == 0xFF);
+        CHECK(screen[EPD_WIDTH/8 - 1] == 0x00);
+        round_trip("dither", 1);
+    }
+
+    // A small image is placed top left, the rest stays white
+    memset(gray, 0, 16 * 16);
+    epd_dither(gray, 16, 16, EPD_DITHER_NONE, 128, screen);
+    CHECK(screen[0] == 0xFF && screen[1] == 0xFF && screen[2] == 0x00);
+    CHECK(screen[16 * EPD_WIDTH/8] == 0x00);
+}
+
+static void test_bad (void) {
+    tcmp441_image_decoder_t dec;
+    size_t size;
+
+    memset(screen, 0, sizeof(screen));
+    size = epd_make_image(screen, 1, image);
+
+    image[0] = 'X';
+    CHECK(tcmp441_image_open(&dec, image) == -1);
+    image[0] = 'E';
+    image[2] = 7;
+    CHECK(tcmp441_image_open(&dec, image) == -1);
+    image[2] = TCMP441_IMAGE_PACKBITS;
+    CHECK(tcmp441_image_open(&dec, image) == 0);
+
+    // Data cut short
+    image[6] = (size - TCMP441_IMAGE_HEADER_SIZE - 1) & 0xFF;
+    image[7] = (size - TCMP441_IMAGE_HEADER_SIZE - 1) >> 8;
+    CHECK(decode(image, 250) == -1);
+
+    // Runs adding up to more than the image must not write past it
+    memset(image + TCMP441_IMAGE_HEADER_SIZE, 0x81, 240);
+    image[6] = 240;
+    image[7] = 0;
+    CHECK(decode(image, EPD_BYTES + 16) == EPD_BYTES);
+    CHECK(decoded[EPD_BYTES] == 0xEE);
+}
+
+int main (int argc, char** argv) {
+    test_patterns();
+    test_dither();
+    test_bad();
+
+    printf("tcmp441_image: %s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,77 @@
+// The original per-pixel drawing code of tcmp441.c, working on any 400x300
+// buffer. Used as the reference for the blitter test and benchmark.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "font8x8_basic.h"
+
+static inline void ref_setPixel (uint8_t* screen, int x, int y, int on) {
+    if (x < 0 || x >= 400 || y < 0 || y >= 300) return;
+
+    int index = (y * 50) + ((50 * x)/400);
+    int bitsIntoByte = 7 - (x % 8);
+
+    screen[index] ^= (-on ^ screen[index]) & (1 << bitsIntoByte);
+}
+
+static inline void ref_insertPixelGrid (uint8_t* screen, int width, int height,
+                                 const uint8_t* grid, int xcoord, int ycoord) {
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            ref_setPixel(screen, x + xcoord, y + ycoord, grid[y*width + x] == 1);
+        }
+    }
+}
+
+static inline void ref_writeCharacter (uint8_t* screen, char character,
+                                int xcoord, int ycoord, int scale) {
+    uint8_t grid[8][8];
+    char *bitmap = font8x8_basic[character & 0x7F];
+
+    for (int i = 0; i < 8; i++) {
+        for (int j = 0; j < 8; j++) {
+            grid[i][j] = (bitmap[i] & (1 << j)) >> j;
+        }
+    }
+
+    for (int y = 0; y < 8 * scale; y++) {
+        for (int x = 0; x < 8 * scale; x++) {
+            ref_setPixel(screen, xcoord + x, ycoord + y, grid[y/scale][x/scale]);
+        }
+    }
+}
+
+static inline void ref_fill (uint8_t* screen, int x, int y, int w, int h, int on) {
+    for (int j = y; j < y + h; j++) {
+        for (int i = x; i < x + w; i++) {
+            ref_setPixel(screen, i, j, on);
+        }
+    }
+}
+
+static inline void ref_setBlock (uint8_t* screen, int x, int y, int on) {
+    for (int i = 0; i < 8; i++) {
+        if (on == 1) {
+            screen[x + (50 * i) + (50 * y * 8)] = 255;
+        } else {
+            screen[x + (50 * i) + (50 * y * 8)] = 0;
+        }
+    }
+}
+
+// tcmp441_writeQRcode as it was: copy the modules to a grid, then one
+// setBlock per module
+static inline void ref_writeQRcode (uint8_t* screen, const uint8_t* data, int width) {
+    uint8_t grid[width][width];
+
+    for (int i = 0; i < width * width; i++) {
+        grid[i / width][i % width] = data[i] & 1;
+    }
+    for (int y = 0; y < width; y++) {
+        for (int x = 0; x < width; x++) {
+            ref_setBlock(screen, x, y, grid[y][x] == 1);
+        }
+    }
+}
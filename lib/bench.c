@@ -0,0 +1,277 @@
+// Timing library code on the chip, see bench.h
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+
+#ifdef BENCH_HOST
+#include <time.h>
+#else
+#include "nrf.h"
+#include "nrf_error.h"
+#include "SEGGER_RTT.h"
+#ifndef NRF52
+#include "nrf_drv_ppi.h"
+#include "sdk_errors.h"
+#endif
+#endif
+
+#define CONCAT_(a, b, c) a##b##c
+#define CONCAT(a, b, c)  CONCAT_(a, b, c)
+
+// Longest line reported
+#define LINE 128
+
+static uint32_t overhead;
+static bool started;
+static uint32_t samples[BENCH_ITERATIONS];
+
+
+/******************************************************************************
+ * Clock and output
+ ******************************************************************************/
+
+#if defined(BENCH_HOST)
+
+#define PLATFORM "host"
+
+static bool clock_start (void) {
+	return true;
+}
+
+uint32_t bench_clock_hz (void) {
+	return 1000000000;
+}
+
+uint32_t bench_now (void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t) ts.tv_sec * 1000000000u + (uint32_t) ts.tv_nsec;
+}
+
+static void output_start (void) {
+}
+
+static void output (const char* text) {
+	fputs(text, stdout);
+}
+
+#else
+
+static void output_start (void) {
+	// Wait for the J-Link rather than drop results
+	SEGGER_RTT_ConfigUpBuffer(0, NULL, NULL, 0, SEGGER_RTT_MODE_BLOCK_IF_FIFO_FULL);
+}
+
+static void output (const char* text) {
+	SEGGER_RTT_WriteString(0, text);
+}
+
+#if defined(NRF52)
+
+#define PLATFORM "nrf52"
+
+static bool clock_start (void) {
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	return true;
+}
+
+uint32_t bench_clock_hz (void) {
+	return SystemCoreClock;
+}
+
+uint32_t bench_now (void) {
+	return DWT->CYCCNT;
+}
+
+#else
+
+/*
+ * nRF51: the M0 has no cycle counter. TIMER counts the CPU clock in 16 bits
+ * and COUNTER counts its wraps: COMPARE[0] at 0 fires as TIMER wraps, and
+ * PPI turns that into a COUNT task without the CPU.
+ */
+
+#define PLATFORM "nrf51"
+
+#define TIMER   CONCAT(NRF_TIMER, BENCH_TIMER_INSTANCE, )
+#define COUNTER CONCAT(NRF_TIMER, BENCH_COUNTER_INSTANCE, )
+
+// Renamed in SDK 12
+#ifndef MODULE_ALREADY_INITIALIZED
+#define MODULE_ALREADY_INITIALIZED NRF_ERROR_MODULE_ALREADY_INITIALIZED
+#endif
+
+static nrf_ppi_channel_t wrap_channel;
+
+static bool clock_start (void) {
+	uint32_t err_code;
+
+	TIMER->TASKS_STOP    = 1;
+	TIMER->MODE          = TIMER_MODE_MODE_Timer;
+	TIMER->BITMODE       = TIMER_BITMODE_BITMODE_16Bit;
+	TIMER->PRESCALER     = 0;
+	TIMER->CC[0]         = 0;
+	TIMER->SHORTS        = 0;
+	TIMER->INTENCLR      = 0xFFFFFFFF;
+	TIMER->TASKS_CLEAR   = 1;
+
+	COUNTER->TASKS_STOP  = 1;
+	COUNTER->MODE        = TIMER_MODE_MODE_Counter;
+	COUNTER->BITMODE     = TIMER_BITMODE_BITMODE_16Bit;
+	COUNTER->SHORTS      = 0;
+	COUNTER->INTENCLR    = 0xFFFFFFFF;
+	COUNTER->TASKS_CLEAR = 1;
+	COUNTER->TASKS_START = 1;
+
+	err_code = nrf_drv_ppi_init();
+	if (err_code != NRF_SUCCESS && err_code != MODULE_ALREADY_INITIALIZED) return false;
+	err_code = nrf_drv_ppi_channel_alloc(&wrap_channel);
+	if (err_code != NRF_SUCCESS) return false;
+	nrf_drv_ppi_channel_assign(wrap_channel, (uint32_t) &TIMER->EVENTS_COMPARE[0],
+	                           (uint32_t) &COUNTER->TASKS_COUNT);
+	nrf_drv_ppi_channel_enable(wrap_channel);
+
+	TIMER->TASKS_START = 1;
+	return true;
+}
+
+uint32_t bench_clock_hz (void) {
+	return 16000000;
+}
+
+uint32_t bench_now (void) {
+	uint32_t high, low, again;
+
+	// The wrap count before and after the low half
+	COUNTER->TASKS_CAPTURE[1] = 1;
+	TIMER->TASKS_CAPTURE[1]   = 1;
+	COUNTER->TASKS_CAPTURE[2] = 1;
+	high  = COUNTER->CC[1];
+	low   = TIMER->CC[1];
+	again = COUNTER->CC[2];
+
+	// TIMER wrapped in between: a small low half came after the wrap
+	if (high != again && low < 0x8000) {
+		high = again;
+	}
+	return (high << 16) | low;
+}
+
+#endif
+#endif
+
+
+/******************************************************************************
+ * Measuring
+ ******************************************************************************/
+
+static void empty (void* context) {
+}
+
+// Not inlined, so the empty call costs what any other does
+static uint16_t __attribute__((noinline)) sample (const bench_t* bench) {
+	uint16_t count = bench->iterations;
+
+	if (count == 0 || count > BENCH_ITERATIONS) {
+		count = BENCH_ITERATIONS;
+	}
+
+	// Once untimed, for the flash cache and anything done on first use
+	if (bench->setup) bench->setup(bench->context);
+	bench->run(bench->context);
+
+	for (uint16_t i = 0; i < count; i++) {
+		uint32_t start;
+
+		if (bench->setup) bench->setup(bench->context);
+		start = bench_now();
+		bench->run(bench->context);
+		samples[i] = bench_now() - start;
+	}
+	return count;
+}
+
+bool bench_init (void) {
+	static const bench_t nothing = {"overhead", NULL, empty, NULL, 0};
+	bench_result_t result;
+	uint16_t count;
+
+	if (!started) {
+		if (!clock_start()) return false;
+		output_start();
+		started = true;
+	}
+
+	count = sample(&nothing);
+	bench_summarize(samples, count, 0, &result);
+	overhead = result.min;
+	return true;
+}
+
+uint32_t bench_overhead (void) {
+	return overhead;
+}
+
+void bench_summarize (uint32_t* values, uint16_t count, uint32_t less,
+                      bench_result_t* result) {
+	memset(result, 0, sizeof(*result));
+	if (count == 0) return;
+
+	// Insertion sort: a few dozen values, once per benchmark
+	for (uint16_t i = 1; i < count; i++) {
+		uint32_t value = values[i];
+		uint16_t j = i;
+
+		while (j > 0 && values[j - 1] > value) {
+			values[j] = values[j - 1];
+			j--;
+		}
+		values[j] = value;
+	}
+
+	result->min        = values[0] > less ? values[0] - less : 0;
+	result->median     = values[count / 2] > less ? values[count / 2] - less : 0;
+	result->max        = values[count - 1] > less ? values[count - 1] - less : 0;
+	result->iterations = count;
+}
+
+void bench_measure (const bench_t* bench, bench_result_t* result) {
+	uint16_t count = sample(bench);
+
+	bench_summarize(samples, count, overhead, result);
+}
+
+
+/******************************************************************************
+ * Reporting
+ ******************************************************************************/
+
+void bench_print (const char* line) {
+	output(line);
+	output("\n");
+}
+
+void bench_run (const bench_t* benches, uint16_t count) {
+	char line[LINE];
+	bench_result_t result;
+
+	snprintf(line, sizeof(line), "bench-start,%s,%lu,%lu", PLATFORM,
+	         (unsigned long) bench_clock_hz(), (unsigned long) overhead);
+	bench_print(line);
+
+	for (uint16_t i = 0; i < count; i++) {
+		bench_measure(&benches[i], &result);
+		snprintf(line, sizeof(line), "bench,%s,%u,%lu,%lu,%lu", benches[i].name,
+		         result.iterations, (unsigned long) result.min,
+		         (unsigned long) result.median, (unsigned long) result.max);
+		bench_print(line);
+	}
+
+	snprintf(line, sizeof(line), "bench-end,%u", count);
+	bench_print(line);
+}
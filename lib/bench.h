@@ -0,0 +1,107 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*******************************************************************************
+ * Cycle counts of library code on the chip, streamed over RTT.
+ *
+ * A benchmark is a function run many times. Each call is timed on its own,
+ * the cost of timing an empty call is taken off, and the minimum, median and
+ * maximum are reported. The minimum is what the code costs; the median and
+ * maximum show what interrupts and the flash cache add.
+ *
+ *   nRF52  the DWT cycle counter, CPU cycles
+ *   nRF51  BENCH_TIMER_INSTANCE at 16 MHz, the CPU clock, so also cycles.
+ *          It is 16 bit, so PPI counts its wraps in BENCH_COUNTER_INSTANCE
+ *          and a call can take up to 268 s.
+ *   host   CLOCK_MONOTONIC in ns, with BENCH_HOST
+ *
+ * Results go to RTT channel 0 (stdout on the host) as lines a script can
+ * pick out of other output:
+ *
+ *   bench-start,<platform>,<clock_hz>,<overhead>
+ *   bench,<name>,<iterations>,<min>,<median>,<max>
+ *   bench-end,<count>
+ *
+ * in clock ticks, overhead already taken off. apps/bench-test/bench_parse.py
+ * prints them as microseconds and compares two runs. Channel 0 is set to
+ * block when full, so no line is lost, and the benchmarks wait for a J-Link
+ * to read them.
+ *
+ * Benchmarks run with interrupts on. Don't advertise or connect while they
+ * run, or the SoftDevice will show up in the maxima.
+ *
+ * USAGE
+ *
+ *   static void parse (void* context) {
+ *     nmea_parse(&parser, SENTENCE, sizeof(SENTENCE) - 1);
+ *   }
+ *
+ *   static const bench_t benches[] = {
+ *     {"nmea", NULL, parse, NULL, 0},
+ *   };
+ *
+ *   bench_init();
+ *   bench_run(benches, sizeof(benches) / sizeof(benches[0]));
+ *
+ */
+
+// Calls timed per benchmark, unless it asks for fewer
+#ifndef BENCH_ITERATIONS
+#define BENCH_ITERATIONS 64
+#endif
+
+#ifndef BENCH_TIMER_INSTANCE
+#define BENCH_TIMER_INSTANCE 1
+#endif
+
+#ifndef BENCH_COUNTER_INSTANCE
+#define BENCH_COUNTER_INSTANCE 2
+#endif
+
+typedef void (*bench_fn_t)(void* context);
+
+typedef struct {
+    const char* name;           // no commas
+    bench_fn_t  setup;          // before each call, not timed, may be NULL
+    bench_fn_t  run;            // the code timed
+    void*       context;        // passed to both
+    uint16_t    iterations;     // 0 for BENCH_ITERATIONS, at most that
+} bench_t;
+
+typedef struct {
+    uint32_t min;
+    uint32_t median;            // the upper of the middle two for even counts
+    uint32_t max;
+    uint16_t iterations;
+} bench_result_t;
+
+// Start the clock and measure the timing overhead. Returns false if there
+// is no clock to start (the PPI channel on the nRF51).
+bool bench_init (void);
+
+// Ticks per second of bench_now()
+uint32_t bench_clock_hz (void);
+
+// The clock, wrapping at 32 bits
+uint32_t bench_now (void);
+
+// Ticks that timing an empty call takes, taken off every sample
+uint32_t bench_overhead (void);
+
+// Time one benchmark: one call untimed to warm up, then its iterations
+void bench_measure (const bench_t* bench, bench_result_t* result);
+
+// Min, median and max of count samples, less overhead. Sorts samples.
+void bench_summarize (uint32_t* samples, uint16_t count, uint32_t overhead,
+                      bench_result_t* result);
+
+// Measure each benchmark and report it, between bench-start and bench-end
+void bench_run (const bench_t* benches, uint16_t count);
+
+// Report a line of text in the same stream, for anything else worth keeping
+void bench_print (const char* line);
+
+#endif
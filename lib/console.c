@@ -0,0 +1,446 @@
+// Line based command console, see console.h
+
+#include <stdio.h>
+#include <string.h>
+
+#include "console.h"
+
+#if (CONSOLE_MAX_COMMANDS & (CONSOLE_MAX_COMMANDS - 1)) != 0 || CONSOLE_MAX_COMMANDS > 128
+#error "CONSOLE_MAX_COMMANDS must be a power of two, at most 128"
+#endif
+
+#define NO_COMMAND 0xFF
+#define PROMPT     "> "
+
+
+// FNV-1a, seeded, with a final mix so that the low bits are usable
+static uint32_t hash (const char* name, uint8_t len, uint32_t seed) {
+	uint32_t h = 2166136261u ^ (seed * 0x9E3779B9u);
+
+	for (uint8_t i = 0; i < len; i++) {
+		h ^= (uint8_t) name[i];
+		h *= 16777619u;
+	}
+	h ^= h >> 16;
+	h *= 0x45D9F3Bu;
+	h ^= h >> 16;
+	return h;
+}
+
+static uint8_t bucket_of (console_t* console, const char* name, uint8_t len) {
+	return hash(name, len, 0) % console->num_buckets;
+}
+
+static uint8_t slot_of (console_t* console, const char* name, uint8_t len, uint8_t seed) {
+	return hash(name, len, seed + 1u) & console->slot_mask;
+}
+
+// Find a seed that puts every command of the bucket in a free slot
+static bool place_bucket (console_t* console, const uint8_t* buckets, uint8_t bucket) {
+	uint8_t taken[CONSOLE_MAX_COMMANDS];
+
+	for (uint16_t seed = 0; seed < 256; seed++) {
+		uint8_t count = 0;
+		bool fits = true;
+
+		for (uint8_t i = 0; i < console->num_commands && fits; i++) {
+			if (buckets[i] != bucket) continue;
+
+			const char* name = console->commands[i].name;
+			uint8_t slot = slot_of(console, name, strlen(name), seed);
+			if (console->slot_command[slot] != NO_COMMAND) {
+				fits = false;
+			} else {
+				console->slot_command[slot] = i;
+				taken[count++] = slot;
+			}
+		}
+
+		if (fits) {
+			console->bucket_seed[bucket] = seed;
+			return true;
+		}
+		while (count > 0) {
+			console->slot_command[taken[--count]] = NO_COMMAND;
+		}
+	}
+
+	// Only two commands with the same name collide under every seed
+	return false;
+}
+
+int console_init (console_t* console, const console_command_t* commands, uint8_t num_commands,
+                  console_write_t write, void* write_ctx) {
+	uint8_t buckets[CONSOLE_MAX_COMMANDS];
+	uint8_t bucket_size[CONSOLE_MAX_COMMANDS] = {0};
+	uint16_t slots = 2;
+
+	memset(console, 0, sizeof(*console));
+	console->commands     = commands;
+	console->num_commands = num_commands;
+	console->write        = write;
+	console->write_ctx    = write_ctx;
+
+	if (num_commands == 0 || num_commands > CONSOLE_MAX_COMMANDS) return -1;
+
+	// Hash and displace: about two commands per bucket, and twice as many
+	// slots as commands. The biggest buckets are placed first, while most
+	// slots are still free.
+	while (slots < 2 * num_commands) slots <<= 1;
+	console->slot_mask   = slots - 1;
+	console->num_buckets = (num_commands + 1) / 2;
+	memset(console->slot_command, NO_COMMAND, sizeof(console->slot_command));
+
+	for (uint8_t i = 0; i < num_commands; i++) {
+		const char* name = commands[i].name;
+		buckets[i] = bucket_of(console, name, strlen(name));
+		bucket_size[buckets[i]]++;
+	}
+
+	for (uint8_t size = num_commands; size > 0; size--) {
+		for (uint8_t b = 0; b < console->num_buckets; b++) {
+			if (bucket_size[b] != size) continue;
+			if (!place_bucket(console, buckets, b)) return -1;
+		}
+	}
+
+	return 0;
+}
+
+const console_command_t* console_find (console_t* console, const char* name, uint8_t len) {
+	uint8_t bucket, index;
+	const console_command_t* command;
+
+	if (console->num_commands == 0) return NULL;
+
+	bucket = bucket_of(console, name, len);
+	index  = console->slot_command[slot_of(console, name, len, console->bucket_seed[bucket])];
+	if (index == NO_COMMAND) return NULL;
+
+	command = &console->commands[index];
+	if (strncmp(command->name, name, len) != 0 || command->name[len] != '\0') return NULL;
+	return command;
+}
+
+
+/******************************************************************************
+ * Output
+ ******************************************************************************/
+
+uint16_t console_flush (console_t* console) {
+	while (console->tx_len > 0) {
+		uint16_t chunk = CONSOLE_TX_SIZE - console->tx_start;
+		uint16_t done;
+
+		if (chunk > console->tx_len) chunk = console->tx_len;
+		done = console->write(console->write_ctx, console->tx + console->tx_start, chunk);
+		if (done == 0) break;
+
+		console->tx_start = (console->tx_start + done) % CONSOLE_TX_SIZE;
+		console->tx_len  -= done;
+	}
+
+	// Start the next batch at the front, so that it goes out in one piece
+	if (console->tx_len == 0) console->tx_start = 0;
+	return console->tx_len;
+}
+
+void console_write (console_t* console, const char* data, uint16_t len) {
+	while (len > 0) {
+		uint16_t end, chunk;
+
+		if (console->tx_len == CONSOLE_TX_SIZE) {
+			console_flush(console);
+			continue;
+		}
+
+		end   = (console->tx_start + console->tx_len) % CONSOLE_TX_SIZE;
+		chunk = CONSOLE_TX_SIZE - console->tx_len;
+		if (chunk > CONSOLE_TX_SIZE - end) chunk = CONSOLE_TX_SIZE - end;
+		if (chunk > len) chunk = len;
+
+		memcpy(console->tx + end, data, chunk);
+		console->tx_len += chunk;
+		data += chunk;
+		len  -= chunk;
+	}
+}
+
+static void console_vprintf (console_t* console, const char* format, va_list args) {
+	char text[CONSOLE_LINE_SIZE];
+	int len = vsnprintf(text, sizeof(text), format, args);
+
+	if (len < 0) return;
+	if (len >= (int) sizeof(text)) len = sizeof(text) - 1;
+	console_write(console, text, len);
+}
+
+void console_printf (console_t* console, const char* format, ...) {
+	va_list args;
+
+	va_start(args, format);
+	console_vprintf(console, format, args);
+	va_end(args);
+}
+
+void console_error (console_t* console, const char* format, ...) {
+	va_list args;
+
+	console->failed = true;
+	console_write(console, "error: ", 7);
+	va_start(args, format);
+	console_vprintf(console, format, args);
+	va_end(args);
+	console_write(console, "\r\n", 2);
+}
+
+
+/******************************************************************************
+ * Commands
+ ******************************************************************************/
+
+static char* skip_spaces (char* p) {
+	while (*p == ' ') p++;
+	return p;
+}
+
+// Cut the word at p out of the line, and return what follows it
+static char* end_word (char* p) {
+	while (*p != '\0' && *p != ' ') p++;
+	if (*p == ' ') *p++ = '\0';
+	return p;
+}
+
+// Decimal or 0x hex. Signed values may start with - or +.
+static bool parse_number (const char* s, bool is_signed, uint32_t* value) {
+	bool negative = false;
+	uint32_t base = 10;
+	uint32_t v = 0;
+
+	if (is_signed && (*s == '-' || *s == '+')) {
+		negative = (*s == '-');
+		s++;
+	}
+	if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+		base = 16;
+		s += 2;
+	}
+	if (*s == '\0') return false;
+
+	for (; *s != '\0'; s++) {
+		uint32_t digit;
+
+		if (*s >= '0' && *s <= '9')                     digit = *s - '0';
+		else if (base == 16 && *s >= 'a' && *s <= 'f')  digit = *s - 'a' + 10;
+		else if (base == 16 && *s >= 'A' && *s <= 'F')  digit = *s - 'A' + 10;
+		else return false;
+
+		if (v > (UINT32_MAX - digit) / base) return false;
+		v = v * base + digit;
+	}
+
+	if (is_signed && v > (negative ? 0x80000000u : 0x7FFFFFFFu)) return false;
+	*value = negative ? 0u - v : v;
+	return true;
+}
+
+// Convert the arguments after the command name following its schema
+static bool parse_args (console_t* console, const console_command_t* command, char* p,
+                        console_arg_t* args, uint8_t* argc) {
+	bool optional = false;
+
+	*argc = 0;
+	for (const char* type = command->args; *type != '\0'; type++) {
+		char* word;
+
+		if (*type == '|') {
+			optional = true;
+			continue;
+		}
+
+		p = skip_spaces(p);
+		if (*p == '\0') {
+			if (optional) break;
+			console_error(console, "usage: %s", command->help ? command->help : command->name);
+			return false;
+		}
+		if (*argc == CONSOLE_MAX_ARGS) break;
+
+		if (*type == 'r') {
+			args[(*argc)++].s = p;
+			p += strlen(p);
+			continue;
+		}
+
+		word = p;
+		p = end_word(p);
+		if (*type == 's') {
+			args[*argc].s = word;
+		} else if (!parse_number(word, *type == 'i', &args[*argc].u)) {
+			console_error(console, "bad number '%s'", word);
+			return false;
+		}
+		(*argc)++;
+	}
+
+	if (*skip_spaces(p) != '\0') {
+		console_error(console, "usage: %s", command->help ? command->help : command->name);
+		return false;
+	}
+	return true;
+}
+
+static void run_line (console_t* console, char* line) {
+	const console_command_t* command;
+	console_arg_t args[CONSOLE_MAX_ARGS];
+	uint8_t argc;
+	uint32_t start = 0;
+	char* name;
+	char* p;
+
+	name = skip_spaces(line);
+	if (*name == '\0') return;
+
+	if (console->clock) start = console->clock();
+	console->failed = false;
+
+	for (p = name; *p != '\0' && *p != ' '; p++);
+	command = console_find(console, name, p - name);
+	if (command == NULL) {
+		console_error(console, "unknown command '%.*s'", (int)(p - name), name);
+		return;
+	}
+
+	if (!parse_args(console, command, p, args, &argc)) return;
+	command->handler(console, args, argc);
+
+	if (console->clock) {
+		console_stats_t* stats = &console->stats[command - console->commands];
+		uint32_t elapsed = console->clock() - start;
+
+		stats->count++;
+		stats->total_us += elapsed;
+		if (elapsed > stats->max_us) stats->max_us = elapsed;
+	}
+
+	if (!console->failed) console_write(console, "ok\r\n", 4);
+}
+
+void console_cmd_help (console_t* console, const console_arg_t* args, uint8_t argc) {
+	for (uint8_t i = 0; i < console->num_commands; i++) {
+		const console_command_t* command = &console->commands[i];
+		console_printf(console, "%-12s %s\r\n", command->name, command->help ? command->help : "");
+	}
+}
+
+void console_cmd_stats (console_t* console, const console_arg_t* args, uint8_t argc) {
+	for (uint8_t i = 0; i < console->num_commands; i++) {
+		const console_stats_t* stats = &console->stats[i];
+
+		if (stats->count == 0) continue;
+		console_printf(console, "%-12s %lu %lu %lu\r\n", console->commands[i].name,
+		               (unsigned long) stats->count,
+		               (unsigned long) (stats->total_us / stats->count),
+		               (unsigned long) stats->max_us);
+	}
+}
+
+
+/******************************************************************************
+ * Input
+ ******************************************************************************/
+
+static void echo (console_t* console, const char* data, uint16_t len) {
+	if (console->echo) console_write(console, data, len);
+}
+
+// Complete the command name as far as it is unambiguous. If that adds
+// nothing, list the candidates.
+static void complete (console_t* console) {
+	const console_command_t* first = NULL;
+	uint8_t len = console->line_len;
+	uint8_t common = 0;
+	uint8_t matches = 0;
+
+	if (memchr(console->line, ' ', len) != NULL) return;
+
+	for (uint8_t i = 0; i < console->num_commands; i++) {
+		const char* name = console->commands[i].name;
+
+		if (strncmp(name, console->line, len) != 0) continue;
+		if (first == NULL) {
+			first  = &console->commands[i];
+			common = strlen(name);
+		} else {
+			uint8_t n = len;
+			while (n < common && name[n] == first->name[n]) n++;
+			common = n;
+		}
+		matches++;
+	}
+	if (matches == 0) return;
+
+	if (common >= CONSOLE_LINE_SIZE - 1) common = CONSOLE_LINE_SIZE - 2;
+	memcpy(console->line + len, first->name + len, common - len);
+	console->line_len = common;
+	echo(console, first->name + len, common - len);
+
+	if (matches == 1) {
+		console->line[console->line_len++] = ' ';
+		echo(console, " ", 1);
+	} else if (common == len && console->echo) {
+		console_write(console, "\r\n", 2);
+		for (uint8_t i = 0; i < console->num_commands; i++) {
+			const char* name = console->commands[i].name;
+			if (strncmp(name, console->line, len) != 0) continue;
+			console_printf(console, "%s ", name);
+		}
+		console_write(console, "\r\n" PROMPT, 2 + strlen(PROMPT));
+		console_write(console, console->line, console->line_len);
+	}
+}
+
+static void end_line (console_t* console) {
+	echo(console, "\r\n", 2);
+
+	if (console->line_overflow) {
+		console_error(console, "line too long");
+	} else {
+		console->line[console->line_len] = '\0';
+		run_line(console, console->line);
+	}
+
+	console->line_len = 0;
+	console->line_overflow = false;
+	echo(console, PROMPT, strlen(PROMPT));
+}
+
+void console_input (console_t* console, const char* data, uint16_t len) {
+	for (uint16_t i = 0; i < len; i++) {
+		char c = data[i];
+		char last = console->last;
+
+		console->last = c;
+		if (c == '\n' && last == '\r') continue;
+
+		if (c == '\r' || c == '\n') {
+			end_line(console);
+		} else if (c == '\b' || c == 0x7F) {
+			if (console->line_len > 0) {
+				console->line_len--;
+				echo(console, "\b \b", 3);
+			}
+		} else if (c == '\t') {
+			complete(console);
+		} else if (c >= ' ' && c < 0x7F) {
+			if (console->line_len < CONSOLE_LINE_SIZE - 1) {
+				console->line[console->line_len++] = c;
+				echo(console, &c, 1);
+			} else {
+				console->line_overflow = true;
+			}
+		}
+	}
+
+	console_flush(console);
+}
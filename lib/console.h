@@ -0,0 +1,149 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*******************************************************************************
+ * Line based command console, for a UART or anything else that moves bytes.
+ *
+ * Commands live in a const table. console_init() builds a perfect hash over
+ * their names, so finding a command is two hashes and one string compare
+ * however many there are. Arguments are split and converted in the line
+ * buffer itself, following a small schema per command:
+ *
+ *   i  int32, decimal or 0x hex       s  one word
+ *   u  uint32, decimal or 0x hex      r  the rest of the line
+ *   |  everything after is optional
+ *
+ * A handler prints with console_printf() and reports failure with
+ * console_error(). Every command is answered with its output and then a
+ * line with "ok" or "error: ...", which makes the console easy to drive
+ * from a script. Output goes into a TX ring and is written out once all the
+ * input at hand has been handled, so a batch of commands costs one write.
+ *
+ * Each command's run time is kept when a clock is given; the "stats"
+ * command prints it. Tab completes command names.
+ *
+ * USAGE
+ *
+ *   static void cmd_led (console_t* console, const console_arg_t* args, uint8_t argc) {
+ *     led_set(args[0].u, argc > 1 ? args[1].u : 1);
+ *   }
+ *
+ *   static const console_command_t commands[] = {
+ *     {"led", cmd_led, "u|u", "led <index> [on]"},
+ *     CONSOLE_BUILTIN_COMMANDS,
+ *   };
+ *
+ *   console_init(&console, commands, CONSOLE_NUM_COMMANDS(commands), uart_write, NULL);
+ *   ...
+ *   console_input(&console, received, len);
+ *
+ */
+
+#ifndef CONSOLE_LINE_SIZE
+#define CONSOLE_LINE_SIZE    128
+#endif
+#ifndef CONSOLE_TX_SIZE
+#define CONSOLE_TX_SIZE      256
+#endif
+#ifndef CONSOLE_MAX_COMMANDS
+#define CONSOLE_MAX_COMMANDS 32     // a power of two
+#endif
+#ifndef CONSOLE_MAX_ARGS
+#define CONSOLE_MAX_ARGS     8
+#endif
+
+// The hash table is at most half full
+#define CONSOLE_HASH_SLOTS   (CONSOLE_MAX_COMMANDS * 2)
+
+typedef struct console_s console_t;
+
+typedef union {
+    int32_t     i;
+    uint32_t    u;
+    const char* s;
+} console_arg_t;
+
+typedef void (*console_handler_t)(console_t* console, const console_arg_t* args, uint8_t argc);
+
+typedef struct {
+    const char*       name;
+    console_handler_t handler;
+    const char*       args;     // schema, see above
+    const char*       help;     // may be NULL
+} console_command_t;
+
+// Where output goes. Returns how many bytes it took, which may be fewer than
+// len (or none) if the transmitter is busy; the rest stays in the TX ring.
+typedef uint16_t (*console_write_t)(void* ctx, const uint8_t* data, uint16_t len);
+
+// Free running microseconds, for command latency
+typedef uint32_t (*console_clock_t)(void);
+
+typedef struct {
+    uint32_t count;
+    uint32_t total_us;
+    uint32_t max_us;
+} console_stats_t;
+
+struct console_s {
+    const console_command_t* commands;
+    uint8_t         num_commands;
+    console_write_t write;
+    void*           write_ctx;
+    console_clock_t clock;      // NULL to not measure
+    bool            echo;       // echo input and show a prompt, for people
+
+    // Perfect hash: the first hash picks a bucket, the bucket's seed the slot
+    uint8_t         bucket_seed[CONSOLE_MAX_COMMANDS];
+    uint8_t         slot_command[CONSOLE_HASH_SLOTS];
+    uint8_t         num_buckets;
+    uint8_t         slot_mask;
+
+    char            line[CONSOLE_LINE_SIZE];
+    uint8_t         line_len;
+    bool            line_overflow;
+    char            last;       // last character, to take \r\n as one
+
+    uint8_t         tx[CONSOLE_TX_SIZE];
+    uint16_t        tx_start;
+    uint16_t        tx_len;
+
+    bool            failed;     // the running command called console_error()
+    console_stats_t stats[CONSOLE_MAX_COMMANDS];
+};
+
+#define CONSOLE_NUM_COMMANDS(table) ((uint8_t)(sizeof(table) / sizeof((table)[0])))
+
+// "help" and "stats", for the end of a command table
+void console_cmd_help (console_t* console, const console_arg_t* args, uint8_t argc);
+void console_cmd_stats (console_t* console, const console_arg_t* args, uint8_t argc);
+#define CONSOLE_BUILTIN_COMMANDS                                        \
+    {"help",  console_cmd_help,  "",  "list commands"},                 \
+    {"stats", console_cmd_stats, "",  "command count, mean and max us"}
+
+// Returns 0, or -1 if there are too many commands or two with one name
+int console_init (console_t* console, const console_command_t* commands, uint8_t num_commands,
+                  console_write_t write, void* write_ctx);
+
+// Feed received characters. Complete lines run their commands, then the
+// output is flushed.
+void console_input (console_t* console, const char* data, uint16_t len);
+
+// The command with this name, or NULL
+const console_command_t* console_find (console_t* console, const char* name, uint8_t len);
+
+// For handlers: output, and marking the command as failed. One call prints
+// at most CONSOLE_LINE_SIZE-1 characters. When the TX ring is full these
+// wait for the writer.
+void console_printf (console_t* console, const char* format, ...) __attribute__ ((format (printf, 2, 3)));
+void console_error (console_t* console, const char* format, ...) __attribute__ ((format (printf, 2, 3)));
+void console_write (console_t* console, const char* data, uint16_t len);
+
+// Hand the TX ring to the writer. Returns the bytes it did not take.
+uint16_t console_flush (console_t* console);
+
+#endif
@@ -0,0 +1,474 @@
+// Fixed point signal processing, see dsp.h
+
+#include <string.h>
+
+#include "dsp.h"
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1) && !defined(DSP_NO_SIMD)
+#include "nrf.h"
+#define DSP_SIMD 1
+#endif
+
+
+/******************************************************************************
+ * Two Q15 values in a word, low half first, and the instructions that work
+ * on them. Without the DSP extension the same thing in plain C.
+ ******************************************************************************/
+
+static inline uint32_t read_pair (const q15_t* p) {
+    uint32_t pair;
+    memcpy(&pair, p, sizeof(pair));
+    return pair;
+}
+
+static inline void write_pair (q15_t* p, uint32_t pair) {
+    memcpy(p, &pair, sizeof(pair));
+}
+
+static inline uint32_t pack (int32_t lo, int32_t hi) {
+    return (uint16_t) lo | ((uint32_t) (uint16_t) hi << 16);
+}
+
+static inline int32_t lo (uint32_t pair) {
+    return (int16_t) (pair & 0xFFFF);
+}
+
+static inline int32_t hi (uint32_t pair) {
+    return (int16_t) (pair >> 16);
+}
+
+static inline q15_t saturate (int64_t x) {
+    if (x > DSP_Q15_MAX) return DSP_Q15_MAX;
+    if (x < DSP_Q15_MIN) return DSP_Q15_MIN;
+    return (q15_t) x;
+}
+
+#ifdef DSP_SIMD
+
+#define smlald(x, y, acc) ((int64_t) __SMLALD((x), (y), (uint64_t) (acc)))
+#define smuad(x, y)       ((int32_t) __SMUAD((x), (y)))
+#define smusdx(x, y)      ((int32_t) __SMUSDX((x), (y)))
+#define shadd16(x, y)     __SHADD16((x), (y))
+#define qadd16(x, y)      __QADD16((x), (y))
+#define qsub16(x, y)      __QSUB16((x), (y))
+
+#else
+
+// acc + x.lo * y.lo + x.hi * y.hi
+static inline int64_t smlald (uint32_t x, uint32_t y, int64_t acc) {
+    return acc + lo(x) * lo(y) + (int64_t) (hi(x) * hi(y));
+}
+
+// x.lo * y.lo + x.hi * y.hi, wrapping like the instruction
+static inline int32_t smuad (uint32_t x, uint32_t y) {
+    return (int32_t) ((uint32_t) (lo(x) * lo(y)) + (uint32_t) (hi(x) * hi(y)));
+}
+
+// x.lo * y.hi - x.hi * y.lo
+static inline int32_t smusdx (uint32_t x, uint32_t y) {
+    return (int32_t) ((uint32_t) (lo(x) * hi(y)) - (uint32_t) (hi(x) * lo(y)));
+}
+
+static inline uint32_t shadd16 (uint32_t x, uint32_t y) {
+    return pack((lo(x) + lo(y)) >> 1, (hi(x) + hi(y)) >> 1);
+}
+
+static inline uint32_t qadd16 (uint32_t x, uint32_t y) {
+    return pack(saturate(lo(x) + lo(y)), saturate(hi(x) + hi(y)));
+}
+
+static inline uint32_t qsub16 (uint32_t x, uint32_t y) {
+    return pack(saturate(lo(x) - lo(y)), saturate(hi(x) - hi(y)));
+}
+
+#endif
+
+
+/******************************************************************************
+ * FIR
+ ******************************************************************************/
+
+void dsp_fir_init (dsp_fir_t* fir, const q15_t* coeffs, uint16_t num_taps, uint8_t factor, q15_t* state) {
+    fir->coeffs   = coeffs;
+    fir->state    = state;
+    fir->num_taps = num_taps;
+    fir->factor   = factor ? factor : 1;
+    fir->phase    = 0;
+    memset(state, 0, (num_taps - 1) * sizeof(q15_t));
+}
+
+// coeffs[0] * x[0] + ... + coeffs[taps-1] * x[taps-1], back to Q15
+static q15_t fir_output (const q15_t* coeffs, const q15_t* x, uint16_t taps) {
+    int64_t acc = 0;
+    uint16_t k = 0;
+
+    for (; k + 4 <= taps; k += 4) {
+        acc = smlald(read_pair(coeffs + k),     read_pair(x + k),     acc);
+        acc = smlald(read_pair(coeffs + k + 2), read_pair(x + k + 2), acc);
+    }
+    for (; k + 2 <= taps; k += 2) {
+        acc = smlald(read_pair(coeffs + k), read_pair(x + k), acc);
+    }
+    if (k < taps) acc += (int32_t) coeffs[k] * x[k];
+
+    return saturate(acc >> 15);
+}
+
+uint16_t dsp_fir (dsp_fir_t* fir, const q15_t* in, uint16_t count, q15_t* out) {
+    q15_t* state = fir->state;
+    uint16_t history = fir->num_taps - 1;
+    uint16_t produced = 0;
+
+    // The state holds the last num_taps-1 inputs and then a chunk of new
+    // ones, so every output is one straight dot product. Outputs never get
+    // ahead of the inputs copied in, so out may overwrite in.
+    while (count > 0) {
+        uint16_t chunk = (count < DSP_FIR_BLOCK) ? count : DSP_FIR_BLOCK;
+
+        memcpy(state + history, in, chunk * sizeof(q15_t));
+        in    += chunk;
+        count -= chunk;
+
+        for (uint16_t i = 0; i < chunk; i++) {
+            if (fir->phase == 0) {
+                out[produced++] = fir_output(fir->coeffs, state + i, fir->num_taps);
+                fir->phase = fir->factor - 1;
+            } else {
+                fir->phase--;
+            }
+        }
+
+        memmove(state, state + chunk, history * sizeof(q15_t));
+    }
+
+    return produced;
+}
+
+
+/******************************************************************************
+ * IIR
+ ******************************************************************************/
+
+void dsp_iir_init (dsp_iir_t* iir, const dsp_biquad_t* stages, uint8_t num_stages, uint8_t factor,
+                   dsp_biquad_state_t* state) {
+    iir->stages     = stages;
+    iir->state      = state;
+    iir->num_stages = num_stages;
+    iir->factor     = factor ? factor : 1;
+    iir->phase      = 0;
+    memset(state, 0, num_stages * sizeof(dsp_biquad_state_t));
+}
+
+static q15_t biquad (const dsp_biquad_t* c, dsp_biquad_state_t* s, q15_t x) {
+    int64_t acc = (int32_t) c->b0 * x;
+    q15_t y;
+
+    // b1, b2 and a1, a2 sit next to each other, as do x1, x2 and y1, y2
+    acc = smlald(read_pair(&c->b1), read_pair(&s->x1), acc);
+    acc = smlald(read_pair(&c->a1), read_pair(&s->y1), acc);
+    y = saturate(acc >> 14);
+
+    s->x2 = s->x1;
+    s->x1 = x;
+    s->y2 = s->y1;
+    s->y1 = y;
+    return y;
+}
+
+uint16_t dsp_iir (dsp_iir_t* iir, const q15_t* in, uint16_t count, q15_t* out) {
+    uint16_t produced = 0;
+
+    for (uint16_t i = 0; i < count; i++) {
+        q15_t y = in[i];
+
+        for (uint8_t stage = 0; stage < iir->num_stages; stage++) {
+            y = biquad(&iir->stages[stage], &iir->state[stage], y);
+        }
+
+        if (iir->phase == 0) {
+            out[produced++] = y;
+            iir->phase = iir->factor - 1;
+        } else {
+            iir->phase--;
+        }
+    }
+
+    return produced;
+}
+
+
+/******************************************************************************
+ * Windows, RMS and peaks
+ ******************************************************************************/
+
+uint32_t dsp_isqrt (uint64_t x) {
+    uint64_t root = 0;
+    uint64_t bit = (uint64_t) 1 << 62;
+
+    while (bit > x) bit >>= 2;
+    while (bit != 0) {
+        if (x >= root + bit) {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t) root;
+}
+
+static uint64_t sum_squares (const q15_t* in, uint16_t count) {
+    int64_t acc = 0;
+    uint16_t i = 0;
+
+    for (; i + 2 <= count; i += 2) {
+        uint32_t pair = read_pair(in + i);
+        acc = smlald(pair, pair, acc);
+    }
+    if (i < count) acc += (int32_t) in[i] * in[i];
+    return (uint64_t) acc;
+}
+
+static int32_t sum (const q15_t* in, uint16_t count) {
+    int32_t total = 0;
+
+    for (uint16_t i = 0; i < count; i++) total += in[i];
+    return total;
+}
+
+static void min_max (const q15_t* in, uint16_t count, q15_t* min, q15_t* max) {
+    for (uint16_t i = 0; i < count; i++) {
+        if (in[i] < *min) *min = in[i];
+        if (in[i] > *max) *max = in[i];
+    }
+}
+
+static q15_t floor_div (int32_t total, uint16_t count) {
+    int32_t q = total / count;
+
+    if (total % count != 0 && total < 0) q--;
+    return q;
+}
+
+void dsp_window_init (dsp_window_t* window, uint16_t length) {
+    memset(window, 0, sizeof(*window));
+    window->length = length;
+}
+
+uint16_t dsp_window (dsp_window_t* window, const q15_t* in, uint16_t count,
+                     dsp_features_t* out, uint16_t max_out) {
+    uint16_t written = 0;
+
+    while (count > 0) {
+        uint16_t chunk = window->length - window->count;
+
+        if (chunk > count) chunk = count;
+        if (window->count == 0) {
+            window->min = DSP_Q15_MAX;
+            window->max = DSP_Q15_MIN;
+            window->sum = 0;
+            window->sum_squares = 0;
+        }
+
+        min_max(in, chunk, &window->min, &window->max);
+        window->sum         += sum(in, chunk);
+        window->sum_squares += sum_squares(in, chunk);
+        window->count       += chunk;
+        in    += chunk;
+        count -= chunk;
+
+        if (window->count == window->length) {
+            if (written < max_out) {
+                out[written].min  = window->min;
+                out[written].max  = window->max;
+                out[written].mean = floor_div(window->sum, window->length);
+                out[written].rms  = dsp_isqrt(window->sum_squares / window->length);
+                written++;
+            }
+            window->count = 0;
+        }
+    }
+
+    return written;
+}
+
+void dsp_features (const q15_t* in, uint16_t count, dsp_features_t* features) {
+    dsp_window_t window;
+
+    dsp_window_init(&window, count);
+    dsp_window(&window, in, count, features, 1);
+}
+
+q15_t dsp_rms (const q15_t* in, uint16_t count) {
+    if (count == 0) return 0;
+    return dsp_isqrt(sum_squares(in, count) / count);
+}
+
+uint16_t dsp_peaks (const q15_t* in, uint16_t count, q15_t threshold, uint16_t min_distance,
+                    uint16_t* peaks, uint16_t max_peaks) {
+    uint16_t found = 0;
+    int32_t last = -(int32_t) min_distance;
+
+    for (uint16_t i = 1; i + 1 < count && found < max_peaks; i++) {
+        q15_t x = in[i];
+
+        if (x >= threshold && x > in[i - 1] && x >= in[i + 1] && (int32_t) i - last >= min_distance) {
+            peaks[found++] = i;
+            last = i;
+        }
+    }
+
+    return found;
+}
+
+
+/******************************************************************************
+ * FFT
+ ******************************************************************************/
+
+// 32767 * sin(2 pi i / DSP_FFT_MAX), a quarter wave
+static const q15_t sine[DSP_FFT_MAX / 4 + 1] = {
+    0, 201, 402, 603, 804, 1005, 1206, 1407,
+    1608, 1809, 2009, 2210, 2410, 2611, 2811, 3012,
+    3212, 3412, 3612, 3811, 4011, 4210, 4410, 4609,
+    4808, 5007, 5205, 5404, 5602, 5800, 5998, 6195,
+    6393, 6590, 6786, 6983, 7179, 7375, 7571, 7767,
+    7962, 8157, 8351, 8545, 8739, 8933, 9126, 9319,
+    9512, 9704, 9896, 10087, 10278, 10469, 10659, 10849,
+    11039, 11228, 11417, 11605, 11793, 11980, 12167, 12353,
+    12539, 12725, 12910, 13094, 13279, 13462, 13645, 13828,
+    14010, 14191, 14372, 14553, 14732, 14912, 15090, 15269,
+    15446, 15623, 15800, 15976, 16151, 16325, 16499, 16673,
+    16846, 17018, 17189, 17360, 17530, 17700, 17869, 18037,
+    18204, 18371, 18537, 18703, 18868, 19032, 19195, 19357,
+    19519, 19680, 19841, 20000, 20159, 20317, 20475, 20631,
+    20787, 20942, 21096, 21250, 21403, 21554, 21705, 21856,
+    22005, 22154, 22301, 22448, 22594, 22739, 22884, 23027,
+    23170, 23311, 23452, 23592, 23731, 23870, 24007, 24143,
+    24279, 24413, 24547, 24680, 24811, 24942, 25072, 25201,
+    25329, 25456, 25582, 25708, 25832, 25955, 26077, 26198,
+    26319, 26438, 26556, 26674, 26790, 26905, 27019, 27133,
+    27245, 27356, 27466, 27575, 27683, 27790, 27896, 28001,
+    28105, 28208, 28310, 28411, 28510, 28609, 28706, 28803,
+    28898, 28992, 29085, 29177, 29268, 29358, 29447, 29534,
+    29621, 29706, 29791, 29874, 29956, 30037, 30117, 30195,
+    30273, 30349, 30424, 30498, 30571, 30643, 30714, 30783,
+    30852, 30919, 30985, 31050, 31113, 31176, 31237, 31297,
+    31356, 31414, 31470, 31526, 31580, 31633, 31685, 31736,
+    31785, 31833, 31880, 31926, 31971, 32014, 32057, 32098,
+    32137, 32176, 32213, 32250, 32285, 32318, 32351, 32382,
+    32412, 32441, 32469, 32495, 32521, 32545, 32567, 32589,
+    32609, 32628, 32646, 32663, 32678, 32692, 32705, 32717,
+    32728, 32737, 32745, 32752, 32757, 32761, 32765, 32766,
+    32767,
+};
+
+// Angles are in units of 2 pi / DSP_FFT_MAX
+static int32_t sin_q15 (uint16_t angle) {
+    angle &= DSP_FFT_MAX - 1;
+    if (angle <= DSP_FFT_MAX / 4)     return sine[angle];
+    if (angle <= DSP_FFT_MAX / 2)     return sine[DSP_FFT_MAX / 2 - angle];
+    if (angle <= DSP_FFT_MAX * 3 / 4) return -sine[angle - DSP_FFT_MAX / 2];
+    return -sine[DSP_FFT_MAX - angle];
+}
+
+static int32_t cos_q15 (uint16_t angle) {
+    return sin_q15(angle + DSP_FFT_MAX / 4);
+}
+
+// Complex FFT of m points, interleaved real and imaginary, scaled by 1/m:
+// every butterfly halves its inputs so nothing overflows
+static void cfft (q15_t* data, uint16_t m) {
+    uint16_t bits = 0;
+
+    while ((1u << bits) < m) bits++;
+
+    for (uint16_t i = 0; i < m; i++) {
+        uint16_t j = 0;
+        for (uint16_t b = 0; b < bits; b++) {
+            if (i & (1u << b)) j |= 1u << (bits - 1 - b);
+        }
+        if (i < j) {
+            uint32_t a = read_pair(data + 2 * i);
+            write_pair(data + 2 * i, read_pair(data + 2 * j));
+            write_pair(data + 2 * j, a);
+        }
+    }
+
+    for (uint16_t size = 2; size <= m; size <<= 1) {
+        uint16_t half = size / 2;
+        uint16_t step = DSP_FFT_MAX / size;
+
+        for (uint16_t j = 0; j < half; j++) {
+            // W = cos - j sin, packed as (cos, sin)
+            uint32_t w = pack(cos_q15(j * step), sin_q15(j * step));
+
+            for (uint16_t start = j; start < m; start += size) {
+                q15_t* pa = data + 2 * start;
+                q15_t* pb = data + 2 * (start + half);
+                uint32_t a = shadd16(read_pair(pa), 0);
+                uint32_t b = read_pair(pb);
+
+                // t = W b / 2: re = b.re cos + b.im sin, im = b.im cos - b.re sin
+                uint32_t t = pack(smuad(b, w) >> 16, smusdx(w, b) >> 16);
+
+                write_pair(pa, qadd16(a, t));
+                write_pair(pb, qsub16(a, t));
+            }
+        }
+    }
+}
+
+// One bin of the real FFT from the complex FFT of the even and odd samples:
+// X[k] = (E[k] + W^k O[k]) / 2 with E = Z[k] + conj(Z[m-k]) and
+// O = -j (Z[k] - conj(Z[m-k])), each also half of the textbook value
+static void split_bin (const q15_t* z, const q15_t* mirror, int32_t c, int32_t s, q15_t* x) {
+    int32_t even_re = z[0] + mirror[0];
+    int32_t even_im = z[1] - mirror[1];
+    int32_t odd_re = z[1] + mirror[1];
+    int32_t odd_im = mirror[0] - z[0];
+    int32_t tr = (int32_t) (((int64_t) odd_re * c + (int64_t) odd_im * s) >> 15);
+    int32_t ti = (int32_t) (((int64_t) odd_im * c - (int64_t) odd_re * s) >> 15);
+
+    x[0] = saturate((even_re + tr) >> 2);
+    x[1] = saturate((even_im + ti) >> 2);
+}
+
+void dsp_rfft (q15_t* data, uint16_t n) {
+    uint16_t m = n / 2;
+    uint16_t step = DSP_FFT_MAX / n;
+    int32_t zr, zi;
+
+    // n real samples are m complex ones, even samples real and odd imaginary
+    cfft(data, m);
+
+    zr = data[0];
+    zi = data[1];
+    data[0] = saturate((zr + zi) >> 1);
+    data[1] = saturate((zr - zi) >> 1);
+
+    for (uint16_t k = 1; k <= m / 2; k++) {
+        q15_t* a = data + 2 * k;
+        q15_t* b = data + 2 * (m - k);
+        q15_t xa[2], xb[2];
+
+        split_bin(a, b, cos_q15(k * step), sin_q15(k * step), xa);
+        split_bin(b, a, cos_q15((m - k) * step), sin_q15((m - k) * step), xb);
+        a[0] = xa[0];
+        a[1] = xa[1];
+        if (b != a) {
+            b[0] = xb[0];
+            b[1] = xb[1];
+        }
+    }
+}
+
+void dsp_rfft_magnitude (const q15_t* data, uint16_t n, q15_t* magnitude) {
+    magnitude[0] = saturate(data[0] < 0 ? -data[0] : data[0]);
+    for (uint16_t k = 1; k < n / 2; k++) {
+        int32_t re = data[2 * k];
+        int32_t im = data[2 * k + 1];
+        magnitude[k] = saturate(dsp_isqrt((uint64_t) (re * re) + (uint64_t) (im * im)));
+    }
+}
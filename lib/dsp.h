@@ -0,0 +1,151 @@
+#ifndef DSP_H
+#define DSP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*******************************************************************************
+ * Fixed point signal processing for sample buffers, so that an app can send
+ * a few features instead of every sample.
+ *
+ * Samples are Q15 (int16, -1 to 1). Everything is integer arithmetic with
+ * the rounding spelled out, so results are the same bit for bit on the
+ * nRF52's Cortex-M4, the nRF51's Cortex-M0 and a PC. On the M4 the inner
+ * loops use the CMSIS SIMD intrinsics (two 16 bit multiply-accumulates per
+ * instruction, halving and saturating 16 bit adds); elsewhere plain C does
+ * exactly what those instructions do. Define DSP_NO_SIMD to use the plain C
+ * on the M4 too.
+ *
+ *   FIR     decimating, coefficients in time reversed order like CMSIS
+ *   IIR     cascade of decimating biquads, Q14 coefficients
+ *   window  min, max, mean and RMS of consecutive windows, across buffers
+ *   peaks   local maxima above a threshold, a minimum distance apart
+ *   FFT     radix-2 real FFT, in place, scaled by 1/N
+ *
+ */
+
+typedef int16_t q15_t;
+
+#define DSP_Q15_MAX  32767
+#define DSP_Q15_MIN  (-32768)
+
+// Convert a constant in [-1, 1) to Q15 or Q14 at compile time
+#define DSP_Q15(x)   ((q15_t)((x) * 32768.0 + ((x) < 0 ? -0.5 : 0.5)))
+#define DSP_Q14(x)   ((q15_t)((x) * 16384.0 + ((x) < 0 ? -0.5 : 0.5)))
+
+
+/******************************************************************************
+ * FIR
+ ******************************************************************************/
+
+// Input is filtered in chunks of this many samples
+#ifndef DSP_FIR_BLOCK
+#define DSP_FIR_BLOCK 32
+#endif
+
+// State buffer length for a filter with `taps` coefficients
+#define DSP_FIR_STATE_LEN(taps) ((taps) - 1 + DSP_FIR_BLOCK)
+
+typedef struct {
+    const q15_t* coeffs;    // num_taps, time reversed: coeffs[num_taps-1] multiplies the newest sample
+    q15_t*       state;     // DSP_FIR_STATE_LEN(num_taps)
+    uint16_t     num_taps;
+    uint8_t      factor;    // keep every factor-th output, 1 to not decimate
+    uint8_t      phase;     // inputs until the next output
+} dsp_fir_t;
+
+void dsp_fir_init (dsp_fir_t* fir, const q15_t* coeffs, uint16_t num_taps, uint8_t factor, q15_t* state);
+
+// Filter count samples. Writes up to count / factor + 1 outputs and returns
+// how many. in and out may be the same buffer.
+uint16_t dsp_fir (dsp_fir_t* fir, const q15_t* in, uint16_t count, q15_t* out);
+
+
+/******************************************************************************
+ * IIR
+ ******************************************************************************/
+
+// One second order section:
+//   y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] + a1 y[n-1] + a2 y[n-2]
+// in Q14, with a1 and a2 negated from the usual textbook sign (as in CMSIS).
+typedef struct {
+    q15_t b0, b1, b2, a1, a2;
+} dsp_biquad_t;
+
+typedef struct {
+    q15_t x1, x2, y1, y2;
+} dsp_biquad_state_t;
+
+typedef struct {
+    const dsp_biquad_t* stages;
+    dsp_biquad_state_t* state;      // one per stage
+    uint8_t             num_stages;
+    uint8_t             factor;
+    uint8_t             phase;
+} dsp_iir_t;
+
+void dsp_iir_init (dsp_iir_t* iir, const dsp_biquad_t* stages, uint8_t num_stages, uint8_t factor,
+                   dsp_biquad_state_t* state);
+
+// Filter count samples through every stage, keeping every factor-th output.
+// Returns the number written. in and out may be the same buffer.
+uint16_t dsp_iir (dsp_iir_t* iir, const q15_t* in, uint16_t count, q15_t* out);
+
+
+/******************************************************************************
+ * Windows, RMS and peaks
+ ******************************************************************************/
+
+typedef struct {
+    q15_t min;
+    q15_t max;
+    q15_t mean;     // rounded toward minus infinity
+    q15_t rms;      // rounded down
+} dsp_features_t;
+
+typedef struct {
+    uint16_t length;
+    uint16_t count;
+    q15_t    min;
+    q15_t    max;
+    int32_t  sum;
+    uint64_t sum_squares;
+} dsp_window_t;
+
+void dsp_window_init (dsp_window_t* window, uint16_t length);
+
+// Add samples. Every window of `length` samples completed writes one entry
+// to out, up to max_out. Returns how many were written.
+uint16_t dsp_window (dsp_window_t* window, const q15_t* in, uint16_t count,
+                     dsp_features_t* out, uint16_t max_out);
+
+// All of a buffer's features at once
+void dsp_features (const q15_t* in, uint16_t count, dsp_features_t* features);
+
+q15_t dsp_rms (const q15_t* in, uint16_t count);
+
+// Indexes of samples at least threshold that are larger than the samples
+// before and not smaller than the samples after them, and at least
+// min_distance after the previous peak. Returns the number found.
+uint16_t dsp_peaks (const q15_t* in, uint16_t count, q15_t threshold, uint16_t min_distance,
+                    uint16_t* peaks, uint16_t max_peaks);
+
+uint32_t dsp_isqrt (uint64_t x);
+
+
+/******************************************************************************
+ * FFT
+ ******************************************************************************/
+
+#define DSP_FFT_MAX 1024
+
+// Real FFT of n (8 to DSP_FFT_MAX, a power of two) samples, in place.
+// Afterwards data holds X/n packed like CMSIS: X[0] and X[n/2], which are
+// real, then the real and imaginary parts of X[1] to X[n/2-1]. The buffer
+// must be 4 byte aligned.
+void dsp_rfft (q15_t* data, uint16_t n);
+
+// Magnitudes of the n/2 bins dsp_rfft() left in data, X[0] to X[n/2-1]
+void dsp_rfft_magnitude (const q15_t* data, uint16_t n, q15_t* magnitude);
+
+#endif
@@ -177,6 +177,9 @@ int fseek (FILE* f, long int offset, int origin) {
 	} else if (origin == SEEK_CUR) {
 		// From current position
 		new_position = offset + fptr;
+	} else if (origin == SEEK_END) {
+		// From the end of the file
+		new_position = offset + file->len;
 	}
 
 	if (new_position > file->len) {
@@ -189,11 +192,20 @@ int fseek (FILE* f, long int offset, int origin) {
 	return 0;
 }
 
+long int ftell (FILE* f) {
+	return f->fpos;
+}
+
 void rewind (FILE* f) {
 	// Just need to reset our array index into the file buffer
 	f->fpos = 0;
 }
 
+// Nothing is buffered, every fwrite goes straight to the file
+int fflush (FILE* stream) {
+	return 0;
+}
+
 int fclose (FILE* stream) {
 	stream->handle = 0;
 	return 0;
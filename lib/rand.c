@@ -0,0 +1,283 @@
+// Entropy pool and CTR-DRBG, see rand.h
+
+#include <string.h>
+
+#include "rand.h"
+#include "spsc_queue.h"
+
+#ifndef RAND_HOST
+#include "nrf.h"
+#include "app_util_platform.h"
+#ifdef SOFTDEVICE_PRESENT
+#include "nrf_sdm.h"
+#include "nrf_soc.h"
+#endif
+#endif
+
+#if (RAND_POOL_SIZE & (RAND_POOL_SIZE - 1)) != 0 || RAND_POOL_SIZE < RAND_SEED_LEN
+#error "RAND_POOL_SIZE must be a power of two, at least RAND_SEED_LEN"
+#endif
+
+#define BLOCK 16
+
+SPSC_QUEUE_DEFINE(pool, uint8_t, RAND_POOL_SIZE);
+
+// SP 800-90A CTR_DRBG state. The reseed counter counts bytes, not requests.
+static struct {
+	uint8_t  key[BLOCK];
+	uint8_t  v[BLOCK];
+	uint32_t since_reseed;
+	bool     seeded;
+} drbg;
+
+static rand_stats_t stats;
+
+
+/******************************************************************************
+ * Hardware
+ ******************************************************************************/
+
+#ifdef RAND_HOST
+
+static void aes (const uint8_t key[BLOCK], const uint8_t in[BLOCK], uint8_t out[BLOCK]) {
+	rand_host_aes(key, in, out);
+}
+
+static void rng_start (void) {
+}
+
+static bool softdevice_seed (uint8_t seed[RAND_SEED_LEN]) {
+	return false;
+}
+
+static void personalize (uint8_t seed[RAND_SEED_LEN]) {
+}
+
+#else
+
+// Whether a SoftDevice owns the RNG and ECB
+static bool softdevice;
+
+// Key, cleartext and ciphertext, the layout ECBDATAPTR points to and the
+// SoftDevice's nrf_ecb_hal_data_t
+static struct {
+	uint8_t key[BLOCK];
+	uint8_t in[BLOCK];
+	uint8_t out[BLOCK];
+} ecb;
+
+static void aes (const uint8_t key[BLOCK], const uint8_t in[BLOCK], uint8_t out[BLOCK]) {
+	memcpy(ecb.key, key, BLOCK);
+	memcpy(ecb.in, in, BLOCK);
+
+#ifdef SOFTDEVICE_PRESENT
+	if (softdevice) {
+		sd_ecb_block_encrypt((nrf_ecb_hal_data_t*) &ecb);
+		memcpy(out, ecb.out, BLOCK);
+		return;
+	}
+#endif
+
+	// About 7 us on the nRF52, 17 on the nRF51. The radio's CCM and AAR can
+	// abort it, in which case it is run again.
+	do {
+		NRF_ECB->ECBDATAPTR      = (uint32_t) &ecb;
+		NRF_ECB->EVENTS_ENDECB   = 0;
+		NRF_ECB->EVENTS_ERRORECB = 0;
+		NRF_ECB->TASKS_STARTECB  = 1;
+		while (NRF_ECB->EVENTS_ENDECB == 0 && NRF_ECB->EVENTS_ERRORECB == 0);
+	} while (NRF_ECB->EVENTS_ENDECB == 0);
+
+	memcpy(out, ecb.out, BLOCK);
+}
+
+// Runs until the pool is full, a byte about every 120 us with bias
+// correction on
+void RNG_IRQHandler (void) {
+	if (NRF_RNG->EVENTS_VALRDY) {
+		uint8_t value = NRF_RNG->VALUE;
+
+		NRF_RNG->EVENTS_VALRDY = 0;
+		rand_add_entropy(&value, 1);
+		if (spsc_queue_count(&pool) == RAND_POOL_SIZE) {
+			NRF_RNG->TASKS_STOP = 1;
+		}
+	}
+}
+
+static void rng_start (void) {
+	if (!softdevice) {
+		NRF_RNG->TASKS_START = 1;
+	}
+}
+
+static void rng_init (void) {
+	NRF_RNG->TASKS_STOP    = 1;
+	NRF_RNG->EVENTS_VALRDY = 0;
+	NRF_RNG->CONFIG        = RNG_CONFIG_DERCEN_Msk;
+	NRF_RNG->INTENSET      = RNG_INTENSET_VALRDY_Msk;
+
+	NVIC_ClearPendingIRQ(RNG_IRQn);
+	NVIC_SetPriority(RNG_IRQn, APP_IRQ_PRIORITY_LOW);
+	NVIC_EnableIRQ(RNG_IRQn);
+
+	NRF_RNG->TASKS_START = 1;
+}
+
+static bool softdevice_seed (uint8_t seed[RAND_SEED_LEN]) {
+#ifdef SOFTDEVICE_PRESENT
+	uint8_t available = 0;
+
+	if (softdevice &&
+	    sd_rand_application_bytes_available_get(&available) == NRF_SUCCESS &&
+	    available >= RAND_SEED_LEN &&
+	    sd_rand_application_vector_get(seed, RAND_SEED_LEN) == NRF_SUCCESS) {
+		stats.entropy_bytes += RAND_SEED_LEN;
+		return true;
+	}
+#endif
+	return false;
+}
+
+// Two chips seeded alike still generate different streams
+static void personalize (uint8_t seed[RAND_SEED_LEN]) {
+	const uint32_t id[4] = {
+		NRF_FICR->DEVICEID[0], NRF_FICR->DEVICEID[1],
+		NRF_FICR->DEVICEADDR[0], NRF_FICR->DEVICEADDR[1],
+	};
+	const uint8_t* bytes = (const uint8_t*) id;
+
+	for (uint8_t i = 0; i < sizeof(id); i++) {
+		seed[i] ^= bytes[i];
+	}
+}
+
+#endif
+
+
+/******************************************************************************
+ * CTR-DRBG
+ ******************************************************************************/
+
+// V is a big endian counter
+static void increment (uint8_t v[BLOCK]) {
+	for (int8_t i = BLOCK - 1; i >= 0; i--) {
+		if (++v[i] != 0) break;
+	}
+}
+
+// CTR_DRBG_Update: the next two blocks, xor the provided data, become the
+// new key and V. Runs after every request, so a later look at the state does
+// not give away what was generated before.
+static void update (const uint8_t provided[RAND_SEED_LEN]) {
+	uint8_t temp[RAND_SEED_LEN];
+
+	for (uint8_t i = 0; i < RAND_SEED_LEN; i += BLOCK) {
+		increment(drbg.v);
+		aes(drbg.key, drbg.v, temp + i);
+	}
+	stats.aes_blocks += RAND_SEED_LEN / BLOCK;
+
+	if (provided != NULL) {
+		for (uint8_t i = 0; i < RAND_SEED_LEN; i++) temp[i] ^= provided[i];
+	}
+	memcpy(drbg.key, temp, BLOCK);
+	memcpy(drbg.v, temp + BLOCK, BLOCK);
+	memset(temp, 0, sizeof(temp));
+}
+
+// A seed's worth from the pool, or else from the SoftDevice
+static bool take_seed (uint8_t seed[RAND_SEED_LEN]) {
+	if (spsc_queue_count(&pool) >= RAND_SEED_LEN) {
+		for (uint8_t i = 0; i < RAND_SEED_LEN; i++) {
+			spsc_queue_pop(&pool, &seed[i]);
+		}
+		rng_start();
+		return true;
+	}
+	return softdevice_seed(seed);
+}
+
+static void reseed (void) {
+	uint8_t seed[RAND_SEED_LEN];
+
+	if (!take_seed(seed)) return;
+
+	if (!drbg.seeded) {
+		// Instantiate: key and V start at zero
+		personalize(seed);
+		memset(drbg.key, 0, BLOCK);
+		memset(drbg.v, 0, BLOCK);
+		drbg.seeded = true;
+	}
+	update(seed);
+	memset(seed, 0, sizeof(seed));
+
+	drbg.since_reseed = 0;
+	stats.reseeds++;
+}
+
+
+/******************************************************************************
+ * API
+ ******************************************************************************/
+
+void rand_init (void) {
+	memset(&drbg, 0, sizeof(drbg));
+	memset(&stats, 0, sizeof(stats));
+	spsc_queue_init(&pool, pool_items, 1, RAND_POOL_SIZE);
+
+#ifndef RAND_HOST
+	softdevice = false;
+#ifdef SOFTDEVICE_PRESENT
+	uint8_t enabled = 0;
+	softdevice = sd_softdevice_is_enabled(&enabled) == NRF_SUCCESS && enabled;
+#endif
+	if (!softdevice) {
+		rng_init();
+	}
+#endif
+}
+
+bool rand_get (void* buf, uint16_t len) {
+	uint8_t* out = buf;
+	uint8_t block[BLOCK];
+
+	stats.calls++;
+
+	if (!drbg.seeded || drbg.since_reseed >= RAND_RESEED_BYTES) {
+		reseed();
+	}
+	if (!drbg.seeded) {
+		stats.not_ready++;
+		return false;
+	}
+
+	while (len > 0) {
+		uint8_t n = len < BLOCK ? len : BLOCK;
+
+		increment(drbg.v);
+		aes(drbg.key, drbg.v, block);
+		memcpy(out, block, n);
+		out += n;
+		len -= n;
+		drbg.since_reseed += n;
+		stats.bytes += n;
+		stats.aes_blocks++;
+	}
+	memset(block, 0, sizeof(block));
+
+	update(NULL);
+	return true;
+}
+
+void rand_add_entropy (const uint8_t* data, uint16_t len) {
+	for (uint16_t i = 0; i < len; i++) {
+		if (!spsc_queue_push(&pool, &data[i])) break;
+		stats.entropy_bytes++;
+	}
+}
+
+void rand_get_stats (rand_stats_t* stats_out) {
+	*stats_out = stats;
+}
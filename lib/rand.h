@@ -0,0 +1,91 @@
+#ifndef RAND_H
+#define RAND_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*******************************************************************************
+ * Random bytes without waiting for the hardware.
+ *
+ * The RNG peripheral makes a byte every ~100 us at best, and much slower
+ * with bias correction, so reading it when the numbers are needed stalls the
+ * caller. Here true random bytes collect in a small pool in the background
+ * and seed a CTR-DRBG (NIST SP 800-90A, AES-128, no derivation function),
+ * which expands them. rand_get() only ever runs AES on the ECB peripheral, a
+ * few microseconds per 16 bytes, and never waits for entropy.
+ *
+ * Where the entropy comes from:
+ *
+ *   no SoftDevice  the RNG interrupt fills the pool and stops the RNG when
+ *                  the pool is full; taking a seed starts it again
+ *   SoftDevice     the RNG belongs to the SoftDevice, which keeps its own
+ *                  pool; seeds come from sd_rand_application_vector_get()
+ *
+ * and AES runs on NRF_ECB directly or through sd_ecb_block_encrypt().
+ * Whether a SoftDevice is enabled is checked in rand_init(), so call it after
+ * simple_ble_init(). Don't link nrf_drv_rng.c as well: both want the RNG.
+ *
+ * The generator is first seeded once RAND_SEED_LEN bytes of entropy are
+ * in; until then rand_get() returns false. After that it reseeds whenever
+ * RAND_RESEED_BYTES have been generated and a fresh seed is at hand.
+ *
+ * Call rand_get() from one interrupt priority (or the main loop) only.
+ *
+ * Built with RAND_HOST there is no hardware: the program supplies
+ * rand_host_aes() and feeds entropy with rand_add_entropy(), so the
+ * generator can be tested on a PC (tests/rand).
+ *
+ * USAGE
+ *
+ *   simple_ble_init(&ble_config);
+ *   rand_init();
+ *   ...
+ *   uint8_t nonce[8];
+ *   if (rand_get(nonce, sizeof(nonce))) {
+ *     ...
+ *   }
+ *
+ */
+
+// Entropy in one seed: key and counter of the DRBG
+#define RAND_SEED_LEN 32
+
+// Bytes of entropy the pool holds, a power of two of at least RAND_SEED_LEN
+#ifndef RAND_POOL_SIZE
+#define RAND_POOL_SIZE 64
+#endif
+
+// Generate at most this much from one seed if fresh entropy is available
+#ifndef RAND_RESEED_BYTES
+#define RAND_RESEED_BYTES 1024
+#endif
+
+typedef struct {
+    uint32_t bytes;             // generated by rand_get()
+    uint32_t calls;
+    uint32_t not_ready;         // calls that found the generator unseeded
+    uint32_t reseeds;           // including the first seed
+    uint32_t entropy_bytes;     // taken into the pool
+    uint32_t aes_blocks;
+} rand_stats_t;
+
+// Start collecting entropy
+void rand_init (void);
+
+// Fill buf with len random bytes. Returns false, and leaves buf alone, if
+// the generator has not been seeded yet.
+bool rand_get (void* buf, uint16_t len);
+
+// Add entropy to the pool, for example noisy ADC samples. Whatever does not
+// fit is dropped. Without a SoftDevice the RNG interrupt already feeds the
+// pool, and it must be the only one that does.
+void rand_add_entropy (const uint8_t* data, uint16_t len);
+
+void rand_get_stats (rand_stats_t* stats);
+
+#ifdef RAND_HOST
+// Provided by the host program: AES-128 of one block
+void rand_host_aes (const uint8_t key[16], const uint8_t in[16], uint8_t out[16]);
+#endif
+
+#endif
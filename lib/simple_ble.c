@@ -905,8 +905,12 @@ uint32_t simple_ble_stack_char_get (simple_ble_char_t* char_handle, uint16_t* le
         .offset = 0,
         .p_value = buf,
     };
+    uint32_t err_code;
 
-    return sd_ble_gatts_value_get(app.conn_handle, char_handle->char_handle.value_handle, &value);
+    err_code = sd_ble_gatts_value_get(app.conn_handle, char_handle->char_handle.value_handle, &value);
+    // report how much was actually read
+    *len = value.len;
+    return err_code;
 }
 
 uint32_t simple_ble_stack_char_set (simple_ble_char_t* char_handle, uint16_t len, uint8_t* buf) {
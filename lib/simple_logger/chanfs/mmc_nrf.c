@@ -5,8 +5,8 @@
 
 #define NRF_SPI NRF_SPI1
 
-#define FCLK_SLOW() NRF_SPI->FREQUENCY = SPI_FREQUENCY_FREQUENCY_K250
-#define FCLK_FAST() NRF_SPI->FREQUENCY = SPI_FREQUENCY_FREQUENCY_M4
+#define FCLK_SLOW() NRF_SPI->FREQUENCY = SpiFreq = SPI_FREQUENCY_FREQUENCY_K250
+#define FCLK_FAST() NRF_SPI->FREQUENCY = SpiFreq = SPI_FREQUENCY_FREQUENCY_M4
 
 #define CS_HIGH()	nrf_gpio_pin_set(SPI_CS_PIN)
 #define CS_LOW()	nrf_gpio_pin_clear(SPI_CS_PIN)
@@ -45,6 +45,23 @@
 #include "diskio.h"
 
 
+/* To share the SPI peripheral with spi_bus users, define MMC_SPI_BUS in
+   board.h as the name of the spi_bus_t that wraps the same instance as
+   NRF_SPI. The card then claims the bus while it is selected. */
+#ifdef MMC_SPI_BUS
+#include "spi_bus.h"
+extern spi_bus_t MMC_SPI_BUS;
+#define SPI_CLAIM()		{ spi_bus_claim_raw(&MMC_SPI_BUS); SPI_CONFIG(); NRF_SPI->FREQUENCY = SpiFreq; }
+#define SPI_RELEASE()	{ NRF_SPI->ENABLE = 0; spi_bus_release_raw(&MMC_SPI_BUS); }
+#else
+#define SPI_CLAIM()
+#define SPI_RELEASE()
+#endif
+
+static
+uint32_t SpiFreq = SPI_FREQUENCY_FREQUENCY_K250;	/* Restored when the bus is claimed */
+
+
 /* MMC/SD command */
 #define CMD0	(0)			/* GO_IDLE_STATE */
 #define CMD1	(1)			/* SEND_OP_COND (MMC) */
@@ -87,6 +104,7 @@ BYTE CardType;			/* Card type flags */
 static void init_spi (void) {
 	SD_PIN_INIT();
 	SD_POWER_ON();
+	SPI_CLAIM();
 	SPI_CONFIG();
 	CS_HIGH();			/* Set CS# high */
 
@@ -161,6 +179,7 @@ void deselect (void)
 {
 	CS_HIGH();		/* Set CS# high */
 	xchg_spi(0xFF);	/* Dummy clock (force DO hi-z for multiple slave SPI) */
+	SPI_RELEASE();	/* Let other spi_bus devices run */
 }
 
 
@@ -172,6 +191,7 @@ void deselect (void)
 static
 int select (void)	/* 1:OK, 0:Timeout */
 {
+	SPI_CLAIM();	/* Take the SPI back from spi_bus if shared */
 	CS_LOW();		/* Set CS# low */
 	xchg_spi(0xFF);	/* Dummy clock (force DO enabled) */
 	if (wait_ready(500)) return 1;	/* Wait for card ready */
@@ -31,6 +31,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
 #define FFS_C
+#include <string.h>
+
 #include "board.h"
 #include "mem-ffs.h"
 #include "mem-mmcsd.h"
@@ -656,115 +658,38 @@ int ffs_fputc (int data, FFS_FILE *file_pointer)
 	BYTE *buffer_pointer;
 
 
-	//Exit of card is write protected
-	if (ffs_card_write_protected)
-		return(FFS_EOF);
-
-	//-------------------------------------------------
-	//----- EXIT IF THIS FILE ISN'T ACTUALLY OPEN -----
-	//-------------------------------------------------
-	if (file_pointer->flags.bits.file_is_open == 0)
+	//--------------------------------------------------------------------------
+	//----- CHECK WRITING IS PERMITTED AND MOVE TO THE END IF APPENDING -----
+	//--------------------------------------------------------------------------
+	if (ffs_prepare_to_write(file_pointer))
 		return(FFS_EOF);
 
 
-	//---------------------------------------------------------------------------------------------------------------------------
-	//----- CHECK THAT WRITING IN THIS POSITION IS PERMITTED FOR THE FOPEN MODE THAT WAS SPECIFIED WHEN THE FILE WAS OPENED -----
-	//---------------------------------------------------------------------------------------------------------------------------
-	if (file_pointer->flags.bits.write_permitted == 0)
-	{
-		//----- WRITING IS NOT PERMITTED -----
-		file_pointer->flags.bits.access_error = 1;
-		return(FFS_EOF);
-	}
-	if (file_pointer->flags.bits.write_append_only)
-	{
-		//----- APPEND MODE - WRITING MAY ONLY OCCUR AS NEW BYTES AT THE END OF THE FILE -----
-		dw_temp = file_pointer->current_byte_within_file;
-		if (file_pointer->flags.bits.inc_posn_before_next_rw)
-		{
-			dw_temp++;
-		}
-
-		if (dw_temp < file_pointer->file_size)
-		{
-			//CURRENTLY POINTING TO WITHIN FILE - SET TO END OF FILE
-			ffs_fseek(file_pointer, 1, FFS_SEEK_END);
-		}
-	}
-
-
 	//-----------------------------------------------------------------------
 	//----- CHECK FOR NEED TO MOVE TO NEXT BYTE POSITION BEFORE WRITING -----
 	//-----------------------------------------------------------------------
 	if (file_pointer->flags.bits.inc_posn_before_next_rw)
 	{
-		//----- INCREMENT BYTE COUNT -----
-		file_pointer->current_byte_within_file++;
-
-		file_pointer->current_byte++;
-		
-		if (file_pointer->current_byte >= ffs_bytes_per_sector)
-		{
-			//----- MOVE TO NEXT SECTOR -----
-			file_pointer->current_byte = 0;
-
-			file_pointer->current_sector++;
-
-			if (file_pointer->current_sector >= sectors_per_cluster)
-			{
-				//----- MOVE TO NEXT CLUSTER -----
-				file_pointer->current_sector = 0;
-
-				if (file_pointer->current_byte_within_file >= file_pointer->file_size)
-				{
-					//ADD NEW CLUSTER TO END OF FILE
-					dw_temp = ffs_get_next_free_cluster();
-					if (dw_temp == 0xffffffff)			//0xffffffff = no empty cluster found
-					{
-						//NOT ENOUGH SPACE FOR ANY MORE OF FILE
-						FFS_CE(1);
-						file_pointer->flags.bits.end_of_file = 1;
-						return(FFS_EOF);
-					}
-
-					//UPDATE THE CURRENT CLUSTER TO LINK TO THE NEXT CLUSTER
-					ffs_modify_cluster_entry_in_fat (file_pointer->current_cluster, dw_temp);
-
-					//UPDATE THE NEXT CLUSTER WITH THE END OF FILE MARKER
-					ffs_modify_cluster_entry_in_fat (dw_temp, 0x0fffffff);
-				}
-				else
-				{
-					//MOVE TO NEXT EXISTING CLUSTER
-                    dw_temp = ffs_get_next_cluster_no(file_pointer->current_cluster);
-					if (dw_temp == 0xffffffff)			//0xffffffff = no empty cluster found
-					{
-						//ERROR
-						FFS_CE(1);
-						file_pointer->flags.bits.access_error = 1;
-						return(FFS_EOF);
-					}
-				}
-
-				file_pointer->current_cluster = dw_temp;
-			}
-		}
-
-		file_pointer->flags.bits.inc_posn_before_next_rw = 0;
+		if (ffs_move_to_next_byte(file_pointer, 1))
+			return(FFS_EOF);
 	}
 
 	
 	//-------------------------------------------------------------
 	//----- CHECK FOR NEED TO LOAD CURRENT SECTOR INTO BUFFER -----
 	//-------------------------------------------------------------
-	dw_temp = (
-				((file_pointer->current_cluster - 2) * sectors_per_cluster) +
-				(DWORD)file_pointer->current_sector +
-				data_area_start_sector
-				);
+	dw_temp = ffs_current_lba(file_pointer);
 	if (ffs_buffer_contains_lba != dw_temp)
 	{
-		ffs_read_sector_to_buffer(dw_temp);
+		if ((file_pointer->current_byte == 0) && (file_pointer->current_byte_within_file >= file_pointer->file_size))
+		{
+			//Starting a sector past the end of the file - nothing in it is worth reading from the card
+			ffs_start_new_sector_in_buffer(dw_temp);
+		}
+		else
+		{
+			ffs_read_sector_to_buffer(dw_temp);
+		}
 	}
 
 
@@ -858,66 +783,15 @@ int ffs_fgetc (FFS_FILE *file_pointer)
 	//-----------------------------------------------------------------------
 	if (file_pointer->flags.bits.inc_posn_before_next_rw)
 	{
-		//----- INCREMENT BYTE COUNT -----
-		file_pointer->current_byte_within_file++;
-
-		file_pointer->current_byte++;
-		
-		if (file_pointer->current_byte >= ffs_bytes_per_sector)
-		{
-			//----- MOVE TO NEXT SECTOR -----
-			file_pointer->current_byte = 0;
-
-			file_pointer->current_sector++;
-
-			if (file_pointer->current_sector >= sectors_per_cluster)
-			{
-				//----- MOVE TO NEXT CLUSTER -----
-				file_pointer->current_sector = 0;
-
-				//Get the next cluster number
-				dw_temp = ffs_get_next_cluster_no(file_pointer->current_cluster);
-
-				if (disk_is_fat_32)
-				{
-					//FAT32
-					if (dw_temp >= 0x0ffffff8)
-					{
-						//There is no next cluster - all of file has been read
-						FFS_CE(1);
-						file_pointer->flags.bits.end_of_file = 1;
-						return(FFS_EOF);
-					}
-				}
-				else
-				{
-					//FAT16
-					if (dw_temp >= 0xfff8)
-					{
-						//There is no next cluster - all of file has been read
-						FFS_CE(1);
-						file_pointer->flags.bits.end_of_file = 1;
-						return(FFS_EOF);
-					}
-				}
-
-				file_pointer->current_cluster = dw_temp;
-
-			}
-		}
-
-		file_pointer->flags.bits.inc_posn_before_next_rw = 0;
+		if (ffs_move_to_next_byte(file_pointer, 0))
+			return(FFS_EOF);
 	}
 
 
 	//-------------------------------------------------------------
 	//----- CHECK FOR NEED TO LOAD CURRENT SECTOR INTO BUFFER -----
 	//-------------------------------------------------------------
-	dw_temp = (
-				((file_pointer->current_cluster - 2) * sectors_per_cluster) +
-				(DWORD)file_pointer->current_sector +
-				data_area_start_sector
-				);
+	dw_temp = ffs_current_lba(file_pointer);
 	if (ffs_buffer_contains_lba != dw_temp)
 	{
 		ffs_read_sector_to_buffer(dw_temp);
@@ -947,6 +821,189 @@ int ffs_fgetc (FFS_FILE *file_pointer)
 
 
 
+//**********************************************
+//**********************************************
+//********** PREPARE TO WRITE TO FILE **********
+//**********************************************
+//**********************************************
+//Checks made before any write.  In append mode the position is moved to the end of the file if it is not there already.
+//Returns
+//	0 if writing may go ahead, 1 otherwise
+BYTE ffs_prepare_to_write (FFS_FILE *file_pointer)
+{
+	DWORD dw_temp;
+
+
+	//Exit of card is write protected
+	if (ffs_card_write_protected)
+		return(1);
+
+	//-------------------------------------------------
+	//----- EXIT IF THIS FILE ISN'T ACTUALLY OPEN -----
+	//-------------------------------------------------
+	if (file_pointer->flags.bits.file_is_open == 0)
+		return(1);
+
+
+	//---------------------------------------------------------------------------------------------------------------------------
+	//----- CHECK THAT WRITING IN THIS POSITION IS PERMITTED FOR THE FOPEN MODE THAT WAS SPECIFIED WHEN THE FILE WAS OPENED -----
+	//---------------------------------------------------------------------------------------------------------------------------
+	if (file_pointer->flags.bits.write_permitted == 0)
+	{
+		//----- WRITING IS NOT PERMITTED -----
+		file_pointer->flags.bits.access_error = 1;
+		return(1);
+	}
+	if (file_pointer->flags.bits.write_append_only)
+	{
+		//----- APPEND MODE - WRITING MAY ONLY OCCUR AS NEW BYTES AT THE END OF THE FILE -----
+		dw_temp = file_pointer->current_byte_within_file;
+		if (file_pointer->flags.bits.inc_posn_before_next_rw)
+		{
+			dw_temp++;
+		}
+
+		if (dw_temp < file_pointer->file_size)
+		{
+			//CURRENTLY POINTING TO WITHIN FILE - SET TO END OF FILE
+			ffs_fseek(file_pointer, 1, FFS_SEEK_END);
+		}
+	}
+	return(0);
+}
+
+
+
+
+//********************************************************
+//********************************************************
+//********** MOVE TO NEXT BYTE POSITION IN FILE **********
+//********************************************************
+//********************************************************
+//Moves the file position on by 1 byte, moving to the next sector and cluster as needed.  When writing (extend_file = 1) a new
+//cluster is added to the file if the end of the last one is reached, when reading reaching the end of the cluster chain is an error.
+//Returns
+//	0 if successful, 1 otherwise (the end_of_file or access_error flag is set)
+BYTE ffs_move_to_next_byte (FFS_FILE *file_pointer, BYTE extend_file)
+{
+	DWORD dw_temp;
+
+
+	//----- INCREMENT BYTE COUNT -----
+	file_pointer->current_byte_within_file++;
+
+	file_pointer->current_byte++;
+	
+	if (file_pointer->current_byte >= ffs_bytes_per_sector)
+	{
+		//----- MOVE TO NEXT SECTOR -----
+		file_pointer->current_byte = 0;
+
+		file_pointer->current_sector++;
+
+		if (file_pointer->current_sector >= sectors_per_cluster)
+		{
+			//----- MOVE TO NEXT CLUSTER -----
+			file_pointer->current_sector = 0;
+
+			if (extend_file && (file_pointer->current_byte_within_file >= file_pointer->file_size))
+			{
+				//ADD NEW CLUSTER TO END OF FILE
+				dw_temp = ffs_get_next_free_cluster();
+				if (dw_temp == 0xffffffff)			//0xffffffff = no empty cluster found
+				{
+					//NOT ENOUGH SPACE FOR ANY MORE OF FILE
+					FFS_CE(1);
+					file_pointer->flags.bits.end_of_file = 1;
+					return(1);
+				}
+
+				//UPDATE THE CURRENT CLUSTER TO LINK TO THE NEXT CLUSTER
+				ffs_modify_cluster_entry_in_fat (file_pointer->current_cluster, dw_temp);
+
+				//UPDATE THE NEXT CLUSTER WITH THE END OF FILE MARKER
+				ffs_modify_cluster_entry_in_fat (dw_temp, 0x0fffffff);
+			}
+			else if (extend_file)
+			{
+				//MOVE TO NEXT EXISTING CLUSTER
+				dw_temp = ffs_get_next_cluster_no(file_pointer->current_cluster);
+				if (dw_temp == 0xffffffff)			//0xffffffff = no empty cluster found
+				{
+					//ERROR
+					FFS_CE(1);
+					file_pointer->flags.bits.access_error = 1;
+					return(1);
+				}
+			}
+			else
+			{
+				//Get the next cluster number
+				dw_temp = ffs_get_next_cluster_no(file_pointer->current_cluster);
+
+				if (
+					(disk_is_fat_32 && (dw_temp >= 0x0ffffff8)) ||			//FAT32
+					(!disk_is_fat_32 && (dw_temp >= 0xfff8))				//FAT16
+					)
+				{
+					//There is no next cluster - all of file has been read
+					FFS_CE(1);
+					file_pointer->flags.bits.end_of_file = 1;
+					return(1);
+				}
+			}
+
+			file_pointer->current_cluster = dw_temp;
+		}
+	}
+
+	file_pointer->flags.bits.inc_posn_before_next_rw = 0;
+	return(0);
+}
+
+
+
+
+//************************************************
+//************************************************
+//********** START NEW SECTOR IN BUFFER **********
+//************************************************
+//************************************************
+//Makes the driver buffer hold sector_lba without reading it from the card, for a sector that is about to be written from
+//its start at the end of a file.  Anything already waiting in the buffer is written to the card first.
+void ffs_start_new_sector_in_buffer (DWORD sector_lba)
+{
+	if (ffs_buffer_needs_writing_to_card)
+	{
+		if (ffs_buffer_contains_lba != 0xffffffff)
+			ffs_write_sector_from_buffer(ffs_buffer_contains_lba);
+		ffs_buffer_needs_writing_to_card = 0;
+	}
+
+	memset(&FFS_DRIVER_GEN_512_BYTE_BUFFER[0], 0, ffs_bytes_per_sector);
+	ffs_buffer_contains_lba = sector_lba;
+}
+
+
+
+
+//****************************************************
+//****************************************************
+//********** GET LBA OF CURRENT FILE SECTOR **********
+//****************************************************
+//****************************************************
+DWORD ffs_current_lba (FFS_FILE *file_pointer)
+{
+	return(
+			((file_pointer->current_cluster - 2) * sectors_per_cluster) +
+			(DWORD)file_pointer->current_sector +
+			data_area_start_sector
+			);
+}
+
+
+
+
 
 
 //******************************************
@@ -1076,34 +1133,100 @@ char* ffs_fgets (char *string, int length, FFS_FILE *file_pointer)
  
 int ffs_fwrite (const void *buffer, int size, int count, FFS_FILE *file_pointer)
 {
-	int size_count;
-	BYTE *string_Pointer;
-	int number_of_items_written = 0;
+	BYTE *source;
+	DWORD total;
+	DWORD remaining;
+	DWORD length;
+	DWORD lba;
 
 
 	//Exit of card is write protected
 	if (ffs_card_write_protected)
 		return(FFS_EOF);
 
-	string_Pointer = (BYTE*)buffer;
+	if ((size <= 0) || (count <= 0))
+		return(0);
+
+	if (ffs_prepare_to_write(file_pointer))
+		return(0);
+
+	source = (BYTE*)buffer;
+	total = (DWORD)size * (DWORD)count;
+	remaining = total;
 
-	//STORE ALL OF THE ITEMS
-	while (count)
+	//STORE THE DATA
+	//Runs within a sector are copied into the sector buffer in one go and whole sectors are written straight to the card,
+	//only the bytes that don't fit either go through ffs_fputc.
+	while (remaining)
 	{
-		//STORE EACH ITEM
-		for (size_count = 0; size_count < size; size_count++)
+		if ((file_pointer->flags.bits.inc_posn_before_next_rw) && (file_pointer->current_byte < (ffs_bytes_per_sector - 1)))
 		{
+			//----- COPY UP TO THE END OF THE CURRENT SECTOR INTO THE BUFFER -----
+			length = (ffs_bytes_per_sector - 1) - file_pointer->current_byte;
+			if (length > remaining)
+				length = remaining;
+
+			lba = ffs_current_lba(file_pointer);
+			if (ffs_buffer_contains_lba != lba)
+				ffs_read_sector_to_buffer(lba);
 
-			if (ffs_fputc((int)*string_Pointer++, file_pointer) == FFS_EOF)
+			memcpy(&FFS_DRIVER_GEN_512_BYTE_BUFFER[0] + file_pointer->current_byte + 1, source, length);
+			file_pointer->current_byte += (WORD)length;
+			file_pointer->current_byte_within_file += length;
+			ffs_buffer_needs_writing_to_card = 1;
+		}
+		else if (
+				(remaining >= ffs_bytes_per_sector) &&
+				(file_pointer->flags.bits.inc_posn_before_next_rw ?
+					(file_pointer->current_byte == (ffs_bytes_per_sector - 1)) :
+					(file_pointer->current_byte == 0))
+				)
+		{
+			//----- WRITE A WHOLE SECTOR STRAIGHT TO THE CARD -----
+			//(No need to read it first as every byte is replaced)
+			if (file_pointer->flags.bits.inc_posn_before_next_rw)
 			{
-				return(number_of_items_written);
+				if (ffs_move_to_next_byte(file_pointer, 1))
+					break;
+			}
+
+			lba = ffs_current_lba(file_pointer);
+			if (ffs_buffer_contains_lba == lba)
+			{
+				//The buffer holds this sector - update it instead so it can't later be written back over this data
+				memcpy(&FFS_DRIVER_GEN_512_BYTE_BUFFER[0], source, ffs_bytes_per_sector);
+				ffs_buffer_needs_writing_to_card = 1;
+			}
+			else
+			{
+				ffs_write_sector_from_ram(lba, source);
 			}
+
+			length = ffs_bytes_per_sector;
+			file_pointer->current_byte = ffs_bytes_per_sector - 1;
+			file_pointer->current_byte_within_file += ffs_bytes_per_sector - 1;
+			file_pointer->flags.bits.inc_posn_before_next_rw = 1;
+		}
+		else
+		{
+			//----- UNALIGNED HEAD OR TAIL - ONE BYTE AT A TIME -----
+			if (ffs_fputc((int)*source, file_pointer) == FFS_EOF)
+				break;
+			length = 1;
 		}
-		number_of_items_written++;
-		count--;
+
+		//ADJUST FILE SIZE IF WE HAVE WRITTEN PAST THE END OF THE FILE
+		if (file_pointer->current_byte_within_file >= file_pointer->file_size)
+		{
+			file_pointer->file_size = file_pointer->current_byte_within_file + 1;
+			file_pointer->flags.bits.file_size_has_changed = 1;
+		}
+
+		source += length;
+		remaining -= length;
 	}
 
-	return(number_of_items_written);
+	return((int)((total - remaining) / (DWORD)size));
 }
 
 
@@ -1122,33 +1245,108 @@ int ffs_fwrite (const void *buffer, int size, int count, FFS_FILE *file_pointer)
 //	occurred or End Of File has been reached (use ffs_ferror or ffs_feof to check what happened)
 int ffs_fread (void *buffer, int size, int count, FFS_FILE *file_pointer)
 {
-	int size_count;
 	int return_value;
-	BYTE *string_Pointer;
-	int number_of_items_written = 0;
+	BYTE *destination;
+	DWORD total;
+	DWORD remaining;
+	DWORD available;
+	DWORD length;
+	DWORD lba;
+
 
+	if ((size <= 0) || (count <= 0))
+		return(0);
+
+	//----- EXIT IF THIS FILE ISN'T OPEN FOR READING -----
+	//(ffs_fgetc makes the same checks, but the block paths below don't go through it)
+	if (file_pointer->flags.bits.file_is_open == 0)
+		return(0);
+
+	if (file_pointer->flags.bits.read_permitted == 0)
+	{
+		file_pointer->flags.bits.access_error = 1;
+		return(0);
+	}
 
-	string_Pointer = (BYTE*)buffer;
+	destination = (BYTE*)buffer;
+	total = (DWORD)size * (DWORD)count;
+	remaining = total;
 
-	//READ ALL OF THE ITEMS
-	while (count)
+	//READ THE DATA
+	//Runs within a sector are copied out of the sector buffer in one go and whole sectors are read straight from the card,
+	//only the bytes that don't fit either go through ffs_fgetc.
+	while (remaining)
 	{
-		//STORE EACH ITEM
-		for (size_count = 0; size_count < size; size_count++)
+		//Bytes left in the file after the next one to be read
+		available = file_pointer->current_byte_within_file;
+		if (file_pointer->flags.bits.inc_posn_before_next_rw)
+			available++;
+		available = (available < file_pointer->file_size) ? (file_pointer->file_size - available) : 0;
+
+		if ((available > 0) && (file_pointer->flags.bits.inc_posn_before_next_rw) && (file_pointer->current_byte < (ffs_bytes_per_sector - 1)))
+		{
+			//----- COPY UP TO THE END OF THE CURRENT SECTOR OUT OF THE BUFFER -----
+			length = (ffs_bytes_per_sector - 1) - file_pointer->current_byte;
+			if (length > remaining)
+				length = remaining;
+			if (length > available)
+				length = available;
+
+			lba = ffs_current_lba(file_pointer);
+			if (ffs_buffer_contains_lba != lba)
+				ffs_read_sector_to_buffer(lba);
+
+			memcpy(destination, &FFS_DRIVER_GEN_512_BYTE_BUFFER[0] + file_pointer->current_byte + 1, length);
+			file_pointer->current_byte += (WORD)length;
+			file_pointer->current_byte_within_file += length;
+		}
+		else if (
+				(remaining >= ffs_bytes_per_sector) &&
+				(available >= ffs_bytes_per_sector) &&
+				(file_pointer->flags.bits.inc_posn_before_next_rw ?
+					(file_pointer->current_byte == (ffs_bytes_per_sector - 1)) :
+					(file_pointer->current_byte == 0))
+				)
 		{
+			//----- READ A WHOLE SECTOR STRAIGHT FROM THE CARD -----
+			if (file_pointer->flags.bits.inc_posn_before_next_rw)
+			{
+				if (ffs_move_to_next_byte(file_pointer, 0))
+					break;
+			}
 
-			return_value = ffs_fgetc(file_pointer);
+			lba = ffs_current_lba(file_pointer);
+			if (ffs_buffer_contains_lba == lba)
+			{
+				//The buffer holds this sector, possibly with changes not yet written to the card
+				memcpy(destination, &FFS_DRIVER_GEN_512_BYTE_BUFFER[0], ffs_bytes_per_sector);
+			}
+			else if (ffs_read_sector_to_ram(lba, destination) == 0)
+			{
+				file_pointer->flags.bits.access_error = 1;
+				break;
+			}
 
+			length = ffs_bytes_per_sector;
+			file_pointer->current_byte = ffs_bytes_per_sector - 1;
+			file_pointer->current_byte_within_file += ffs_bytes_per_sector - 1;
+			file_pointer->flags.bits.inc_posn_before_next_rw = 1;
+		}
+		else
+		{
+			//----- UNALIGNED HEAD OR TAIL - ONE BYTE AT A TIME -----
+			return_value = ffs_fgetc(file_pointer);
 			if (return_value == FFS_EOF)
-				return(number_of_items_written);
-			
-			*string_Pointer++ = (BYTE)return_value;
+				break;
+			*destination = (BYTE)return_value;
+			length = 1;
 		}
-		number_of_items_written++;
-		count--;
+
+		destination += length;
+		remaining -= length;
 	}
 
-	return(number_of_items_written);
+	return((int)((total - remaining) / (DWORD)size));
 }
 
 
@@ -1527,6 +1725,10 @@ int ffs_remove (const char *filename)
 	if (last_found_free_cluster > lowest_cluster_number_released)
 		last_found_free_cluster = lowest_cluster_number_released;
 
+	#ifdef FFS_FREE_CLUSTER_CACHE
+		ffs_free_cache_clusters_released();
+	#endif
+
 	//----- ENSURE CARD HAS COMPLETED LAST WRITE PROCESS -----
 	//If the last write to the card before it is removed or powered down just occured some cards have been found to not store
 	//the last sector written.  If the card is flagging that its busy then provide clock pulses to allow it to complete its last operation
@@ -1881,6 +2083,10 @@ int ffs_change_file_size (const char *filename, DWORD new_file_size)
 	if (last_found_free_cluster > lowest_cluster_number_released)
 		last_found_free_cluster = lowest_cluster_number_released;
 
+	#ifdef FFS_FREE_CLUSTER_CACHE
+		ffs_free_cache_clusters_released();
+	#endif
+
 	//----- ENSURE CARD HAS COMPLETED LAST WRITE PROCESS -----
 	//If the last write to the card before it is removed or powered down just occured some cards have been found to not store
 	//the last sector written.  If the card is flagging that its busy then provide clock pulses to allow it to complete its last operation
@@ -2888,6 +3094,13 @@ DWORD ffs_get_next_free_cluster (void)
 	BYTE *buffer_pointer;
 
 
+	#ifdef FFS_FREE_CLUSTER_CACHE
+		//----- USE THE FREE CLUSTER CACHE IF IT HAS ONE -----
+		next_free_cluster = ffs_free_cache_take();
+		if (next_free_cluster != 0xffffffff)
+			return(next_free_cluster);
+	#endif
+
 	//----- START READING THE FAT TABLE FROM THE LAST ENTRY WHERE WE FOUND A FREE CLUSTER -----
 	lba = fat1_start_sector;
 
@@ -3044,6 +3257,14 @@ void ffs_modify_cluster_entry_in_fat (DWORD cluster_to_modify, DWORD cluster_ent
 	BYTE done_read_of_fat_sector = 0;
 
 
+	#ifdef FFS_FREE_CLUSTER_CACHE
+		//----- KEEP THE FREE CLUSTER CACHE UP TO DATE -----
+		if (cluster_entry_new_value)
+			ffs_free_cache_cluster_used(cluster_to_modify);
+		else
+			ffs_free_cache_clusters_released();
+	#endif
+
 	//----- MOVE TO THE SECTOR FOR THIS CLUSTER ENTRY IN THE FAT1 TABLE -----
 	lba = fat1_start_sector;
 
@@ -3092,6 +3313,304 @@ void ffs_modify_cluster_entry_in_fat (DWORD cluster_to_modify, DWORD cluster_ent
 
 
 
+#ifdef FFS_FREE_CLUSTER_CACHE
+//**************************************************
+//**************************************************
+//********** RESET THE FREE CLUSTER CACHE **********
+//**************************************************
+//**************************************************
+//Called when a card is mounted.  Empties the cache and has ffs_free_cache_process() scan the FAT again.
+void ffs_free_cache_reset (void)
+{
+	ffs_free_extent_count = 0;
+	ffs_free_scan_cluster = 0;
+	ffs_free_scan_run_length = 0;
+	ffs_free_last_taken = 0;
+	ffs_free_rescan_needed = 1;
+}
+
+
+
+
+
+
+//****************************************************
+//****************************************************
+//********** SCAN THE FAT FOR FREE CLUSTERS **********
+//****************************************************
+//****************************************************
+//Call from the main loop (ffs_process() does this).  Each call reads at most 1 sector of the FAT and adds the runs of free clusters it finds
+//to the cache, keeping the longest FFS_FREE_CLUSTER_CACHE of them.  Does nothing once the scan is complete until clusters are released again.
+void ffs_free_cache_process (void)
+{
+	DWORD lba;
+	DWORD fat_entries_per_sector;
+	DWORD dw_data;
+	DWORD dw_count;
+	BYTE *buffer_pointer;
+
+
+	if (ffs_card_ok == 0)
+		return;
+
+	if (ffs_free_scan_cluster == 0)
+	{
+		//----- NO SCAN RUNNING - START ONE IF CLUSTERS HAVE BEEN RELEASED OR THE CACHE HAS RUN DRY -----
+		if (ffs_free_rescan_needed == 0)
+			return;
+		ffs_free_rescan_needed = 0;
+		ffs_free_scan_cluster = 2;							//Clusters 0 and 1 are reserved
+		ffs_free_scan_run_length = 0;
+	}
+
+	if (disk_is_fat_32)
+		fat_entries_per_sector = (DWORD)(ffs_bytes_per_sector >> 2);		//FAT32 - Divide no of bytes per sector by 4 as each fat entry is 1 double word
+	else
+		fat_entries_per_sector = (DWORD)(ffs_bytes_per_sector >> 1);		//FAT16 - Divide no of bytes per sector by 2 as each fat entry is 1 word
+
+	//----- CHECK FOR END OF THE FAT -----
+	//We stop at (sectors_per_fat - 1) as ffs_get_next_free_cluster() does
+	dw_count = (ffs_free_scan_cluster / fat_entries_per_sector);
+	if (dw_count >= (sectors_per_fat - 1))
+	{
+		if (ffs_free_scan_run_length)
+			ffs_free_cache_insert(ffs_free_scan_run_start, ffs_free_scan_run_length);
+		ffs_free_scan_run_length = 0;
+		ffs_free_scan_cluster = 0;
+		return;
+	}
+
+	//----- READ THE NEXT SECTOR OF THE FAT -----
+	lba = fat1_start_sector + dw_count;
+	ffs_read_sector_to_buffer(lba);
+
+	dw_count = ffs_free_scan_cluster - (dw_count * fat_entries_per_sector);
+	if (disk_is_fat_32)
+		buffer_pointer = &FFS_DRIVER_GEN_512_BYTE_BUFFER[0] + (dw_count << 2);
+	else
+		buffer_pointer = &FFS_DRIVER_GEN_512_BYTE_BUFFER[0] + (dw_count << 1);
+
+	for ( ; dw_count < fat_entries_per_sector; dw_count++)
+	{
+		dw_data = (DWORD)*buffer_pointer++;
+		dw_data |= (DWORD)(*buffer_pointer++) << 8;
+		if (disk_is_fat_32)
+		{
+			dw_data |= (DWORD)(*buffer_pointer++) << 16;
+			dw_data |= (DWORD)(*buffer_pointer++) << 24;
+			dw_data &= 0x0fffffff;							//The top 4 bits are reserved
+		}
+
+		if (dw_data == 0)
+		{
+			//Free cluster - start or extend the current run
+			if (ffs_free_scan_run_length == 0)
+				ffs_free_scan_run_start = ffs_free_scan_cluster;
+			ffs_free_scan_run_length++;
+		}
+		else if (ffs_free_scan_run_length)
+		{
+			//End of a run
+			ffs_free_cache_insert(ffs_free_scan_run_start, ffs_free_scan_run_length);
+			ffs_free_scan_run_length = 0;
+		}
+		ffs_free_scan_cluster++;
+	}
+}
+
+
+
+
+
+
+//*************************************************
+//*************************************************
+//********** ADD A RUN TO THE FREE CACHE **********
+//*************************************************
+//*************************************************
+//Runs already in the cache that fall within the new run are replaced by it.  If the cache is full the shortest run is dropped.
+void ffs_free_cache_insert (DWORD start, DWORD length)
+{
+	BYTE count;
+	BYTE shortest;
+
+
+	//----- REMOVE ANY RUNS THIS ONE COVERS -----
+	for (count = 0; count < ffs_free_extent_count; )
+	{
+		if ((ffs_free_extents[count].start < (start + length)) &&
+			((ffs_free_extents[count].start + ffs_free_extents[count].length) > start))
+		{
+			ffs_free_extent_count--;
+			ffs_free_extents[count] = ffs_free_extents[ffs_free_extent_count];
+		}
+		else
+		{
+			count++;
+		}
+	}
+
+	//----- ADD IT -----
+	if (ffs_free_extent_count < FFS_FREE_CLUSTER_CACHE)
+	{
+		ffs_free_extents[ffs_free_extent_count].start = start;
+		ffs_free_extents[ffs_free_extent_count].length = length;
+		ffs_free_extent_count++;
+		return;
+	}
+
+	//Cache is full - replace the shortest run if this one is longer
+	shortest = 0;
+	for (count = 1; count < ffs_free_extent_count; count++)
+	{
+		if (ffs_free_extents[count].length < ffs_free_extents[shortest].length)
+			shortest = count;
+	}
+	if (length > ffs_free_extents[shortest].length)
+	{
+		ffs_free_extents[shortest].start = start;
+		ffs_free_extents[shortest].length = length;
+	}
+}
+
+
+
+
+
+
+//***************************************************************
+//***************************************************************
+//********** TAKE THE NEXT CLUSTER FROM THE FREE CACHE **********
+//***************************************************************
+//***************************************************************
+//Returns the cluster following the last one handed out if it is free so files stay contiguous, otherwise the start of the longest run.
+//Returns 0xffffffff if the cache is empty, in which case the caller searches the FAT as usual.
+DWORD ffs_free_cache_take (void)
+{
+	BYTE count;
+	BYTE best;
+	DWORD cluster;
+
+
+	if (ffs_free_extent_count == 0)
+	{
+		//Cache has run dry - refill it in the background
+		if (ffs_free_scan_cluster == 0)
+			ffs_free_rescan_needed = 1;
+		return(0xffffffff);
+	}
+
+	best = 0;
+	for (count = 0; count < ffs_free_extent_count; count++)
+	{
+		if (ffs_free_extents[count].start == (ffs_free_last_taken + 1))
+		{
+			best = count;
+			break;
+		}
+		if (ffs_free_extents[count].length > ffs_free_extents[best].length)
+			best = count;
+	}
+
+	cluster = ffs_free_extents[best].start;
+	ffs_free_extents[best].start++;
+	ffs_free_extents[best].length--;
+	if (ffs_free_extents[best].length == 0)
+	{
+		ffs_free_extent_count--;
+		ffs_free_extents[best] = ffs_free_extents[ffs_free_extent_count];
+	}
+
+	ffs_free_last_taken = cluster;
+	return(cluster);
+}
+
+
+
+
+
+
+//**********************************************************
+//**********************************************************
+//********** REMOVE A USED CLUSTER FROM THE CACHE **********
+//**********************************************************
+//**********************************************************
+//Called by ffs_modify_cluster_entry_in_fat() whenever a cluster is marked as in use, however it was found
+void ffs_free_cache_cluster_used (DWORD cluster)
+{
+	BYTE count;
+	DWORD end;
+
+
+	for (count = 0; count < ffs_free_extent_count; count++)
+	{
+		end = ffs_free_extents[count].start + ffs_free_extents[count].length;
+		if ((cluster < ffs_free_extents[count].start) || (cluster >= end))
+			continue;
+
+		if (cluster == ffs_free_extents[count].start)
+		{
+			//Front of the run
+			ffs_free_extents[count].start++;
+			ffs_free_extents[count].length--;
+		}
+		else if (cluster == (end - 1))
+		{
+			//End of the run
+			ffs_free_extents[count].length--;
+		}
+		else
+		{
+			//Middle of the run - split it, keeping the longer half if there's no room for both
+			ffs_free_extents[count].length = cluster - ffs_free_extents[count].start;
+			if (ffs_free_extent_count < FFS_FREE_CLUSTER_CACHE)
+			{
+				ffs_free_extents[ffs_free_extent_count].start = cluster + 1;
+				ffs_free_extents[ffs_free_extent_count].length = end - (cluster + 1);
+				ffs_free_extent_count++;
+			}
+			else if ((end - (cluster + 1)) > ffs_free_extents[count].length)
+			{
+				ffs_free_extents[count].start = cluster + 1;
+				ffs_free_extents[count].length = end - (cluster + 1);
+			}
+		}
+
+		if (ffs_free_extents[count].length == 0)
+		{
+			ffs_free_extent_count--;
+			ffs_free_extents[count] = ffs_free_extents[ffs_free_extent_count];
+		}
+		break;
+	}
+
+	//----- THE RUN THE SCAN IS PART WAY THROUGH -----
+	if ((ffs_free_scan_run_length) && (cluster >= ffs_free_scan_run_start) && (cluster < (ffs_free_scan_run_start + ffs_free_scan_run_length)))
+	{
+		ffs_free_scan_run_length = (ffs_free_scan_run_start + ffs_free_scan_run_length) - (cluster + 1);
+		ffs_free_scan_run_start = cluster + 1;
+	}
+}
+
+
+
+
+
+
+//*************************************************
+//*************************************************
+//********** CLUSTERS HAVE BEEN RELEASED **********
+//*************************************************
+//*************************************************
+//Called when clusters are freed.  Rather than try to merge them into the cache, scan the FAT again once the current scan (if any) is done.
+void ffs_free_cache_clusters_released (void)
+{
+	ffs_free_rescan_needed = 1;
+}
+#endif
+
+
+
 
 
 
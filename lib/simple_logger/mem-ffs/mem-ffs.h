@@ -75,6 +75,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //----- USER DEFINES -----									//<<<<< CHECK FOR A NEW APPLICATION <<<<<
 //------------------------
 #define	FFS_FOPEN_MAX				2		//Maximum number of files that may be opened simultaneously (1 - 254).  22 bytes or memory requried per file.
+//#define	FFS_FREE_CLUSTER_CACHE		8		//Remember up to this many runs of free clusters (8 bytes of ram each) so new clusters can be handed out without
+											//searching the FAT.  ffs_process() builds the list a FAT sector at a time after a card is inserted.  Comment out to
+											//search the FAT for every new cluster.
 
 
 //---------------------------
@@ -163,6 +166,17 @@ typedef struct _FFS_FILE
 
 
 
+#ifdef FFS_FREE_CLUSTER_CACHE
+//A run of free clusters
+typedef struct _FFS_FREE_EXTENT
+{
+	DWORD start;										//First free cluster
+	DWORD length;										//Number of free clusters from start
+} FFS_FREE_EXTENT;
+#endif
+
+
+
 //FSEEK origin defines:-
 #define	FFS_SEEK_SET		0			//Beginning of file
 #define	FFS_SEEK_CUR		1			//Current position of the file pointer
@@ -196,6 +210,14 @@ BYTE ffs_create_new_file (const char *file_name, DWORD *write_file_start_cluster
 DWORD ffs_get_next_free_cluster (void);
 DWORD ffs_get_next_cluster_no (DWORD current_cluster);
 void ffs_modify_cluster_entry_in_fat (DWORD cluster_to_modify, DWORD cluster_entry_new_value);
+BYTE ffs_prepare_to_write (FFS_FILE *file_pointer);
+BYTE ffs_move_to_next_byte (FFS_FILE *file_pointer, BYTE extend_file);
+DWORD ffs_current_lba (FFS_FILE *file_pointer);
+void ffs_start_new_sector_in_buffer (DWORD sector_lba);
+DWORD ffs_free_cache_take (void);
+void ffs_free_cache_insert (DWORD start, DWORD length);
+void ffs_free_cache_cluster_used (DWORD cluster);
+void ffs_free_cache_clusters_released (void);
 
 
 //-----------------------------------------
@@ -224,6 +246,8 @@ void ffs_clearerr (FFS_FILE *file_pointer);
 int ffs_feof (FFS_FILE *file_pointer);
 int ffs_ferror (FFS_FILE *file_pointer);
 BYTE ffs_is_card_available (void);
+void ffs_free_cache_reset (void);
+void ffs_free_cache_process (void);
 
 
 
@@ -258,6 +282,8 @@ extern void ffs_clearerr (FFS_FILE *file_pointer);
 extern int ffs_feof (FFS_FILE *file_pointer);
 extern int ffs_ferror (FFS_FILE *file_pointer);
 extern BYTE ffs_is_card_available (void);
+extern void ffs_free_cache_reset (void);
+extern void ffs_free_cache_process (void);
 
 
 
@@ -278,6 +304,15 @@ extern BYTE ffs_is_card_available (void);
 //--------------------------------------------
 //----- INTERNAL ONLY MEMORY DEFINITIONS -----
 //--------------------------------------------
+#ifdef FFS_FREE_CLUSTER_CACHE
+FFS_FREE_EXTENT ffs_free_extents[FFS_FREE_CLUSTER_CACHE];
+BYTE ffs_free_extent_count = 0;
+DWORD ffs_free_scan_cluster = 0;					//Next FAT entry the background scan will look at, 0 if no scan is running
+DWORD ffs_free_scan_run_start;						//Run of free clusters the scan is in the middle of
+DWORD ffs_free_scan_run_length = 0;
+DWORD ffs_free_last_taken = 0;						//Last cluster handed out, to keep handing out the one after it
+BYTE ffs_free_rescan_needed = 0;
+#endif
 
 
 
@@ -120,7 +120,12 @@ void ffs_process (void)
 
 		//If card is still inserted then exit
 		if (ffs_is_card_present() && ffs_card_ok)
+		{
+			#ifdef FFS_FREE_CLUSTER_CACHE
+				ffs_free_cache_process();		//Carry on finding free clusters in the background
+			#endif
 			return;
+		}
 
 		//CARD HAS BEEN REMOVED
 		ffs_card_ok = 0;
@@ -787,6 +792,9 @@ init_new_ffs_card_init_mmc_done:
 
 	//Do Driver specific initialisations
 	last_found_free_cluster = 0;		//When we next look for a free cluster, start from the beginning
+	#ifdef FFS_FREE_CLUSTER_CACHE
+		ffs_free_cache_reset();			//Build the free cluster cache again for this card
+	#endif
 
 
 	return;
@@ -850,10 +858,6 @@ BYTE ffs_is_card_present (void)
 //	FFS_CE(1);					//Deselect the card
 void ffs_read_sector_to_buffer (DWORD sector_lba)
 {
-	WORD count;
-	BYTE *buffer_pointer;
-	BYTE read_successful = 0;
-
 	//----- IF LBA MATCHES THE LAST LBA DON'T BOTHER RE-READING AS THE DATA IS STILL IN THE BUFFER -----
 	if (ffs_buffer_contains_lba == sector_lba)
 	{
@@ -872,7 +876,9 @@ void ffs_read_sector_to_buffer (DWORD sector_lba)
 
 	if(!ffs_10ms_timer) {
 		ffs_card_ok = 0;
-		goto ffs_read_sector_to_buffer_exit;
+		FFS_CE(1);									//De - select the card
+		ffs_write_byte(0xff);
+		return;
 	}
 
 	//----- IF THE BUFFER CONTAINS DATA THAT IS WAITING TO BE WRITTEN THEN WRITE IT FIRST -----
@@ -886,6 +892,28 @@ void ffs_read_sector_to_buffer (DWORD sector_lba)
 		ffs_buffer_needs_writing_to_card = 0;
 	}
 
+	if (ffs_read_sector_to_ram(sector_lba, &FFS_DRIVER_GEN_512_BYTE_BUFFER[0]))
+		ffs_buffer_contains_lba = sector_lba;				//Flag that the data buffer currently contains data for this LBA (logged to avoid re-loading the buffer again if its not necessary)
+}
+
+
+
+
+//****************************************
+//****************************************
+//********** READ SECTOR TO RAM **********
+//****************************************
+//****************************************
+//Reads a whole sector straight into the callers memory, bypassing the driver buffer.  Used by ffs_fread for complete
+//sectors.  The driver buffer is left alone, so the caller must check ffs_buffer_contains_lba first as the buffer may
+//hold newer data for this sector that has not been written yet.
+//Returns
+//	1 if successful, 0 otherwise
+BYTE ffs_read_sector_to_ram (DWORD sector_lba, BYTE *destination)
+{
+	WORD count;
+	BYTE read_successful = 0;
+
 	ffs_10ms_timer = 20;									//Set operation timeout just in case
 	while ((read_successful == 0) && (ffs_10ms_timer))		//Retry until the read is successful
 	{
@@ -900,7 +928,7 @@ void ffs_read_sector_to_buffer (DWORD sector_lba)
 
 		if(!ffs_10ms_timer) {
 			ffs_card_ok = 0;
-			goto ffs_read_sector_to_buffer_exit;
+			goto ffs_read_sector_to_ram_exit;
 		}
 
 
@@ -927,7 +955,7 @@ void ffs_read_sector_to_buffer (DWORD sector_lba)
 
 		//Get command response
 		if (ffs_check_command_response_byte(0xff, 0x00) == 0)		//R1 response: | 0 | ParameterError | AddressError | Erase Sequence Error | Com CRC Error | Illegal Command | Erase Reset | In Idle State |
-			goto ffs_read_sector_to_buffer_exit;			//Error - shouldn't happen
+			goto ffs_read_sector_to_ram_exit;			//Error - shouldn't happen
 
 		//Wait for data token
 		for (count = 1000; count > 0; count--)			//Repeate many times as read data is allowed to take a lot of cycles to be ready (the exact number is dependant on clock speed so we just use a generic over the top timeout)
@@ -936,7 +964,7 @@ void ffs_read_sector_to_buffer (DWORD sector_lba)
 				break;
 				
 			if (count == 1)
-				goto ffs_read_sector_to_buffer_exit;		//Error - shouldn't happen
+				goto ffs_read_sector_to_ram_exit;		//Error - shouldn't happen
 		}
 
 		read_successful = 1;
@@ -944,15 +972,7 @@ void ffs_read_sector_to_buffer (DWORD sector_lba)
 
 		//We have to read the entire data block for an SD or MMC card and these cards also have a timeout for commands
 		//so we get the entire block now to avoid possible timeout problems.
-
-		buffer_pointer = &FFS_DRIVER_GEN_512_BYTE_BUFFER[0];
-		
-		for (count = 0; count < ffs_bytes_per_sector; count++)
-		{
-			*buffer_pointer++ = ffs_read_byte();
-		}
-
-		ffs_buffer_contains_lba = sector_lba;				//Flag that the data buffer currently contains data for this LBA (logged to avoid re-loading the buffer again if its not necessary)
+		ffs_read_block(destination, ffs_bytes_per_sector);
 
 		//Get the CRC
 		ffs_read_byte();
@@ -960,7 +980,7 @@ void ffs_read_sector_to_buffer (DWORD sector_lba)
 
 
 
-ffs_read_sector_to_buffer_exit:
+ffs_read_sector_to_ram_exit:
 		FFS_CE(1);											//De - select the card
 
 		//Give 8 clocks for the card to complete the operation
@@ -968,6 +988,7 @@ ffs_read_sector_to_buffer_exit:
 
 	}  //while ((read_successful == 0) && (ffs_10ms_timer))		//Retry until the read is successful
 
+	return(read_successful);
 }
 
 
@@ -982,15 +1003,28 @@ ffs_read_sector_to_buffer_exit:
 //**********************************************
 void ffs_write_sector_from_buffer (DWORD sector_lba)
 {
-	WORD count;
-	BYTE *buffer_pointer;
-	BYTE write_successful = 0;
-	
-	
-
 	ffs_buffer_needs_writing_to_card = 0;			//Flag that buffer is no longer waiting to write to card (must be at top as this function
 													//calls other functions that check this flag and would call the function back)
 
+	ffs_write_sector_from_ram(sector_lba, &FFS_DRIVER_GEN_512_BYTE_BUFFER[0]);
+}
+
+
+
+
+//*******************************************
+//*******************************************
+//********** WRITE SECTOR FROM RAM **********
+//*******************************************
+//*******************************************
+//Writes a whole sector straight from the callers memory, bypassing the driver buffer.  Used by ffs_fwrite for complete
+//sectors.  If the driver buffer holds the same sector the caller must update the buffer instead, or it will be
+//written back over this data later.
+void ffs_write_sector_from_ram (DWORD sector_lba, BYTE *source)
+{
+	WORD count;
+	BYTE write_successful = 0;
+
 	ffs_10ms_timer = 20;									//Set operation timeout just in case
 	while ((write_successful == 0) && (ffs_10ms_timer))		//Retry until the write is successful
 	{
@@ -1006,7 +1040,7 @@ void ffs_write_sector_from_buffer (DWORD sector_lba)
 
 		if(!ffs_10ms_timer) {
 			ffs_card_ok = 0;
-			goto ffs_write_sector_from_buffer_exit;
+			goto ffs_write_sector_from_ram_exit;
 		}
 
 
@@ -1034,18 +1068,14 @@ void ffs_write_sector_from_buffer (DWORD sector_lba)
 
 			//Get command response
 			if (ffs_check_command_response_byte(0xff, 0x00) == 0)		//R1 response: | 0 | ParameterError | AddressError | Erase Sequence Error | Com CRC Error | Illegal Command | Erase Reset | In Idle State |
-				goto ffs_write_sector_from_buffer_exit;
+				goto ffs_write_sector_from_ram_exit;
 
 			//Send the data token
 			ffs_write_byte(0xfe);
 
 
-			//----- WRITE THE BUFFER TO THE CARD SECTOR -----
-			buffer_pointer = &FFS_DRIVER_GEN_512_BYTE_BUFFER[0];
-			for (count = 0; count < ffs_bytes_per_sector; count++)
-			{
-				ffs_write_byte(*buffer_pointer++);
-			}
+			//----- WRITE THE SECTOR TO THE CARD -----
+			ffs_write_block(source, ffs_bytes_per_sector);
 		
 			//Send dummy CRC
 			ffs_write_byte(0xff);
@@ -1053,13 +1083,13 @@ void ffs_write_sector_from_buffer (DWORD sector_lba)
 		
 			//Get command response
 			if (ffs_check_command_response_byte(0x0f, 0x05) == 0)		//Data response token. xxx0SSS1.  SSS=010=data accepted, 101=data rejected due to a CRC error, 110=data rejected due to a write error
-				goto ffs_write_sector_from_buffer_exit;
+				goto ffs_write_sector_from_ram_exit;
 			else
 				write_successful = 1;
 		}
 
 
-ffs_write_sector_from_buffer_exit:
+ffs_write_sector_from_ram_exit:
 		FFS_CE(1);										//Deselect the card
 
 		if (write_successful == 0)
@@ -1168,6 +1198,62 @@ BYTE ffs_read_byte (void)
 }
 
 
+//*************************************
+//*************************************
+//********** BLOCK TRANSFERS **********
+//*************************************
+//*************************************
+//Sector data moves through these rather than ffs_read_byte / ffs_write_byte so the SPI bus is only set up once per
+//block instead of once per byte.
+void ffs_read_block (BYTE *destination, WORD length)
+{
+	if(speed == 1) {
+		SPI_BUS_SET_TO_FULL_SPEED_SD;
+	} else {
+		SPI_BUS_SET_TO_LOW_SPEED;
+	}
+
+	while (length--)
+	{
+		//Send dummy byte
+		FFS_SPI_TX_BYTE(0xff);
+	
+		//Wait for tx to complete
+		while (!FFS_SPI_BUF_FULL);
+
+		*destination++ = FFS_SPI_RX_BYTE_BUFFER;
+
+		FFS_SPI_CLEAR_FLAG;
+	}
+}
+
+void ffs_write_block (BYTE *source, WORD length)
+{
+	BYTE data_rx;
+
+	if(speed == 1) {
+		SPI_BUS_SET_TO_FULL_SPEED_SD;
+	} else {
+		SPI_BUS_SET_TO_LOW_SPEED;
+	}
+
+	while (length--)
+	{
+		//Send byte
+		FFS_SPI_TX_BYTE(*source++);
+
+		//Wait for tx to complete
+		while (!FFS_SPI_BUF_FULL);
+
+		//Read the received byte (some SPI peripherals require this)
+		data_rx = FFS_SPI_RX_BYTE_BUFFER;
+
+		FFS_SPI_CLEAR_FLAG;
+	}
+	(void)data_rx;
+}
+
+
 //******************************************************
 //******************************************************
 //********** CHECK COMMAND RESPONSE FROM CARD **********
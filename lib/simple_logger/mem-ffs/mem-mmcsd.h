@@ -137,6 +137,8 @@ typedef enum _FFS_PROCESS_STATE
 //----- INTERNAL ONLY FUNCTIONS -----
 //-----------------------------------
 BYTE ffs_check_command_response_byte (BYTE mask, BYTE data_requried);
+void ffs_read_block (BYTE *destination, WORD length);
+void ffs_write_block (BYTE *source, WORD length);
 
 
 //-----------------------------------------
@@ -148,6 +150,8 @@ void ffs_init (void);
 BYTE ffs_is_card_present (void);
 void ffs_read_sector_to_buffer (DWORD sector_lba);
 void ffs_write_sector_from_buffer (DWORD sector_lba);
+BYTE ffs_read_sector_to_ram (DWORD sector_lba, BYTE *destination);
+void ffs_write_sector_from_ram (DWORD sector_lba, BYTE *source);
 BYTE ffs_write_byte (BYTE data);
 WORD ffs_read_word (void);
 BYTE ffs_read_byte (void);
@@ -164,6 +168,8 @@ extern void ffs_init (void);
 extern BYTE ffs_is_card_present (void);
 extern void ffs_read_sector_to_buffer (DWORD sector_lba);
 extern void ffs_write_sector_from_buffer (DWORD sector_lba);
+extern BYTE ffs_read_sector_to_ram (DWORD sector_lba, BYTE *destination);
+extern void ffs_write_sector_from_ram (DWORD sector_lba, BYTE *source);
 extern BYTE ffs_write_byte (BYTE data);
 extern WORD ffs_read_word (void);
 extern BYTE ffs_read_byte (void);
@@ -1,17 +1,18 @@
-
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
 #include "simple_logger.h"
+#include "simple_logger_backend.h"
 #include "simple_timer.h"
-#include "chanfs/ff.h"
-#include "chanfs/diskio.h"
 #include "stdarg.h"
+#ifdef SIMPLE_LOGGER_DELTA
+#include "simple_logger_compress.h"
+#endif
 
 static uint8_t simple_logger_inited = 0;
 static uint8_t simple_logger_file_exists = 0;
-static uint8_t busy = 0;
 static uint8_t header_written = 0;
-static uint8_t error_count = 0;
 
 const char *file = NULL;
 
@@ -26,113 +27,353 @@ const char *file = NULL;
 #endif
 
 
-static FIL 	simple_logger_fpointer;
-static FATFS 	simple_logger_fs;
-static uint8_t simple_logger_opts;
+static const simple_logger_backend_t* backend = NULL;
+static void* backend_ctx = NULL;
+static bool log_open = false;
+static bool truncate_on_open = false;
 
-extern void disk_timerproc(void);
-extern void disk_restart(void);
+#ifdef SIMPLE_LOGGER_DELTA
+	// Numeric records, each stored as its difference from the one before.
+	// Starts over with a key record whenever the log is (re)opened.
+	static simple_logger_delta_t delta;
+#endif
 
-static void error(void) {
-	error_count++;
+#ifdef SIMPLE_LOGGER_ROTATE
+	// Rotation. The log is split into segments named STEM.000, STEM.001, ...
+	// where STEM is the part of the filename before the dot. STEM.IDX holds
+	// the numbers of the oldest and newest segments, so init finds the
+	// newest one without scanning the directory. Logging never rotates by
+	// itself, simple_logger_update() notices a full segment and then moves
+	// to the next one and deletes old ones one step per call.
+	enum {
+		ROTATE_IDLE = 0,
+		ROTATE_SWITCH,
+		ROTATE_INDEX,
+		ROTATE_PRUNE
+	};
+
+	static char     stem[9];
+	static char     segment_name[13];
+	static uint16_t oldest_segment;
+	static uint16_t newest_segment;
+	static uint8_t  rotate_step = ROTATE_IDLE;
+	static volatile uint32_t ms_ticks = 0;
+	static uint32_t segment_started;
+#endif
 
-	if(error_count > 20) {
-		disk_restart();
-		error_count = 0;
+static void heartbeat (void* p_context) {
+	if(backend->tick) {
+		backend->tick(backend_ctx);
 	}
+#ifdef SIMPLE_LOGGER_ROTATE
+	ms_ticks++;
+#endif
 }
 
-static void heartbeat (void* p_context) {
-	disk_timerproc();
+//only start the 1 ms timer if something needs it
+static bool need_heartbeat() {
+#ifdef SIMPLE_LOGGER_ROTATE_SECONDS
+	return true;
+#else
+	return backend->tick != NULL;
+#endif
 }
 
+//add bytes to the end of the log and make sure they are stored
+static uint8_t write_bytes(const char* data, uint32_t len) {
+	if(backend->append(backend_ctx, data, len) != 0) {
+		return SIMPLE_LOGGER_FILE_ERROR;
+	}
+	if(backend->flush(backend_ctx) != 0) {
+		return SIMPLE_LOGGER_FILE_ERROR;
+	}
+	return SIMPLE_LOGGER_SUCCESS;
+}
+
+static uint8_t write_string(const char* str) {
+	return write_bytes(str, strlen(str));
+}
 
-//an sd card was inserted after being gone for a bit
-//let's reopen the file, and try to rewrite the header if it's necessary
+//(re)open the log, after init or after the medium went away for a bit,
+//and write the header if the log is empty
 static uint8_t logger_init() {
 
-	volatile FRESULT res;
-	res |= f_mount(&simple_logger_fs, "", 1);
+	if(log_open) {
+		backend->close(backend_ctx);
+		log_open = false;
+	}
 
-	//see if the file exists already
-	FIL temp;
-	res |= f_open(&temp,file, FA_READ | FA_OPEN_EXISTING);
-	if(res == FR_NO_FILE) {
-		//the file doesn't exist
-		simple_logger_file_exists = 0;
-	} else if(res == FR_OK) {
-		simple_logger_file_exists = 1;
-		res |= f_close(&temp);
+	if(backend->open(backend_ctx, file, truncate_on_open) != 0) {
+		return SIMPLE_LOGGER_FILE_ERROR;
 	}
+	log_open = true;
 
-	res |= f_open(&simple_logger_fpointer,file, simple_logger_opts);
+#ifdef SIMPLE_LOGGER_DELTA
+	simple_logger_delta_reset(&delta);
+#endif
 
-	if(simple_logger_opts && FA_OPEN_ALWAYS) {
-		//we are in append mode and should move to the end
-		res |= f_lseek(&simple_logger_fpointer, f_size(&simple_logger_fpointer));
-	}
+	simple_logger_file_exists = (backend->size(backend_ctx) > 0);
 
 	if(header_written && !simple_logger_file_exists) {
-		f_puts(header_buffer, &simple_logger_fpointer);
-		res |= f_sync(&simple_logger_fpointer);
+		return write_string(header_buffer);
 	}
+	return SIMPLE_LOGGER_SUCCESS;
+}
 
-	simple_logger_inited = 1;
+#ifdef SIMPLE_LOGGER_ROTATE
+static void segment_filename(char* name, uint16_t segment) {
+	sprintf(name, "%s.%03u", stem, segment);
+}
+
+static uint16_t segment_count() {
+	return (newest_segment + 1000 - oldest_segment) % 1000 + 1;
+}
+
+//returns false if there is no index yet
+static bool read_index() {
+	char name[13];
+	char line[16];
+	unsigned int oldest, newest;
+	int len;
+
+	sprintf(name, "%s.IDX", stem);
+	len = backend->read_file(backend_ctx, name, line, sizeof(line) - 1);
+	if(len <= 0) {
+		return false;
+	}
+	line[len] = '\0';
+
+	if(sscanf(line, "%u %u", &oldest, &newest) != 2 ||
+	   oldest >= 1000 || newest >= 1000) {
+		return false;
+	}
+	oldest_segment = oldest;
+	newest_segment = newest;
+	return true;
+}
+
+static int write_index() {
+	char name[13];
+	char line[16];
+
+	sprintf(name, "%s.IDX", stem);
+	sprintf(line, "%03u %03u\n", oldest_segment, newest_segment);
+	return backend->write_file(backend_ctx, name, line, strlen(line));
+}
+
+static bool segment_full() {
+	uint32_t size = backend->size(backend_ctx);
+
+	if(size == 0) {
+		return false;
+	}
+#ifdef SIMPLE_LOGGER_ROTATE_BYTES
+	if(size >= SIMPLE_LOGGER_ROTATE_BYTES) {
+		return true;
+	}
+#endif
+#ifdef SIMPLE_LOGGER_ROTATE_SECONDS
+	if(ms_ticks - segment_started >= SIMPLE_LOGGER_ROTATE_SECONDS * 1000UL) {
+		return true;
+	}
+#endif
+	return false;
+}
+
+//work out which segment to open from the index
+static uint8_t rotate_init(const char* filename) {
+	uint8_t i;
+
+	if(!backend->read_file || !backend->write_file || !backend->remove) {
+		//rotation needs named files
+		return SIMPLE_LOGGER_NOT_SUPPORTED;
+	}
+
+	for(i = 0; i < 8 && filename[i] != '\0' && filename[i] != '.'; i++) {
+		stem[i] = filename[i];
+	}
+	stem[i] = '\0';
+
+	oldest_segment = 0;
+	newest_segment = 0;
+	if(read_index() && truncate_on_open) {
+		//"w" starts a new segment rather than overwriting the newest
+		newest_segment = (newest_segment + 1) % 1000;
+	}
+
+	segment_filename(segment_name, newest_segment);
+	file = segment_name;
+	segment_started = ms_ticks;
+	rotate_step = ROTATE_INDEX;
+	return SIMPLE_LOGGER_SUCCESS;
+}
+
+//close the current segment and open the next
+static uint8_t rotate_switch() {
+	uint8_t res;
+
+	if(backend->close(backend_ctx) != 0) {
+		return SIMPLE_LOGGER_FILE_ERROR;
+	}
+	log_open = false;
+
+	newest_segment = (newest_segment + 1) % 1000;
+	segment_filename(segment_name, newest_segment);
+	segment_started = ms_ticks;
+
+	truncate_on_open = true;
+	res = logger_init();
+	truncate_on_open = false;
 	return res;
 }
+#endif
 
-uint8_t simple_logger_init(const char *filename, const char *permissions) {
+//call from the main loop, this is where log rotation happens
+void simple_logger_update() {
+#ifdef SIMPLE_LOGGER_ROTATE
+	char name[13];
 
-	if(simple_logger_inited) {
-		return SIMPLE_LOGGER_ALREADY_INITIALIZED; //can only initialize once 
+	if(!simple_logger_inited) {
+		return;
 	}
 
-	//initialize a simple timer
-	simple_timer_init();
-	simple_timer_start (1, heartbeat);
-	
-	file = filename;
+	switch(rotate_step) {
+	case ROTATE_IDLE:
+		if(segment_full()) {
+			rotate_step = ROTATE_SWITCH;
+		}
+		break;
+
+	case ROTATE_SWITCH:
+		if(rotate_switch() != SIMPLE_LOGGER_SUCCESS) {
+			break;
+		}
+		rotate_step = ROTATE_INDEX;
+		break;
+
+	case ROTATE_INDEX:
+		//the index always names the newest segment before any is deleted
+		if(write_index() == 0) {
+			rotate_step = ROTATE_PRUNE;
+		}
+		break;
+
+	case ROTATE_PRUNE:
+		//delete the oldest segment, one per call
+		if(segment_count() <= SIMPLE_LOGGER_MAX_FILES) {
+			rotate_step = ROTATE_IDLE;
+			break;
+		}
+		segment_filename(name, oldest_segment);
+		if(backend->remove(backend_ctx, name) == 0) {
+			oldest_segment = (oldest_segment + 1) % 1000;
+			write_index();
+		}
+		break;
+	}
+#endif
+}
+
+uint8_t simple_logger_init_backend(const simple_logger_backend_t* log_backend, void* ctx,
+		const char *filename, const char *permissions) {
+
+	if(simple_logger_inited) {
+		return SIMPLE_LOGGER_ALREADY_INITIALIZED; //can only initialize once
+	}
 
-	//we must have not timed out and a card is available
 	if((permissions[0] != 'w' && permissions[0] != 'a') || permissions[1] != '\0') {
 		//the person didn't use the right permissions
 		return SIMPLE_LOGGER_BAD_PERMISSIONS;
-	} else if(permissions[0] == 'w') {
-		simple_logger_opts = (FA_WRITE | FA_CREATE_ALWAYS);
-	} else {
-		simple_logger_opts = (FA_WRITE | FA_OPEN_ALWAYS);
 	}
 
+	backend = log_backend;
+	backend_ctx = ctx;
+	file = filename;
+	truncate_on_open = (permissions[0] == 'w');
+
+#ifdef SIMPLE_LOGGER_ROTATE
+	uint8_t rotate_err = rotate_init(filename);
+	if(rotate_err != SIMPLE_LOGGER_SUCCESS) {
+		return rotate_err;
+	}
+#endif
+
+	//initialize a simple timer
+	if(need_heartbeat()) {
+		simple_timer_init();
+		simple_timer_start (1, heartbeat);
+	}
+
+	//from here on logging retries even if the first open fails
+	simple_logger_inited = 1;
+
 	uint8_t err_code = logger_init();
+
+	//reopening after an error must not truncate the log
+	truncate_on_open = false;
 	return  err_code;
 }
 
 //the function meant to log data
 uint8_t simple_logger_log(const char *format, ...) {
 
+	if(!simple_logger_inited) {
+		return SIMPLE_LOGGER_BAD_FPOINTER;
+	}
+
 	va_list argptr;
 	va_start(argptr, format);
 	vsnprintf(buffer, buffer_size, format, argptr);
 	va_end(argptr);
-	
-	f_puts(buffer, &simple_logger_fpointer);
-	FRESULT res = f_sync(&simple_logger_fpointer);
 
-	if(res != FR_OK) {
+	uint8_t res = write_string(buffer);
+
+	if(res != SIMPLE_LOGGER_SUCCESS) {
+		res = logger_init();
+		if(res == SIMPLE_LOGGER_SUCCESS) {
+			res = write_string(buffer);
+		}
+	}
+
+	return res;
+}
+
+#ifdef SIMPLE_LOGGER_DELTA
+//log a record of numbers, delta + zigzag varint encoded
+uint8_t simple_logger_log_values(const int32_t* values, uint8_t count) {
+	uint8_t record[SIMPLE_LOGGER_DELTA_RECORD_MAX];
+	uint8_t len;
+
+	if(!simple_logger_inited) {
+		return SIMPLE_LOGGER_BAD_FPOINTER;
+	}
+
+	len = simple_logger_delta_encode(&delta, values, count, record);
+	if(len == 0) {
+		return SIMPLE_LOGGER_NOT_SUPPORTED;
+	}
+
+	uint8_t res = write_bytes((const char*)record, len);
+
+	if(res != SIMPLE_LOGGER_SUCCESS) {
 		res = logger_init();
-		if(res == FR_OK) {
-			f_puts(buffer, &simple_logger_fpointer);
-			res = f_sync(&simple_logger_fpointer);
-		} else {
-			error();
+		if(res == SIMPLE_LOGGER_SUCCESS) {
+			//the reopened log needs a key record
+			len = simple_logger_delta_encode(&delta, values, count, record);
+			res = write_bytes((const char*)record, len);
 		}
 	}
 
 	return res;
 }
+#endif
 
 uint8_t simple_logger_log_header(const char *format, ...) {
 
+	if(!simple_logger_inited) {
+		return SIMPLE_LOGGER_BAD_FPOINTER;
+	}
+
 	header_written = 1;
 
 	va_list argptr;
@@ -141,17 +382,14 @@ uint8_t simple_logger_log_header(const char *format, ...) {
 	va_end(argptr);
 
 	if(!simple_logger_file_exists) {
-		f_puts(header_buffer, &simple_logger_fpointer);
-		FRESULT res = f_sync(&simple_logger_fpointer);
+		uint8_t res = write_string(header_buffer);
 
-		if(res != FR_OK) {
-			res = logger_init();
-			if(res != FR_OK) {
-				error();
-			}
-			return res;	
-		} 
+		if(res != SIMPLE_LOGGER_SUCCESS) {
+			//logger_init writes the header once the log is back
+			return logger_init();
+		}
 
+		simple_logger_file_exists = 1;
 		return res;
 	} else {
 		return SIMPLE_LOGGER_FILE_EXISTS;
@@ -3,13 +3,18 @@
 
 //////////////USAGE GUIDE////////////
 //	//REQUIRES: simple_ble, simple_timer
-//	//USES: one simple timer
+//	//USES: one simple timer (not with the FRAM or stdio backend,
+//	//unless SIMPLE_LOGGER_ROTATE_SECONDS is set)
 //
 //	//In initialization
 //	//permissions
 //	//"w" - write
 //	//"a" - append (just like c files)
+//	//logs to an SD card, needs simple_logger_chanfs.c
 //	simple_logger_init(filename, permissions);
+//
+//	//or to some other medium, see simple_logger_backend.h
+//	simple_logger_init_backend(&simple_logger_stdio_backend, NULL, filename, permissions);
 //	
 //	//In main loop
 //	simple_logger_update()
@@ -24,8 +29,49 @@
 //	//of max length 256 chars
 //	//To have longer strings
 //	#define SIMPLE_LOGGER_BUFFER_SIZE N
+//
+//	//To reserve N contiguous bytes on the card for a new file and write
+//	//log lines straight to its sectors (the file size on the card is
+//	//updated every SIMPLE_LOGGER_CHECKPOINT bytes, default 4096)
+//	#define SIMPLE_LOGGER_PREALLOCATE N
+//
+//	//To split the log into files NAME.000, NAME.001, ... starting a new
+//	//one after N bytes and/or N seconds, and keeping at most
+//	//SIMPLE_LOGGER_MAX_FILES of them (default 10, oldest deleted first).
+//	//NAME.IDX records the oldest and newest file. Rotation happens in
+//	//simple_logger_update(), so that has to be called from the main loop.
+//	//The backend has to support named files (not FRAM).
+//	#define SIMPLE_LOGGER_ROTATE_BYTES N
+//	#define SIMPLE_LOGGER_ROTATE_SECONDS N
+//
+//	//To log numbers as binary records, each value stored as a zigzag
+//	//varint of its change since the last record (needs
+//	//simple_logger_compress.c, decode with tools/slog_decompress -r)
+//	#define SIMPLE_LOGGER_DELTA
+//	simple_logger_log_values(values, count);
+//
+//	//To compress text on the way to the medium, wrap the backend in
+//	//simple_logger_lz_backend, see simple_logger_compress.h
 ////////////////////////////////////
 
+#include "simple_logger_backend.h"
+
+#if defined(SIMPLE_LOGGER_ROTATE_BYTES) || defined(SIMPLE_LOGGER_ROTATE_SECONDS)
+#define SIMPLE_LOGGER_ROTATE
+#ifndef SIMPLE_LOGGER_MAX_FILES
+#define SIMPLE_LOGGER_MAX_FILES 10
+#endif
+#if SIMPLE_LOGGER_MAX_FILES < 1 || SIMPLE_LOGGER_MAX_FILES > 998
+#error SIMPLE_LOGGER_MAX_FILES must be between 1 and 998
+#endif
+#endif
+
+#ifdef SIMPLE_LOGGER_PREALLOCATE
+#ifndef SIMPLE_LOGGER_CHECKPOINT
+#define SIMPLE_LOGGER_CHECKPOINT 4096
+#endif
+#endif
+
 enum {
 	SIMPLE_LOGGER_SUCCESS = 0,
 	SIMPLE_LOGGER_BUSY,
@@ -36,15 +82,21 @@ enum {
 	SIMPLE_LOGGER_FILE_EXISTS,
 	SIMPLE_LOGGER_FILE_ERROR,
 	SIMPLE_LOGGER_ALREADY_INITIALIZED,
-	SIMPLE_LOGGER_BAD_PERMISSIONS
+	SIMPLE_LOGGER_BAD_PERMISSIONS,
+	SIMPLE_LOGGER_NOT_SUPPORTED
 } SIMPLE_LOGGER_ERROR; 
 
 uint8_t simple_logger_init(const char *filename, const char *permissions);
+uint8_t simple_logger_init_backend(const simple_logger_backend_t* backend, void* ctx,
+		const char *filename, const char *permissions);
 uint8_t simple_logger_ready(void);
 void simple_logger_update();
 uint8_t simple_logger_log(const char *format, ...)
 		__attribute__ ((format (printf, 1, 2)));
 uint8_t simple_logger_log_header(const char *format, ...)
 		__attribute__ ((format (printf, 1, 2)));
+#ifdef SIMPLE_LOGGER_DELTA
+uint8_t simple_logger_log_values(const int32_t* values, uint8_t count);
+#endif
 
 #endif
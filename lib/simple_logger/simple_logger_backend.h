@@ -0,0 +1,55 @@
+#ifndef SIMPLE_LOGGER_BACKEND_H
+#define SIMPLE_LOGGER_BACKEND_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Where simple_logger keeps the log. simple_logger formats the lines and
+// handles the header, retries and rotation, a backend only stores bytes.
+// `ctx` is whatever was passed to simple_logger_init_backend(), it comes
+// back unchanged in every call.
+//
+// Everything returns 0 on success and -1 on failure, except size().
+typedef struct {
+	// Open the named log, creating it if it isn't there. If truncate is
+	// set whatever was in it goes, otherwise appends go to the end of it.
+	int      (*open)(void* ctx, const char* name, bool truncate);
+
+	// Add bytes to the end of the open log. They may sit in RAM until the
+	// next flush().
+	int      (*append)(void* ctx, const char* data, uint32_t len);
+
+	// Make everything appended so far survive a reset. Called after every
+	// line.
+	int      (*flush)(void* ctx);
+
+	// Bytes in the open log, counting what hasn't been flushed yet
+	uint32_t (*size)(void* ctx);
+
+	int      (*close)(void* ctx);
+
+	// The rest are optional, NULL if the backend doesn't have them
+
+	// Called every millisecond from the logger's timer
+	void     (*tick)(void* ctx);
+
+	// Small side files, for the rotation index. They are used while the log
+	// is open. read_file() returns the number of bytes read or -1.
+	int      (*read_file)(void* ctx, const char* name, char* buf, uint32_t len);
+	int      (*write_file)(void* ctx, const char* name, const char* data, uint32_t len);
+	int      (*remove)(void* ctx, const char* name);
+} simple_logger_backend_t;
+
+// FAT file on an SD card through chanfs and mmc_nrf.c (simple_logger_chanfs.c).
+// What simple_logger_init() uses. ctx is NULL.
+extern const simple_logger_backend_t simple_logger_chanfs_backend;
+
+// Plain C stdio (simple_logger_stdio.c). A real file on Linux, and a RAM
+// file when linked with mbramfs.c. ctx is NULL.
+extern const simple_logger_backend_t simple_logger_stdio_backend;
+
+// Region of an FM25L04B FRAM (simple_logger_fram.c, ctx in
+// simple_logger_fram.h)
+extern const simple_logger_backend_t simple_logger_fram_backend;
+
+#endif
@@ -0,0 +1,317 @@
+// simple_logger backend for a FAT file on an SD card, through chanfs and
+// mmc_nrf.c
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "simple_logger.h"
+#include "simple_logger_backend.h"
+#include "chanfs/ff.h"
+#include "chanfs/diskio.h"
+
+static FIL 	simple_logger_fpointer;
+static FATFS 	simple_logger_fs;
+static bool mounted = false;
+static bool file_open = false;
+static uint8_t error_count = 0;
+
+#ifdef SIMPLE_LOGGER_PREALLOCATE
+	// Streaming mode. A new log file gets one contiguous run of
+	// SIMPLE_LOGGER_PREALLOCATE bytes up front, and log lines go straight to
+	// the sectors of that run, so no FAT lookups or updates happen while
+	// logging. The file size in the directory entry is only brought up to
+	// date every SIMPLE_LOGGER_CHECKPOINT bytes. The last partly filled
+	// sector lives in the FIL's own sector buffer.
+
+	static bool    stream_active = false;
+	static DWORD   stream_sector;		// first sector of the preallocated run
+	static DWORD   stream_sectors;		// length of the run in sectors
+	static FSIZE_t stream_size;			// bytes logged so far
+	static FSIZE_t stream_synced;		// file size in the directory entry
+#endif
+
+extern void disk_timerproc(void);
+extern void disk_restart(void);
+
+static void error(void) {
+	error_count++;
+
+	if(error_count > 20) {
+		disk_restart();
+		error_count = 0;
+	}
+}
+
+static FRESULT mount(bool force) {
+	FRESULT res = FR_OK;
+
+	if(force || !mounted) {
+		res = f_mount(&simple_logger_fs, "", 1);
+		mounted = (res == FR_OK);
+	}
+	return res;
+}
+
+
+#ifdef SIMPLE_LOGGER_PREALLOCATE
+//write the file size to the directory entry
+static FRESULT stream_checkpoint() {
+	FRESULT res;
+
+	simple_logger_fpointer.obj.objsize = stream_size;
+	simple_logger_fpointer.flag |= _FA_MODIFIED;
+	res = f_sync(&simple_logger_fpointer);
+	if(res == FR_OK) {
+		stream_synced = stream_size;
+	}
+	return res;
+}
+
+//preallocate the file, only possible while it is still empty
+static void stream_start() {
+	FATFS* fs = simple_logger_fpointer.obj.fs;
+
+	stream_active = false;
+	if(f_size(&simple_logger_fpointer) != 0) {
+		return;
+	}
+	if(f_expand(&simple_logger_fpointer, SIMPLE_LOGGER_PREALLOCATE, 1) != FR_OK) {
+		//no room for a contiguous run, log the normal way
+		return;
+	}
+
+	stream_sector = fs->database + (simple_logger_fpointer.obj.sclust - 2) * fs->csize;
+	stream_sectors = (SIMPLE_LOGGER_PREALLOCATE + 511) / 512;
+	stream_size = 0;
+
+	//f_expand sets the size to the whole run, the file is still empty
+	if(stream_checkpoint() != FR_OK) {
+		return;
+	}
+
+	simple_logger_fpointer.sect = 0;
+	memset(simple_logger_fpointer.buf, 0, sizeof(simple_logger_fpointer.buf));
+	stream_active = true;
+}
+
+//run is used up, carry on through f_write from where streaming stopped
+static FRESULT stream_stop() {
+	FRESULT res;
+
+	stream_active = false;
+	res = stream_checkpoint();
+	if(res == FR_OK) {
+		simple_logger_fpointer.fptr = 0;
+		simple_logger_fpointer.sect = 0;
+		res = f_lseek(&simple_logger_fpointer, stream_size);
+	}
+	return res;
+}
+
+//copy into the sector buffer, writing out every sector that fills up
+static FRESULT stream_write(const char* str, UINT len) {
+	BYTE* buf = simple_logger_fpointer.buf;
+	BYTE drv = simple_logger_fpointer.obj.fs->drv;
+
+	while(len > 0) {
+		UINT offset = stream_size % 512;
+		UINT n = 512 - offset;
+		if(n > len) {
+			n = len;
+		}
+
+		memcpy(buf + offset, str, n);
+		str += n;
+		len -= n;
+		stream_size += n;
+
+		//sector is full, write it out and start the next one
+		if(stream_size % 512 == 0) {
+			if(disk_write(drv, buf, stream_sector + (stream_size / 512) - 1, 1) != RES_OK) {
+				return FR_DISK_ERR;
+			}
+			memset(buf, 0, 512);
+		}
+	}
+	return FR_OK;
+}
+
+//the partly filled last sector goes out every time, like f_sync did
+static FRESULT stream_flush() {
+	BYTE drv = simple_logger_fpointer.obj.fs->drv;
+
+	if(stream_size % 512 != 0) {
+		if(disk_write(drv, simple_logger_fpointer.buf, stream_sector + (stream_size / 512), 1) != RES_OK) {
+			return FR_DISK_ERR;
+		}
+	}
+
+	if(stream_size - stream_synced >= SIMPLE_LOGGER_CHECKPOINT) {
+		return stream_checkpoint();
+	}
+	return FR_OK;
+}
+#endif
+
+//an sd card may have been swapped since the last open, so always remount
+static int chanfs_open(void* ctx, const char* name, bool truncate) {
+	FRESULT res = mount(true);
+
+	file_open = false;
+	if(res == FR_OK) {
+		res = f_open(&simple_logger_fpointer, name,
+				FA_WRITE | (truncate ? FA_CREATE_ALWAYS : FA_OPEN_ALWAYS));
+	}
+	if(res == FR_OK) {
+		//move to the end to append
+		res = f_lseek(&simple_logger_fpointer, f_size(&simple_logger_fpointer));
+	}
+	if(res != FR_OK) {
+		error();
+		return -1;
+	}
+	file_open = true;
+
+#ifdef SIMPLE_LOGGER_PREALLOCATE
+	stream_start();
+#endif
+	return 0;
+}
+
+static int chanfs_append(void* ctx, const char* data, uint32_t len) {
+	UINT written;
+
+	if(!file_open) {
+		return -1;
+	}
+
+#ifdef SIMPLE_LOGGER_PREALLOCATE
+	if(stream_active) {
+		if(stream_size + len <= (FSIZE_t)stream_sectors * 512) {
+			return stream_write(data, len) == FR_OK ? 0 : -1;
+		}
+		if(stream_stop() != FR_OK) {
+			return -1;
+		}
+	}
+#endif
+	if(f_write(&simple_logger_fpointer, data, len, &written) != FR_OK || written != len) {
+		return -1;
+	}
+	return 0;
+}
+
+static int chanfs_flush(void* ctx) {
+	if(!file_open) {
+		return -1;
+	}
+
+#ifdef SIMPLE_LOGGER_PREALLOCATE
+	if(stream_active) {
+		return stream_flush() == FR_OK ? 0 : -1;
+	}
+#endif
+	return f_sync(&simple_logger_fpointer) == FR_OK ? 0 : -1;
+}
+
+static uint32_t chanfs_size(void* ctx) {
+	if(!file_open) {
+		return 0;
+	}
+
+#ifdef SIMPLE_LOGGER_PREALLOCATE
+	if(stream_active) {
+		return stream_size;
+	}
+#endif
+	return f_size(&simple_logger_fpointer);
+}
+
+static int chanfs_close(void* ctx) {
+	FRESULT res = FR_OK;
+
+	if(!file_open) {
+		return 0;
+	}
+	file_open = false;
+
+#ifdef SIMPLE_LOGGER_PREALLOCATE
+	if(stream_active) {
+		//give back the part of the run that wasn't used
+		res = stream_stop();
+		if(res == FR_OK) {
+			res = f_truncate(&simple_logger_fpointer);
+		}
+	}
+#endif
+	if(f_close(&simple_logger_fpointer) != FR_OK) {
+		res = FR_DISK_ERR;
+	}
+	return res == FR_OK ? 0 : -1;
+}
+
+static void chanfs_tick(void* ctx) {
+	disk_timerproc();
+}
+
+static int chanfs_read_file(void* ctx, const char* name, char* buf, uint32_t len) {
+	FIL f;
+	UINT n;
+
+	if(mount(false) != FR_OK) {
+		return -1;
+	}
+	if(f_open(&f, name, FA_READ | FA_OPEN_EXISTING) != FR_OK) {
+		return -1;
+	}
+	if(f_read(&f, buf, len, &n) != FR_OK) {
+		n = 0;
+	}
+	f_close(&f);
+	return n;
+}
+
+static int chanfs_write_file(void* ctx, const char* name, const char* data, uint32_t len) {
+	FIL f;
+	UINT n;
+	FRESULT res;
+
+	if(mount(false) != FR_OK) {
+		return -1;
+	}
+	res = f_open(&f, name, FA_WRITE | FA_CREATE_ALWAYS);
+	if(res != FR_OK) {
+		return -1;
+	}
+	res = f_write(&f, data, len, &n);
+	if(f_close(&f) != FR_OK || res != FR_OK || n != len) {
+		return -1;
+	}
+	return 0;
+}
+
+static int chanfs_remove(void* ctx, const char* name) {
+	FRESULT res;
+
+	if(mount(false) != FR_OK) {
+		return -1;
+	}
+	res = f_unlink(name);
+	return (res == FR_OK || res == FR_NO_FILE) ? 0 : -1;
+}
+
+const simple_logger_backend_t simple_logger_chanfs_backend = {
+	.open       = chanfs_open,
+	.append     = chanfs_append,
+	.flush      = chanfs_flush,
+	.size       = chanfs_size,
+	.close      = chanfs_close,
+	.tick       = chanfs_tick,
+	.read_file  = chanfs_read_file,
+	.write_file = chanfs_write_file,
+	.remove     = chanfs_remove,
+};
+
+uint8_t simple_logger_init(const char *filename, const char *permissions) {
+	return simple_logger_init_backend(&simple_logger_chanfs_backend, NULL, filename, permissions);
+}
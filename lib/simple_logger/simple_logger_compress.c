@@ -0,0 +1,431 @@
+// Compression for simple_logger: small window LZ for text, delta + zigzag
+// varint for numeric records, and a backend that runs the LZ in front of
+// another backend. Formats are described in simple_logger_compress.h.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "simple_logger_compress.h"
+
+#define WINDOW_MASK (SIMPLE_LOGGER_LZ_WINDOW - 1)
+#define MIN_MATCH   2
+#define MAX_MATCH   ((1 << SIMPLE_LOGGER_LZ_LENGTH_BITS) - 1 + MIN_MATCH)
+
+
+// LZ encoder
+
+static inline uint8_t hash(uint8_t a, uint8_t b) {
+	return ((a << 2) ^ (a >> 3) ^ b) & (SIMPLE_LOGGER_LZ_HASH - 1);
+}
+
+static int emit_out(simple_logger_lz_t* lz) {
+	uint8_t len = lz->out_len;
+
+	if(len == 0) {
+		return 0;
+	}
+	lz->out_len = 0;
+	return lz->emit(lz->emit_ctx, lz->out, len);
+}
+
+static int put_bits(simple_logger_lz_t* lz, uint16_t value, uint8_t n) {
+	int res = 0;
+
+	while(n--) {
+		lz->bits = (lz->bits << 1) | ((value >> n) & 1);
+		if(++lz->nbits == 8) {
+			lz->out[lz->out_len++] = lz->bits;
+			lz->bits = 0;
+			lz->nbits = 0;
+			if(lz->out_len == SIMPLE_LOGGER_LZ_OUT) {
+				res |= emit_out(lz);
+			}
+		}
+	}
+	return res;
+}
+
+//how many bytes at p match the ones dist back, up to max. Past the current
+//position the source is p itself, which is how runs get encoded.
+static uint16_t match_length(simple_logger_lz_t* lz, const uint8_t* p, uint16_t dist, uint16_t max) {
+	uint16_t n;
+
+	for(n = 0; n < max; n++) {
+		uint8_t src = (n < dist) ?
+			lz->window[(uint16_t)(lz->pos - dist + n) & WINDOW_MASK] : p[n - dist];
+		if(src != p[n]) {
+			break;
+		}
+	}
+	return n;
+}
+
+//add data[i] to the window, and to the hash chains if data[i+1] is known
+static void insert(simple_logger_lz_t* lz, const uint8_t* data, uint32_t i, uint32_t len) {
+	if(i + 1 < len) {
+		uint8_t h = hash(data[i], data[i + 1]);
+		lz->prev[lz->pos & WINDOW_MASK] = lz->head[h];
+		lz->head[h] = lz->pos;
+	}
+	lz->window[lz->pos & WINDOW_MASK] = data[i];
+	lz->pos++;
+	if(lz->filled < SIMPLE_LOGGER_LZ_WINDOW - 1) {
+		lz->filled++;
+	}
+}
+
+void simple_logger_lz_reset(simple_logger_lz_t* lz, simple_logger_lz_emit_t emit, void* emit_ctx) {
+	memset(lz, 0, sizeof(*lz));
+	lz->emit = emit;
+	lz->emit_ctx = emit_ctx;
+}
+
+int simple_logger_lz_header(simple_logger_lz_t* lz) {
+	int res = put_bits(lz, SIMPLE_LOGGER_LZ_MAGIC, 8);
+	res |= put_bits(lz, SIMPLE_LOGGER_LZ_WINDOW_BITS << 4 | SIMPLE_LOGGER_LZ_LENGTH_BITS, 8);
+	return res ? -1 : 0;
+}
+
+int simple_logger_lz_encode(simple_logger_lz_t* lz, const uint8_t* data, uint32_t len) {
+	uint32_t i = 0;
+	int res = 0;
+
+	while(i < len) {
+		uint16_t best_len = 0;
+		uint16_t best_dist = 0;
+
+		if(i + 1 < len) {
+			uint16_t max = (len - i < MAX_MATCH) ? len - i : MAX_MATCH;
+			uint16_t cand = lz->head[hash(data[i], data[i + 1])];
+			uint16_t last_dist = 0;
+			uint8_t chain;
+
+			//walk back through earlier positions with the same hash, the
+			//chain is stale once the distance stops growing
+			for(chain = 0; chain < SIMPLE_LOGGER_LZ_CHAIN; chain++) {
+				uint16_t dist = lz->pos - cand;
+				uint16_t n;
+
+				if(dist <= last_dist || dist > lz->filled) {
+					break;
+				}
+				n = match_length(lz, data + i, dist, max);
+				if(n > best_len) {
+					best_len = n;
+					best_dist = dist;
+					if(n == max) {
+						break;
+					}
+				}
+				last_dist = dist;
+				cand = lz->prev[cand & WINDOW_MASK];
+			}
+		}
+
+		if(best_len >= MIN_MATCH) {
+			res |= put_bits(lz, best_dist, 1 + SIMPLE_LOGGER_LZ_WINDOW_BITS);
+			res |= put_bits(lz, best_len - MIN_MATCH, SIMPLE_LOGGER_LZ_LENGTH_BITS);
+		} else {
+			res |= put_bits(lz, 0x100 | data[i], 9);
+			best_len = 1;
+		}
+
+		while(best_len--) {
+			insert(lz, data, i++, len);
+		}
+		lz->dirty = true;
+	}
+	return res ? -1 : 0;
+}
+
+int simple_logger_lz_flush(simple_logger_lz_t* lz) {
+	int res = 0;
+
+	if(lz->dirty) {
+		res |= put_bits(lz, 0, 1 + SIMPLE_LOGGER_LZ_WINDOW_BITS);
+		if(lz->nbits) {
+			res |= put_bits(lz, 0, 8 - lz->nbits);
+		}
+		lz->dirty = false;
+	}
+	res |= emit_out(lz);
+	return res ? -1 : 0;
+}
+
+uint32_t simple_logger_lz_pending(simple_logger_lz_t* lz) {
+	return lz->out_len + (lz->nbits ? 1 : 0);
+}
+
+
+// LZ decoder
+
+static uint16_t get_bits(const uint8_t* in, uint32_t* bitpos, uint8_t n) {
+	uint16_t v = 0;
+
+	while(n--) {
+		v = (v << 1) | ((in[*bitpos >> 3] >> (7 - (*bitpos & 7))) & 1);
+		(*bitpos)++;
+	}
+	return v;
+}
+
+int32_t simple_logger_lz_decode(const uint8_t* in, uint32_t len, uint8_t* out, uint32_t cap) {
+	uint32_t bitpos = 16;
+	uint32_t end = len * 8;
+	uint32_t o = 0;
+	uint8_t w, l;
+
+	if(len < 2 || in[0] != SIMPLE_LOGGER_LZ_MAGIC) {
+		return -1;
+	}
+	w = in[1] >> 4;
+	l = in[1] & 0x0F;
+	if(w < 4 || w > 12 || l < 2 || l > 8) {
+		return -1;
+	}
+
+	while(bitpos < end) {
+		if(get_bits(in, &bitpos, 1)) {
+			if(bitpos + 8 > end) {
+				break;
+			}
+			if(o >= cap) {
+				return -1;
+			}
+			out[o++] = get_bits(in, &bitpos, 8);
+		} else {
+			uint16_t dist, n;
+
+			if(bitpos + w > end) {
+				break;
+			}
+			dist = get_bits(in, &bitpos, w);
+			if(dist == 0) {
+				//sync
+				bitpos = (bitpos + 7) & ~7UL;
+				continue;
+			}
+			if(bitpos + l > end) {
+				break;
+			}
+			n = get_bits(in, &bitpos, l) + MIN_MATCH;
+			if(dist > o || o + n > cap) {
+				return -1;
+			}
+			//byte by byte, the copy may overlap what it writes
+			while(n--) {
+				out[o] = out[o - dist];
+				o++;
+			}
+		}
+	}
+	return o;
+}
+
+
+// Delta + zigzag varint records
+
+static inline uint32_t zigzag(int32_t v) {
+	return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t z) {
+	return (int32_t)((z >> 1) ^ -(z & 1));
+}
+
+void simple_logger_delta_reset(simple_logger_delta_t* delta) {
+	memset(delta, 0, sizeof(*delta));
+}
+
+uint8_t simple_logger_delta_encode(simple_logger_delta_t* delta, const int32_t* values,
+		uint8_t count, uint8_t* out) {
+	bool key;
+	uint8_t len = 1;
+	uint8_t i;
+
+	if(count == 0 || count > SIMPLE_LOGGER_DELTA_MAX_VALUES) {
+		return 0;
+	}
+
+	key = (count != delta->count) || (delta->since_key >= SIMPLE_LOGGER_DELTA_KEY_INTERVAL - 1);
+	out[0] = count | (key ? 0x80 : 0);
+
+	for(i = 0; i < count; i++) {
+		//wrapping difference, so any two values have one
+		uint32_t z = zigzag(key ? values[i] : (int32_t)((uint32_t)values[i] - (uint32_t)delta->last[i]));
+
+		while(z >= 0x80) {
+			out[len++] = z | 0x80;
+			z >>= 7;
+		}
+		out[len++] = z;
+		delta->last[i] = values[i];
+	}
+
+	delta->count = count;
+	delta->since_key = key ? 0 : delta->since_key + 1;
+	return len;
+}
+
+int simple_logger_delta_decode(simple_logger_delta_t* delta, const uint8_t* in, uint32_t len,
+		int32_t* values, uint8_t* count) {
+	uint32_t used = 1;
+	bool key;
+	uint8_t n, i;
+
+	if(len == 0) {
+		return 0;
+	}
+	key = in[0] & 0x80;
+	n = in[0] & 0x7F;
+	if(n == 0 || n > SIMPLE_LOGGER_DELTA_MAX_VALUES || (!key && n != delta->count)) {
+		return -1;
+	}
+
+	for(i = 0; i < n; i++) {
+		uint32_t z = 0;
+		uint8_t shift = 0;
+
+		do {
+			if(used >= len) {
+				return 0;
+			}
+			if(shift > 28) {
+				return -1;
+			}
+			z |= (uint32_t)(in[used] & 0x7F) << shift;
+			shift += 7;
+		} while(in[used++] & 0x80);
+
+		values[i] = key ? unzigzag(z) : (int32_t)((uint32_t)delta->last[i] + (uint32_t)unzigzag(z));
+	}
+
+	memcpy(delta->last, values, n * sizeof(int32_t));
+	delta->count = n;
+	delta->since_key = key ? 0 : delta->since_key + 1;
+	*count = n;
+	return used;
+}
+
+
+// Backend
+
+static int lz_emit(void* ctx, const uint8_t* data, uint32_t len) {
+	simple_logger_lz_stream_t* s = ctx;
+	return s->backend->append(s->ctx, (const char*)data, len);
+}
+
+//a reopened log carries on without a header, and without matches into
+//what was written before
+static int lz_open(void* ctx, const char* name, bool truncate) {
+	simple_logger_lz_stream_t* s = ctx;
+
+	s->open = false;
+	if(s->backend->open(s->ctx, name, truncate) != 0) {
+		return -1;
+	}
+	simple_logger_lz_reset(&s->lz, lz_emit, s);
+	s->need_header = (s->backend->size(s->ctx) == 0);
+	s->open = true;
+	return 0;
+}
+
+static int lz_append(void* ctx, const char* data, uint32_t len) {
+	simple_logger_lz_stream_t* s = ctx;
+
+	if(!s->open) {
+		return -1;
+	}
+	if(s->need_header) {
+		if(simple_logger_lz_header(&s->lz) != 0) {
+			return -1;
+		}
+		s->need_header = false;
+	}
+	return simple_logger_lz_encode(&s->lz, (const uint8_t*)data, len);
+}
+
+static int lz_flush(void* ctx) {
+	simple_logger_lz_stream_t* s = ctx;
+
+	if(!s->open || simple_logger_lz_flush(&s->lz) != 0) {
+		return -1;
+	}
+	return s->backend->flush(s->ctx);
+}
+
+//bytes on the medium, which is what rotation should go by
+static uint32_t lz_size(void* ctx) {
+	simple_logger_lz_stream_t* s = ctx;
+
+	if(!s->open) {
+		return 0;
+	}
+	return s->backend->size(s->ctx) + simple_logger_lz_pending(&s->lz);
+}
+
+static int lz_close(void* ctx) {
+	simple_logger_lz_stream_t* s = ctx;
+	int res = 0;
+
+	if(!s->open) {
+		return 0;
+	}
+	s->open = false;
+	if(simple_logger_lz_flush(&s->lz) != 0) {
+		res = -1;
+	}
+	if(s->backend->close(s->ctx) != 0) {
+		res = -1;
+	}
+	return res;
+}
+
+static void lz_tick(void* ctx) {
+	simple_logger_lz_stream_t* s = ctx;
+
+	if(s->backend->tick) {
+		s->backend->tick(s->ctx);
+	}
+}
+
+//side files go through uncompressed
+static int lz_read_file(void* ctx, const char* name, char* buf, uint32_t len) {
+	simple_logger_lz_stream_t* s = ctx;
+
+	if(!s->backend->read_file) {
+		return -1;
+	}
+	return s->backend->read_file(s->ctx, name, buf, len);
+}
+
+static int lz_write_file(void* ctx, const char* name, const char* data, uint32_t len) {
+	simple_logger_lz_stream_t* s = ctx;
+
+	if(!s->backend->write_file) {
+		return -1;
+	}
+	return s->backend->write_file(s->ctx, name, data, len);
+}
+
+static int lz_remove(void* ctx, const char* name) {
+	simple_logger_lz_stream_t* s = ctx;
+
+	if(!s->backend->remove) {
+		return -1;
+	}
+	return s->backend->remove(s->ctx, name);
+}
+
+const simple_logger_backend_t simple_logger_lz_backend = {
+	.open       = lz_open,
+	.append     = lz_append,
+	.flush      = lz_flush,
+	.size       = lz_size,
+	.close      = lz_close,
+	.tick       = lz_tick,
+	.read_file  = lz_read_file,
+	.write_file = lz_write_file,
+	.remove     = lz_remove,
+};
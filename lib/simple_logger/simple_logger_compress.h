@@ -0,0 +1,147 @@
+#ifndef SIMPLE_LOGGER_COMPRESS_H
+#define SIMPLE_LOGGER_COMPRESS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "simple_logger_backend.h"
+
+// Compression for simple_logger, all in fixed size structs.
+//
+// LZ: a small window LZ77 for text, in the spirit of heatshrink. The output
+// is a bit stream, most significant bit first, of
+//
+//   1 b[8]                   literal byte b
+//   0 d[W] n[L]              copy n+2 bytes from d bytes back, d >= 1
+//   0 0[W]                   sync, skip to the next byte boundary
+//
+// where W is SIMPLE_LOGGER_LZ_WINDOW_BITS and L SIMPLE_LOGGER_LZ_LENGTH_BITS.
+// The stream starts with SIMPLE_LOGGER_LZ_MAGIC and a byte holding W << 4 | L.
+// Every flush ends with a sync, so whatever reached the medium decodes.
+//
+// Delta: records of up to SIMPLE_LOGGER_DELTA_MAX_VALUES int32 values.
+// Each record is a byte with the number of values, plus 0x80 if it is a key
+// record, then one zigzag varint per value: the value itself in a key
+// record, otherwise the difference from the same value in the record
+// before. A record with a different number of values than the last one is
+// always a key, and so is every SIMPLE_LOGGER_DELTA_KEY_INTERVAL'th.
+
+#ifndef SIMPLE_LOGGER_LZ_WINDOW_BITS
+#define SIMPLE_LOGGER_LZ_WINDOW_BITS 8
+#endif
+#ifndef SIMPLE_LOGGER_LZ_LENGTH_BITS
+#define SIMPLE_LOGGER_LZ_LENGTH_BITS 4
+#endif
+#if SIMPLE_LOGGER_LZ_WINDOW_BITS < 4 || SIMPLE_LOGGER_LZ_WINDOW_BITS > 12
+#error SIMPLE_LOGGER_LZ_WINDOW_BITS must be between 4 and 12
+#endif
+#if SIMPLE_LOGGER_LZ_LENGTH_BITS < 2 || SIMPLE_LOGGER_LZ_LENGTH_BITS > 8
+#error SIMPLE_LOGGER_LZ_LENGTH_BITS must be between 2 and 8
+#endif
+
+// How many earlier positions with the same hash are tried per byte. Bounds
+// the time per byte, more finds longer matches.
+#ifndef SIMPLE_LOGGER_LZ_CHAIN
+#define SIMPLE_LOGGER_LZ_CHAIN 8
+#endif
+
+#define SIMPLE_LOGGER_LZ_MAGIC    0xC5
+#define SIMPLE_LOGGER_LZ_WINDOW   (1 << SIMPLE_LOGGER_LZ_WINDOW_BITS)
+#define SIMPLE_LOGGER_LZ_HASH     64
+#define SIMPLE_LOGGER_LZ_OUT      32
+
+#ifndef SIMPLE_LOGGER_DELTA_MAX_VALUES
+#define SIMPLE_LOGGER_DELTA_MAX_VALUES 16
+#endif
+#ifndef SIMPLE_LOGGER_DELTA_KEY_INTERVAL
+#define SIMPLE_LOGGER_DELTA_KEY_INTERVAL 64
+#endif
+#if SIMPLE_LOGGER_DELTA_MAX_VALUES > 127
+#error SIMPLE_LOGGER_DELTA_MAX_VALUES must be at most 127
+#endif
+
+// Longest encoded record
+#define SIMPLE_LOGGER_DELTA_RECORD_MAX (1 + 5 * SIMPLE_LOGGER_DELTA_MAX_VALUES)
+
+// Where compressed bytes go. Returns 0 on success, -1 on failure.
+typedef int (*simple_logger_lz_emit_t)(void* ctx, const uint8_t* data, uint32_t len);
+
+typedef struct {
+	uint8_t  window[SIMPLE_LOGGER_LZ_WINDOW];	// last bytes seen, by position
+	uint16_t prev[SIMPLE_LOGGER_LZ_WINDOW];	// earlier position with the same hash
+	uint16_t head[SIMPLE_LOGGER_LZ_HASH];	// latest position for each hash
+	uint16_t pos;				// bytes seen since reset, wraps
+	uint16_t filled;			// bytes of the window that are valid
+	bool     dirty;				// something encoded since the last sync
+
+	uint8_t  bits;				// bits not yet a whole byte
+	uint8_t  nbits;
+	uint8_t  out[SIMPLE_LOGGER_LZ_OUT];	// bytes not yet emitted
+	uint8_t  out_len;
+
+	simple_logger_lz_emit_t emit;
+	void*    emit_ctx;
+} simple_logger_lz_t;
+
+typedef struct {
+	int32_t  last[SIMPLE_LOGGER_DELTA_MAX_VALUES];
+	uint8_t  count;				// values in the last record, 0 after reset
+	uint8_t  since_key;
+} simple_logger_delta_t;
+
+
+// Start a new stream. Matches never reach back before a reset.
+void simple_logger_lz_reset(simple_logger_lz_t* lz, simple_logger_lz_emit_t emit, void* emit_ctx);
+
+// The two byte stream header, emitted once at the start of a file
+int simple_logger_lz_header(simple_logger_lz_t* lz);
+
+// Compress len bytes. Output goes to emit() as the internal buffer fills.
+int simple_logger_lz_encode(simple_logger_lz_t* lz, const uint8_t* data, uint32_t len);
+
+// Sync and emit everything compressed so far
+int simple_logger_lz_flush(simple_logger_lz_t* lz);
+
+// Bytes compressed but not emitted yet
+uint32_t simple_logger_lz_pending(simple_logger_lz_t* lz);
+
+// Decompress a whole stream, header included, into out. Returns the number
+// of bytes written to out, or -1 if the stream is bad or out is too small.
+// A stream cut off part way through a token decodes up to that token.
+int32_t simple_logger_lz_decode(const uint8_t* in, uint32_t len, uint8_t* out, uint32_t cap);
+
+
+void simple_logger_delta_reset(simple_logger_delta_t* delta);
+
+// Encode a record into out (SIMPLE_LOGGER_DELTA_RECORD_MAX bytes). Returns
+// its length, or 0 if count is 0 or too big.
+uint8_t simple_logger_delta_encode(simple_logger_delta_t* delta, const int32_t* values,
+		uint8_t count, uint8_t* out);
+
+// Decode one record from in. Returns the bytes used, 0 if in ends part way
+// through the record, or -1 if it isn't a valid record.
+int simple_logger_delta_decode(simple_logger_delta_t* delta, const uint8_t* in, uint32_t len,
+		int32_t* values, uint8_t* count);
+
+
+// simple_logger backend that compresses with the LZ above on the way to
+// another backend. Every flush() syncs, so each logged line is complete on
+// the medium.
+//
+//	static simple_logger_lz_stream_t lz_log = {
+//		.backend = &simple_logger_chanfs_backend,
+//		.ctx     = NULL,
+//	};
+//	simple_logger_init_backend(&simple_logger_lz_backend, &lz_log, "LOG.LZ", "a");
+typedef struct {
+	const simple_logger_backend_t* backend;
+	void*              ctx;
+
+	// Kept up to date by the backend
+	simple_logger_lz_t lz;
+	bool               need_header;
+	bool               open;
+} simple_logger_lz_stream_t;
+
+extern const simple_logger_backend_t simple_logger_lz_backend;
+
+#endif
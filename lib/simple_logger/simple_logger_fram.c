@@ -0,0 +1,107 @@
+// simple_logger backend for a region of an FM25L04B FRAM. FRAM writes need
+// no erase and take effect straight away, so append() writes the bytes and
+// flush() only has to move the length in the header.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "simple_logger.h"
+#include "simple_logger_fram.h"
+
+static int write_header(simple_logger_fram_t* log, uint16_t length) {
+	uint8_t header[SIMPLE_LOGGER_FRAM_HEADER];
+
+	header[0] = SIMPLE_LOGGER_FRAM_MAGIC & 0xFF;
+	header[1] = SIMPLE_LOGGER_FRAM_MAGIC >> 8;
+	header[2] = length & 0xFF;
+	header[3] = length >> 8;
+	if(fm25l04b_write(log->dev, log->base, header, SIMPLE_LOGGER_FRAM_HEADER) != 0) {
+		return -1;
+	}
+	log->flushed = length;
+	return 0;
+}
+
+static int fram_open(void* ctx, const char* name, bool truncate) {
+	simple_logger_fram_t* log = ctx;
+	uint8_t header[SIMPLE_LOGGER_FRAM_HEADER];
+	uint16_t length;
+
+	log->open = false;
+	if(log->size <= SIMPLE_LOGGER_FRAM_HEADER) {
+		return -1;
+	}
+	if(fm25l04b_read(log->dev, log->base, header, SIMPLE_LOGGER_FRAM_HEADER) != 0) {
+		return -1;
+	}
+
+	length = header[2] | (header[3] << 8);
+	if(truncate ||
+	   (header[0] | (header[1] << 8)) != SIMPLE_LOGGER_FRAM_MAGIC ||
+	   length > log->size - SIMPLE_LOGGER_FRAM_HEADER) {
+		//empty, or nothing we know of, start a new log
+		if(write_header(log, 0) != 0) {
+			return -1;
+		}
+		length = 0;
+	}
+
+	log->length = length;
+	log->flushed = length;
+	log->open = true;
+	return 0;
+}
+
+static int fram_append(void* ctx, const char* data, uint32_t len) {
+	simple_logger_fram_t* log = ctx;
+
+	if(!log->open || len > (uint32_t)(log->size - SIMPLE_LOGGER_FRAM_HEADER - log->length)) {
+		return -1;
+	}
+	if(fm25l04b_write(log->dev, log->base + SIMPLE_LOGGER_FRAM_HEADER + log->length,
+			(uint8_t*)data, len) != 0) {
+		return -1;
+	}
+	log->length += len;
+	return 0;
+}
+
+static int fram_flush(void* ctx) {
+	simple_logger_fram_t* log = ctx;
+
+	if(!log->open) {
+		return -1;
+	}
+	if(log->length == log->flushed) {
+		return 0;
+	}
+	return write_header(log, log->length);
+}
+
+static uint32_t fram_size(void* ctx) {
+	simple_logger_fram_t* log = ctx;
+	return log->length;
+}
+
+static int fram_close(void* ctx) {
+	simple_logger_fram_t* log = ctx;
+	int res = 0;
+
+	if(log->open) {
+		res = fram_flush(ctx);
+		log->open = false;
+	}
+	return res;
+}
+
+const simple_logger_backend_t simple_logger_fram_backend = {
+	.open       = fram_open,
+	.append     = fram_append,
+	.flush      = fram_flush,
+	.size       = fram_size,
+	.close      = fram_close,
+	.tick       = NULL,
+	.read_file  = NULL,
+	.write_file = NULL,
+	.remove     = NULL,
+};
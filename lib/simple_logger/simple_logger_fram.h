@@ -0,0 +1,39 @@
+#ifndef SIMPLE_LOGGER_FRAM_H
+#define SIMPLE_LOGGER_FRAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fm25l04b.h"
+#include "simple_logger_backend.h"
+
+// simple_logger in a region of an FM25L04B. The region is
+//
+//   magic[2] length[2] log text...
+//
+// and the length only moves on at flush(), so a reset part way through a
+// line loses that line and nothing else. There is one log per region, the
+// filename is ignored. Once the region is full logging fails. Rotation is
+// not supported.
+//
+//	static simple_logger_fram_t fram_log = {
+//		.dev  = &fram,
+//		.base = 0,
+//		.size = FM25L04B_SIZE,
+//	};
+//	simple_logger_init_backend(&simple_logger_fram_backend, &fram_log, "", "a");
+
+#define SIMPLE_LOGGER_FRAM_MAGIC  0x4C53  // "SL"
+#define SIMPLE_LOGGER_FRAM_HEADER 4
+
+typedef struct {
+	fm25l04b_t* dev;
+	uint16_t    base;	// first FRAM address used by the log
+	uint16_t    size;	// bytes of FRAM used, header included
+
+	// Kept up to date in RAM
+	uint16_t    length;	// bytes of log text, flushed or not
+	uint16_t    flushed;	// length in the header
+	bool        open;
+} simple_logger_fram_t;
+
+#endif
@@ -0,0 +1,111 @@
+// simple_logger backend on plain C stdio. On Linux the log is a real file,
+// linked with mbramfs.c it is a file in RAM.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "simple_logger.h"
+#include "simple_logger_backend.h"
+
+static FILE* log_file = NULL;
+static uint32_t log_size = 0;
+
+static int stdio_open(void* ctx, const char* name, bool truncate) {
+	long pos;
+
+	log_file = fopen(name, truncate ? "w" : "a");
+	if(log_file == NULL) {
+		return -1;
+	}
+
+	if(fseek(log_file, 0, SEEK_END) != 0) {
+		fclose(log_file);
+		log_file = NULL;
+		return -1;
+	}
+	pos = ftell(log_file);
+	log_size = (pos > 0) ? pos : 0;
+	return 0;
+}
+
+static int stdio_append(void* ctx, const char* data, uint32_t len) {
+	if(log_file == NULL) {
+		return -1;
+	}
+	if(fwrite(data, 1, len, log_file) != len) {
+		return -1;
+	}
+	log_size += len;
+	return 0;
+}
+
+static int stdio_flush(void* ctx) {
+	if(log_file == NULL) {
+		return -1;
+	}
+	return fflush(log_file) == 0 ? 0 : -1;
+}
+
+static uint32_t stdio_size(void* ctx) {
+	return log_size;
+}
+
+static int stdio_close(void* ctx) {
+	int res;
+
+	if(log_file == NULL) {
+		return 0;
+	}
+	res = fclose(log_file);
+	log_file = NULL;
+	return res == 0 ? 0 : -1;
+}
+
+static int stdio_read_file(void* ctx, const char* name, char* buf, uint32_t len) {
+	FILE* f = fopen(name, "r");
+	int n;
+
+	if(f == NULL) {
+		return -1;
+	}
+	n = fread(buf, 1, len, f);
+	fclose(f);
+	return n;
+}
+
+static int stdio_write_file(void* ctx, const char* name, const char* data, uint32_t len) {
+	FILE* f = fopen(name, "w");
+	size_t n;
+
+	if(f == NULL) {
+		return -1;
+	}
+	n = fwrite(data, 1, len, f);
+	if(fclose(f) != 0 || n != len) {
+		return -1;
+	}
+	return 0;
+}
+
+static int stdio_remove(void* ctx, const char* name) {
+	FILE* f = fopen(name, "r");
+
+	//a segment that is already gone is fine
+	if(f == NULL) {
+		return 0;
+	}
+	fclose(f);
+	return remove(name) == 0 ? 0 : -1;
+}
+
+const simple_logger_backend_t simple_logger_stdio_backend = {
+	.open       = stdio_open,
+	.append     = stdio_append,
+	.flush      = stdio_flush,
+	.size       = stdio_size,
+	.close      = stdio_close,
+	.tick       = NULL,
+	.read_file  = stdio_read_file,
+	.write_file = stdio_write_file,
+	.remove     = stdio_remove,
+};
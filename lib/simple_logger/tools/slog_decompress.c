@@ -0,0 +1,151 @@
+// Read a log written by simple_logger with compression
+//
+// LZ compressed logs (simple_logger_lz_backend) are recognised by their
+// header and decompressed. With -r the log, decompressed or not, holds
+// records from simple_logger_log_values() and is printed as CSV, one record
+// per line. -H passes a text header line in front of the records through.
+//
+//   ./slog_decompress LOG.LZ LOG.TXT
+//   ./slog_decompress -r -H DATA.BIN > data.csv
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "simple_logger_compress.h"
+
+static void usage (void) {
+    fprintf(stderr,
+        "usage: slog_decompress [options] input [output]\n"
+        "  -r   the log holds records from simple_logger_log_values(), print CSV\n"
+        "  -H   with -r, the records follow a text header line\n");
+    exit(1);
+}
+
+static uint8_t* load (const char* path, uint32_t* len) {
+    FILE* f = fopen(path, "rb");
+    uint8_t* buf = NULL;
+    uint32_t cap = 0;
+    size_t n;
+
+    if (f == NULL) {
+        perror(path);
+        return NULL;
+    }
+    *len = 0;
+    do {
+        if (*len == cap) {
+            cap = cap ? cap * 2 : 65536;
+            buf = realloc(buf, cap);
+        }
+        n = fread(buf + *len, 1, cap - *len, f);
+        *len += n;
+    } while (n > 0);
+    fclose(f);
+    return buf;
+}
+
+// Decompress into a buffer big enough for it
+static uint8_t* lz_decode (const uint8_t* in, uint32_t len, uint32_t* out_len) {
+    uint32_t cap = len * 4 + 1024;
+
+    for (;;) {
+        uint8_t* out = malloc(cap);
+        int32_t n = simple_logger_lz_decode(in, len, out, cap);
+
+        if (n >= 0) {
+            *out_len = n;
+            return out;
+        }
+        free(out);
+        // Either out is too small or the stream is bad. At best a copy of
+        // 2^L+1 bytes takes 1+W+L bits, about 10 times smaller.
+        if (cap > len * 32 + 1024) return NULL;
+        cap *= 2;
+    }
+}
+
+static int print_records (const uint8_t* data, uint32_t len, int header, FILE* out) {
+    simple_logger_delta_t delta;
+    int32_t values[SIMPLE_LOGGER_DELTA_MAX_VALUES];
+    uint32_t pos = 0;
+    uint8_t count;
+
+    if (header) {
+        while (pos < len && data[pos] != '\n') fputc(data[pos++], out);
+        if (pos < len) fputc(data[pos++], out);
+    }
+
+    simple_logger_delta_reset(&delta);
+    while (pos < len) {
+        int used = simple_logger_delta_decode(&delta, data + pos, len - pos, values, &count);
+
+        if (used == 0) {
+            fprintf(stderr, "log ends part way through a record at byte %u\n", pos);
+            break;
+        }
+        if (used < 0) {
+            fprintf(stderr, "bad record at byte %u\n", pos);
+            return -1;
+        }
+        for (uint8_t i = 0; i < count; i++) {
+            fprintf(out, i ? ",%d" : "%d", values[i]);
+        }
+        fputc('\n', out);
+        pos += used;
+    }
+    return 0;
+}
+
+int main (int argc, char** argv) {
+    int records = 0, header = 0;
+    uint8_t* in;
+    uint8_t* data;
+    uint32_t len, data_len;
+    FILE* out = stdout;
+    int opt, res = 0;
+
+    while ((opt = getopt(argc, argv, "rH")) != -1) {
+        switch (opt) {
+            case 'r': records = 1; break;
+            case 'H': header = 1; break;
+            default:  usage();
+        }
+    }
+    if (optind >= argc || argc - optind > 2) usage();
+
+    in = load(argv[optind], &len);
+    if (in == NULL) return 1;
+
+    if (len >= 2 && in[0] == SIMPLE_LOGGER_LZ_MAGIC) {
+        data = lz_decode(in, len, &data_len);
+        if (data == NULL) {
+            fprintf(stderr, "%s: bad compressed log\n", argv[optind]);
+            return 1;
+        }
+        fprintf(stderr, "%u bytes -> %u bytes (%.1f%%)\n", len, data_len,
+                data_len ? 100.0 * len / data_len : 0.0);
+    } else {
+        data = in;
+        data_len = len;
+    }
+
+    if (argc - optind == 2) {
+        out = fopen(argv[optind + 1], "wb");
+        if (out == NULL) {
+            perror(argv[optind + 1]);
+            return 1;
+        }
+    }
+
+    if (records) {
+        res = print_records(data, data_len, header, out);
+    } else {
+        fwrite(data, 1, data_len, out);
+    }
+
+    if (out != stdout) fclose(out);
+    return res ? 1 : 0;
+}
@@ -0,0 +1,103 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/*******************************************************************************
+ * Lock free queue for one producer and one consumer, for example an interrupt
+ * handing work to the main loop. Neither side ever disables interrupts.
+ *
+ * Items are fixed size and copied in. The producer only writes `tail` and
+ * the consumer only writes `head`; both count up forever and wrap, and the
+ * capacity is a power of two so the difference is always the fill level.
+ *
+ * USAGE
+ *
+ *   typedef struct { uint8_t* data; uint16_t len; } frame_t;
+ *   SPSC_QUEUE_DEFINE(frames, frame_t, 8);
+ *
+ *   // in the interrupt
+ *   spsc_queue_push(&frames, &frame);
+ *
+ *   // in the main loop
+ *   frame_t* f;
+ *   while ((f = spsc_queue_peek(&frames)) != NULL) {
+ *     ...
+ *     spsc_queue_drop(&frames);
+ *   }
+ *
+ */
+
+typedef struct {
+    uint8_t* items;
+    uint16_t item_size;
+    uint16_t capacity;  // power of two, at most 32768
+    uint16_t head;      // next item to read, written by the consumer
+    uint16_t tail;      // next slot to write, written by the producer
+} spsc_queue_t;
+
+#define SPSC_QUEUE_DEFINE(name, type, size)                                   \
+    static type name##_items[size];                                           \
+    static spsc_queue_t name = {(uint8_t*) name##_items, sizeof(type), size, 0, 0}
+
+// The acquire/release pairs order the item copy against the index update.
+// On a single Cortex-M core they come down to a compiler barrier (and a DMB).
+#define SPSC_LOAD(x)     __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define SPSC_STORE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+
+static inline void* spsc_queue_slot (spsc_queue_t* q, uint16_t index) {
+    return q->items + (uint32_t)(index & (q->capacity - 1)) * q->item_size;
+}
+
+static inline void spsc_queue_init (spsc_queue_t* q, void* items, uint16_t item_size, uint16_t capacity) {
+    q->items     = items;
+    q->item_size = item_size;
+    q->capacity  = capacity;
+    q->head      = 0;
+    q->tail      = 0;
+}
+
+// Number of items queued. Exact for either side, a lower (producer) or upper
+// (consumer) bound for anyone else.
+static inline uint16_t spsc_queue_count (spsc_queue_t* q) {
+    return (uint16_t)(SPSC_LOAD(q->tail) - SPSC_LOAD(q->head));
+}
+
+// Producer: copy an item in. Returns false if the queue is full.
+static inline bool spsc_queue_push (spsc_queue_t* q, const void* item) {
+    uint16_t tail = q->tail;
+
+    if ((uint16_t)(tail - SPSC_LOAD(q->head)) == q->capacity) return false;
+
+    memcpy(spsc_queue_slot(q, tail), item, q->item_size);
+    SPSC_STORE(q->tail, (uint16_t)(tail + 1));
+    return true;
+}
+
+// Consumer: the oldest item, left in place, or NULL if the queue is empty.
+// It stays valid until spsc_queue_drop().
+static inline void* spsc_queue_peek (spsc_queue_t* q) {
+    uint16_t head = q->head;
+
+    if (head == SPSC_LOAD(q->tail)) return NULL;
+    return spsc_queue_slot(q, head);
+}
+
+// Consumer: done with the oldest item
+static inline void spsc_queue_drop (spsc_queue_t* q) {
+    SPSC_STORE(q->head, (uint16_t)(q->head + 1));
+}
+
+// Consumer: copy the oldest item out and drop it. Returns false if empty.
+static inline bool spsc_queue_pop (spsc_queue_t* q, void* item) {
+    void* slot = spsc_queue_peek(q);
+
+    if (slot == NULL) return false;
+    memcpy(item, slot, q->item_size);
+    spsc_queue_drop(q);
+    return true;
+}
+
+#endif
@@ -0,0 +1,139 @@
+// Host test for bench.c, built with BENCH_HOST: the statistics, that setup
+// stays out of the times, and the lines bench_run() reports.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bench.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do {                                              \
+    if (!(cond)) {                                                    \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+        failures++;                                                   \
+    }                                                                 \
+} while (0)
+
+static uint32_t setups, runs;
+
+static void spin (uint32_t ns) {
+    uint32_t start = bench_now();
+    while (bench_now() - start < ns);
+}
+
+static void slow_setup (void* context) {
+    setups++;
+    spin(200000);
+}
+
+static void nothing (void* context) {
+    runs++;
+}
+
+static void wait (void* context) {
+    runs++;
+    spin(*(uint32_t*) context);
+}
+
+static void test_summarize (void) {
+    uint32_t odd[] = {50, 10, 90, 30, 70};
+    uint32_t even[] = {4, 1, 3, 2};
+    uint32_t one[] = {7};
+    bench_result_t result;
+
+    bench_summarize(odd, 5, 0, &result);
+    CHECK(result.min == 10 && result.median == 50 && result.max == 90);
+    CHECK(result.iterations == 5);
+    CHECK(odd[0] == 10 && odd[4] == 90);
+
+    // The upper middle, and overhead taken off without going below zero
+    bench_summarize(even, 4, 2, &result);
+    CHECK(result.min == 0 && result.median == 1 && result.max == 2);
+
+    bench_summarize(one, 1, 0, &result);
+    CHECK(result.min == 7 && result.median == 7 && result.max == 7);
+
+    bench_summarize(one, 0, 0, &result);
+    CHECK(result.iterations == 0 && result.max == 0);
+}
+
+static void test_measure (void) {
+    uint32_t ns = 50000;
+    bench_t timed = {"wait", NULL, wait, &ns, 10};
+    bench_t setup = {"setup", slow_setup, nothing, NULL, 0};
+    bench_t many = {"many", NULL, nothing, NULL, BENCH_ITERATIONS + 1};
+    bench_result_t result;
+
+    CHECK(bench_init());
+    CHECK(bench_clock_hz() == 1000000000);
+    CHECK(bench_overhead() < 100000);
+
+    // One call to warm up, then the iterations asked for
+    runs = 0;
+    bench_measure(&timed, &result);
+    CHECK(runs == 11 && result.iterations == 10);
+    CHECK(result.min >= ns - bench_overhead());
+    CHECK(result.min <= result.median && result.median <= result.max);
+
+    // Setup runs before every call and isn't timed
+    setups = runs = 0;
+    bench_measure(&setup, &result);
+    CHECK(setups == BENCH_ITERATIONS + 1 && runs == BENCH_ITERATIONS + 1);
+    CHECK(result.median < 100000);
+
+    bench_measure(&many, &result);
+    CHECK(result.iterations == BENCH_ITERATIONS);
+}
+
+static void test_report (void) {
+    static const bench_t benches[] = {
+        {"first", NULL, nothing, NULL, 3},
+        {"second", NULL, nothing, NULL, 0},
+    };
+    char text[512], platform[16], name[16];
+    unsigned long hz, ticks, min, median, max;
+    unsigned count, iterations;
+    FILE* saved = stdout;
+    FILE* out = tmpfile();
+    char* line;
+    size_t len;
+
+    stdout = out;
+    bench_run(benches, 2);
+    bench_print("free text");
+    fflush(out);
+    stdout = saved;
+
+    rewind(out);
+    len = fread(text, 1, sizeof(text) - 1, out);
+    fclose(out);
+    text[len] = '\0';
+
+    line = strtok(text, "\n");
+    CHECK(line && sscanf(line, "bench-start,%15[^,],%lu,%lu", platform, &hz, &ticks) == 3);
+    CHECK(strcmp(platform, "host") == 0 && hz == 1000000000 && ticks == bench_overhead());
+
+    line = strtok(NULL, "\n");
+    CHECK(line && sscanf(line, "bench,%15[^,],%u,%lu,%lu,%lu", name, &iterations,
+                         &min, &median, &max) == 5);
+    CHECK(strcmp(name, "first") == 0 && iterations == 3);
+    CHECK(min <= median && median <= max);
+
+    line = strtok(NULL, "\n");
+    CHECK(line && strncmp(line, "bench,second,64,", 16) == 0);
+    line = strtok(NULL, "\n");
+    CHECK(line && sscanf(line, "bench-end,%u", &count) == 1 && count == 2);
+    line = strtok(NULL, "\n");
+    CHECK(line && strcmp(line, "free text") == 0);
+}
+
+int main (void) {
+    test_summarize();
+    test_measure();
+    test_report();
+
+    printf("bench: %s\n", failures ? "FAILED" : "OK");
+    return failures != 0;
+}
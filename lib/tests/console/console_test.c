@@ -0,0 +1,435 @@
+// Host test for console.c. First the pieces on their own: the perfect hash,
+// argument parsing, completion and the TX ring. Then the console serves one
+// end of a pty from a thread, the way it would serve a UART, and the other
+// end drives it like a factory test rig: hundreds of commands, one at a time
+// and pipelined, checking every answer.
+
+#define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "console.h"
+
+#define RIG_COMMANDS 500
+
+static int failures = 0;
+
+#define CHECK(cond) do {                                              \
+    if (!(cond)) {                                                    \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+        failures++;                                                   \
+    }                                                                 \
+} while (0)
+
+static console_t console;
+
+// What the last command got
+static console_arg_t got_args[CONSOLE_MAX_ARGS];
+static uint8_t got_argc;
+static int got_calls;
+
+static void cmd_record (console_t* c, const console_arg_t* args, uint8_t argc) {
+    memcpy(got_args, args, argc * sizeof(args[0]));
+    got_argc = argc;
+    got_calls++;
+}
+
+static void cmd_fail (console_t* c, const console_arg_t* args, uint8_t argc) {
+    console_error(c, "no such sensor %lu", (unsigned long) args[0].u);
+}
+
+static void cmd_add (console_t* c, const console_arg_t* args, uint8_t argc) {
+    console_printf(c, "%ld\r\n", (long) args[0].i + args[1].i);
+}
+
+static const console_command_t commands[] = {
+    {"led",      cmd_record, "u|u",  "led <index> [on]"},
+    {"set",      cmd_record, "si",   "set <name> <value>"},
+    {"add",      cmd_add,    "ii",   "add <a> <b>"},
+    {"echo",     cmd_record, "r",    "echo <text>"},
+    {"sensor",   cmd_fail,   "u",    "sensor <index>"},
+    {"reset",    cmd_record, "",     NULL},
+    {"radio",    cmd_record, "s|uu", "radio <on|off> [channel] [power]"},
+    {"read",     cmd_record, "u|u",  "read <address> [length]"},
+    {"write",    cmd_record, "uu",   "write <address> <value>"},
+    {"version",  cmd_record, "",     NULL},
+    {"serial",   cmd_record, "",     NULL},
+    {"adc",      cmd_record, "u",    NULL},
+    {"gpio",     cmd_record, "uu",   NULL},
+    {"calibrate",cmd_record, "|u",   NULL},
+    {"sleep",    cmd_record, "u",    NULL},
+    {"temp",     cmd_record, "",     NULL},
+    {"flash",    cmd_record, "s|u",  NULL},
+    {"stop",     cmd_record, "",     NULL},
+    CONSOLE_BUILTIN_COMMANDS,
+};
+
+// Output collected from the console
+static char out[8192];
+static size_t out_len;
+static int writes;
+static uint16_t write_limit;    // take at most this much per write, 0 for all
+
+static uint16_t collect (void* ctx, const uint8_t* data, uint16_t len) {
+    if (write_limit && len > write_limit) len = write_limit;
+    if (out_len + len < sizeof(out)) {
+        memcpy(out + out_len, data, len);
+        out_len += len;
+        out[out_len] = '\0';
+    }
+    writes++;
+    return len;
+}
+
+static void reset_output (void) {
+    out_len = 0;
+    out[0] = '\0';
+    writes = 0;
+}
+
+static void send (const char* text) {
+    reset_output();
+    console_input(&console, text, strlen(text));
+}
+
+static uint32_t fake_us;
+
+static uint32_t fake_clock (void) {
+    return fake_us += 7;
+}
+
+static void test_hash (void) {
+    static const console_command_t twice[] = {
+        {"on",  cmd_record, "", NULL},
+        {"off", cmd_record, "", NULL},
+        {"on",  cmd_record, "", NULL},
+    };
+    static console_command_t many[CONSOLE_MAX_COMMANDS];
+    static char names[CONSOLE_MAX_COMMANDS][8];
+    console_t other;
+
+    CHECK(console_init(&console, commands, CONSOLE_NUM_COMMANDS(commands), collect, NULL) == 0);
+    for (uint8_t i = 0; i < CONSOLE_NUM_COMMANDS(commands); i++) {
+        const char* name = commands[i].name;
+        CHECK(console_find(&console, name, strlen(name)) == &commands[i]);
+    }
+    CHECK(console_find(&console, "le", 2) == NULL);
+    CHECK(console_find(&console, "leds", 4) == NULL);
+    CHECK(console_find(&console, "", 0) == NULL);
+    CHECK(console_find(&console, "ledx", 3) == &commands[0]);
+
+    CHECK(console_init(&other, twice, 3, collect, NULL) == -1);
+    CHECK(console_init(&other, twice, 2, collect, NULL) == 0);
+
+    // A full table of similar names
+    for (uint8_t i = 0; i < CONSOLE_MAX_COMMANDS; i++) {
+        snprintf(names[i], sizeof(names[i]), "cmd%u", i);
+        many[i].name    = names[i];
+        many[i].handler = cmd_record;
+        many[i].args    = "";
+    }
+    CHECK(console_init(&other, many, CONSOLE_MAX_COMMANDS, collect, NULL) == 0);
+    for (uint8_t i = 0; i < CONSOLE_MAX_COMMANDS; i++) {
+        CHECK(console_find(&other, names[i], strlen(names[i])) == &many[i]);
+    }
+}
+
+static void test_args (void) {
+    console_init(&console, commands, CONSOLE_NUM_COMMANDS(commands), collect, NULL);
+
+    got_calls = 0;
+    send("led 3\r\n");
+    CHECK(got_calls == 1 && got_argc == 1 && got_args[0].u == 3);
+    CHECK(strcmp(out, "ok\r\n") == 0);
+
+    send("  led   0x1F  1  \n");
+    CHECK(got_argc == 2 && got_args[0].u == 31 && got_args[1].u == 1);
+
+    send("set gain -2147483648\r");
+    CHECK(got_argc == 2 && strcmp(got_args[0].s, "gain") == 0 && got_args[1].i == INT32_MIN);
+    CHECK(strcmp(out, "ok\r\n") == 0);
+
+    send("add 40 2\r\n");
+    CHECK(strcmp(out, "42\r\nok\r\n") == 0);
+
+    send("echo  hello  there \r\n");
+    CHECK(got_argc == 1 && strcmp(got_args[0].s, "hello  there ") == 0);
+
+    send("radio on\r\n");
+    CHECK(got_argc == 1 && strcmp(got_args[0].s, "on") == 0);
+    send("radio on 11 4\r\n");
+    CHECK(got_argc == 3 && got_args[1].u == 11 && got_args[2].u == 4);
+
+    got_calls = 0;
+    send("led\r\n");
+    CHECK(strcmp(out, "error: usage: led <index> [on]\r\n") == 0);
+    send("led 1 2 3\r\n");
+    CHECK(strcmp(out, "error: usage: led <index> [on]\r\n") == 0);
+    send("led 1x\r\n");
+    CHECK(strcmp(out, "error: bad number '1x'\r\n") == 0);
+    send("led 4294967296\r\n");
+    CHECK(strncmp(out, "error: bad number", 17) == 0);
+    send("set gain 2147483648\r\n");
+    CHECK(strncmp(out, "error: bad number", 17) == 0);
+    send("led -1\r\n");
+    CHECK(strncmp(out, "error: bad number", 17) == 0);
+    send("reset now\r\n");
+    CHECK(strcmp(out, "error: usage: reset\r\n") == 0);
+    send("blink 3\r\n");
+    CHECK(strcmp(out, "error: unknown command 'blink'\r\n") == 0);
+    CHECK(got_calls == 0);
+
+    send("sensor 9\r\n");
+    CHECK(strcmp(out, "error: no such sensor 9\r\n") == 0);
+
+    // \r\n is one line ending, blank lines are ignored
+    send("\r\n\r\n   \r\n");
+    CHECK(out_len == 0);
+
+    // Too long
+    {
+        char line[CONSOLE_LINE_SIZE + 10];
+        memset(line, 'a', sizeof(line));
+        console_input(&console, line, sizeof(line));
+        send("\r\n");
+        CHECK(strcmp(out, "error: line too long\r\n") == 0);
+        send("led 2\r\n");
+        CHECK(strcmp(out, "ok\r\n") == 0);
+    }
+}
+
+static void test_output (void) {
+    char batch[1024] = "";
+
+    console_init(&console, commands, CONSOLE_NUM_COMMANDS(commands), collect, NULL);
+
+    // A batch of commands is answered in one write
+    for (int i = 0; i < 20; i++) strcat(batch, "add 1 1\r\n");
+    send(batch);
+    CHECK(writes == 1);
+    CHECK(out_len == 20 * strlen("2\r\nok\r\n"));
+
+    // More than the TX ring holds, through a writer that takes little at a
+    // time: nothing may be lost or reordered
+    write_limit = 7;
+    batch[0] = '\0';
+    for (int i = 0; i < 60; i++) {
+        char line[32];
+        snprintf(line, sizeof(line), "add %d 1000\r\n", i);
+        strcat(batch, line);
+    }
+    send(batch);
+    write_limit = 0;
+    {
+        char expect[2048] = "";
+        for (int i = 0; i < 60; i++) {
+            char line[32];
+            snprintf(line, sizeof(line), "%d\r\nok\r\n", i + 1000);
+            strcat(expect, line);
+        }
+        CHECK(strcmp(out, expect) == 0);
+    }
+    CHECK(console.tx_len == 0);
+
+    send("help\r\n");
+    CHECK(strstr(out, "led          led <index> [on]\r\n") != NULL);
+    CHECK(strstr(out, "\r\nok\r\n") != NULL);
+}
+
+static void test_stats (void) {
+    console_init(&console, commands, CONSOLE_NUM_COMMANDS(commands), collect, NULL);
+    console.clock = fake_clock;
+
+    send("led 1\r\nled 2\r\nadd 1 2\r\n");
+    CHECK(console.stats[0].count == 2 && console.stats[0].total_us == 14 && console.stats[0].max_us == 7);
+    CHECK(console.stats[2].count == 1);
+    CHECK(console.stats[1].count == 0);
+
+    send("stats\r\n");
+    CHECK(strncmp(out, "led          2 7 7\r\nadd          1 7 7\r\n", 40) == 0);
+}
+
+static void test_completion (void) {
+    console_init(&console, commands, CONSOLE_NUM_COMMANDS(commands), collect, NULL);
+    console.echo = true;
+
+    // Unique: the whole name and a space
+    send("ver\t");
+    CHECK(strcmp(out, "ver" "sion ") == 0);
+    send("\r");
+    CHECK(strcmp(out, "\r\nok\r\n> ") == 0);
+
+    // Ambiguous: as far as it goes, then the list
+    send("ca\t");
+    CHECK(strcmp(out, "ca" "librate ") == 0);
+    send("\b\b\b\b\b\b\b\b\b\b\r");
+    send("s\t");
+    CHECK(strcmp(out, "s\r\nset sensor serial sleep stop stats \r\n> s") == 0);
+    send("e\t");
+    CHECK(strcmp(out, "e\r\nset sensor serial \r\n> se") == 0);
+    send("n\t");
+    CHECK(strcmp(out, "n" "sor ") == 0);
+    send("\b\b\b\b\b\b\b\r");
+
+    // Only the command name completes
+    send("led 1\t\r");
+    CHECK(strcmp(out, "led 1\r\nok\r\n> ") == 0);
+    send("zz\t\r");
+    CHECK(strcmp(out, "zz\r\nerror: unknown command 'zz'\r\n> ") == 0);
+}
+
+
+/******************************************************************************
+ * The console on a pty
+ ******************************************************************************/
+
+static volatile int serving;
+
+static uint16_t pty_write (void* ctx, const uint8_t* data, uint16_t len) {
+    ssize_t done = write(*(int*) ctx, data, len);
+    return done > 0 ? done : 0;
+}
+
+static uint32_t host_clock (void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000u + now.tv_nsec / 1000;
+}
+
+static void* serve (void* arg) {
+    int fd = *(int*) arg;
+    char buf[64];
+
+    console_init(&console, commands, CONSOLE_NUM_COMMANDS(commands), pty_write, arg);
+    console.clock = host_clock;
+
+    while (serving) {
+        struct pollfd p = {fd, POLLIN, 0};
+        if (poll(&p, 1, 20) <= 0) continue;
+
+        ssize_t len = read(fd, buf, sizeof(buf));
+        if (len > 0) console_input(&console, buf, len);
+    }
+    return NULL;
+}
+
+// Read until `count` lines ending in ok or error have come back
+static int read_answers (int fd, int count, char* text, size_t size) {
+    size_t len = 0;
+    int answers = 0;
+
+    while (answers < count) {
+        struct pollfd p = {fd, POLLIN, 0};
+        if (poll(&p, 1, 2000) <= 0) return -1;
+
+        ssize_t n = read(fd, text + len, size - 1 - len);
+        if (n <= 0) return -1;
+        len += n;
+        text[len] = '\0';
+
+        answers = 0;
+        for (char* s = text; (s = strstr(s, "\r\n")) != NULL; s += 2) {
+            char* line = s;
+            while (line > text && line[-1] != '\n') line--;
+            if (strncmp(line, "ok", 2) == 0 || strncmp(line, "error", 5) == 0) answers++;
+        }
+    }
+    return answers;
+}
+
+static double seconds (void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void test_pty (void) {
+    static char text[RIG_COMMANDS * 16];
+    struct termios raw;
+    pthread_t thread;
+    int master, slave;
+    double start, one_by_one, pipelined;
+    int bad = 0;
+
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    CHECK(master >= 0);
+    if (master < 0) return;
+    grantpt(master);
+    unlockpt(master);
+    slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    CHECK(slave >= 0);
+    if (slave < 0) return;
+
+    // Like a UART: no echo or line editing by the tty
+    tcgetattr(slave, &raw);
+    cfmakeraw(&raw);
+    tcsetattr(slave, TCSANOW, &raw);
+
+    serving = 1;
+    pthread_create(&thread, NULL, serve, &slave);
+
+    // One command at a time, waiting for each answer
+    start = seconds();
+    for (int i = 0; i < RIG_COMMANDS; i++) {
+        char cmd[32], expect[32];
+        int len = snprintf(cmd, sizeof(cmd), "add %d %d\r\n", i, -2 * i);
+
+        snprintf(expect, sizeof(expect), "%d\r\nok\r\n", -i);
+        if (write(master, cmd, len) != len ||
+            read_answers(master, 1, text, sizeof(text)) != 1 ||
+            strcmp(text, expect) != 0) {
+            bad++;
+        }
+    }
+    one_by_one = seconds() - start;
+    CHECK(bad == 0);
+
+    // All at once, with a failing command mixed in
+    {
+        static char batch[RIG_COMMANDS * 16];
+        size_t len = 0;
+
+        for (int i = 0; i < RIG_COMMANDS; i++) {
+            len += sprintf(batch + len, i == RIG_COMMANDS / 2 ? "sensor %d\r\n" : "led %d\r\n", i);
+        }
+        start = seconds();
+        CHECK(write(master, batch, len) == (ssize_t) len);
+        CHECK(read_answers(master, RIG_COMMANDS, text, sizeof(text)) == RIG_COMMANDS);
+        pipelined = seconds() - start;
+        CHECK(strstr(text, "error: no such sensor 250\r\n") != NULL);
+    }
+
+    serving = 0;
+    pthread_join(thread, NULL);
+
+    CHECK(console.stats[2].count == RIG_COMMANDS);
+    CHECK(console.stats[0].count == RIG_COMMANDS - 1);
+    printf("console over a pty: %d commands one by one %.1f us each, pipelined %.1f us each; "
+           "add runs in %lu us on average\n",
+           RIG_COMMANDS, one_by_one * 1e6 / RIG_COMMANDS, pipelined * 1e6 / RIG_COMMANDS,
+           (unsigned long) (console.stats[2].total_us / console.stats[2].count));
+
+    close(slave);
+    close(master);
+}
+
+int main (int argc, char** argv) {
+    test_hash();
+    test_args();
+    test_output();
+    test_stats();
+    test_completion();
+    test_pty();
+
+    printf("console: %s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
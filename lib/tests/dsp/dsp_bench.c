@@ -0,0 +1,118 @@
+// Speed of the dsp.c blocks on the host, in samples per second. On a PC
+// this is the plain C path; the numbers are for comparing changes, not for
+// guessing the time on a Cortex-M. The bytes a window of features takes
+// against the raw samples is printed too.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "dsp.h"
+
+#define SAMPLES (1 << 20)
+
+static q15_t input[SAMPLES] __attribute__ ((aligned (4)));
+static q15_t output[SAMPLES] __attribute__ ((aligned (4)));
+static volatile uint32_t sink;
+
+static double now (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report (const char* name, double seconds) {
+    printf("%-28s %8.1f Msamples/s\n", name, SAMPLES / seconds / 1e6);
+}
+
+static void bench_fir (uint16_t taps, uint8_t factor) {
+    static q15_t coeffs[64];
+    static q15_t state[DSP_FIR_STATE_LEN(64)];
+    char name[40];
+    dsp_fir_t fir;
+    double start;
+
+    for (uint16_t i = 0; i < taps; i++) coeffs[i] = 32767 / taps;
+    dsp_fir_init(&fir, coeffs, taps, factor, state);
+
+    start = now();
+    for (uint32_t i = 0; i < SAMPLES; i += 256) {
+        sink += dsp_fir(&fir, input + i, 256, output + i);
+    }
+    snprintf(name, sizeof(name), "fir %u taps, / %u", taps, factor);
+    report(name, now() - start);
+}
+
+static void bench_iir (void) {
+    static const dsp_biquad_t stages[2] = {
+        {DSP_Q14(0.0201), DSP_Q14(0.0402), DSP_Q14(0.0201), DSP_Q14(1.5610), DSP_Q14(-0.6414)},
+        {DSP_Q14(1.0), DSP_Q14(1.99), DSP_Q14(1.0), DSP_Q14(1.7199), DSP_Q14(-0.8204)},
+    };
+    dsp_biquad_state_t state[2];
+    dsp_iir_t iir;
+    double start;
+
+    dsp_iir_init(&iir, stages, 2, 4, state);
+    start = now();
+    for (uint32_t i = 0; i < SAMPLES; i += 256) {
+        sink += dsp_iir(&iir, input + i, 256, output + i);
+    }
+    report("iir 2 biquads, / 4", now() - start);
+}
+
+static void bench_window (void) {
+    dsp_features_t features[8];
+    dsp_window_t window;
+    double start;
+
+    dsp_window_init(&window, 100);
+    start = now();
+    for (uint32_t i = 0; i < SAMPLES; i += 256) {
+        sink += dsp_window(&window, input + i, 256, features, 8);
+    }
+    report("window of 100", now() - start);
+    printf("%-28s %8u bytes instead of %u\n", "  features of a window", (unsigned) sizeof(dsp_features_t), 100 * 2);
+}
+
+static void bench_peaks (void) {
+    uint16_t peaks[64];
+    double start = now();
+
+    for (uint32_t i = 0; i < SAMPLES; i += 256) {
+        sink += dsp_peaks(input + i, 256, 16000, 8, peaks, 64);
+    }
+    report("peaks", now() - start);
+}
+
+static void bench_fft (uint16_t n) {
+    static q15_t magnitude[DSP_FFT_MAX / 2];
+    char name[40];
+    double start = now();
+
+    for (uint32_t i = 0; i < SAMPLES; i += n) {
+        dsp_rfft(input + i, n);
+        dsp_rfft_magnitude(input + i, n, magnitude);
+        sink += magnitude[1];
+    }
+    snprintf(name, sizeof(name), "rfft %u + magnitude", n);
+    report(name, now() - start);
+}
+
+int main (int argc, char** argv) {
+    srand(1);
+    for (uint32_t i = 0; i < SAMPLES; i++) input[i] = (rand() & 0xFFFF) - 32768;
+
+    bench_fir(8, 1);
+    bench_fir(31, 4);
+    bench_fir(64, 8);
+    bench_iir();
+    bench_window();
+    bench_peaks();
+
+    // These overwrite the input
+    bench_fft(64);
+    bench_fft(256);
+    bench_fft(1024);
+    return 0;
+}
@@ -0,0 +1,309 @@
+// Host test for dsp.c. Every block is checked bit for bit against a plain
+// reference written the obvious way with 64 bit integers, fed in chunks of
+// random size. The FFT is checked against a double precision DFT.
+//
+// The FNV hashes of each block's output on a fixed input are compared
+// with the ones below, so running this with the SIMD code (on an
+// nRF52) shows the same results as the plain C.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dsp.h"
+
+#define SAMPLES 4000
+
+// Output hashes of the FIR, IIR, window and FFT blocks on the test signal
+static const uint32_t golden[7] = {
+    0x99914042, 0xae71e281, 0xc79b5456, 0xc68b4d22, 0x0b1309d6, 0x242cb107, 0x8394741c,
+};
+
+static int failures = 0;
+
+#define CHECK(cond) do {                                              \
+    if (!(cond)) {                                                    \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+        failures++;                                                   \
+    }                                                                 \
+} while (0)
+
+static uint32_t seed = 12345;
+
+static uint32_t next_random (void) {
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 8;
+}
+
+// A couple of tones and noise, with some full scale samples
+static void make_signal (q15_t* x, uint16_t count) {
+    for (uint16_t i = 0; i < count; i++) {
+        double v = 0.4 * sin(i * 0.05) + 0.3 * sin(i * 0.9) + ((int32_t)(next_random() % 8192) - 4096) / 32768.0;
+        x[i] = (q15_t) lrint(v * 32767);
+        if (i % 997 == 0) x[i] = (i & 1) ? DSP_Q15_MIN : DSP_Q15_MAX;
+    }
+}
+
+static uint32_t hash (const q15_t* x, uint32_t count, uint32_t h) {
+    for (uint32_t i = 0; i < count; i++) {
+        h = (h ^ (uint16_t) x[i]) * 16777619u;
+    }
+    return h;
+}
+
+static q15_t saturate (int64_t v) {
+    return v > 32767 ? 32767 : v < -32768 ? -32768 : (q15_t) v;
+}
+
+static q15_t signal_in[SAMPLES];
+
+static const q15_t lowpass[31] = {
+    -120, -180, -130, 80, 400, 650, 560, -40, -1000, -1800, -1700, -100, 2900, 6600, 9800, 11000,
+    9800, 6600, 2900, -100, -1700, -1800, -1000, -40, 560, 650, 400, 80, -130, -180, -120,
+};
+
+static const q15_t skewed[6] = {DSP_Q15(0.9), DSP_Q15(-0.7), DSP_Q15(0.5), DSP_Q15(0.2), DSP_Q15(-0.999), DSP_Q15(0.999)};
+
+static uint32_t test_fir (const q15_t* coeffs, uint16_t taps, uint8_t factor) {
+    static q15_t out[SAMPLES + 1];
+    static q15_t buf[SAMPLES];
+    q15_t state[DSP_FIR_STATE_LEN(31)];
+    dsp_fir_t fir;
+    uint16_t produced = 0, done = 0, bad = 0;
+
+    dsp_fir_init(&fir, coeffs, taps, factor, state);
+    memcpy(buf, signal_in, sizeof(buf));
+
+    // In place, in chunks of random size
+    while (done < SAMPLES) {
+        uint16_t chunk = 1 + next_random() % 90;
+        if (chunk > SAMPLES - done) chunk = SAMPLES - done;
+        uint16_t n = dsp_fir(&fir, buf + done, chunk, buf + done);
+        memcpy(out + produced, buf + done, n * sizeof(q15_t));
+        produced += n;
+        done += chunk;
+    }
+
+    CHECK(produced == (SAMPLES + factor - 1) / factor);
+    for (uint16_t i = 0; i < produced; i++) {
+        int32_t n = i * factor;
+        int64_t acc = 0;
+        for (int32_t k = 0; k < taps; k++) {
+            int32_t j = n - (taps - 1) + k;
+            if (j >= 0) acc += (int64_t) coeffs[k] * signal_in[j];
+        }
+        if (out[i] != saturate(acc >> 15)) bad++;
+    }
+    CHECK(bad == 0);
+    return hash(out, produced, 2166136261u);
+}
+
+static uint32_t test_iir (void) {
+    // Butterworth low pass at fs/20, two sections, then decimated by 4
+    static const dsp_biquad_t stages[2] = {
+        {DSP_Q14(0.0201), DSP_Q14(0.0402), DSP_Q14(0.0201), DSP_Q14(1.5610), DSP_Q14(-0.6414)},
+        {DSP_Q14(1.0), DSP_Q14(2.0 - 1.0 / 16384), DSP_Q14(1.0), DSP_Q14(1.7199), DSP_Q14(-0.8204)},
+    };
+    static q15_t out[SAMPLES];
+    dsp_biquad_state_t state[2];
+    dsp_biquad_state_t ref[2];
+    dsp_iir_t iir;
+    uint16_t produced = 0, done = 0, bad = 0, expected = 0;
+
+    dsp_iir_init(&iir, stages, 2, 4, state);
+    while (done < SAMPLES) {
+        uint16_t chunk = 1 + next_random() % 70;
+        if (chunk > SAMPLES - done) chunk = SAMPLES - done;
+        produced += dsp_iir(&iir, signal_in + done, chunk, out + produced);
+        done += chunk;
+    }
+    CHECK(produced == SAMPLES / 4);
+
+    memset(ref, 0, sizeof(ref));
+    for (uint16_t i = 0; i < SAMPLES; i++) {
+        q15_t y = signal_in[i];
+        for (int s = 0; s < 2; s++) {
+            const dsp_biquad_t* c = &stages[s];
+            int64_t acc = (int64_t) c->b0 * y + (int64_t) c->b1 * ref[s].x1 + (int64_t) c->b2 * ref[s].x2 +
+                          (int64_t) c->a1 * ref[s].y1 + (int64_t) c->a2 * ref[s].y2;
+            q15_t x = y;
+            y = saturate(acc >> 14);
+            ref[s].x2 = ref[s].x1;
+            ref[s].x1 = x;
+            ref[s].y2 = ref[s].y1;
+            ref[s].y1 = y;
+        }
+        if (i % 4 == 0) {
+            if (out[expected] != y) bad++;
+            expected++;
+        }
+    }
+    CHECK(bad == 0);
+    return hash(out, produced, 2166136261u);
+}
+
+static void reference_features (const q15_t* x, uint16_t count, dsp_features_t* f) {
+    int64_t total = 0;
+    uint64_t squares = 0;
+
+    f->min = 32767;
+    f->max = -32768;
+    for (uint16_t i = 0; i < count; i++) {
+        if (x[i] < f->min) f->min = x[i];
+        if (x[i] > f->max) f->max = x[i];
+        total += x[i];
+        squares += (int64_t) x[i] * x[i];
+    }
+    f->mean = (q15_t) floor((double) total / count);
+    f->rms  = (q15_t) floor(sqrt((double) (squares / count)));
+}
+
+static uint32_t test_window (void) {
+    dsp_features_t out[SAMPLES / 50 + 1];
+    dsp_features_t expect;
+    dsp_window_t window;
+    uint16_t produced = 0, done = 0, bad = 0;
+
+    dsp_window_init(&window, 50);
+    while (done < SAMPLES) {
+        uint16_t chunk = 1 + next_random() % 130;
+        if (chunk > SAMPLES - done) chunk = SAMPLES - done;
+        produced += dsp_window(&window, signal_in + done, chunk, out + produced, SAMPLES / 50 + 1 - produced);
+        done += chunk;
+    }
+    CHECK(produced == SAMPLES / 50);
+
+    for (uint16_t i = 0; i < produced; i++) {
+        reference_features(signal_in + i * 50, 50, &expect);
+        if (memcmp(&out[i], &expect, sizeof(expect)) != 0) bad++;
+    }
+    CHECK(bad == 0);
+
+    // Whole buffer helpers, and a negative mean that must round down
+    {
+        static const q15_t neg[3] = {-1, -1, 0};
+        dsp_features_t f;
+
+        dsp_features(signal_in, SAMPLES, &f);
+        reference_features(signal_in, SAMPLES, &expect);
+        CHECK(memcmp(&f, &expect, sizeof(f)) == 0);
+        CHECK(dsp_rms(signal_in, SAMPLES) == expect.rms);
+        CHECK(dsp_rms(signal_in + 1, 7) == dsp_isqrt(((int64_t) signal_in[1] * signal_in[1] + (int64_t) signal_in[2] * signal_in[2] +
+                                                      (int64_t) signal_in[3] * signal_in[3] + (int64_t) signal_in[4] * signal_in[4] +
+                                                      (int64_t) signal_in[5] * signal_in[5] + (int64_t) signal_in[6] * signal_in[6] +
+                                                      (int64_t) signal_in[7] * signal_in[7]) / 7));
+        dsp_features(neg, 3, &f);
+        CHECK(f.mean == -1 && f.min == -1 && f.max == 0 && f.rms == 0);
+    }
+
+    CHECK(dsp_isqrt(0) == 0);
+    CHECK(dsp_isqrt(15) == 3 && dsp_isqrt(16) == 4);
+    CHECK(dsp_isqrt(0xFFFFFFFFFFFFFFFFull) == 0xFFFFFFFFu);
+    CHECK(dsp_isqrt((uint64_t) 1073741824 * 2) == 46340);
+
+    return hash((const q15_t*) out, produced * 4, 2166136261u);
+}
+
+static void test_peaks (void) {
+    static const q15_t x[] = {0, 5, 3, 3, 9, 9, 2, 1, 7, 0, 6, 8, 8, 8, 1, 0};
+    uint16_t peaks[8];
+
+    CHECK(dsp_peaks(x, sizeof(x) / 2, 4, 1, peaks, 8) == 4);
+    CHECK(peaks[0] == 1 && peaks[1] == 4 && peaks[2] == 8 && peaks[3] == 11);
+    CHECK(dsp_peaks(x, sizeof(x) / 2, 6, 1, peaks, 8) == 3);
+    CHECK(dsp_peaks(x, sizeof(x) / 2, 4, 5, peaks, 8) == 2);
+    CHECK(peaks[0] == 1 && peaks[1] == 8);
+    CHECK(dsp_peaks(x, sizeof(x) / 2, 4, 1, peaks, 2) == 2);
+    CHECK(dsp_peaks(x, 2, 0, 1, peaks, 8) == 0);
+}
+
+static uint32_t test_fft (uint16_t n) {
+    static q15_t data[DSP_FFT_MAX] __attribute__ ((aligned (4)));
+    static q15_t magnitude[DSP_FFT_MAX / 2];
+    double worst = 0;
+    uint32_t h;
+
+    memcpy(data, signal_in, n * sizeof(q15_t));
+    dsp_rfft(data, n);
+    h = hash(data, n, 2166136261u);
+
+    for (uint16_t k = 0; k <= n / 2; k++) {
+        double re = 0, im = 0, got_re, got_im;
+
+        for (uint16_t i = 0; i < n; i++) {
+            re += signal_in[i] * cos(2 * M_PI * k * i / n);
+            im -= signal_in[i] * sin(2 * M_PI * k * i / n);
+        }
+        re /= n;
+        im /= n;
+
+        if (k == 0) {
+            got_re = data[0];
+            got_im = 0;
+        } else if (k == n / 2) {
+            got_re = data[1];
+            got_im = 0;
+        } else {
+            got_re = data[2 * k];
+            got_im = data[2 * k + 1];
+        }
+        if (fabs(got_re - re) > worst) worst = fabs(got_re - re);
+        if (fabs(got_im - im) > worst) worst = fabs(got_im - im);
+    }
+
+    // Each of the log2(n) halvings truncates, which costs up to an LSB
+    CHECK(worst <= log2(n) + 1);
+
+    dsp_rfft_magnitude(data, n, magnitude);
+    CHECK(magnitude[0] == abs(data[0]));
+    CHECK(magnitude[3] == (q15_t) dsp_isqrt((int64_t) data[6] * data[6] + (int64_t) data[7] * data[7]));
+
+    return h;
+}
+
+static void test_fft_tone (void) {
+    static q15_t data[256] __attribute__ ((aligned (4)));
+    static q15_t magnitude[128];
+    uint16_t peak = 0;
+
+    // Half scale at bin 20 shows up as a quarter (X/n, split between +-20)
+    for (uint16_t i = 0; i < 256; i++) {
+        data[i] = (q15_t) lrint(16384 * cos(2 * M_PI * 20 * i / 256));
+    }
+    dsp_rfft(data, 256);
+    dsp_rfft_magnitude(data, 256, magnitude);
+    for (uint16_t k = 1; k < 128; k++) {
+        if (magnitude[k] > magnitude[peak]) peak = k;
+    }
+    CHECK(peak == 20);
+    CHECK(abs(magnitude[20] - 8192) <= 8);
+    CHECK(magnitude[19] <= 8 && magnitude[21] <= 8);
+}
+
+int main (int argc, char** argv) {
+    uint32_t hashes[7];
+
+    make_signal(signal_in, SAMPLES);
+
+    hashes[0] = test_fir(lowpass, 31, 4);
+    hashes[1] = test_fir(skewed, 6, 1);
+    hashes[2] = test_fir(skewed, 5, 3);
+    hashes[3] = test_iir();
+    hashes[4] = test_window();
+    test_peaks();
+    hashes[5] = test_fft(8);
+    hashes[6] = test_fft(1024);
+    test_fft_tone();
+
+    for (int i = 0; i < 7; i++) {
+        if (hashes[i] != golden[i]) {
+            printf("block %d: hash 0x%08x, expected 0x%08x\n", i, hashes[i], golden[i]);
+            failures++;
+        }
+    }
+
+    printf("dsp: %s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,16 @@
+// Host board for running mem-ffs against the RAM disk in ramdisk.c. The
+// card pins go nowhere and MISO always reads high, so busy waits finish.
+#pragma once
+
+#include <stdint.h>
+
+#define SPI_SCK_PIN   0
+#define SPI_MOSI_PIN  1
+#define SPI_MISO_PIN  2
+#define SPI_CS_PIN    3
+#define CD_PIN        4
+#define SD_ENABLE_PIN 5
+
+static inline void nrf_gpio_pin_set (uint32_t pin) { (void)pin; }
+static inline void nrf_gpio_pin_clear (uint32_t pin) { (void)pin; }
+static inline uint32_t nrf_gpio_pin_read (uint32_t pin) { (void)pin; return 1; }
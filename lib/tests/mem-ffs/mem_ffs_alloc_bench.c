@@ -0,0 +1,99 @@
+// Cost of finding free clusters in mem-ffs, on a RAM disk fragmented by
+// deleting every other one of many small files. Build it with and without
+// -DFFS_FREE_CLUSTER_CACHE=8 and compare.
+//
+// FAT sector reads are what the allocator costs on a card; the time on the
+// host is mostly the rest of mem-ffs.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "board.h"
+#include "mem-mmcsd.h"
+#include "mem-ffs.h"
+#include "ramdisk.h"
+
+#define DISK_SECTORS 65536
+#define SMALL_FILES  400
+#define SMALL_SIZE   8192
+#define LOG_SIZE     (4 * 1024 * 1024)
+#define CHUNK        512
+
+static uint8_t buf[SMALL_SIZE];
+
+static double now (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t fat_entry (uint32_t cluster) {
+    uint32_t size;
+    const uint8_t* p = ramdisk_image(&size) + fat1_start_sector * 512 + cluster * 4;
+    return (p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24) & 0x0fffffff;
+}
+
+static void run (uint8_t spc) {
+    ramdisk_stats_t scan, w;
+    FFS_FILE* f;
+    char name[16];
+    uint32_t cluster, clusters = 0, fragments = 1;
+    double t;
+
+    // Fragment the disk
+    ramdisk_format(DISK_SECTORS, spc);
+    for (int i = 0; i < SMALL_FILES; i++) {
+        sprintf(name, "F%03d.BIN", i);
+        f = ffs_fopen(name, "w");
+        ffs_fwrite(buf, 1, SMALL_SIZE, f);
+        ffs_fclose(f);
+    }
+    for (int i = 0; i < SMALL_FILES; i += 2) {
+        sprintf(name, "F%03d.BIN", i);
+        ffs_remove(name);
+    }
+
+    // Give the background scan its main loop passes
+    ramdisk_reset_stats();
+    for (DWORD i = 0; i < sectors_per_fat + 2; i++) ffs_process();
+    ramdisk_get_stats(&scan);
+
+    // Append a log
+    ramdisk_reset_stats();
+    t = now();
+    f = ffs_fopen("LOG.BIN", "w");
+    for (int done = 0; done < LOG_SIZE; done += CHUNK) {
+        ffs_fwrite(buf, 1, CHUNK, f);
+    }
+    ffs_fclose(f);
+    t = now() - t;
+    ramdisk_get_stats(&w);
+
+    f = ffs_fopen("LOG.BIN", "r");
+    for (cluster = f->current_cluster; cluster >= 2 && cluster < 0x0ffffff7; cluster = fat_entry(cluster)) {
+        if (fat_entry(cluster) < 0x0ffffff7 && fat_entry(cluster) != cluster + 1) fragments++;
+        clusters++;
+    }
+    ffs_fclose(f);
+
+    printf("%2d sect/cluster  scan %4u FAT rd   log: %5.0f FAT rd /MB %5.2f FAT rd /cluster %5.0f FAT wr /MB  %4u fragments  %6.1f MB/s\n",
+           spc, scan.fat_reads,
+           w.fat_reads * 1048576.0 / LOG_SIZE, (double)w.fat_reads / clusters,
+           w.fat_writes * 1048576.0 / LOG_SIZE, fragments, LOG_SIZE / t / 1e6);
+}
+
+int main (int argc, char** argv) {
+    for (unsigned i = 0; i < sizeof(buf); i++) buf[i] = rand();
+
+#ifdef FFS_FREE_CLUSTER_CACHE
+    printf("free cluster cache, %d runs\n", FFS_FREE_CLUSTER_CACHE);
+#else
+    printf("no free cluster cache\n");
+#endif
+    run(1);
+    run(4);
+    run(8);
+    return 0;
+}
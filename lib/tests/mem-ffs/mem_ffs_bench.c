@@ -0,0 +1,78 @@
+// Write and read a file through mem-ffs on the RAM disk, with fwrite/fread
+// and a byte at a time, and count what reaches the card.
+//
+// The host time mostly shows the per byte overhead. On the nRF the sector
+// counts matter more: every sector read or write is ~520 bytes on the SPI
+// bus plus the card's own busy time.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "mem-ffs.h"
+#include "ramdisk.h"
+
+#define DISK_SECTORS 65536
+#define FILE_SIZE    (4 * 1024 * 1024)
+
+static uint8_t buf[8192];
+
+static double now (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void run (const char* name, int chunk, int bytewise) {
+    ramdisk_stats_t w, r;
+    double tw, tr;
+    FFS_FILE* f;
+    int i;
+
+    ramdisk_format(DISK_SECTORS, 8);
+
+    tw = now();
+    f = ffs_fopen("BENCH.BIN", "w");
+    for (int done = 0; done < FILE_SIZE; done += chunk) {
+        if (bytewise) {
+            for (i = 0; i < chunk; i++) ffs_fputc(buf[i], f);
+        } else {
+            ffs_fwrite(buf, 1, chunk, f);
+        }
+    }
+    ffs_fclose(f);
+    tw = now() - tw;
+    ramdisk_get_stats(&w);
+    ramdisk_reset_stats();
+
+    tr = now();
+    f = ffs_fopen("BENCH.BIN", "r");
+    for (int done = 0; done < FILE_SIZE; done += chunk) {
+        if (bytewise) {
+            for (i = 0; i < chunk; i++) buf[i] = ffs_fgetc(f);
+        } else {
+            ffs_fread(buf, 1, chunk, f);
+        }
+    }
+    ffs_fclose(f);
+    tr = now() - tr;
+    ramdisk_get_stats(&r);
+
+    printf("%-9s %5d  write %7.1f MB/s %5.0f rd %5.0f wr /MB   read %7.1f MB/s %5.0f rd /MB\n",
+           name, chunk,
+           FILE_SIZE / tw / 1e6, w.sector_reads * 1048576.0 / FILE_SIZE, w.sector_writes * 1048576.0 / FILE_SIZE,
+           FILE_SIZE / tr / 1e6, r.sector_reads * 1048576.0 / FILE_SIZE);
+}
+
+int main (int argc, char** argv) {
+    static const int chunks[] = {16, 64, 512, 4096};
+
+    for (unsigned i = 0; i < sizeof(buf); i++) buf[i] = rand();
+
+    for (unsigned c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+        run("bytewise", chunks[c], 1);
+        run("block", chunks[c], 0);
+    }
+    return 0;
+}
@@ -0,0 +1,207 @@
+// Host test for the mem-ffs free cluster cache (FFS_FREE_CLUSTER_CACHE).
+// Built with a small cache so runs get dropped and split. The disk is
+// fragmented first, then files are written with the background scan
+// running, clusters released part way through and several files growing
+// at once. Afterwards every file must read back intact and no cluster may
+// belong to two files or to none.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "board.h"
+#include "mem-mmcsd.h"
+#include "mem-ffs.h"
+#include "ramdisk.h"
+
+#define DISK_SECTORS 8192
+#define SMALL_FILES  40
+#define SMALL_SIZE   1536
+#define BIG_SIZE     100000
+
+static uint8_t data[BIG_SIZE];
+static uint8_t readback[BIG_SIZE];
+static uint8_t owner[DISK_SECTORS];
+static int     failures = 0;
+
+#define CHECK(cond) do {                                              \
+    if (!(cond)) {                                                    \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+        failures++;                                                   \
+    }                                                                 \
+} while (0)
+
+static uint32_t fat_entry (uint32_t cluster) {
+    uint32_t size;
+    const uint8_t* p = ramdisk_image(&size) + fat1_start_sector * 512 + cluster * 4;
+    return (p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24) & 0x0fffffff;
+}
+
+static void drain (void) {
+    for (DWORD i = 0; i < sectors_per_fat + 2; i++) ffs_process();
+}
+
+static void small_name (char* name, int i) {
+    sprintf(name, "F%02d.BIN", i);
+}
+
+static void write_file (const char* name, const uint8_t* buf, int len) {
+    FFS_FILE* f = ffs_fopen(name, "w");
+    CHECK(f != NULL);
+    CHECK(ffs_fwrite(buf, 1, len, f) == len);
+    CHECK(ffs_fclose(f) == 0);
+}
+
+// Read a file back and claim its clusters, returns the number of fragments
+static int check_file (const char* name, const uint8_t* expect, int len, uint8_t id) {
+    FFS_FILE* f = ffs_fopen(name, "r");
+    uint32_t cluster;
+    int fragments = 1;
+
+    CHECK(f != NULL);
+    if (f == NULL) return 0;
+
+    memset(readback, 0, len);
+    cluster = f->current_cluster;
+    CHECK(ffs_fread(readback, 1, len, f) == len);
+    CHECK(memcmp(readback, expect, len) == 0);
+    ffs_fclose(f);
+
+    while (cluster >= 2 && cluster < 0x0ffffff7) {
+        uint32_t next = fat_entry(cluster);
+
+        CHECK(owner[cluster] == 0);
+        owner[cluster] = id;
+        if (next < 0x0ffffff7 && next != cluster + 1) fragments++;
+        cluster = next;
+    }
+    return fragments;
+}
+
+// Every cluster in use in the FAT has to be one claimed by check_file()
+// or part of the root directory
+static void check_no_leaks (void) {
+    uint32_t clusters = (DISK_SECTORS - data_area_start_sector) / sectors_per_cluster + 2;
+
+    for (uint32_t c = 2; c >= 2 && c < 0x0ffffff7; c = fat_entry(c)) {
+        CHECK(owner[c] == 0);
+        owner[c] = 0xff;
+    }
+    for (uint32_t c = 2; c < clusters; c++) {
+        if (fat_entry(c) != 0 && owner[c] == 0) {
+            printf("  cluster %u used but not in any file\n", c);
+            failures++;
+        }
+    }
+}
+
+// Fill the disk with small files and delete every other one, leaving
+// holes of SMALL_SIZE
+static void fragment (uint8_t spc) {
+    char name[16];
+
+    ramdisk_format(DISK_SECTORS, spc);
+    drain();
+
+    for (int i = 0; i < SMALL_FILES; i++) {
+        small_name(name, i);
+        write_file(name, data + i, SMALL_SIZE);
+    }
+    for (int i = 0; i < SMALL_FILES; i += 2) {
+        small_name(name, i);
+        CHECK(ffs_remove(name) == 0);
+    }
+}
+
+static void check_small_files (void) {
+    char name[16];
+
+    for (int i = 1; i < SMALL_FILES; i += 2) {
+        small_name(name, i);
+        check_file(name, data + i, SMALL_SIZE, i);
+    }
+}
+
+// One big file written once the scan has finished lands in a single run
+static void test_contiguous (uint8_t spc) {
+    memset(owner, 0, sizeof(owner));
+    fragment(spc);
+    drain();
+
+    write_file("BIG.BIN", data, BIG_SIZE);
+
+    check_small_files();
+    CHECK(check_file("BIG.BIN", data, BIG_SIZE, 200) == 1);
+    check_no_leaks();
+}
+
+// Two files growing together while the scan runs, with holes opened up
+// behind the scan part way through
+static void test_interleaved (uint8_t spc) {
+    FFS_FILE* a;
+    FFS_FILE* b;
+    char name[16];
+    int chunk = 700;
+
+    memset(owner, 0, sizeof(owner));
+    fragment(spc);
+
+    a = ffs_fopen("A.BIN", "w");
+    b = ffs_fopen("B.BIN", "w");
+    for (int done = 0; done < BIG_SIZE / 2; done += chunk) {
+        CHECK(ffs_fwrite(data + done, 1, chunk, a) == chunk);
+        ffs_process();
+        CHECK(ffs_fwrite(data + BIG_SIZE / 2 + done, 1, chunk, b) == chunk);
+        ffs_process();
+
+        if (done == 20 * chunk) {
+            small_name(name, 3);
+            CHECK(ffs_remove(name) == 0);
+            small_name(name, 35);
+            CHECK(ffs_remove(name) == 0);
+        }
+    }
+    CHECK(ffs_fclose(a) == 0);
+    CHECK(ffs_fclose(b) == 0);
+
+    for (int i = 1; i < SMALL_FILES; i += 2) {
+        if (i == 3 || i == 35) continue;
+        small_name(name, i);
+        check_file(name, data + i, SMALL_SIZE, i);
+    }
+    check_file("A.BIN", data, BIG_SIZE / 2 / chunk * chunk, 200);
+    check_file("B.BIN", data + BIG_SIZE / 2, BIG_SIZE / 2 / chunk * chunk, 201);
+    check_no_leaks();
+}
+
+// Running out of cached runs falls back to searching the FAT
+static void test_fill_disk (void) {
+    FFS_FILE* f;
+    int chunk = 4096, total = 0;
+
+    memset(owner, 0, sizeof(owner));
+    fragment(1);
+    drain();
+
+    f = ffs_fopen("FULL.BIN", "w");
+    while (ffs_fwrite(data, 1, chunk, f) == chunk) total += chunk;
+    ffs_fclose(f);
+
+    check_small_files();
+    CHECK(total > (DISK_SECTORS - data_area_start_sector - SMALL_FILES * SMALL_SIZE / 512) * 512 * 9 / 10);
+}
+
+int main (int argc, char** argv) {
+    srand(2);
+    for (int i = 0; i < BIG_SIZE; i++) data[i] = rand();
+
+    test_contiguous(1);
+    test_contiguous(4);
+    test_interleaved(1);
+    test_interleaved(4);
+    test_fill_disk();
+
+    printf("mem_ffs_cache: %s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
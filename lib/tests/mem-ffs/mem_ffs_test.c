@@ -0,0 +1,167 @@
+// Host test for the mem-ffs fwrite/fread block paths. Every run is done
+// twice, once with fwrite/fread and once a byte at a time through
+// fputc/fgetc (which is what fwrite/fread used to do), and the two disk
+// images must come out identical.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mem-ffs.h"
+#include "ramdisk.h"
+
+#define DISK_SECTORS 8192
+#define DATA_SIZE    20000
+
+static uint8_t data[DATA_SIZE];
+static uint8_t readback[DATA_SIZE];
+static uint8_t expect[DATA_SIZE];
+static uint8_t* reference;
+static int     failures = 0;
+
+#define CHECK(cond) do {                                              \
+    if (!(cond)) {                                                    \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+        failures++;                                                   \
+    }                                                                 \
+} while (0)
+
+static int bytewise = 0;
+
+static int do_write (FFS_FILE* f, const uint8_t* buf, int len) {
+    if (!bytewise) return ffs_fwrite(buf, 1, len, f);
+
+    for (int i = 0; i < len; i++) {
+        if (ffs_fputc(buf[i], f) == FFS_EOF) return i;
+    }
+    return len;
+}
+
+static int do_read (FFS_FILE* f, uint8_t* buf, int len) {
+    if (!bytewise) return ffs_fread(buf, 1, len, f);
+
+    for (int i = 0; i < len; i++) {
+        int c = ffs_fgetc(f);
+        if (c == FFS_EOF) return i;
+        buf[i] = c;
+    }
+    return len;
+}
+
+// Write DATA_SIZE bytes in `chunk` sized pieces, overwrite part of it
+// through r+, append some more, then read it all back in `rchunk` pieces
+static void scenario (uint8_t spc, int chunk, int rchunk) {
+    FFS_FILE* f;
+    int done, n;
+
+    ramdisk_format(DISK_SECTORS, spc);
+
+    f = ffs_fopen("LOG.TXT", "w");
+    CHECK(f != NULL);
+    for (done = 0; done < DATA_SIZE - 3000; done += n) {
+        n = chunk;
+        if (n > DATA_SIZE - 3000 - done) n = DATA_SIZE - 3000 - done;
+        CHECK(do_write(f, data + done, n) == n);
+    }
+    CHECK(ffs_fclose(f) == 0);
+
+    // Overwrite from an odd offset across several sectors
+    memcpy(readback, data, DATA_SIZE);
+    f = ffs_fopen("LOG.TXT", "r+");
+    CHECK(ffs_fseek(f, 1000, FFS_SEEK_SET) == 0);
+    for (int i = 0; i < 2000; i++) readback[1000 + i] = ~data[i];
+    CHECK(do_write(f, readback + 1000, 2000) == 2000);
+    CHECK(ffs_fclose(f) == 0);
+
+    // And from a sector boundary
+    f = ffs_fopen("LOG.TXT", "r+");
+    CHECK(ffs_fseek(f, 4096, FFS_SEEK_SET) == 0);
+    for (int i = 0; i < 1024; i++) readback[4096 + i] = data[i] ^ 0x5a;
+    CHECK(do_write(f, readback + 4096, 1024) == 1024);
+    CHECK(ffs_fclose(f) == 0);
+
+    f = ffs_fopen("LOG.TXT", "a");
+    CHECK(do_write(f, data + DATA_SIZE - 3000, 3000) == 3000);
+    memcpy(readback + DATA_SIZE - 3000, data + DATA_SIZE - 3000, 3000);
+    CHECK(ffs_fclose(f) == 0);
+
+    memcpy(expect, readback, DATA_SIZE);
+    memset(readback, 0, DATA_SIZE);
+
+    f = ffs_fopen("LOG.TXT", "r");
+    CHECK(f != NULL);
+    for (done = 0; done < DATA_SIZE; done += n) {
+        n = rchunk;
+        if (n > DATA_SIZE - done) n = DATA_SIZE - done;
+        CHECK(do_read(f, readback + done, n) == n);
+    }
+    // Nothing past the end
+    CHECK(do_read(f, readback, 10) == 0);
+    CHECK(ffs_feof(f));
+    CHECK(ffs_fclose(f) == 0);
+    CHECK(memcmp(readback, expect, DATA_SIZE) == 0);
+}
+
+static void compare (uint8_t spc, int chunk, int rchunk) {
+    uint32_t size;
+    const uint8_t* image;
+    int before = failures;
+
+    bytewise = 1;
+    scenario(spc, chunk, rchunk);
+    image = ramdisk_image(&size);
+    reference = realloc(reference, size);
+    memcpy(reference, image, size);
+
+    bytewise = 0;
+    scenario(spc, chunk, rchunk);
+    image = ramdisk_image(&size);
+    CHECK(memcmp(reference, image, size) == 0);
+
+    if (failures != before) printf("  cluster %d sectors, chunk %d, read chunk %d\n", spc, chunk, rchunk);
+}
+
+// Reads that run into the end of the file stop there, with the item count
+static void test_short_read (void) {
+    FFS_FILE* f;
+    uint8_t buf[2048];
+
+    ramdisk_format(DISK_SECTORS, 1);
+    f = ffs_fopen("A.BIN", "w");
+    CHECK(ffs_fwrite(data, 1, 1500, f) == 1500);
+    ffs_fclose(f);
+
+    f = ffs_fopen("A.BIN", "r");
+    CHECK(ffs_fread(buf, 100, 20, f) == 15);
+    CHECK(memcmp(buf, data, 1500) == 0);
+    CHECK(ffs_feof(f));
+    ffs_fclose(f);
+
+    // Write only and read only files refuse the other direction
+    f = ffs_fopen("A.BIN", "r");
+    CHECK(ffs_fwrite(data, 1, 600, f) == 0);
+    CHECK(ffs_ferror(f));
+    ffs_fclose(f);
+    f = ffs_fopen("B.BIN", "w");
+    CHECK(ffs_fread(buf, 1, 600, f) == 0);
+    ffs_fclose(f);
+}
+
+int main (int argc, char** argv) {
+    static const int chunks[] = {1, 7, 100, 511, 512, 513, 1536, 4099, DATA_SIZE};
+    static const uint8_t spcs[] = {1, 4};
+
+    srand(1);
+    for (int i = 0; i < DATA_SIZE; i++) data[i] = rand();
+
+    for (unsigned s = 0; s < sizeof(spcs); s++) {
+        for (unsigned c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+            compare(spcs[s], chunks[c], chunks[(c + 3) % 9]);
+        }
+    }
+    test_short_read();
+
+    printf("mem_ffs: %s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1 @@
+// Stand-in for the nRF headers so mem-ffs builds on the host
@@ -0,0 +1,193 @@
+// RAM disk implementation of the mem-mmcsd.c interface
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MMCSD_C
+#include "board.h"
+#include "mem-mmcsd.h"
+#include "mem-ffs.h"
+
+#include "ramdisk.h"
+
+#define PARTITION_START  64
+#define RESERVED_SECTORS 32
+#define NUMBER_OF_FATS   2
+
+static uint8_t*        disk = NULL;
+static uint32_t        disk_sectors = 0;
+static ramdisk_stats_t stats;
+
+static int is_fat (DWORD lba) {
+    return lba >= fat1_start_sector && lba < data_area_start_sector;
+}
+
+static void put16 (uint8_t* p, uint32_t v) { p[0] = v; p[1] = v >> 8; }
+static void put32 (uint8_t* p, uint32_t v) { put16(p, v); put16(p + 2, v >> 16); }
+
+static void set_fat (uint32_t fat_sectors, uint32_t cluster, uint32_t value) {
+    for (int i = 0; i < NUMBER_OF_FATS; i++) {
+        uint32_t lba = PARTITION_START + RESERVED_SECTORS + i * fat_sectors;
+        put32(disk + lba * 512 + cluster * 4, value);
+    }
+}
+
+void ramdisk_format (uint32_t sectors, uint8_t spc) {
+    uint32_t data_sectors = sectors - PARTITION_START - RESERVED_SECTORS;
+    uint32_t fat_sectors = 1, clusters = 0;
+    uint8_t* mbr;
+    uint8_t* boot;
+
+    // Grow the FAT until it covers every cluster left after it
+    for (;;) {
+        clusters = (data_sectors - NUMBER_OF_FATS * fat_sectors) / spc;
+        if ((clusters + 2) * 4 <= fat_sectors * 512) break;
+        fat_sectors++;
+    }
+
+    free(disk);
+    disk = calloc(sectors, 512);
+    disk_sectors = sectors;
+
+    mbr = disk;
+    mbr[446 + 4] = 0x0c;                           // FAT32 LBA
+    put32(mbr + 446 + 8, PARTITION_START);
+    put32(mbr + 446 + 12, sectors - PARTITION_START);
+    mbr[510] = 0x55;
+    mbr[511] = 0xaa;
+
+    boot = disk + PARTITION_START * 512;
+    memcpy(boot, "\xeb\x58\x90MSWIN4.1", 11);
+    put16(boot + 11, 512);
+    boot[13] = spc;
+    put16(boot + 14, RESERVED_SECTORS);
+    boot[16] = NUMBER_OF_FATS;
+    boot[21] = 0xf8;
+    put32(boot + 32, sectors - PARTITION_START);
+    put32(boot + 36, fat_sectors);
+    put32(boot + 44, 2);                           // root directory cluster
+    put16(boot + 48, 1);
+    boot[510] = 0x55;
+    boot[511] = 0xaa;
+
+    set_fat(fat_sectors, 0, 0x0ffffff8);
+    set_fat(fat_sectors, 1, 0x0fffffff);
+    set_fat(fat_sectors, 2, 0x0fffffff);           // root directory
+    for (uint32_t c = clusters + 2; c < fat_sectors * 128; c++) {
+        set_fat(fat_sectors, c, 0x0ffffff7);       // past the end of the disk
+    }
+
+    // What mem-mmcsd.c works out from the boot record
+    ffs_bytes_per_sector = 512;
+    sectors_per_cluster = spc;
+    disk_is_fat_32 = 1;
+    sectors_per_fat = fat_sectors;
+    fat1_start_sector = PARTITION_START + RESERVED_SECTORS;
+    data_area_start_sector = fat1_start_sector + NUMBER_OF_FATS * fat_sectors;
+    root_directory_start_sector_cluster = 2;
+    number_of_root_directory_sectors = 0;
+    active_fat_table_flags = 0x03;
+    last_found_free_cluster = 0;
+    ffs_card_write_protected = 0;
+    ffs_buffer_contains_lba = 0xffffffff;
+    ffs_buffer_needs_writing_to_card = 0;
+    memset(ffs_file, 0, sizeof(ffs_file));
+    ffs_card_ok = 1;
+#ifdef FFS_FREE_CLUSTER_CACHE
+    ffs_free_cache_reset();
+#endif
+
+    ramdisk_reset_stats();
+}
+
+const uint8_t* ramdisk_image (uint32_t* size) {
+    *size = disk_sectors * 512;
+    return disk;
+}
+
+void ramdisk_get_stats (ramdisk_stats_t* s) {
+    *s = stats;
+}
+
+void ramdisk_reset_stats (void) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+
+// The mem-mmcsd.c interface
+
+void ffs_process (void) {
+#ifdef FFS_FREE_CLUSTER_CACHE
+    if (disk) ffs_free_cache_process();
+#endif
+}
+void ffs_init (void) {}
+
+BYTE ffs_is_card_present (void) {
+    return 1;
+}
+
+void ffs_read_sector_to_buffer (DWORD sector_lba) {
+    if (ffs_buffer_contains_lba == sector_lba) return;
+
+    if (ffs_buffer_needs_writing_to_card) {
+        if (ffs_buffer_contains_lba != 0xffffffff) {
+            ffs_write_sector_from_buffer(ffs_buffer_contains_lba);
+        }
+        ffs_buffer_needs_writing_to_card = 0;
+    }
+
+    if (ffs_read_sector_to_ram(sector_lba, &FFS_DRIVER_GEN_512_BYTE_BUFFER[0])) {
+        ffs_buffer_contains_lba = sector_lba;
+    }
+}
+
+BYTE ffs_read_sector_to_ram (DWORD sector_lba, BYTE* destination) {
+    if (sector_lba >= disk_sectors) return 0;
+
+    memcpy(destination, disk + sector_lba * 512, 512);
+    stats.sector_reads++;
+    if (is_fat(sector_lba)) stats.fat_reads++;
+    return 1;
+}
+
+void ffs_write_sector_from_buffer (DWORD sector_lba) {
+    ffs_buffer_needs_writing_to_card = 0;
+    ffs_write_sector_from_ram(sector_lba, &FFS_DRIVER_GEN_512_BYTE_BUFFER[0]);
+}
+
+void ffs_write_sector_from_ram (DWORD sector_lba, BYTE* source) {
+    if (sector_lba >= disk_sectors || ffs_card_write_protected) return;
+
+    memcpy(disk + sector_lba * 512, source, 512);
+    stats.sector_writes++;
+    if (is_fat(sector_lba)) stats.fat_writes++;
+}
+
+BYTE ffs_write_byte (BYTE data) {
+    (void)data;
+    return 1;
+}
+
+WORD ffs_read_word (void) {
+    return 0xffff;
+}
+
+BYTE ffs_read_byte (void) {
+    return 0xff;
+}
+
+BYTE ffs_check_command_response_byte (BYTE mask, BYTE data_requried) {
+    (void)mask;
+    (void)data_requried;
+    return 1;
+}
+
+void ffs_read_block (BYTE* destination, WORD length) {
+    memset(destination, 0xff, length);
+}
+
+void ffs_write_block (BYTE* source, WORD length) {
+    (void)source;
+    (void)length;
+}
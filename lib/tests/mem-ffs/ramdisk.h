@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+// RAM disk standing in for mem-mmcsd.c, so mem-ffs runs on the host. The
+// disk holds one FAT32 partition and counts every sector that crosses the
+// "SPI bus".
+
+typedef struct {
+    uint32_t sector_reads;
+    uint32_t sector_writes;
+    uint32_t fat_reads;       // the part of the above that hit a FAT
+    uint32_t fat_writes;
+} ramdisk_stats_t;
+
+// Format a fresh disk of `sectors` 512 byte sectors and mount it the way
+// mem-mmcsd.c does after reading the boot record. ffs_process() then does
+// the same background work as on a card that stays inserted.
+void ramdisk_format(uint32_t sectors, uint8_t sectors_per_cluster);
+
+// The whole disk image, to compare two runs
+const uint8_t* ramdisk_image(uint32_t* size);
+
+void ramdisk_get_stats(ramdisk_stats_t* stats);
+void ramdisk_reset_stats(void);
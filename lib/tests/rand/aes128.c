@@ -0,0 +1,92 @@
+// AES-128 encryption in plain C, standing in for the ECB peripheral when
+// rand.c is built with RAND_HOST. Small and slow: the S-box is computed
+// once, and each round is done byte by byte as in FIPS-197.
+
+#include <stdint.h>
+#include <string.h>
+
+#include "rand.h"
+
+static uint8_t sbox[256];
+
+static uint8_t xtime (uint8_t x) {
+    return (uint8_t)((x << 1) ^ ((x & 0x80) ? 0x1B : 0));
+}
+
+static uint8_t rotl8 (uint8_t x, int n) {
+    return (uint8_t)((x << n) | (x >> (8 - n)));
+}
+
+// Walk p over the multiplicative group with 3 and q over it with 1/3, so q
+// is always p's inverse, and apply the affine map.
+static void make_sbox (void) {
+    uint8_t p = 1, q = 1;
+
+    do {
+        p = p ^ xtime(p);
+        q ^= q << 1;
+        q ^= q << 2;
+        q ^= q << 4;
+        if (q & 0x80) q ^= 0x09;
+        sbox[p] = q ^ rotl8(q, 1) ^ rotl8(q, 2) ^ rotl8(q, 3) ^ rotl8(q, 4) ^ 0x63;
+    } while (p != 1);
+    sbox[0] = 0x63;
+}
+
+static void expand_key (const uint8_t key[16], uint8_t round_keys[176]) {
+    uint8_t rcon = 1;
+
+    memcpy(round_keys, key, 16);
+    for (int i = 16; i < 176; i += 4) {
+        uint8_t t[4];
+
+        memcpy(t, &round_keys[i - 4], 4);
+        if (i % 16 == 0) {
+            uint8_t first = t[0];
+            t[0] = sbox[t[1]] ^ rcon;
+            t[1] = sbox[t[2]];
+            t[2] = sbox[t[3]];
+            t[3] = sbox[first];
+            rcon = xtime(rcon);
+        }
+        for (int j = 0; j < 4; j++) round_keys[i + j] = round_keys[i - 16 + j] ^ t[j];
+    }
+}
+
+void rand_host_aes (const uint8_t key[16], const uint8_t in[16], uint8_t out[16]) {
+    uint8_t round_keys[176];
+    uint8_t s[16];
+
+    if (sbox[0] == 0) make_sbox();
+    expand_key(key, round_keys);
+
+    for (int i = 0; i < 16; i++) s[i] = in[i] ^ round_keys[i];
+
+    for (int round = 1; round <= 10; round++) {
+        uint8_t t[16];
+
+        // SubBytes and ShiftRows; the state is column major
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 4; r++) {
+                t[c * 4 + r] = sbox[s[((c + r) % 4) * 4 + r]];
+            }
+        }
+
+        // MixColumns, except in the last round
+        if (round < 10) {
+            for (int c = 0; c < 4; c++) {
+                uint8_t* col = &t[c * 4];
+                uint8_t all = col[0] ^ col[1] ^ col[2] ^ col[3];
+                uint8_t first = col[0];
+
+                col[0] ^= all ^ xtime(col[0] ^ col[1]);
+                col[1] ^= all ^ xtime(col[1] ^ col[2]);
+                col[2] ^= all ^ xtime(col[2] ^ col[3]);
+                col[3] ^= all ^ xtime(col[3] ^ first);
+            }
+        }
+
+        for (int i = 0; i < 16; i++) s[i] = t[i] ^ round_keys[round * 16 + i];
+    }
+    memcpy(out, s, 16);
+}
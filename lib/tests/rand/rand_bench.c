@@ -0,0 +1,56 @@
+// Throughput and worst case latency of rand_get() on the host, per request
+// size. The plain C AES here is far slower than the ECB peripheral, so the
+// AES blocks per call are printed too: on a chip a call costs about that
+// many times 17 us (nRF51) or 7 us (nRF52), and never more, because it
+// never waits for entropy.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "rand.h"
+
+#define CALLS 20000
+
+static double now (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench (uint16_t len) {
+    static uint8_t buf[1024];
+    uint8_t entropy[RAND_SEED_LEN] = {0};
+    double start, worst = 0;
+    rand_stats_t stats;
+
+    rand_init();
+    rand_add_entropy(entropy, RAND_SEED_LEN);
+
+    start = now();
+    for (uint32_t i = 0; i < CALLS; i++) {
+        double call = now();
+
+        rand_get(buf, len);
+        call = now() - call;
+        if (call > worst) worst = call;
+
+        // A fresh seed always at hand, as with the RNG running
+        entropy[0] = i;
+        rand_add_entropy(entropy, RAND_SEED_LEN);
+    }
+
+    rand_get_stats(&stats);
+    printf("%4u bytes  %8.2f MB/s  worst %6.1f us  %5.2f AES blocks per call, %u reseeds\n",
+           len, (double) len * CALLS / (now() - start) / 1e6, worst * 1e6,
+           (double) stats.aes_blocks / CALLS, stats.reseeds);
+}
+
+int main (int argc, char** argv) {
+    bench(4);
+    bench(16);
+    bench(32);
+    bench(256);
+    bench(1024);
+    return 0;
+}
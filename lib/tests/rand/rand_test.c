@@ -0,0 +1,330 @@
+// Host test for rand.c, built with RAND_HOST and the plain C AES in
+// aes128.c. Checks the AES against FIPS-197, the generator bit for bit
+// against SP 800-90A written out the obvious way, the seeding and reseeding
+// rules, and then runs the usual quick statistical tests over a few MB of
+// output seeded from a deliberately poor source.
+//
+//   rand_test              run the tests
+//   rand_test --dump N     write N random bytes to stdout, for dieharder,
+//                          PractRand or ent
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rand.h"
+
+#define STAT_BYTES (4 << 20)
+
+static int failures = 0;
+
+#define CHECK(cond) do {                                              \
+    if (!(cond)) {                                                    \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+        failures++;                                                   \
+    }                                                                 \
+} while (0)
+
+static void hex (const char* text, uint8_t* out, int len) {
+    for (int i = 0; i < len; i++) {
+        sscanf(text + 2 * i, "%2hhx", &out[i]);
+    }
+}
+
+// Entropy that is anything but random, so the statistics are the DRBG's
+static void add_counter_entropy (uint8_t start) {
+    uint8_t seed[RAND_SEED_LEN];
+
+    for (int i = 0; i < RAND_SEED_LEN; i++) seed[i] = start + i;
+    rand_add_entropy(seed, RAND_SEED_LEN);
+}
+
+
+/******************************************************************************
+ * Reference CTR_DRBG, AES-128, no derivation function (SP 800-90A 10.2.1)
+ ******************************************************************************/
+
+typedef struct {
+    uint8_t key[16];
+    uint8_t v[16];
+} ref_drbg_t;
+
+static void ref_add_one (uint8_t v[16]) {
+    unsigned carry = 1;
+
+    for (int i = 15; i >= 0; i--) {
+        carry += v[i];
+        v[i] = carry & 0xFF;
+        carry >>= 8;
+    }
+}
+
+static void ref_update (ref_drbg_t* d, const uint8_t provided[32]) {
+    uint8_t temp[32];
+
+    ref_add_one(d->v);
+    rand_host_aes(d->key, d->v, temp);
+    ref_add_one(d->v);
+    rand_host_aes(d->key, d->v, temp + 16);
+    for (int i = 0; i < 32; i++) temp[i] ^= provided[i];
+    memcpy(d->key, temp, 16);
+    memcpy(d->v, temp + 16, 16);
+}
+
+static void ref_instantiate (ref_drbg_t* d, const uint8_t entropy[32]) {
+    memset(d, 0, sizeof(*d));
+    ref_update(d, entropy);
+}
+
+static void ref_generate (ref_drbg_t* d, uint8_t* out, int len) {
+    static const uint8_t zeros[32];
+    uint8_t block[16];
+
+    for (int i = 0; i < len; i += 16) {
+        ref_add_one(d->v);
+        rand_host_aes(d->key, d->v, block);
+        memcpy(out + i, block, len - i < 16 ? len - i : 16);
+    }
+    ref_update(d, zeros);
+}
+
+
+/******************************************************************************
+ * Tests
+ ******************************************************************************/
+
+static void test_aes (void) {
+    uint8_t key[16], in[16], expected[16], out[16];
+
+    // FIPS-197 appendix C.1
+    hex("000102030405060708090a0b0c0d0e0f", key, 16);
+    hex("00112233445566778899aabbccddeeff", in, 16);
+    hex("69c4e0d86a7b0430d8cdb78070b4c55a", expected, 16);
+    rand_host_aes(key, in, out);
+    CHECK(memcmp(out, expected, 16) == 0);
+
+    // Appendix B
+    hex("2b7e151628aed2a6abf7158809cf4f3c", key, 16);
+    hex("3243f6a8885a308d313198a2e0370734", in, 16);
+    hex("3925841d02dc09fbdc118597196a0b32", expected, 16);
+    rand_host_aes(key, in, out);
+    CHECK(memcmp(out, expected, 16) == 0);
+}
+
+static void test_not_ready (void) {
+    uint8_t buf[4] = {1, 2, 3, 4};
+    rand_stats_t stats;
+
+    rand_init();
+    CHECK(!rand_get(buf, sizeof(buf)));
+    CHECK(buf[0] == 1 && buf[3] == 4);
+
+    // One byte short of a seed is still not enough
+    for (int i = 0; i < RAND_SEED_LEN - 1; i++) rand_add_entropy((uint8_t*) &i, 1);
+    CHECK(!rand_get(buf, sizeof(buf)));
+
+    rand_add_entropy(buf, 1);
+    CHECK(rand_get(buf, sizeof(buf)));
+
+    rand_get_stats(&stats);
+    CHECK(stats.calls == 3);
+    CHECK(stats.not_ready == 2);
+    CHECK(stats.reseeds == 1);
+    CHECK(stats.bytes == 4);
+    CHECK(stats.entropy_bytes == RAND_SEED_LEN);
+}
+
+static void test_pool_full (void) {
+    uint8_t lots[RAND_POOL_SIZE * 2] = {0};
+    rand_stats_t stats;
+
+    rand_init();
+    rand_add_entropy(lots, sizeof(lots));
+    rand_get_stats(&stats);
+    CHECK(stats.entropy_bytes == RAND_POOL_SIZE);
+}
+
+// Every request length against the reference, across a reseed
+static void test_known (void) {
+    uint8_t seed[RAND_SEED_LEN], out[300], expected[300];
+    uint32_t since_reseed = 0;
+    rand_stats_t stats;
+    ref_drbg_t ref;
+
+    for (int i = 0; i < RAND_SEED_LEN; i++) seed[i] = i * 7 + 1;
+
+    rand_init();
+    rand_add_entropy(seed, RAND_SEED_LEN);
+    ref_instantiate(&ref, seed);
+
+    for (int len = 1; len <= 300; len += 13) {
+        CHECK(rand_get(out, len));
+        ref_generate(&ref, expected, len);
+        CHECK(memcmp(out, expected, len) == 0);
+        since_reseed += len;
+    }
+    CHECK(since_reseed >= RAND_RESEED_BYTES);
+
+    // Due for a reseed, but there is no entropy: keep going on the old seed
+    CHECK(rand_get(out, 16));
+    ref_generate(&ref, expected, 16);
+    CHECK(memcmp(out, expected, 16) == 0);
+
+    // With entropy the next request reseeds first
+    for (int i = 0; i < RAND_SEED_LEN; i++) seed[i] = 255 - i;
+    rand_add_entropy(seed, RAND_SEED_LEN);
+    CHECK(rand_get(out, 40));
+    ref_update(&ref, seed);
+    ref_generate(&ref, expected, 40);
+    CHECK(memcmp(out, expected, 40) == 0);
+
+    // And not again until RAND_RESEED_BYTES later
+    rand_add_entropy(seed, RAND_SEED_LEN);
+    CHECK(rand_get(out, 40));
+    ref_generate(&ref, expected, 40);
+    CHECK(memcmp(out, expected, 40) == 0);
+
+    rand_get_stats(&stats);
+    CHECK(stats.reseeds == 2);
+}
+
+// Same seed, same stream; one bit different, about half the bits differ
+static void test_seeds (void) {
+    static uint8_t a[4096], b[4096], c[4096];
+    uint8_t flip[RAND_SEED_LEN];
+    int differing = 0;
+
+    rand_init();
+    add_counter_entropy(0);
+    CHECK(rand_get(a, sizeof(a)));
+
+    rand_init();
+    add_counter_entropy(0);
+    CHECK(rand_get(b, sizeof(b)));
+    CHECK(memcmp(a, b, sizeof(a)) == 0);
+
+    for (int i = 0; i < RAND_SEED_LEN; i++) flip[i] = i;
+    flip[RAND_SEED_LEN - 1] ^= 1;
+    rand_init();
+    rand_add_entropy(flip, RAND_SEED_LEN);
+    CHECK(rand_get(c, sizeof(c)));
+    for (size_t i = 0; i < sizeof(a); i++) differing += __builtin_popcount(a[i] ^ c[i]);
+    CHECK(abs(differing - 4096 * 4) < 4 * 64);
+}
+
+
+/******************************************************************************
+ * Statistics
+ ******************************************************************************/
+
+// Runs of random request lengths, reseeding from a counter as it goes
+static void generate (uint8_t* out, uint32_t len) {
+    uint32_t done = 0;
+    uint8_t start = 0;
+    uint32_t lcg = 1;
+
+    rand_init();
+    add_counter_entropy(start++);
+    while (done < len) {
+        uint32_t n;
+
+        lcg = lcg * 1103515245u + 12345u;
+        n = (lcg >> 16) % 300 + 1;
+        if (n > len - done) n = len - done;
+        if (!rand_get(out + done, n)) {
+            CHECK(false);
+            return;
+        }
+        done += n;
+        add_counter_entropy(start++);
+    }
+}
+
+static void test_statistics (void) {
+    uint8_t* data = malloc(STAT_BYTES);
+    uint32_t counts[256] = {0};
+    uint64_t ones = 0, runs = 1;
+    double n_bits = STAT_BYTES * 8.0;
+    double chi = 0, expected = STAT_BYTES / 256.0;
+    double sum = 0, sum_sq = 0, sum_xy = 0;
+    rand_stats_t stats;
+
+    generate(data, STAT_BYTES);
+    rand_get_stats(&stats);
+    CHECK(stats.reseeds > STAT_BYTES / RAND_RESEED_BYTES / 2);
+
+    for (uint32_t i = 0; i < STAT_BYTES; i++) {
+        uint8_t byte = data[i];
+        uint8_t next = data[(i + 1) % STAT_BYTES];
+
+        counts[byte]++;
+        ones += __builtin_popcount(byte);
+
+        // Bit transitions within the byte and into the next one
+        runs += __builtin_popcount((byte ^ (byte >> 1)) & 0x7F);
+        if (i + 1 < STAT_BYTES) runs += (byte & 1) != (next >> 7);
+
+        sum    += byte;
+        sum_sq += (double) byte * byte;
+        sum_xy += (double) byte * next;
+    }
+
+    // Monobit: ones are binomial(n, 1/2), allow 5 sigma
+    double z_ones = (ones - n_bits / 2) / sqrt(n_bits / 4);
+    printf("  monobit          z = %6.2f\n", z_ones);
+    CHECK(fabs(z_ones) < 5);
+
+    // Runs: n - 1 transitions, each with probability 1/2
+    double z_runs = (runs - 1 - (n_bits - 1) / 2) / sqrt((n_bits - 1) / 4);
+    printf("  runs             z = %6.2f\n", z_runs);
+    CHECK(fabs(z_runs) < 5);
+
+    // Byte frequencies, 255 degrees of freedom: mean 255, sd 22.6
+    for (int i = 0; i < 256; i++) {
+        chi += (counts[i] - expected) * (counts[i] - expected) / expected;
+    }
+    printf("  chi-square bytes   %6.1f (255 dof)\n", chi);
+    CHECK(chi > 160 && chi < 370);
+
+    // Serial correlation of neighbouring bytes, sd 1/sqrt(n)
+    double n = STAT_BYTES;
+    double r = (n * sum_xy - sum * sum) / (n * sum_sq - sum * sum);
+    printf("  serial corr.     r = %9.6f\n", r);
+    CHECK(fabs(r) < 5 / sqrt(n));
+
+    free(data);
+}
+
+static int dump (long count) {
+    uint8_t buf[4096];
+
+    rand_init();
+    add_counter_entropy(0);
+    while (count > 0) {
+        int n = count < (long) sizeof(buf) ? count : (int) sizeof(buf);
+
+        rand_get(buf, n);
+        fwrite(buf, 1, n, stdout);
+        count -= n;
+        add_counter_entropy(count & 0xFF);
+    }
+    return 0;
+}
+
+int main (int argc, char** argv) {
+    if (argc == 3 && strcmp(argv[1], "--dump") == 0) {
+        return dump(atol(argv[2]));
+    }
+
+    test_aes();
+    test_not_ready();
+    test_pool_full();
+    test_known();
+    test_seeds();
+    test_statistics();
+
+    printf("rand: %s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,83 @@
+// RAM disk implementation of diskio.h, plus the bits of mmc_nrf.c that
+// simple_logger calls
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ff.h"
+#include "diskio.h"
+
+#include "ramdisk.h"
+
+static uint8_t*        disk = NULL;
+static uint32_t        disk_sectors = 0;
+static ramdisk_stats_t stats;
+
+void ramdisk_format (uint32_t sectors) {
+    FATFS fs;
+
+    free(disk);
+    disk = calloc(sectors, 512);
+    disk_sectors = sectors;
+
+    f_mount(&fs, "", 0);
+    f_mkfs("", 1, 4096);                           // 4 kB clusters like most cards
+    f_mount(NULL, "", 0);
+
+    ramdisk_reset_stats();
+}
+
+void ramdisk_get_stats (ramdisk_stats_t* s) {
+    *s = stats;
+}
+
+void ramdisk_reset_stats (void) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+
+// diskio.h
+
+DSTATUS disk_initialize (BYTE pdrv) {
+    return disk_status(pdrv);
+}
+
+DSTATUS disk_status (BYTE pdrv) {
+    return (pdrv == 0 && disk) ? 0 : STA_NOINIT;
+}
+
+DRESULT disk_read (BYTE pdrv, BYTE* buff, DWORD sector, UINT count) {
+    if (pdrv != 0 || sector + count > disk_sectors) return RES_PARERR;
+
+    memcpy(buff, disk + sector * 512, count * 512);
+    stats.sector_reads += count;
+    return RES_OK;
+}
+
+DRESULT disk_write (BYTE pdrv, const BYTE* buff, DWORD sector, UINT count) {
+    if (pdrv != 0 || sector + count > disk_sectors) return RES_PARERR;
+
+    memcpy(disk + sector * 512, buff, count * 512);
+    stats.sector_writes += count;
+    return RES_OK;
+}
+
+DRESULT disk_ioctl (BYTE pdrv, BYTE cmd, void* buff) {
+    switch (cmd) {
+    case CTRL_SYNC:
+        return RES_OK;
+    case GET_SECTOR_COUNT:
+        *(DWORD*)buff = disk_sectors;
+        return RES_OK;
+    case GET_BLOCK_SIZE:
+        *(DWORD*)buff = 1;
+        return RES_OK;
+    }
+    return RES_PARERR;
+}
+
+
+// mmc_nrf.c
+
+void disk_timerproc (void) {}
+void disk_restart (void) {}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+
+// RAM disk behind the chanfs diskio interface, in place of mmc_nrf.c, so
+// simple_logger runs on the host. Counts the sectors that would cross the
+// SPI bus.
+
+typedef struct {
+    uint32_t sector_reads;
+    uint32_t sector_writes;
+} ramdisk_stats_t;
+
+// Make a fresh, FAT formatted disk of `sectors` 512 byte sectors
+void ramdisk_format(uint32_t sectors);
+
+void ramdisk_get_stats(ramdisk_stats_t* stats);
+void ramdisk_reset_stats(void);
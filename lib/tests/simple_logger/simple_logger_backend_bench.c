@@ -0,0 +1,69 @@
+// Time simple_logger_log() itself, formatting and the backend call, with no
+// card behind it. Built with -DBACKEND_STDIO (a file in /tmp) and
+// -DBACKEND_FRAM (the FM25L04B mock, restarted whenever it fills up, and
+// counting the bytes that would cross the SPI bus).
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "simple_logger.h"
+#include "simple_logger_backend.h"
+
+#ifdef BACKEND_FRAM
+#include "simple_logger_fram.h"
+#include "fm25l04b_mock.h"
+
+static fm25l04b_t fram;
+static simple_logger_fram_t fram_log = {
+    .dev  = &fram,
+    .base = 0,
+    .size = FM25L04B_SIZE,
+};
+#define BACKEND (&simple_logger_fram_backend)
+#define CTX     (&fram_log)
+#define NAME    ""
+#else
+#define BACKEND (&simple_logger_stdio_backend)
+#define CTX     NULL
+#define NAME    "/tmp/simple_logger_bench.txt"
+#endif
+
+#define LINES 1000000
+
+static double now (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main (int argc, char** argv) {
+    double t;
+
+#ifdef BACKEND_FRAM
+    fm25l04b_init(&fram);
+#endif
+    simple_logger_init_backend(BACKEND, CTX, NAME, "w");
+
+    t = now();
+    for (uint32_t i = 0; i < LINES; i++) {
+        // ~40 bytes, a typical sensor line
+        if (simple_logger_log("%08u,%6d,%6d,%6d,%8u\n", i, i % 1000, -(int)(i % 777), 12345, i * 3) != SIMPLE_LOGGER_SUCCESS) {
+            // Only the FRAM fills up, start it over and log the line again
+            BACKEND->close(CTX);
+            BACKEND->open(CTX, NAME, true);
+            i--;
+        }
+    }
+    t = now() - t;
+    BACKEND->close(CTX);
+
+#ifdef BACKEND_FRAM
+    printf("fram:  %.0f ns per line on the host, %.1f bytes to the FRAM per line\n",
+           t / LINES * 1e9, (double)fm25l04b_mock_bytes_written / LINES);
+#else
+    remove(NAME);
+    printf("stdio: %.0f ns per line on the host\n", t / LINES * 1e9);
+#endif
+    return 0;
+}
@@ -0,0 +1,148 @@
+// Host test for the simple_logger backends that don't need chanfs. Built
+// once per backend with -DBACKEND_STDIO (a file in the current directory),
+// -DBACKEND_MBRAMFS (the stdio backend linked with mbramfs.c) or
+// -DBACKEND_FRAM (the FM25L04B mock). Logs a header and some lines, reads
+// them back, and checks that reopening appends where the log left off.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "simple_logger.h"
+#include "simple_logger_backend.h"
+
+#ifdef BACKEND_FRAM
+#include "simple_logger_fram.h"
+#include "fm25l04b_mock.h"
+
+static fm25l04b_t fram;
+static simple_logger_fram_t fram_log = {
+    .dev  = &fram,
+    .base = 16,
+    .size = 400,
+};
+#define BACKEND (&simple_logger_fram_backend)
+#define CTX     (&fram_log)
+#else
+#define BACKEND (&simple_logger_stdio_backend)
+#define CTX     NULL
+#endif
+
+#define NAME   "BACKEND.TXT"
+#define HEADER "line,value\n"
+
+static char expect[1024];
+static char readback[1024];
+static int  failures = 0;
+
+#define CHECK(cond) do {                                              \
+    if (!(cond)) {                                                    \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+        failures++;                                                   \
+    }                                                                 \
+} while (0)
+
+// What the medium holds, however the backend stores it
+static int read_log (void) {
+#ifdef BACKEND_FRAM
+    const uint8_t* p = fm25l04b_mock_mem + fram_log.base;
+    int len = p[2] | (p[3] << 8);
+
+    if ((p[0] | (p[1] << 8)) != SIMPLE_LOGGER_FRAM_MAGIC) return -1;
+    memcpy(readback, p + SIMPLE_LOGGER_FRAM_HEADER, len);
+#else
+    FILE* f = fopen(NAME, "r");
+    int len;
+
+    if (f == NULL) return -1;
+    len = fread(readback, 1, sizeof(readback) - 1, f);
+    fclose(f);
+#endif
+    readback[len] = '\0';
+    return len;
+}
+
+static void log_lines (int first, int n) {
+    char line[32];
+
+    for (int i = first; i < first + n; i++) {
+        sprintf(line, "%d,%d\n", i, i * 31);
+        strcat(expect, line);
+        CHECK(simple_logger_log("%d,%d\n", i, i * 31) == SIMPLE_LOGGER_SUCCESS);
+    }
+}
+
+int main (int argc, char** argv) {
+#ifdef BACKEND_FRAM
+    fm25l04b_mock_fill(0xA5);
+    fm25l04b_init(&fram);
+#endif
+
+    CHECK(simple_logger_init_backend(BACKEND, CTX, NAME, "x") == SIMPLE_LOGGER_BAD_PERMISSIONS);
+    CHECK(simple_logger_init_backend(BACKEND, CTX, NAME, "w") == SIMPLE_LOGGER_SUCCESS);
+    CHECK(simple_logger_init_backend(BACKEND, CTX, NAME, "w") == SIMPLE_LOGGER_ALREADY_INITIALIZED);
+
+    CHECK(simple_logger_log_header(HEADER) == SIMPLE_LOGGER_SUCCESS);
+    strcpy(expect, HEADER);
+    log_lines(0, 10);
+
+    // Every line is stored as soon as it is logged
+    CHECK(read_log() == (int)strlen(expect));
+    CHECK(strcmp(readback, expect) == 0);
+    CHECK(BACKEND->size(CTX) == strlen(expect));
+
+    // Reopening appends, and doesn't write the header again
+    CHECK(BACKEND->close(CTX) == 0);
+    CHECK(BACKEND->open(CTX, NAME, false) == 0);
+    CHECK(BACKEND->size(CTX) == strlen(expect));
+    log_lines(10, 10);
+    CHECK(read_log() == (int)strlen(expect));
+    CHECK(strcmp(readback, expect) == 0);
+
+#ifdef BACKEND_FRAM
+    // A reset part way through a line loses only that line
+    {
+        int before = strlen(expect);
+
+        fm25l04b_mock_cut_after(3);
+        CHECK(simple_logger_log("%d,%d\n", 9999, 9999) != SIMPLE_LOGGER_SUCCESS);
+        fm25l04b_mock_power_on();
+        CHECK(BACKEND->open(CTX, NAME, false) == 0);
+        CHECK(BACKEND->size(CTX) == (uint32_t)before);
+        log_lines(20, 5);
+        CHECK(read_log() == (int)strlen(expect));
+        CHECK(strcmp(readback, expect) == 0);
+    }
+
+    // Nothing is written outside the region
+    CHECK(fm25l04b_mock_mem[fram_log.base - 1] == 0xA5);
+    CHECK(fm25l04b_mock_mem[fram_log.base + fram_log.size] == 0xA5);
+
+    // Once the region is full logging fails and what is there stays intact
+    {
+        int i = 100;
+
+        while (strlen(expect) + 8 < fram_log.size - SIMPLE_LOGGER_FRAM_HEADER) {
+            log_lines(i++, 1);
+        }
+        CHECK(simple_logger_log("%s\n", "this line does not fit") != SIMPLE_LOGGER_SUCCESS);
+        CHECK(read_log() == (int)strlen(expect));
+        CHECK(strcmp(readback, expect) == 0);
+        CHECK(fm25l04b_mock_mem[fram_log.base + fram_log.size] == 0xA5);
+    }
+#endif
+
+    // "w" empties the log, a new header goes in
+    CHECK(BACKEND->close(CTX) == 0);
+    CHECK(BACKEND->open(CTX, NAME, true) == 0);
+    CHECK(BACKEND->size(CTX) == 0);
+    CHECK(read_log() == 0);
+
+    BACKEND->close(CTX);
+#ifndef BACKEND_FRAM
+    remove(NAME);
+#endif
+
+    printf("simple_logger_backend: %s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
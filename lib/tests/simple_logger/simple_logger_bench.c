@@ -0,0 +1,50 @@
+// Log 4 MB of short lines through simple_logger on the RAM disk and count
+// what reaches the card. Build it with and without
+// -DSIMPLE_LOGGER_PREALLOCATE=<bytes> and compare.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "ff.h"
+#include "simple_logger.h"
+#include "ramdisk.h"
+
+#define DISK_SECTORS 65535                // f_mkfs in R0.12 gets bigger FAT16 volumes wrong
+#define LOG_BYTES    (4 * 1024 * 1024)
+
+static double now (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main (int argc, char** argv) {
+    ramdisk_stats_t stats;
+    uint32_t logged = 0, lines = 0;
+    double t;
+
+    ramdisk_format(DISK_SECTORS);
+    simple_logger_init("LOG.TXT", "w");
+    ramdisk_reset_stats();
+
+    t = now();
+    while (logged < LOG_BYTES) {
+        // ~40 bytes, a typical sensor line
+        logged += 38;
+        simple_logger_log("%08u,%6d,%6d,%6d,%8u\n", lines, lines % 1000, -(int)(lines % 777), 12345, lines * 3);
+        lines++;
+    }
+    t = now() - t;
+    ramdisk_get_stats(&stats);
+
+#ifdef SIMPLE_LOGGER_PREALLOCATE
+    printf("preallocated %d bytes, checkpoint every %d bytes\n", SIMPLE_LOGGER_PREALLOCATE, SIMPLE_LOGGER_CHECKPOINT);
+#else
+    printf("no preallocation\n");
+#endif
+    printf("%u lines: %.2f sector reads, %.2f sector writes per line, %.0f kB/s on the host\n",
+           lines, (double)stats.sector_reads / lines, (double)stats.sector_writes / lines,
+           logged / t / 1e3);
+    return 0;
+}
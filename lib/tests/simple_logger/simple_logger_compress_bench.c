@@ -0,0 +1,185 @@
+// Compression ratio and speed of simple_logger_compress on sample traces.
+//
+// Text traces are compressed a line at a time with a flush after every
+// line, like simple_logger_lz_backend does, and again flushing only every
+// 4 kB. Without arguments it makes up a sensor CSV and a GPS NMEA trace,
+// otherwise every argument is a text file to use as a trace. The sensor
+// values are also logged as delta records, with and without the LZ on top.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "simple_logger_compress.h"
+
+#define TRACE_SIZE (4 * 1024 * 1024)
+#define VALUES     6
+
+static uint8_t  trace[TRACE_SIZE];
+static uint8_t  stream[TRACE_SIZE + TRACE_SIZE / 4];
+static uint8_t  decoded[TRACE_SIZE];
+static uint32_t stream_len;
+
+static double now (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int to_stream (void* ctx, const uint8_t* buf, uint32_t len) {
+    memcpy(stream + stream_len, buf, len);
+    stream_len += len;
+    return 0;
+}
+
+// Slowly changing sensor values: time in ms, temperature and humidity in
+// hundredths, pressure in Pa, and a noisy accelerometer
+static void sensor_values (uint32_t i, int32_t* v) {
+    v[0] = i * 100;
+    v[1] = 2150 + (int32_t)(i / 300) % 40 + rand() % 3;
+    v[2] = 4510 - (int32_t)(i / 500) % 60 + rand() % 5;
+    v[3] = 101325 + (int32_t)(i / 1000) % 20 - rand() % 3;
+    v[4] = rand() % 41 - 20;
+    v[5] = 1000 + rand() % 41 - 20;
+}
+
+static uint32_t make_sensor_trace (void) {
+    uint32_t len = 0;
+    int32_t v[VALUES];
+
+    for (uint32_t i = 0; len < TRACE_SIZE - 100; i++) {
+        sensor_values(i, v);
+        len += sprintf((char*)trace + len, "%u,%d.%02d,%d.%02d,%d,%d,%d\n",
+                       v[0], v[1] / 100, v[1] % 100, v[2] / 100, v[2] % 100, v[3], v[4], v[5]);
+    }
+    return len;
+}
+
+static uint32_t make_nmea_trace (void) {
+    uint32_t len = 0;
+
+    for (uint32_t i = 0; len < TRACE_SIZE - 200; i++) {
+        uint32_t s = 12 * 3600 + i;
+        uint32_t lat = 4217 * 10000 + 2810 + i / 7 + rand() % 3;
+        uint32_t lon = 8343 * 10000 + 7312 + i / 11 + rand() % 3;
+        char body[100];
+        uint8_t sum = 0;
+
+        sprintf(body, "GPRMC,%02u%02u%02u.00,A,%04u.%04u,N,%05u.%04u,W,0.%03u,%03u.%u,190217,,,A",
+                s / 3600 % 24, s / 60 % 60, s % 60, lat / 10000, lat % 10000,
+                lon / 10000, lon % 10000, rand() % 1000, rand() % 360, rand() % 10);
+        for (char* c = body; *c; c++) sum ^= *c;
+        len += sprintf((char*)trace + len, "$%s*%02X\r\n", body, sum);
+    }
+    return len;
+}
+
+static uint32_t load_trace (const char* path) {
+    FILE* f = fopen(path, "rb");
+    uint32_t len;
+
+    if (f == NULL) {
+        perror(path);
+        exit(1);
+    }
+    len = fread(trace, 1, TRACE_SIZE, f);
+    fclose(f);
+    return len;
+}
+
+// Compress trace[0, len), flushing at the end of each line or every
+// flush_bytes, returns the compressed size
+static uint32_t compress (uint32_t len, uint32_t flush_bytes, double* t) {
+    simple_logger_lz_t lz;
+    uint32_t start = 0, since_flush = 0;
+
+    stream_len = 0;
+    *t = now();
+    simple_logger_lz_reset(&lz, to_stream, NULL);
+    simple_logger_lz_header(&lz);
+    for (uint32_t i = 0; i < len; i++) {
+        if (trace[i] != '\n' && i != len - 1) continue;
+
+        simple_logger_lz_encode(&lz, trace + start, i + 1 - start);
+        since_flush += i + 1 - start;
+        start = i + 1;
+        if (since_flush >= flush_bytes) {
+            simple_logger_lz_flush(&lz);
+            since_flush = 0;
+        }
+    }
+    simple_logger_lz_flush(&lz);
+    *t = now() - *t;
+    return stream_len;
+}
+
+static void bench_text (const char* name, uint32_t len) {
+    uint32_t line, block;
+    double t_line, t_block, t_dec;
+    int32_t n;
+
+    line = compress(len, 1, &t_line);
+    block = compress(len, 4096, &t_block);
+
+    t_dec = now();
+    n = simple_logger_lz_decode(stream, stream_len, decoded, sizeof(decoded));
+    t_dec = now() - t_dec;
+    if (n != (int32_t)len || memcmp(decoded, trace, len) != 0) {
+        printf("%s: decoded differently!\n", name);
+        exit(1);
+    }
+
+    printf("%-20s %8u bytes  per line %5.1f%% %6.1f MB/s   per 4 kB %5.1f%% %6.1f MB/s   decode %6.1f MB/s\n",
+           name, len, 100.0 * line / len, len / t_line / 1e6,
+           100.0 * block / len, len / t_block / 1e6, len / t_dec / 1e6);
+}
+
+static void bench_records (void) {
+    simple_logger_delta_t delta;
+    simple_logger_lz_t lz;
+    uint8_t record[SIMPLE_LOGGER_DELTA_RECORD_MAX];
+    int32_t v[VALUES];
+    uint32_t records = 200000, delta_bytes = 0;
+    double t;
+
+    srand(1);
+    stream_len = 0;
+    simple_logger_delta_reset(&delta);
+    simple_logger_lz_reset(&lz, to_stream, NULL);
+    simple_logger_lz_header(&lz);
+
+    t = now();
+    for (uint32_t i = 0; i < records; i++) {
+        uint8_t len;
+
+        sensor_values(i, v);
+        len = simple_logger_delta_encode(&delta, v, VALUES, record);
+        delta_bytes += len;
+        simple_logger_lz_encode(&lz, record, len);
+        simple_logger_lz_flush(&lz);
+    }
+    t = now() - t;
+
+    printf("%-20s %8u bytes  delta %5.1f%%   delta+LZ per record %5.1f%%   %6.1f M records/s\n",
+           "sensor records", records * VALUES * 4,
+           100.0 * delta_bytes / (records * VALUES * 4),
+           100.0 * stream_len / (records * VALUES * 4), records / t / 1e6);
+}
+
+int main (int argc, char** argv) {
+    printf("window %d, lengths to %d, chain %d\n", SIMPLE_LOGGER_LZ_WINDOW,
+           (1 << SIMPLE_LOGGER_LZ_LENGTH_BITS) + 1, SIMPLE_LOGGER_LZ_CHAIN);
+
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) bench_text(argv[i], load_trace(argv[i]));
+        return 0;
+    }
+
+    srand(1);
+    bench_text("sensor csv", make_sensor_trace());
+    bench_text("gps nmea", make_nmea_trace());
+    bench_records();
+    return 0;
+}
@@ -0,0 +1,246 @@
+// Host test for simple_logger_compress. The LZ and the delta records must
+// decode to exactly what went in, however the input is split up and
+// wherever the stream is flushed or cut off. Then a log of records goes
+// through simple_logger, the LZ backend and the stdio backend, with one
+// failed write on the way, and has to read back complete.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simple_logger.h"
+#include "simple_logger_compress.h"
+
+#define DATA_SIZE 20000
+#define NAME      "COMPRESS.LZ"
+
+static uint8_t data[DATA_SIZE];
+static uint8_t stream[DATA_SIZE * 2];
+static uint8_t decoded[DATA_SIZE * 2];
+static uint32_t stream_len;
+static int     failures = 0;
+
+#define CHECK(cond) do {                                              \
+    if (!(cond)) {                                                    \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+        failures++;                                                   \
+    }                                                                 \
+} while (0)
+
+static int to_stream (void* ctx, const uint8_t* buf, uint32_t len) {
+    memcpy(stream + stream_len, buf, len);
+    stream_len += len;
+    return 0;
+}
+
+// Compress data[0, len) in chunks of up to max_chunk bytes, flushing after
+// a chunk with probability 1/flush_every, and check every flush point
+// decodes to what was compressed so far
+static void lz_round_trip (uint32_t len, uint32_t max_chunk, int flush_every) {
+    simple_logger_lz_t lz;
+    uint32_t done = 0;
+
+    stream_len = 0;
+    simple_logger_lz_reset(&lz, to_stream, NULL);
+    CHECK(simple_logger_lz_header(&lz) == 0);
+
+    while (done < len) {
+        uint32_t n = 1 + rand() % max_chunk;
+        if (n > len - done) n = len - done;
+
+        CHECK(simple_logger_lz_encode(&lz, data + done, n) == 0);
+        done += n;
+
+        if (rand() % flush_every == 0 || done == len) {
+            CHECK(simple_logger_lz_flush(&lz) == 0);
+            CHECK(simple_logger_lz_pending(&lz) == 0);
+            CHECK(simple_logger_lz_decode(stream, stream_len, decoded, sizeof(decoded)) == (int32_t)done);
+            CHECK(memcmp(decoded, data, done) == 0);
+        }
+    }
+
+    // Too small an output buffer is an error, not an overrun
+    if (len > 10) {
+        CHECK(simple_logger_lz_decode(stream, stream_len, decoded, len - 1) == -1);
+    }
+}
+
+static void test_lz (void) {
+    // Text much like a log
+    uint32_t len = 0;
+    for (int i = 0; len < DATA_SIZE - 64; i++) {
+        len += sprintf((char*)data + len, "%08u,%6d,%6d,%6d,%8u\n", i, i % 1000, -(i % 777), 12345, i * 3);
+    }
+    lz_round_trip(len, 40, 1);
+    lz_round_trip(len, 200, 5);
+    lz_round_trip(len, 1, 50);
+
+    // Runs, where copies overlap what they produce
+    memset(data, 'a', DATA_SIZE);
+    lz_round_trip(DATA_SIZE, 1000, 3);
+
+    // Nothing to find
+    for (int i = 0; i < DATA_SIZE; i++) data[i] = rand();
+    lz_round_trip(DATA_SIZE, 300, 4);
+
+    // A few symbols, lots of short matches at every distance
+    for (int i = 0; i < DATA_SIZE; i++) data[i] = "abc"[rand() % 3];
+    lz_round_trip(DATA_SIZE, 500, 10);
+
+    // A bad header or a cut off stream
+    data[0] = 0;
+    CHECK(simple_logger_lz_decode(data, 10, decoded, sizeof(decoded)) == -1);
+    CHECK(simple_logger_lz_decode(stream, 1, decoded, sizeof(decoded)) == -1);
+    CHECK(simple_logger_lz_decode(stream, stream_len - 1, decoded, sizeof(decoded)) >= 0);
+}
+
+static void delta_round_trip (const int32_t* values, uint8_t count, int records) {
+    simple_logger_delta_t enc, dec;
+    uint8_t buf[SIMPLE_LOGGER_DELTA_RECORD_MAX];
+    int32_t out[SIMPLE_LOGGER_DELTA_MAX_VALUES];
+
+    simple_logger_delta_reset(&enc);
+    simple_logger_delta_reset(&dec);
+    for (int r = 0; r < records; r++) {
+        const int32_t* v = values + r * count;
+        uint8_t len = simple_logger_delta_encode(&enc, v, count, buf);
+        uint8_t n = 0;
+
+        CHECK(len > 0 && len <= SIMPLE_LOGGER_DELTA_RECORD_MAX);
+        CHECK(((buf[0] & 0x80) != 0) == (r % SIMPLE_LOGGER_DELTA_KEY_INTERVAL == 0));
+        // Cut short the record isn't there yet
+        CHECK(simple_logger_delta_decode(&dec, buf, len - 1, out, &n) == 0);
+        CHECK(simple_logger_delta_decode(&dec, buf, len, out, &n) == len);
+        CHECK(n == count);
+        CHECK(memcmp(out, v, count * sizeof(int32_t)) == 0);
+    }
+}
+
+static void test_delta (void) {
+    static int32_t values[1000 * 4];
+    simple_logger_delta_t enc, dec;
+    uint8_t buf[SIMPLE_LOGGER_DELTA_RECORD_MAX];
+    int32_t out[SIMPLE_LOGGER_DELTA_MAX_VALUES];
+    uint8_t n;
+
+    // Slowly changing values take a byte or so each
+    for (int r = 0; r < 1000; r++) {
+        values[r * 4 + 0] = r * 1000;
+        values[r * 4 + 1] = 2000 + (rand() % 5) - 2;
+        values[r * 4 + 2] = -100000 + r;
+        values[r * 4 + 3] = (r > 0 ? values[(r - 1) * 4 + 3] : 0) + (rand() % 61) - 30;
+    }
+    delta_round_trip(values, 4, 1000);
+
+    // Differences that wrap
+    for (int r = 0; r < 1000; r++) {
+        values[r * 2 + 0] = (r & 1) ? INT32_MAX : INT32_MIN;
+        values[r * 2 + 1] = rand() * (rand() & 1 ? -1 : 1);
+    }
+    delta_round_trip(values, 2, 1000);
+
+    // A different number of values makes a key record
+    simple_logger_delta_reset(&enc);
+    simple_logger_delta_reset(&dec);
+    simple_logger_delta_encode(&enc, values, 2, buf);
+    CHECK(simple_logger_delta_encode(&enc, values, 3, buf) > 0 && (buf[0] & 0x80));
+    CHECK(simple_logger_delta_encode(&enc, values, 0, buf) == 0);
+    CHECK(simple_logger_delta_encode(&enc, values, SIMPLE_LOGGER_DELTA_MAX_VALUES + 1, buf) == 0);
+
+    // A delta record with nothing to go on is an error
+    simple_logger_delta_encode(&enc, values, 3, buf);
+    CHECK(!(buf[0] & 0x80));
+    CHECK(simple_logger_delta_decode(&dec, buf, sizeof(buf), out, &n) == -1);
+}
+
+
+// stdio backend under the LZ backend, failing one append
+
+static int appends = 0;
+static int fail_at = -1;
+
+static int flaky_open (void* ctx, const char* name, bool truncate) {
+    return simple_logger_stdio_backend.open(ctx, name, truncate);
+}
+static int flaky_append (void* ctx, const char* data, uint32_t len) {
+    if (appends++ == fail_at) return -1;
+    return simple_logger_stdio_backend.append(ctx, data, len);
+}
+static int flaky_flush (void* ctx) { return simple_logger_stdio_backend.flush(ctx); }
+static uint32_t flaky_size (void* ctx) { return simple_logger_stdio_backend.size(ctx); }
+static int flaky_close (void* ctx) { return simple_logger_stdio_backend.close(ctx); }
+
+static const simple_logger_backend_t flaky_backend = {
+    .open   = flaky_open,
+    .append = flaky_append,
+    .flush  = flaky_flush,
+    .size   = flaky_size,
+    .close  = flaky_close,
+};
+
+static simple_logger_lz_stream_t lz_log = {
+    .backend = &flaky_backend,
+    .ctx     = NULL,
+};
+
+static void test_logger (void) {
+    static int32_t logged[500][3];
+    simple_logger_delta_t dec;
+    FILE* f;
+    uint32_t len, pos;
+    int32_t decoded_len;
+    int32_t out[SIMPLE_LOGGER_DELTA_MAX_VALUES];
+    uint8_t n;
+    int r;
+
+    CHECK(simple_logger_init_backend(&simple_logger_lz_backend, &lz_log, NAME, "w") == SIMPLE_LOGGER_SUCCESS);
+    CHECK(simple_logger_log_header("time,temp,humidity\n") == SIMPLE_LOGGER_SUCCESS);
+
+    fail_at = appends + 200;
+    for (r = 0; r < 500; r++) {
+        logged[r][0] = r * 1000;
+        logged[r][1] = 2150 + (r / 50) - (rand() % 3);
+        logged[r][2] = 4000 - r;
+        CHECK(simple_logger_log_values(logged[r], 3) == SIMPLE_LOGGER_SUCCESS);
+    }
+    lz_log.backend->close(lz_log.ctx);
+    CHECK(appends > fail_at);
+
+    f = fopen(NAME, "rb");
+    CHECK(f != NULL);
+    if (f == NULL) return;
+    len = fread(stream, 1, sizeof(stream), f);
+    fclose(f);
+    remove(NAME);
+
+    // A third of the raw int32s or less
+    CHECK(len < 500 * 12 / 3);
+
+    decoded_len = simple_logger_lz_decode(stream, len, decoded, sizeof(decoded));
+    CHECK(decoded_len > 0);
+    if (decoded_len <= 0) return;
+
+    CHECK(memcmp(decoded, "time,temp,humidity\n", 19) == 0);
+    simple_logger_delta_reset(&dec);
+    for (r = 0, pos = 19; pos < (uint32_t)decoded_len; r++) {
+        int used = simple_logger_delta_decode(&dec, decoded + pos, decoded_len - pos, out, &n);
+
+        CHECK(used > 0);
+        if (used <= 0) break;
+        CHECK(n == 3 && memcmp(out, logged[r], sizeof(logged[r])) == 0);
+        pos += used;
+    }
+    CHECK(r == 500);
+}
+
+int main (int argc, char** argv) {
+    srand(3);
+
+    test_lz();
+    test_delta();
+    test_logger();
+
+    printf("simple_logger_compress: %s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
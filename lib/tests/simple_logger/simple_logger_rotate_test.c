@@ -0,0 +1,116 @@
+// Host test for simple_logger's log rotation. Built with
+// SIMPLE_LOGGER_ROTATE_BYTES or SIMPLE_LOGGER_ROTATE_SECONDS, and with and
+// without SIMPLE_LOGGER_PREALLOCATE. Logs a line every 100 ms of timer
+// ticks, calling simple_logger_update() in between like a main loop would,
+// then checks the segments left on the card.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ff.h"
+#include "simple_logger.h"
+#include "ramdisk.h"
+#include "simple_timer.h"
+
+#define LINES  3000
+#define HEADER "line,value\n"
+
+static char buf[16384];
+static int  failures = 0;
+
+#define CHECK(cond) do {                                              \
+    if (!(cond)) {                                                    \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+        failures++;                                                   \
+    }                                                                 \
+} while (0)
+
+static int exists (const char* name) {
+    FILINFO info;
+    return f_stat(name, &info) == FR_OK;
+}
+
+// Read a whole file into buf, returns its length or -1
+static int read_file (const char* name) {
+    FIL f;
+    UINT n = 0;
+
+    if (f_open(&f, name, FA_READ | FA_OPEN_EXISTING) != FR_OK) return -1;
+    f_read(&f, buf, sizeof(buf) - 1, &n);
+    f_close(&f);
+    buf[n] = '\0';
+    return n;
+}
+
+int main (int argc, char** argv) {
+    unsigned oldest, newest;
+    char name[16];
+    int next = -1;
+
+    ramdisk_format(16384);
+    simple_logger_init("LOG.TXT", "w");
+    CHECK(simple_logger_log_header(HEADER) == SIMPLE_LOGGER_SUCCESS);
+
+    for (int i = 0; i < LINES; i++) {
+        CHECK(simple_logger_log("%d,%d\n", i, i * 7919) == SIMPLE_LOGGER_SUCCESS);
+        simple_logger_update();
+        simple_timer_tick(100);
+    }
+    // Let any deleting finish
+    for (int i = 0; i < 10; i++) simple_logger_update();
+
+    // The index names the oldest and newest segment
+    CHECK(read_file("LOG.IDX") > 0);
+    CHECK(sscanf(buf, "%u %u", &oldest, &newest) == 2);
+    CHECK(newest > SIMPLE_LOGGER_MAX_FILES);
+    CHECK(newest - oldest + 1 == SIMPLE_LOGGER_MAX_FILES);
+    CHECK(!exists("LOG.000"));
+    sprintf(name, "LOG.%03u", oldest - 1);
+    CHECK(!exists(name));
+
+    // Each segment starts with the header and carries on where the last
+    // one stopped, and the newest ends with the last line logged
+    for (unsigned s = oldest; s <= newest; s++) {
+        char* p;
+        int len, lines = 0;
+
+        sprintf(name, "LOG.%03u", s);
+        len = read_file(name);
+#ifdef SIMPLE_LOGGER_PREALLOCATE
+        // The newest segment's size on the card lags by up to a checkpoint
+        if (s == newest && len == 0) continue;
+#endif
+        CHECK(len > 0);
+        if (len <= 0) continue;
+        CHECK(strncmp(buf, HEADER, strlen(HEADER)) == 0);
+
+        for (p = buf + strlen(HEADER); *p; p = strchr(p, '\n') + 1) {
+            int line, value;
+            CHECK(sscanf(p, "%d,%d", &line, &value) == 2);
+            CHECK(value == line * 7919);
+            if (next >= 0) CHECK(line == next);
+            next = line + 1;
+            lines++;
+        }
+
+        if (s < newest) {
+#ifdef SIMPLE_LOGGER_ROTATE_BYTES
+            // Rotation lags the threshold by a line or two
+            CHECK(len >= SIMPLE_LOGGER_ROTATE_BYTES && len < SIMPLE_LOGGER_ROTATE_BYTES + 40);
+#else
+            // A line every 100 ms, give or take the lines logged while
+            // simple_logger_update() works through the rotation
+            CHECK(lines >= SIMPLE_LOGGER_ROTATE_SECONDS * 10 && lines <= SIMPLE_LOGGER_ROTATE_SECONDS * 10 + 2);
+#endif
+        }
+    }
+#ifdef SIMPLE_LOGGER_PREALLOCATE
+    CHECK(next <= LINES && next > LINES - SIMPLE_LOGGER_CHECKPOINT / 10);
+#else
+    CHECK(next == LINES);
+#endif
+
+    printf("simple_logger_rotate: %s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
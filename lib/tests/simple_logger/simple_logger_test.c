@@ -0,0 +1,89 @@
+// Host test for simple_logger's preallocated streaming mode. Built with a
+// small SIMPLE_LOGGER_PREALLOCATE so the log runs past the end of the
+// preallocated run and carries on the normal way.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ff.h"
+#include "simple_logger.h"
+#include "ramdisk.h"
+
+#define LOG_BYTES 40000
+
+static char    expect[LOG_BYTES + 64];
+static char    readback[LOG_BYTES + 64];
+static int     logged = 0;
+static int     failures = 0;
+
+#define CHECK(cond) do {                                              \
+    if (!(cond)) {                                                    \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+        failures++;                                                   \
+    }                                                                 \
+} while (0)
+
+// What is in the file according to its directory entry
+static int file_size (void) {
+    FILINFO info;
+    if (f_stat("LOG.TXT", &info) != FR_OK) return -1;
+    return info.fsize;
+}
+
+static void check_contents (int size) {
+    FIL f;
+    UINT n = 0;
+
+    CHECK(f_open(&f, "LOG.TXT", FA_READ | FA_OPEN_EXISTING) == FR_OK);
+    CHECK(f_read(&f, readback, size, &n) == FR_OK);
+    CHECK((int)n == size);
+    CHECK(memcmp(readback, expect, size) == 0);
+    f_close(&f);
+}
+
+int main (int argc, char** argv) {
+    ramdisk_stats_t stats;
+    int lines = 0;
+    int stream_lines = 0;
+    int streamed = 0;
+
+    ramdisk_format(16384);
+    // The return value also has the "does the file exist" probe or'ed in
+    simple_logger_init("LOG.TXT", "w");
+
+    CHECK(simple_logger_log_header("line,value\n") == SIMPLE_LOGGER_SUCCESS);
+    strcpy(expect, "line,value\n");
+    logged = strlen(expect);
+
+    ramdisk_reset_stats();
+    while (logged < LOG_BYTES) {
+        int n = sprintf(expect + logged, "%d,%d\n", lines, lines * 7919);
+
+        CHECK(simple_logger_log("%d,%d\n", lines, lines * 7919) == SIMPLE_LOGGER_SUCCESS);
+        logged += n;
+        lines++;
+
+        if (logged <= SIMPLE_LOGGER_PREALLOCATE) {
+            // Streaming: the directory entry lags by less than a checkpoint
+            int size = file_size();
+            CHECK(size <= logged && size > logged - SIMPLE_LOGGER_CHECKPOINT);
+            ramdisk_get_stats(&stats);
+            stream_lines = lines;
+        } else {
+            // Past the run every line is synced again
+            streamed = 1;
+            CHECK(file_size() == logged);
+        }
+    }
+    CHECK(streamed);
+
+    // While streaming, about one sector write per line and no reads
+    CHECK(stats.sector_reads == 0);
+    CHECK(stats.sector_writes < stream_lines + stream_lines / 4);
+
+    check_contents(logged);
+
+    printf("simple_logger: %s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,21 @@
+// Host stand-in for lib/simple_timer.c
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "simple_timer.h"
+
+static app_timer_timeout_handler_t timer = NULL;
+
+void simple_timer_init (void) {}
+
+// Only the logger's 1 ms heartbeat is ever started
+uint32_t simple_timer_start (uint32_t milliseconds, app_timer_timeout_handler_t callback) {
+    (void)milliseconds;
+    timer = callback;
+    return 0;
+}
+
+void simple_timer_tick (uint32_t ms) {
+    while (timer && ms--) timer(NULL);
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// Host stand-in for lib/simple_timer.h, simple_timer_tick() drives the timer
+
+#include <stdint.h>
+
+typedef void (*app_timer_timeout_handler_t)(void* p_context);
+
+void simple_timer_init(void);
+uint32_t simple_timer_start(uint32_t milliseconds, app_timer_timeout_handler_t callback);
+
+// Let `ms` milliseconds pass for the timer simple_logger started
+void simple_timer_tick(uint32_t ms);
@@ -0,0 +1,170 @@
+// simple_ble.c and advertisement/ against softdevice_emu.c: host time per
+// event handed to the application, per notification, and per advertisement
+// encoded, and the notification throughput the connection interval allows.
+// The host times say how much work the code does, not how long it takes on
+// a 16 MHz M0; the throughput is what the emulated SoftDevice lets out, six
+// 20 byte packets per connection event.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "ble.h"
+#include "ble_advdata.h"
+#include "app_util.h"
+#include "nrf_error.h"
+
+#include "simple_ble.h"
+#include "simple_adv.h"
+#include "eddystone.h"
+#include "softdevice_emu.h"
+
+#define EVENTS  200000
+#define NOTIFY  200000
+#define ENCODES 100000
+
+static const simple_ble_config_t config = {
+    .platform_id       = 0x30,
+    .device_id         = 0x1234,
+    .adv_name          = "emu-bench",
+    .adv_interval      = MSEC_TO_UNITS(500, UNIT_0_625_MS),
+    .min_conn_interval = MSEC_TO_UNITS(7.5, UNIT_1_25_MS),
+    .max_conn_interval = MSEC_TO_UNITS(30, UNIT_1_25_MS),
+};
+
+static simple_ble_service_t service = {
+    .uuid128 = {{0x87, 0xa4, 0xde, 0xa0, 0x96, 0xea, 0x4e, 0xe6,
+                 0x87, 0x45, 0x83, 0x28, 0x89, 0x0f, 0xad, 0x7b}}
+};
+
+static simple_ble_char_t rw_char     = {.uuid16 = 0x8910};
+static simple_ble_char_t notify_char = {.uuid16 = 0x8911};
+
+static uint8_t rw_value[4];
+static uint8_t notify_value[20];
+
+static uint32_t writes, tx_complete;
+
+void services_init (void) {
+    simple_ble_add_service(&service);
+    simple_ble_add_characteristic(1, 1, 0, 0, sizeof(rw_value), rw_value, &service, &rw_char);
+    simple_ble_add_characteristic(1, 0, 1, 0, sizeof(notify_value), notify_value, &service, &notify_char);
+}
+
+void ble_evt_write (ble_evt_t* p_ble_evt) {
+    (void) p_ble_evt;
+    writes++;
+}
+
+void ble_evt_user_handler (ble_evt_t* p_ble_evt) {
+    if (p_ble_evt->header.evt_id == BLE_EVT_TX_COMPLETE) {
+        tx_complete += p_ble_evt->evt.common_evt.params.tx_complete.count;
+    }
+}
+
+static double now (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void start (void) {
+    softdevice_emu_reset();
+    writes = tx_complete = 0;
+    simple_ble_init(&config);
+    simple_adv_only_name();
+}
+
+static void connect (void) {
+    softdevice_emu_connect(NULL);
+    softdevice_emu_run();
+    softdevice_emu_enable_notify(notify_char.char_handle.value_handle);
+    softdevice_emu_run();
+}
+
+// Write Requests from the peer, through ble_evt_write()
+static void bench_events (void) {
+    uint16_t handle;
+    double start_time;
+
+    start();
+    connect();
+    handle = rw_char.char_handle.value_handle;
+    writes = 0;
+
+    start_time = now();
+    for (uint32_t i = 0; i < EVENTS; i++) {
+        softdevice_emu_write(handle, (uint8_t*) &i, sizeof(i));
+        softdevice_emu_run();
+    }
+    printf("write event       %7.1f ns per event (%u seen)\n",
+           (now() - start_time) / EVENTS * 1e9, writes);
+}
+
+// Notifications, either as many as the buffers take before each connection
+// event, or one at a time waiting for its TX_COMPLETE
+static void bench_notify (const char* name, uint32_t per_event) {
+    softdevice_emu_stats_t stats;
+    double start_time, elapsed;
+    uint32_t sent = 0;
+
+    start();
+    connect();
+    softdevice_emu_reset_stats();
+
+    start_time = now();
+    while (sent < NOTIFY) {
+        for (uint32_t i = 0; i < per_event; i++) {
+            notify_value[0] = sent;
+            if (simple_ble_notify_char(&notify_char) != NRF_SUCCESS) break;
+            sent++;
+        }
+        softdevice_emu_connection_event();
+        softdevice_emu_run();
+    }
+    elapsed = now() - start_time;
+
+    softdevice_emu_get_stats(&stats);
+    double per_ce = (double) stats.bytes / stats.connection_events;
+    printf("notify %-10s %7.1f ns per packet  %5.1f bytes per event  "
+           "%6.0f B/s at 7.5 ms  %5.0f B/s at 30 ms  (%u refused)\n",
+           name, elapsed / stats.packets * 1e9, per_ce,
+           per_ce * 1000 / 7.5, per_ce * 1000 / 30, stats.hvx_no_buffers);
+}
+
+static void bench_adv (const char* name, void (*encode)(void)) {
+    double start_time;
+
+    start();
+    start_time = now();
+    for (uint32_t i = 0; i < ENCODES; i++) {
+        encode();
+    }
+    printf("%-17s %7.1f ns per call\n", name, (now() - start_time) / ENCODES * 1e9);
+}
+
+static void adv_name (void) {
+    simple_adv_only_name();
+}
+
+static void adv_service_manuf (void) {
+    static uint8_t manuf[4] = {1, 2, 3, 4};
+    ble_advdata_manuf_data_t manuf_data = {0x02E0, {sizeof(manuf), manuf}};
+
+    simple_adv_service_manuf_data(&service.uuid_handle, &manuf_data);
+}
+
+static void adv_eddystone (void) {
+    eddystone_with_name("goo.gl/abc");
+}
+
+int main (int argc, char** argv) {
+    bench_events();
+    bench_notify("batched", SOFTDEVICE_EMU_TX_BUFFERS);
+    bench_notify("one", 1);
+    bench_adv("only_name", adv_name);
+    bench_adv("service_manuf", adv_service_manuf);
+    bench_adv("eddystone", adv_eddystone);
+    return 0;
+}
@@ -0,0 +1,605 @@
+// simple_ble.c, advertisement/ and services/device_info_service.c, built
+// for the host and run against softdevice_emu.c. Each test starts from a
+// fresh SoftDevice and simple_ble_init(), plays the peer, and checks what
+// reaches the application and what goes over the air.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ble.h"
+#include "ble_hci.h"
+#include "ble_advdata.h"
+#include "ble_srv_common.h"
+#include "app_util.h"
+#include "nrf_error.h"
+
+#include "simple_ble.h"
+#include "simple_adv.h"
+#include "eddystone.h"
+#include "iot_gateway.h"
+#include "multi_adv.h"
+#include "device_info_service.h"
+#include "softdevice_emu.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do {                                              \
+    if (!(cond)) {                                                    \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+        failures++;                                                   \
+    }                                                                 \
+} while (0)
+
+#define NAME "emu-test"
+
+static const simple_ble_config_t config = {
+    .platform_id       = 0x30,
+    .device_id         = 0x1234,
+    .adv_name          = NAME,
+    .adv_interval      = MSEC_TO_UNITS(500, UNIT_0_625_MS),
+    .min_conn_interval = MSEC_TO_UNITS(500, UNIT_1_25_MS),
+    .max_conn_interval = MSEC_TO_UNITS(1000, UNIT_1_25_MS),
+};
+
+static simple_ble_app_t* app_state;
+
+static simple_ble_service_t service = {
+    .uuid128 = {{0x87, 0xa4, 0xde, 0xa0, 0x96, 0xea, 0x4e, 0xe6,
+                 0x87, 0x45, 0x83, 0x28, 0x89, 0x0f, 0xad, 0x7b}}
+};
+
+static simple_ble_char_t rw_char     = {.uuid16 = 0x8910};
+static simple_ble_char_t notify_char = {.uuid16 = 0x8911};
+static simple_ble_char_t stack_char  = {.uuid16 = 0x8912};
+static simple_ble_char_t auth_char   = {.uuid16 = 0x8913};
+
+static uint8_t rw_value[4];
+static uint8_t notify_value[20];
+static uint8_t auth_value[2];
+
+// What the application saw
+static uint32_t connects, disconnects, writes, auths, reports, events, tx_complete;
+static ble_evt_t last_write;
+static uint8_t last_write_data[SOFTDEVICE_EMU_MAX_PAYLOAD];
+static uint8_t report_data[31];
+static int report_len;
+static bool deny_auth;
+
+void services_init (void) {
+    simple_ble_add_service(&service);
+    simple_ble_add_characteristic(1, 1, 0, 0, sizeof(rw_value), rw_value, &service, &rw_char);
+    simple_ble_add_characteristic(1, 0, 1, 1, sizeof(notify_value), notify_value, &service, &notify_char);
+    simple_ble_add_stack_characteristic(1, 1, 0, 1, 8, NULL, &service, &stack_char);
+    simple_ble_add_auth_characteristic(1, 1, 0, 0, true, true, sizeof(auth_value), auth_value,
+                                       &service, &auth_char);
+    simple_ble_device_info_service("B", "1.2", "emu");
+}
+
+void ble_evt_connected (ble_evt_t* p_ble_evt) {
+    (void) p_ble_evt;
+    connects++;
+}
+
+void ble_evt_disconnected (ble_evt_t* p_ble_evt) {
+    (void) p_ble_evt;
+    disconnects++;
+}
+
+void ble_evt_write (ble_evt_t* p_ble_evt) {
+    const ble_gatts_evt_write_t* w = &p_ble_evt->evt.gatts_evt.params.write;
+
+    writes++;
+    last_write = *p_ble_evt;
+    memcpy(last_write_data, w->data, w->len);
+}
+
+void ble_evt_rw_auth (ble_evt_t* p_ble_evt) {
+    auths++;
+    if (!deny_auth) {
+        CHECK(simple_ble_grant_auth(p_ble_evt) == NRF_SUCCESS);
+    } else {
+        ble_gatts_rw_authorize_reply_params_t reply;
+
+        memset(&reply, 0, sizeof(reply));
+        reply.type = p_ble_evt->evt.gatts_evt.params.authorize_request.type;
+        reply.params.write.gatt_status = BLE_GATT_STATUS_ATTERR_WRITE_NOT_PERMITTED;
+        CHECK(sd_ble_gatts_rw_authorize_reply(app_state->conn_handle, &reply) == NRF_SUCCESS);
+    }
+}
+
+void ble_evt_adv_report (ble_evt_t* p_ble_evt) {
+    reports++;
+    report_len = parse_adata(p_ble_evt, BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA, report_data);
+}
+
+void ble_evt_user_handler (ble_evt_t* p_ble_evt) {
+    events++;
+    if (p_ble_evt->header.evt_id == BLE_EVT_TX_COMPLETE) {
+        tx_complete += p_ble_evt->evt.common_evt.params.tx_complete.count;
+    }
+}
+
+static void start (void) {
+    softdevice_emu_reset();
+    memset(rw_value, 0, sizeof(rw_value));
+    memset(notify_value, 0, sizeof(notify_value));
+    memset(auth_value, 0, sizeof(auth_value));
+    connects = disconnects = writes = auths = reports = events = tx_complete = 0;
+    deny_auth = false;
+
+    app_state = simple_ble_init(&config);
+    simple_adv_only_name();
+}
+
+static void connect (void) {
+    CHECK(softdevice_emu_connect(NULL));
+    softdevice_emu_run();
+}
+
+static uint32_t app_errors (void) {
+    softdevice_emu_stats_t stats;
+
+    softdevice_emu_get_stats(&stats);
+    return stats.app_errors;
+}
+
+static int read_string (uint16_t uuid16, char* out) {
+    ble_uuid_t uuid = {uuid16, BLE_UUID_TYPE_BLE};
+    uint16_t handle = softdevice_emu_find(&uuid, 0);
+    int len;
+
+    if (!softdevice_emu_connected()) connect();
+    len = softdevice_emu_read(handle, (uint8_t*) out, 31);
+    if (len >= 0) out[len] = '\0';
+    return len;
+}
+
+static void test_init (void) {
+    static const uint8_t address[6] = {0x34, 0x12, 0x30, 0xe5, 0x98, 0xc0};
+    ble_gap_conn_params_t ppcp;
+    ble_gap_addr_t addr;
+    ble_uuid_t uuid = {0x8911, 0};
+    uint8_t name[32];
+    uint16_t len = sizeof(name), appearance;
+    char text[32];
+
+    start();
+    CHECK(app_errors() == 0);
+    CHECK(app_state->conn_handle == BLE_CONN_HANDLE_INVALID);
+
+    // Address from the config: device id, platform id, lab11 OUI
+    softdevice_emu_address(&addr);
+    CHECK(addr.addr_type == BLE_GAP_ADDR_TYPE_PUBLIC);
+    CHECK(memcmp(addr.addr, address, 6) == 0);
+
+    CHECK(sd_ble_gap_device_name_get(name, &len) == NRF_SUCCESS);
+    CHECK(len == strlen(NAME) && memcmp(name, NAME, len) == 0);
+    CHECK(sd_ble_gap_appearance_get(&appearance) == NRF_SUCCESS);
+    CHECK(appearance == BLE_APPEARANCE_GENERIC_COMPUTER);
+    CHECK(sd_ble_gap_ppcp_get(&ppcp) == NRF_SUCCESS);
+    CHECK(ppcp.min_conn_interval == config.min_conn_interval);
+    CHECK(ppcp.max_conn_interval == config.max_conn_interval);
+
+    CHECK(service.service_handle == SOFTDEVICE_EMU_FIRST_USER_HANDLE);
+    CHECK(service.uuid_handle.type == BLE_UUID_TYPE_VENDOR_BEGIN);
+    CHECK(rw_char.char_handle.value_handle == service.service_handle + 2);
+    CHECK(rw_char.char_handle.cccd_handle == 0);
+    CHECK(notify_char.char_handle.cccd_handle == notify_char.char_handle.value_handle + 1);
+    uuid.type = service.uuid_handle.type;
+    CHECK(softdevice_emu_find(&uuid, 0) == notify_char.char_handle.value_handle);
+
+    // Device information
+    CHECK(read_string(BLE_UUID_HARDWARE_REVISION_STRING_CHAR, text) == 1 && strcmp(text, "B") == 0);
+    CHECK(read_string(BLE_UUID_FIRMWARE_REVISION_STRING_CHAR, text) == 3 && strcmp(text, "1.2") == 0);
+    CHECK(read_string(BLE_UUID_SOFTWARE_REVISION_STRING_CHAR, text) == 3 && strcmp(text, "emu") == 0);
+    CHECK(read_string(BLE_UUID_SYSTEM_ID_CHAR, text) == 8);
+    CHECK(read_string(BLE_UUID_MODEL_NUMBER_STRING_CHAR, text) == -1);
+}
+
+static void check_ad (const uint8_t* data, uint8_t len, const uint8_t* expected, uint8_t expected_len) {
+    CHECK(len == expected_len);
+    CHECK(memcmp(data, expected, expected_len) == 0);
+}
+
+static void test_adv (void) {
+    static const uint8_t only_name[] = {
+        0x02, BLE_GAP_AD_TYPE_FLAGS, BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE,
+        0x09, BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME, 'e', 'm', 'u', '-', 't', 'e', 's', 't',
+    };
+    static const uint8_t eddystone[] = {
+        0x02, BLE_GAP_AD_TYPE_FLAGS, BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE,
+        0x03, BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE, 0xAA, 0xFE,
+        0x10, BLE_GAP_AD_TYPE_SERVICE_DATA, 0xAA, 0xFE,
+        PHYSWEB_URL_TYPE, PHYSWEB_TX_POWER, PHYSWEB_URLSCHEME_HTTP,
+        'g', 'o', 'o', '.', 'g', 'l', '/', 'a', 'b', 'c',
+    };
+    const ble_gap_adv_params_t* params;
+    const uint8_t* data;
+    uint8_t len, manuf[4] = {1, 2, 3, 4};
+    ble_advdata_manuf_data_t manuf_data = {0x02E0, {sizeof(manuf), manuf}};
+    softdevice_emu_stats_t stats;
+
+    start();
+    params = softdevice_emu_advertising();
+    CHECK(params != NULL && params->type == BLE_GAP_ADV_TYPE_ADV_IND);
+    CHECK(params != NULL && params->interval == config.adv_interval);
+    data = softdevice_emu_adv_data(&len);
+    check_ad(data, len, only_name, sizeof(only_name));
+    softdevice_emu_scan_rsp_data(&len);
+    CHECK(len == 0);
+
+    // The service UUID in the packet pushes the name to the scan response
+    simple_adv_service_manuf_data(&service.uuid_handle, &manuf_data);
+    data = softdevice_emu_adv_data(&len);
+    CHECK(len == 3 + 18 + 8);
+    CHECK(data[3] == 17 && data[4] == BLE_GAP_AD_TYPE_128BIT_SERVICE_UUID_COMPLETE);
+    CHECK(memcmp(data + 5, service.uuid128.uuid128, 12) == 0);
+    CHECK(data[5 + 12] == 0x0f && data[5 + 13] == 0x89);
+    CHECK(data[21] == 7 && data[22] == BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA);
+    CHECK(data[23] == 0xE0 && data[24] == 0x02 && memcmp(data + 25, manuf, 4) == 0);
+    data = softdevice_emu_scan_rsp_data(&len);
+    check_ad(data, len, only_name + 3, sizeof(only_name) - 3);
+
+    eddystone_with_name("goo.gl/abc");
+    data = softdevice_emu_adv_data(&len);
+    check_ad(data, len, eddystone, sizeof(eddystone));
+
+    // A URL that doesn't fit is an error, and the old packet stays.
+    // ble_advdata itself would copy it past the end of its buffer.
+    eddystone_with_name("example.com/a-url-that-is-far-too-long");
+    CHECK(app_errors() == 1);
+    data = softdevice_emu_adv_data(&len);
+    check_ad(data, len, eddystone, sizeof(eddystone));
+
+    // A name too long for the packet is shortened
+    CHECK(sd_ble_gap_device_name_set(&(ble_gap_conn_sec_mode_t){1, 1}, (const uint8_t*)
+          "a name far longer than thirty", 29) == NRF_SUCCESS);
+    simple_adv_only_name();
+    data = softdevice_emu_adv_data(&len);
+    CHECK(len == BLE_GAP_ADV_MAX_SIZE);
+    CHECK(data[3] == 27 && data[4] == BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME);
+    CHECK(memcmp(data + 5, "a name far longer than thi", 26) == 0);
+
+    CHECK(iot_gateway_adv("gateway.lab11", 16, 0, 0, NULL, 0, NULL) == NRF_ERROR_INVALID_PARAM);
+
+    // The SoftDevice checks the AD structures
+    CHECK(sd_ble_gap_adv_data_set((const uint8_t*) "\x05\x09" "ab", 4, NULL, 0) == NRF_ERROR_INVALID_DATA);
+    CHECK(sd_ble_gap_adv_data_set(eddystone, 32, NULL, 0) == NRF_ERROR_DATA_SIZE);
+
+    // Only the calls that changed something count
+    softdevice_emu_get_stats(&stats);
+    CHECK(stats.adv_data_sets == 4);
+}
+
+static void test_connect (void) {
+    const ble_gap_adv_params_t* params;
+
+    start();
+    CHECK(softdevice_emu_connect(NULL));
+    CHECK(connects == 0);
+    CHECK(softdevice_emu_run() == 1);
+    CHECK(connects == 1 && app_state->conn_handle == 0);
+    CHECK(softdevice_emu_connected());
+    CHECK(!softdevice_emu_connect(NULL));
+
+    // Still advertising, but not connectably
+    params = softdevice_emu_advertising();
+    CHECK(params != NULL && params->type == BLE_GAP_ADV_TYPE_ADV_SCAN_IND);
+
+    CHECK(softdevice_emu_disconnect(BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION));
+    softdevice_emu_run();
+    CHECK(disconnects == 1 && app_state->conn_handle == BLE_CONN_HANDLE_INVALID);
+    params = softdevice_emu_advertising();
+    CHECK(params != NULL && params->type == BLE_GAP_ADV_TYPE_ADV_IND);
+
+    // Connectable advertising is gone once advertising times out
+    softdevice_emu_gap_timeout(BLE_GAP_TIMEOUT_SRC_ADVERTISING);
+    softdevice_emu_run();
+    CHECK(softdevice_emu_advertising() == NULL);
+    CHECK(!softdevice_emu_connect(NULL));
+    CHECK(app_errors() == 0);
+}
+
+static void test_write (void) {
+    static const uint8_t data[4] = {0xde, 0xad, 0xbe, 0xef};
+    uint16_t handle = rw_char.char_handle.value_handle;
+    uint8_t out[4];
+
+    start();
+    CHECK(!softdevice_emu_write(handle, data, 4));
+    connect();
+    CHECK(softdevice_emu_write(handle, data, 4));
+    CHECK(writes == 0);
+    softdevice_emu_run();
+    CHECK(writes == 1);
+    CHECK(simple_ble_is_char_event(&last_write, &rw_char));
+    CHECK(!simple_ble_is_char_event(&last_write, &notify_char));
+    CHECK(last_write.evt.gatts_evt.params.write.len == 4);
+    CHECK(memcmp(last_write_data, data, 4) == 0);
+
+    // Values live in the application's memory
+    CHECK(memcmp(rw_value, data, 4) == 0);
+    rw_value[0] = 0x42;
+    CHECK(softdevice_emu_read(handle, out, sizeof(out)) == 4 && out[0] == 0x42);
+
+    // Not writable, too long
+    CHECK(!softdevice_emu_write(notify_char.char_handle.value_handle, data, 1));
+    CHECK(!softdevice_emu_write(handle, data, 5));
+    CHECK(softdevice_emu_run() == 0);
+
+    // Stack values
+    handle = stack_char.char_handle.value_handle;
+    CHECK(softdevice_emu_write(handle, data, 3));
+    softdevice_emu_run();
+    {
+        uint8_t buf[8];
+        uint16_t len = sizeof(buf);
+
+        CHECK(simple_ble_stack_char_get(&stack_char, &len, buf) == NRF_SUCCESS);
+        CHECK(len == 3 && memcmp(buf, data, 3) == 0);
+        CHECK(simple_ble_stack_char_set(&stack_char, 2, (uint8_t*) "hi") == NRF_SUCCESS);
+        CHECK(softdevice_emu_read(handle, buf, sizeof(buf)) == 2 && memcmp(buf, "hi", 2) == 0);
+        CHECK(simple_ble_stack_char_set(&stack_char, 9, buf) == NRF_ERROR_DATA_SIZE);
+    }
+    CHECK(app_errors() == 0);
+}
+
+static void test_notify (void) {
+    uint16_t handle = notify_char.char_handle.value_handle;
+    softdevice_emu_stats_t stats;
+    const softdevice_emu_packet_t* packet;
+
+    start();
+
+    // Quietly nothing, without a connection or before the peer asks
+    CHECK(simple_ble_notify_char(&notify_char) == NRF_SUCCESS);
+    connect();
+    CHECK(simple_ble_notify_char(&notify_char) == NRF_SUCCESS);
+    softdevice_emu_get_stats(&stats);
+    CHECK(stats.hvx == 0 && stats.hvx_not_enabled == 1);
+
+    CHECK(softdevice_emu_enable_notify(handle));
+    softdevice_emu_run();
+    CHECK(writes == 1);
+    CHECK(last_write.evt.gatts_evt.params.write.handle == notify_char.char_handle.cccd_handle);
+
+    // The SoftDevice copies the value when called; six buffers
+    softdevice_emu_reset_stats();
+    for (int i = 0; i < SOFTDEVICE_EMU_TX_BUFFERS; i++) {
+        notify_value[0] = i;
+        CHECK(simple_ble_notify_char(&notify_char) == NRF_SUCCESS);
+    }
+    CHECK(simple_ble_notify_char(&notify_char) == BLE_ERROR_NO_TX_PACKETS);
+    CHECK(softdevice_emu_tx_free() == 0);
+
+    CHECK(softdevice_emu_connection_event() == SOFTDEVICE_EMU_TX_BUFFERS);
+    CHECK(softdevice_emu_tx_free() == SOFTDEVICE_EMU_TX_BUFFERS);
+    softdevice_emu_run();
+    CHECK(tx_complete == SOFTDEVICE_EMU_TX_BUFFERS);
+    for (int i = 0; i < SOFTDEVICE_EMU_TX_BUFFERS; i++) {
+        packet = softdevice_emu_packet(i);
+        CHECK(packet != NULL && packet->handle == handle && packet->data[0] == i);
+        CHECK(packet != NULL && packet->len == sizeof(notify_value));
+    }
+    CHECK(softdevice_emu_packet(SOFTDEVICE_EMU_TX_BUFFERS) == NULL);
+
+    // A shorter variable length value
+    CHECK(simple_ble_update_char_len(&notify_char, 5) == NRF_SUCCESS);
+    CHECK(simple_ble_notify_char(&notify_char) == NRF_SUCCESS);
+    CHECK(softdevice_emu_connection_event() == 1);
+    packet = softdevice_emu_packet(SOFTDEVICE_EMU_TX_BUFFERS);
+    CHECK(packet != NULL && packet->len == 5);
+    CHECK(simple_ble_update_char_len(&notify_char, 21) == NRF_ERROR_DATA_SIZE);
+
+    softdevice_emu_get_stats(&stats);
+    CHECK(stats.hvx == SOFTDEVICE_EMU_TX_BUFFERS + 1 && stats.hvx_no_buffers == 1);
+    CHECK(stats.bytes == SOFTDEVICE_EMU_TX_BUFFERS * 20 + 5);
+
+    // Nothing goes out after a disconnect
+    CHECK(simple_ble_notify_char(&notify_char) == NRF_SUCCESS);
+    softdevice_emu_disconnect(BLE_HCI_CONNECTION_TIMEOUT);
+    softdevice_emu_run();
+    CHECK(softdevice_emu_connection_event() == 0);
+    CHECK(simple_ble_notify_char(&notify_char) == NRF_SUCCESS);
+    CHECK(app_errors() == 0);
+}
+
+// A CCCD written before the application set the system attributes
+static void test_sys_attr_missing (void) {
+    start();
+    CHECK(softdevice_emu_connect(NULL));
+    CHECK(!softdevice_emu_enable_notify(notify_char.char_handle.value_handle));
+    CHECK(softdevice_emu_run() == 2);
+    CHECK(softdevice_emu_enable_notify(notify_char.char_handle.value_handle));
+    softdevice_emu_run();
+    CHECK(writes == 1);
+    CHECK(app_errors() == 0);
+}
+
+static void test_auth (void) {
+    uint16_t handle = auth_char.char_handle.value_handle;
+    uint8_t out[2];
+
+    start();
+    connect();
+    auth_value[0] = 7;
+
+    // Reads wait for the application
+    CHECK(softdevice_emu_read(handle, out, 2) == -1);
+    CHECK(auths == 0);
+    softdevice_emu_run();
+    CHECK(auths == 1);
+    CHECK(softdevice_emu_auth_status() == BLE_GATT_STATUS_SUCCESS);
+    CHECK(softdevice_emu_read(handle, out, 2) == 2 && out[0] == 7);
+    CHECK(softdevice_emu_read(handle, out, 2) == -1);
+    softdevice_emu_run();
+
+    // Writes too, and take no write event
+    CHECK(softdevice_emu_write(handle, (const uint8_t*) "\x01\x02", 2));
+    CHECK(auth_value[0] == 7);
+    softdevice_emu_run();
+    CHECK(auths == 3 && writes == 0);
+    CHECK(auth_value[0] == 1 && auth_value[1] == 2);
+
+    deny_auth = true;
+    CHECK(softdevice_emu_write(handle, (const uint8_t*) "\x03\x04", 2));
+    softdevice_emu_run();
+    CHECK(softdevice_emu_auth_status() == BLE_GATT_STATUS_ATTERR_WRITE_NOT_PERMITTED);
+    CHECK(auth_value[0] == 1);
+
+    // Nothing to reply to
+    CHECK(simple_ble_grant_auth(&last_write) == NRF_ERROR_INVALID_STATE);
+    CHECK(app_errors() == 0);
+}
+
+// Parameters outside the PPCP get renegotiated by ble_conn_params after
+// FIRST_CONN_PARAMS_UPDATE_DELAY
+static void test_conn_params (void) {
+    ble_gap_conn_params_t slow = {
+        MSEC_TO_UNITS(2000, UNIT_1_25_MS), MSEC_TO_UNITS(2000, UNIT_1_25_MS),
+        0, MSEC_TO_UNITS(6000, UNIT_10_MS),
+    };
+    softdevice_emu_stats_t stats;
+
+    start();
+    CHECK(softdevice_emu_connect(&slow));
+    softdevice_emu_run();
+    softdevice_emu_advance(SOFTDEVICE_EMU_TICKS(999));
+    softdevice_emu_get_stats(&stats);
+    CHECK(stats.conn_param_updates == 0);
+    softdevice_emu_advance(SOFTDEVICE_EMU_TICKS(2));
+    softdevice_emu_get_stats(&stats);
+    CHECK(stats.conn_param_updates == 1);
+
+    // Accepted, so no more
+    softdevice_emu_advance(SOFTDEVICE_EMU_TICKS(60000));
+    softdevice_emu_get_stats(&stats);
+    CHECK(stats.conn_param_updates == 1);
+    CHECK(softdevice_emu_connected());
+
+    // Good ones from the start
+    softdevice_emu_disconnect(BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+    softdevice_emu_run();
+    softdevice_emu_reset_stats();
+    connect();
+    softdevice_emu_advance(SOFTDEVICE_EMU_TICKS(60000));
+    softdevice_emu_get_stats(&stats);
+    CHECK(stats.conn_param_updates == 0);
+    CHECK(app_errors() == 0);
+}
+
+static void adv_name (void) {
+    simple_adv_only_name();
+}
+
+static void adv_url (void) {
+    eddystone_with_name("goo.gl/abc");
+}
+
+static void test_multi_adv (void) {
+    const uint8_t* data;
+    uint8_t len;
+
+    start();
+    CHECK(multi_adv_init(1000) == NRF_SUCCESS);
+    CHECK(multi_adv_register_config(adv_name) == NRF_SUCCESS);
+    CHECK(multi_adv_register_config(adv_url) == NRF_SUCCESS);
+    CHECK(multi_adv_start() == NRF_SUCCESS);
+
+    softdevice_emu_advance(SOFTDEVICE_EMU_TICKS(999));
+    data = softdevice_emu_adv_data(&len);
+    CHECK(data[4] == BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME);
+    softdevice_emu_advance(SOFTDEVICE_EMU_TICKS(2));
+    data = softdevice_emu_adv_data(&len);
+    CHECK(data[4] == BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE);
+    softdevice_emu_advance(SOFTDEVICE_EMU_TICKS(1000));
+    data = softdevice_emu_adv_data(&len);
+    CHECK(data[4] == BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME);
+
+    CHECK(multi_adv_stop() == NRF_SUCCESS);
+    softdevice_emu_advance(SOFTDEVICE_EMU_TICKS(5000));
+    data = softdevice_emu_adv_data(&len);
+    CHECK(data[4] == BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME);
+    CHECK(app_errors() == 0);
+}
+
+static void test_scan (void) {
+    static const uint8_t adv[] = {
+        0x02, BLE_GAP_AD_TYPE_FLAGS, BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE,
+        0x05, BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA, 0xE0, 0x02, 0x11, 0x22,
+    };
+    ble_gap_addr_t peer = {BLE_GAP_ADDR_TYPE_PUBLIC, {1, 2, 3, 4, 5, 6}};
+
+    start();
+    CHECK(!softdevice_emu_adv_report(&peer, -60, false, adv, sizeof(adv)));
+    simple_ble_scan_start();
+    CHECK(softdevice_emu_scanning());
+    CHECK(softdevice_emu_adv_report(&peer, -60, false, adv, sizeof(adv)));
+    softdevice_emu_run();
+    CHECK(reports == 1);
+    CHECK(report_len == 4 && report_data[0] == 0xE0 && report_data[3] == 0x22);
+
+    // Starting again is fine
+    simple_ble_scan_start();
+    CHECK(softdevice_emu_scanning());
+    CHECK(app_errors() == 0);
+}
+
+// Things the SoftDevice refuses that the libraries might get wrong
+static void test_errors (void) {
+    ble_gap_adv_params_t params = {0};
+    ble_gatts_value_t value = {1, 4, rw_value};
+
+    start();
+
+    // Non-connectable advertising can't be faster than 100 ms
+    sd_ble_gap_adv_stop();
+    params.type = BLE_GAP_ADV_TYPE_ADV_NONCONN_IND;
+    params.interval = MSEC_TO_UNITS(20, UNIT_0_625_MS);
+    CHECK(sd_ble_gap_adv_start(&params) == NRF_ERROR_INVALID_PARAM);
+    params.interval = MSEC_TO_UNITS(100, UNIT_0_625_MS);
+    CHECK(sd_ble_gap_adv_start(&params) == NRF_SUCCESS);
+    CHECK(sd_ble_gap_adv_start(&params) == NRF_ERROR_INVALID_STATE);
+
+    CHECK(sd_ble_gatts_value_set(BLE_CONN_HANDLE_INVALID, rw_char.char_handle.value_handle, &value)
+          == NRF_ERROR_DATA_SIZE);
+    CHECK(sd_ble_gatts_value_set(BLE_CONN_HANDLE_INVALID, service.service_handle, &value)
+          == NRF_ERROR_FORBIDDEN);
+    CHECK(sd_ble_gatts_value_set(BLE_CONN_HANDLE_INVALID, 0x200, &value)
+          == BLE_ERROR_INVALID_ATTR_HANDLE);
+
+    // Characteristics only go in the last service
+    simple_ble_add_characteristic(1, 0, 0, 0, 1, rw_value, &service, &rw_char);
+    CHECK(app_errors() == 1);
+
+    // One vendor base: the same base again is fine, another isn't
+    {
+        simple_ble_service_t same = {.uuid128 = {{0x87, 0xa4, 0xde, 0xa0, 0x96, 0xea, 0x4e, 0xe6,
+                                                  0x87, 0x45, 0x83, 0x28, 0x00, 0x01, 0xad, 0x7b}}};
+        simple_ble_service_t other = {.uuid128 = {{1}}};
+        uint8_t type;
+
+        simple_ble_add_service(&same);
+        CHECK(app_errors() == 1);
+        CHECK(same.uuid_handle.type == service.uuid_handle.type);
+        CHECK(sd_ble_uuid_vs_add(&other.uuid128, &type) == NRF_ERROR_NO_MEM);
+    }
+}
+
+int main (void) {
+    test_init();
+    test_adv();
+    test_connect();
+    test_write();
+    test_notify();
+    test_sys_attr_missing();
+    test_auth();
+    test_conn_params();
+    test_multi_adv();
+    test_scan();
+    test_errors();
+
+    printf("simple_ble: %s\n", failures ? "FAILED" : "OK");
+    return failures != 0;
+}
@@ -0,0 +1,1501 @@
+// The S130 calls simple_ble and friends make, emulated in RAM. See
+// softdevice_emu.h.
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ble.h"
+#include "ble_hci.h"
+#include "nrf_error.h"
+#include "nrf_soc.h"
+#include "nrf_sdm.h"
+#include "app_error.h"
+#include "app_timer.h"
+#include "softdevice_handler.h"
+
+#include "softdevice_emu.h"
+
+// Largest table of stack values, and the S130 default
+#define POOL_SIZE       4096
+#define POOL_DEFAULT    0x580
+
+#define MAX_VS_UUIDS    10
+#define MAX_TIMERS      16
+#define RTC_MASK        0xFFFFFF
+
+// Room for the HVX queue: every TX buffer and one indication
+#define OUT_QUEUE       (SOFTDEVICE_EMU_TX_BUFFERS + 1)
+
+// Attribute types that aren't values
+#define TYPE_VALUE      0
+#define TYPE_SERVICE    BLE_UUID_SERVICE_PRIMARY
+#define TYPE_SECONDARY  BLE_UUID_SERVICE_SECONDARY
+#define TYPE_CHAR       BLE_UUID_CHARACTERISTIC
+#define TYPE_CCCD       BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG
+
+// The handles the GAP service values live at
+#define HANDLE_NAME         3
+#define HANDLE_APPEARANCE   5
+#define HANDLE_PPCP         7
+
+typedef struct {
+    uint16_t type;          // TYPE_* or a descriptor's UUID
+    ble_uuid_t uuid;        // the value's, or the service's for a service
+    uint16_t value_handle;  // the value a declaration or descriptor belongs to
+    uint16_t cccd_handle;   // a value's CCCD, 0 for none
+    ble_gatt_char_props_t props;
+    uint8_t vlen : 1;
+    uint8_t rd_auth : 1;
+    uint8_t wr_auth : 1;
+    uint8_t readable : 1;
+    uint8_t writable : 1;
+    uint16_t len;
+    uint16_t max_len;
+    uint8_t* value;         // user memory, or the pool
+} attr_t;
+
+typedef union {
+    ble_evt_t evt;
+    uint8_t bytes[BLE_STACK_EVT_MSG_BUF_SIZE];
+} event_t;
+
+typedef struct {
+    event_t event;
+    uint16_t len;
+} queued_event_t;
+
+// What an app_timer_t holds here
+typedef struct {
+    app_timer_timeout_handler_t handler;
+    void* context;
+    uint64_t due;
+    uint32_t period;
+    bool repeated;
+    bool running;
+} emu_timer_t;
+
+_Static_assert(sizeof(emu_timer_t) <= sizeof(app_timer_t), "emu_timer_t must fit in app_timer_t");
+
+uint8_t softdevice_emu_flash[8];
+
+static attr_t _attrs[SOFTDEVICE_EMU_MAX_ATTRS];
+static uint16_t _num_attrs;
+static uint16_t _last_service;
+
+static uint8_t _pool[POOL_SIZE];
+static uint16_t _pool_used;
+static uint16_t _pool_size;
+
+static ble_uuid128_t _vs_uuids[MAX_VS_UUIDS];
+static uint8_t _vs_count;
+static uint8_t _vs_max;
+
+static bool _enabled;
+static uint8_t _periph_links;
+static ble_evt_handler_t _ble_handler;
+static sys_evt_handler_t _sys_handler;
+
+static ble_gap_addr_t _address;
+static uint8_t _adv_data[BLE_GAP_ADV_MAX_SIZE];
+static uint8_t _adv_len;
+static uint8_t _sr_data[BLE_GAP_ADV_MAX_SIZE];
+static uint8_t _sr_len;
+static ble_gap_adv_params_t _adv_params;
+static bool _advertising;
+static bool _scanning;
+
+static bool _connected;
+static bool _sys_attrs_set;
+static uint8_t _tx_free;
+static bool _indication_pending;
+static uint16_t _auth_handle;       // value waiting on an authorization reply
+static uint8_t _auth_type;
+static uint8_t _auth_data[SOFTDEVICE_EMU_MAX_PAYLOAD];
+static uint16_t _auth_len;
+static uint16_t _auth_status;
+static uint16_t _auth_granted;      // value the application let the peer read
+
+static softdevice_emu_packet_t _out[OUT_QUEUE];
+static uint8_t _out_head;
+static uint8_t _out_count;
+
+static queued_event_t _events[SOFTDEVICE_EMU_EVENT_QUEUE];
+static uint8_t _events_head;
+static uint8_t _events_count;
+
+static bool _timers_initialized;
+static emu_timer_t* _timers[MAX_TIMERS];
+static uint8_t _num_timers;
+static uint64_t _now;
+
+static softdevice_emu_packet_t _log[SOFTDEVICE_EMU_PACKET_LOG];
+static softdevice_emu_stats_t _stats;
+
+
+/****** Attribute table ******/
+
+static attr_t* attr (uint16_t handle) {
+    if (handle == 0 || handle > _num_attrs) return NULL;
+    return &_attrs[handle - 1];
+}
+
+static attr_t* add_attr (uint16_t type, uint16_t* handle) {
+    attr_t* a;
+
+    if (_num_attrs == SOFTDEVICE_EMU_MAX_ATTRS) return NULL;
+    a = &_attrs[_num_attrs++];
+    memset(a, 0, sizeof(*a));
+    a->type = type;
+    a->readable = 1;
+    if (handle) *handle = _num_attrs;
+    return a;
+}
+
+// Room in the pool for a stack value
+static uint8_t* pool_alloc (uint16_t len) {
+    uint8_t* p;
+
+    // The SoftDevice keeps values word aligned
+    len = (len + 3) & ~3;
+    if (_pool_used + len > _pool_size) return NULL;
+    p = &_pool[_pool_used];
+    _pool_used += len;
+    memset(p, 0, len);
+    return p;
+}
+
+static bool perm_open (ble_gap_conn_sec_mode_t perm) {
+    return perm.sm != 0 && perm.lv != 0;
+}
+
+static bool uuid_valid (const ble_uuid_t* uuid) {
+    if (uuid == NULL) return false;
+    if (uuid->type == BLE_UUID_TYPE_BLE) return true;
+    return uuid->type >= BLE_UUID_TYPE_VENDOR_BEGIN &&
+           uuid->type - BLE_UUID_TYPE_VENDOR_BEGIN < _vs_count;
+}
+
+// Little endian UUID, as it goes over the air
+static uint8_t uuid_le (const ble_uuid_t* uuid, uint8_t* out) {
+    if (uuid->type == BLE_UUID_TYPE_BLE) {
+        out[0] = uuid->uuid & 0xFF;
+        out[1] = uuid->uuid >> 8;
+        return 2;
+    }
+    memcpy(out, _vs_uuids[uuid->type - BLE_UUID_TYPE_VENDOR_BEGIN].uuid128, 16);
+    out[12] = uuid->uuid & 0xFF;
+    out[13] = uuid->uuid >> 8;
+    return 16;
+}
+
+// The bytes a peer reads: the value, or a declaration made up on the fly
+static const uint8_t* attr_bytes (uint16_t handle, uint16_t* len) {
+    static uint8_t decl[3 + 16];
+    attr_t* a = attr(handle);
+
+    if (a->type == TYPE_SERVICE || a->type == TYPE_SECONDARY) {
+        *len = uuid_le(&a->uuid, decl);
+        return decl;
+    }
+    if (a->type == TYPE_CHAR) {
+        const ble_gatt_char_props_t* p = &attr(a->value_handle)->props;
+
+        decl[0] = p->broadcast | p->read << 1 | p->write_wo_resp << 2 | p->write << 3 |
+                  p->notify << 4 | p->indicate << 5 | p->auth_signed_wr << 6;
+        decl[1] = a->value_handle & 0xFF;
+        decl[2] = a->value_handle >> 8;
+        *len = 3 + uuid_le(&attr(a->value_handle)->uuid, decl + 3);
+        return decl;
+    }
+    *len = a->len;
+    return a->value;
+}
+
+static void add_gap_service (void) {
+    static const uint16_t uuids[] = {
+        BLE_UUID_GAP_CHARACTERISTIC_DEVICE_NAME,
+        BLE_UUID_GAP_CHARACTERISTIC_APPEARANCE,
+        BLE_UUID_GAP_CHARACTERISTIC_PPCP,
+    };
+    static const uint16_t lengths[] = {BLE_GAP_DEVNAME_MAX_LEN, 2, 8};
+    attr_t* a;
+
+    a = add_attr(TYPE_SERVICE, NULL);
+    a->uuid.type = BLE_UUID_TYPE_BLE;
+    a->uuid.uuid = BLE_UUID_GAP;
+
+    for (int i = 0; i < 3; i++) {
+        uint16_t value_handle = _num_attrs + 2;
+
+        a = add_attr(TYPE_CHAR, NULL);
+        a->value_handle = value_handle;
+
+        a = add_attr(TYPE_VALUE, NULL);
+        a->uuid.type = BLE_UUID_TYPE_BLE;
+        a->uuid.uuid = uuids[i];
+        a->props.read = 1;
+        a->vlen = i == 0;
+        a->max_len = lengths[i];
+        a->len = i == 0 ? 0 : lengths[i];
+        a->value = pool_alloc(lengths[i]);
+    }
+
+    a = add_attr(TYPE_SERVICE, NULL);
+    a->uuid.type = BLE_UUID_TYPE_BLE;
+    a->uuid.uuid = BLE_UUID_GATT;
+}
+
+
+/****** Events ******/
+
+static bool push_event (const event_t* event, uint16_t len) {
+    queued_event_t* q;
+
+    if (_events_count == SOFTDEVICE_EMU_EVENT_QUEUE) {
+        _stats.events_dropped++;
+        return false;
+    }
+    q = &_events[(_events_head + _events_count) % SOFTDEVICE_EMU_EVENT_QUEUE];
+    memcpy(&q->event, event, len);
+    q->len = len;
+    _events_count++;
+    return true;
+}
+
+// Start an event: header filled in, the rest zeroed. `len` counts from evt;
+// evt_len counts the header too, and the padding after it on the host.
+static event_t* new_event (event_t* event, uint16_t id, uint16_t len) {
+    memset(event, 0, sizeof(*event));
+    event->evt.header.evt_id = id;
+    event->evt.header.evt_len = offsetof(ble_evt_t, evt) + len;
+    return event;
+}
+
+static bool queue_event (event_t* event) {
+    return push_event(event, event->evt.header.evt_len);
+}
+
+static void queue_gap_event (event_t* event) {
+    event->evt.evt.gap_evt.conn_handle = _connected ? 0 : BLE_CONN_HANDLE_INVALID;
+    queue_event(event);
+}
+
+static void queue_disconnected (uint8_t reason) {
+    event_t event;
+
+    new_event(&event, BLE_GAP_EVT_DISCONNECTED, sizeof(ble_gap_evt_t));
+    event.evt.evt.gap_evt.conn_handle = 0;
+    event.evt.evt.gap_evt.params.disconnected.reason = reason;
+    queue_event(&event);
+}
+
+
+/****** Setup ******/
+
+void softdevice_emu_reset (void) {
+    _num_attrs = 0;
+    _last_service = 0;
+    _pool_used = 0;
+    _pool_size = POOL_DEFAULT;
+    _vs_count = 0;
+    _vs_max = MAX_VS_UUIDS;
+
+    _enabled = false;
+    _periph_links = 1;
+    _ble_handler = NULL;
+    _sys_handler = NULL;
+
+    memset(&_address, 0, sizeof(_address));
+    _address.addr_type = BLE_GAP_ADDR_TYPE_RANDOM_STATIC;
+    memcpy(_address.addr, "\x11\x22\x33\x44\x55\xC6", 6);
+    _adv_len = 0;
+    _sr_len = 0;
+    _advertising = false;
+    _scanning = false;
+
+    _connected = false;
+    _sys_attrs_set = false;
+    _tx_free = SOFTDEVICE_EMU_TX_BUFFERS;
+    _indication_pending = false;
+    _auth_handle = 0;
+    _auth_status = BLE_GATT_STATUS_SUCCESS;
+    _auth_granted = 0;
+    _out_count = 0;
+    _events_count = 0;
+
+    _timers_initialized = false;
+    _num_timers = 0;
+    _now = 0;
+
+    memset(softdevice_emu_flash, 0xFF, sizeof(softdevice_emu_flash));
+    softdevice_emu_reset_stats();
+
+    add_gap_service();
+}
+
+void softdevice_emu_reset_stats (void) {
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+uint32_t softdevice_handler_init (nrf_clock_lf_cfg_t* p_clock_lf_cfg,
+                                  void* p_ble_evt_buffer,
+                                  uint16_t ble_evt_buffer_size,
+                                  softdevice_evt_schedule_func_t evt_schedule_func) {
+    (void) p_clock_lf_cfg;
+    (void) evt_schedule_func;
+
+    if (_num_attrs == 0) softdevice_emu_reset();
+    if (p_ble_evt_buffer == NULL || ble_evt_buffer_size < BLE_STACK_EVT_MSG_BUF_SIZE) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    _enabled = true;
+    return NRF_SUCCESS;
+}
+
+uint32_t softdevice_enable_get_default_config (uint8_t central_links_count,
+                                               uint8_t periph_links_count,
+                                               ble_enable_params_t* p_ble_enable_params) {
+    memset(p_ble_enable_params, 0, sizeof(*p_ble_enable_params));
+    p_ble_enable_params->common_enable_params.vs_uuid_count   = 1;
+    p_ble_enable_params->gap_enable_params.central_conn_count = central_links_count;
+    p_ble_enable_params->gap_enable_params.periph_conn_count  = periph_links_count;
+    p_ble_enable_params->gatts_enable_params.attr_tab_size    = BLE_GATTS_ATTR_TAB_SIZE_DEFAULT;
+    return NRF_SUCCESS;
+}
+
+uint32_t softdevice_enable (ble_enable_params_t* p_ble_enable_params) {
+    uint32_t app_ram_base = 0;
+
+    return sd_ble_enable(p_ble_enable_params, &app_ram_base);
+}
+
+uint32_t sd_check_ram_start (uint32_t sd_req_ram_start) {
+    (void) sd_req_ram_start;
+    return NRF_SUCCESS;
+}
+
+uint32_t softdevice_ble_evt_handler_set (ble_evt_handler_t ble_evt_handler) {
+    if (ble_evt_handler == NULL) return NRF_ERROR_NULL;
+    _ble_handler = ble_evt_handler;
+    return NRF_SUCCESS;
+}
+
+uint32_t softdevice_sys_evt_handler_set (sys_evt_handler_t sys_evt_handler) {
+    if (sys_evt_handler == NULL) return NRF_ERROR_NULL;
+    _sys_handler = sys_evt_handler;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_enable (ble_enable_params_t* p_ble_enable_params, uint32_t* p_app_ram_base) {
+    const ble_enable_params_t* p = p_ble_enable_params;
+
+    _stats.svc_calls++;
+    if (!_enabled) return NRF_ERROR_INVALID_STATE;
+    if (p == NULL || p_app_ram_base == NULL) return NRF_ERROR_INVALID_ADDR;
+
+    _vs_max = p->common_enable_params.vs_uuid_count;
+    if (_vs_max == BLE_UUID_VS_COUNT_DEFAULT || _vs_max > MAX_VS_UUIDS) _vs_max = MAX_VS_UUIDS;
+    _pool_size = p->gatts_enable_params.attr_tab_size;
+    if (_pool_size == BLE_GATTS_ATTR_TAB_SIZE_DEFAULT) _pool_size = POOL_DEFAULT;
+    if (_pool_size > POOL_SIZE || _pool_size % 4 != 0) return NRF_ERROR_INVALID_PARAM;
+    _periph_links = p->gap_enable_params.periph_conn_count;
+    return NRF_SUCCESS;
+}
+
+// Errors from APP_ERROR_CHECK are counted and printed rather than fatal, so
+// a test sees every one
+void app_error_handler (uint32_t error_code, uint32_t line_num, const uint8_t* p_file_name) {
+    _stats.app_errors++;
+    _stats.last_app_error = error_code;
+    fprintf(stderr, "app_error 0x%x at %s:%u\n", (unsigned) error_code,
+            (const char*) p_file_name, (unsigned) line_num);
+}
+
+void app_error_handler_bare (ret_code_t error_code) {
+    _stats.app_errors++;
+    _stats.last_app_error = error_code;
+    fprintf(stderr, "app_error 0x%x\n", (unsigned) error_code);
+}
+
+
+/****** GAP ******/
+
+uint32_t sd_ble_gap_address_set (uint8_t addr_cycle_mode, const ble_gap_addr_t* p_addr) {
+    _stats.svc_calls++;
+    if (p_addr == NULL) return NRF_ERROR_INVALID_ADDR;
+    if (addr_cycle_mode != BLE_GAP_ADDR_CYCLE_MODE_NONE) return NRF_ERROR_NOT_SUPPORTED;
+    if (p_addr->addr_type > BLE_GAP_ADDR_TYPE_RANDOM_PRIVATE_NON_RESOLVABLE) {
+        return BLE_ERROR_GAP_INVALID_BLE_ADDR;
+    }
+    if (_advertising || _scanning || _connected) return NRF_ERROR_INVALID_STATE;
+    _address = *p_addr;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_address_get (ble_gap_addr_t* p_addr) {
+    _stats.svc_calls++;
+    if (p_addr == NULL) return NRF_ERROR_INVALID_ADDR;
+    *p_addr = _address;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_tx_power_set (int8_t tx_power) {
+    static const int8_t powers[] = {-40, -30, -20, -16, -12, -8, -4, 0, 4};
+
+    _stats.svc_calls++;
+    for (size_t i = 0; i < sizeof(powers); i++) {
+        if (powers[i] == tx_power) return NRF_SUCCESS;
+    }
+    return NRF_ERROR_INVALID_PARAM;
+}
+
+uint32_t sd_ble_gap_device_name_set (const ble_gap_conn_sec_mode_t* p_write_perm,
+                                     const uint8_t* p_dev_name, uint16_t len) {
+    attr_t* a = attr(HANDLE_NAME);
+
+    _stats.svc_calls++;
+    if (p_dev_name == NULL && len > 0) return NRF_ERROR_INVALID_ADDR;
+    if (len > BLE_GAP_DEVNAME_MAX_LEN) return NRF_ERROR_DATA_SIZE;
+    if (len > 0) memcpy(a->value, p_dev_name, len);
+    a->len = len;
+    a->writable = p_write_perm != NULL && perm_open(*p_write_perm);
+    a->props.write = a->writable;
+    return NRF_SUCCESS;
+}
+
+// Copies what fits and returns the full length, like the SoftDevice;
+// ble_advdata shortens the name with it
+uint32_t sd_ble_gap_device_name_get (uint8_t* p_dev_name, uint16_t* p_len) {
+    attr_t* a = attr(HANDLE_NAME);
+
+    _stats.svc_calls++;
+    if (p_len == NULL) return NRF_ERROR_INVALID_ADDR;
+    if (p_dev_name != NULL) memcpy(p_dev_name, a->value, a->len < *p_len ? a->len : *p_len);
+    *p_len = a->len;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_appearance_set (uint16_t appearance) {
+    attr_t* a = attr(HANDLE_APPEARANCE);
+
+    _stats.svc_calls++;
+    a->value[0] = appearance & 0xFF;
+    a->value[1] = appearance >> 8;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_appearance_get (uint16_t* p_appearance) {
+    attr_t* a = attr(HANDLE_APPEARANCE);
+
+    _stats.svc_calls++;
+    if (p_appearance == NULL) return NRF_ERROR_INVALID_ADDR;
+    *p_appearance = a->value[0] | a->value[1] << 8;
+    return NRF_SUCCESS;
+}
+
+static bool conn_params_valid (const ble_gap_conn_params_t* p) {
+    return p->min_conn_interval >= BLE_GAP_CP_MIN_CONN_INTVL_MIN &&
+           p->max_conn_interval <= BLE_GAP_CP_MAX_CONN_INTVL_MAX &&
+           p->min_conn_interval <= p->max_conn_interval &&
+           p->slave_latency <= BLE_GAP_CP_SLAVE_LATENCY_MAX &&
+           p->conn_sup_timeout >= BLE_GAP_CP_CONN_SUP_TIMEOUT_MIN &&
+           p->conn_sup_timeout <= BLE_GAP_CP_CONN_SUP_TIMEOUT_MAX;
+}
+
+uint32_t sd_ble_gap_ppcp_set (const ble_gap_conn_params_t* p_conn_params) {
+    const ble_gap_conn_params_t* p = p_conn_params;
+    uint8_t* v = attr(HANDLE_PPCP)->value;
+
+    _stats.svc_calls++;
+    if (p == NULL) return NRF_ERROR_INVALID_ADDR;
+    if (!conn_params_valid(p)) return NRF_ERROR_INVALID_PARAM;
+    uint16_t fields[4] = {p->min_conn_interval, p->max_conn_interval,
+                          p->slave_latency, p->conn_sup_timeout};
+    for (int i = 0; i < 4; i++) {
+        v[2 * i]     = fields[i] & 0xFF;
+        v[2 * i + 1] = fields[i] >> 8;
+    }
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_ppcp_get (ble_gap_conn_params_t* p_conn_params) {
+    const uint8_t* v = attr(HANDLE_PPCP)->value;
+
+    _stats.svc_calls++;
+    if (p_conn_params == NULL) return NRF_ERROR_INVALID_ADDR;
+    p_conn_params->min_conn_interval = v[0] | v[1] << 8;
+    p_conn_params->max_conn_interval = v[2] | v[3] << 8;
+    p_conn_params->slave_latency     = v[4] | v[5] << 8;
+    p_conn_params->conn_sup_timeout  = v[6] | v[7] << 8;
+    return NRF_SUCCESS;
+}
+
+// Walk the AD structures the way a scanner would
+static bool adv_data_valid (const uint8_t* data, uint8_t len) {
+    uint8_t i = 0;
+
+    while (i < len) {
+        if (data[i] == 0 || i + 1 + data[i] > len) return false;
+        i += 1 + data[i];
+    }
+    return true;
+}
+
+uint32_t sd_ble_gap_adv_data_set (const uint8_t* p_data, uint8_t dlen,
+                                  const uint8_t* p_sr_data, uint8_t srdlen) {
+    _stats.svc_calls++;
+    if ((p_data == NULL && dlen > 0) || (p_sr_data == NULL && srdlen > 0)) {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if (dlen > BLE_GAP_ADV_MAX_SIZE || srdlen > BLE_GAP_ADV_MAX_SIZE) return NRF_ERROR_DATA_SIZE;
+    if ((p_data && !adv_data_valid(p_data, dlen)) || (p_sr_data && !adv_data_valid(p_sr_data, srdlen))) {
+        return NRF_ERROR_INVALID_DATA;
+    }
+
+    // NULL leaves that part as it is
+    if (p_data != NULL) {
+        memcpy(_adv_data, p_data, dlen);
+        _adv_len = dlen;
+    }
+    if (p_sr_data != NULL) {
+        memcpy(_sr_data, p_sr_data, srdlen);
+        _sr_len = srdlen;
+    }
+    _stats.adv_data_sets++;
+    return NRF_SUCCESS;
+}
+
+static bool connectable (uint8_t type) {
+    return type == BLE_GAP_ADV_TYPE_ADV_IND || type == BLE_GAP_ADV_TYPE_ADV_DIRECT_IND;
+}
+
+uint32_t sd_ble_gap_adv_start (const ble_gap_adv_params_t* p_adv_params) {
+    const ble_gap_adv_params_t* p = p_adv_params;
+    uint16_t min_interval;
+
+    _stats.svc_calls++;
+    if (p == NULL) return NRF_ERROR_INVALID_ADDR;
+    if (_advertising) return NRF_ERROR_INVALID_STATE;
+    if (p->type > BLE_GAP_ADV_TYPE_ADV_NONCONN_IND) return NRF_ERROR_INVALID_PARAM;
+
+    min_interval = connectable(p->type) ? BLE_GAP_ADV_INTERVAL_MIN : BLE_GAP_ADV_NONCON_INTERVAL_MIN;
+    if (p->type != BLE_GAP_ADV_TYPE_ADV_DIRECT_IND &&
+        (p->interval < min_interval || p->interval > BLE_GAP_ADV_INTERVAL_MAX)) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (connectable(p->type) && _connected && _periph_links <= 1) return NRF_ERROR_CONN_COUNT;
+
+    _adv_params = *p;
+    _advertising = true;
+    _stats.adv_starts++;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_adv_stop (void) {
+    _stats.svc_calls++;
+    if (!_advertising) return NRF_ERROR_INVALID_STATE;
+    _advertising = false;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_scan_start (const ble_gap_scan_params_t* p_scan_params) {
+    _stats.svc_calls++;
+    if (p_scan_params == NULL) return NRF_ERROR_INVALID_ADDR;
+    if (_scanning) return NRF_ERROR_INVALID_STATE;
+    if (p_scan_params->window > p_scan_params->interval) return NRF_ERROR_INVALID_PARAM;
+    _scanning = true;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_scan_stop (void) {
+    _stats.svc_calls++;
+    if (!_scanning) return NRF_ERROR_INVALID_STATE;
+    _scanning = false;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_disconnect (uint16_t conn_handle, uint8_t hci_status_code) {
+    _stats.svc_calls++;
+    if (!_connected || conn_handle != 0) return BLE_ERROR_INVALID_CONN_HANDLE;
+    if (hci_status_code != BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION &&
+        hci_status_code != BLE_HCI_CONN_INTERVAL_UNACCEPTABLE) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    _connected = false;
+    _out_count = 0;
+    queue_disconnected(BLE_HCI_LOCAL_HOST_TERMINATED_CONNECTION);
+    return NRF_SUCCESS;
+}
+
+// The peer takes whatever the application asks for
+uint32_t sd_ble_gap_conn_param_update (uint16_t conn_handle, const ble_gap_conn_params_t* p_conn_params) {
+    ble_gap_conn_params_t params;
+    event_t event;
+
+    _stats.svc_calls++;
+    if (!_connected || conn_handle != 0) return BLE_ERROR_INVALID_CONN_HANDLE;
+    if (p_conn_params == NULL) {
+        sd_ble_gap_ppcp_get(&params);
+    } else {
+        if (!conn_params_valid(p_conn_params)) return NRF_ERROR_INVALID_PARAM;
+        params = *p_conn_params;
+    }
+    params.max_conn_interval = params.min_conn_interval;
+    _stats.conn_param_updates++;
+
+    new_event(&event, BLE_GAP_EVT_CONN_PARAM_UPDATE, sizeof(ble_gap_evt_t));
+    event.evt.evt.gap_evt.params.conn_param_update.conn_params = params;
+    queue_gap_event(&event);
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_sec_params_reply (uint16_t conn_handle, uint8_t sec_status,
+                                      const ble_gap_sec_params_t* p_sec_params,
+                                      const ble_gap_sec_keyset_t* p_sec_keyset) {
+    (void) sec_status;
+    (void) p_sec_params;
+    (void) p_sec_keyset;
+
+    _stats.svc_calls++;
+    if (!_connected || conn_handle != 0) return BLE_ERROR_INVALID_CONN_HANDLE;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_sec_info_reply (uint16_t conn_handle, const ble_gap_enc_info_t* p_enc_info,
+                                    const ble_gap_irk_t* p_id_info, const ble_gap_sign_info_t* p_sign_info) {
+    (void) p_enc_info;
+    (void) p_id_info;
+    (void) p_sign_info;
+
+    _stats.svc_calls++;
+    if (!_connected || conn_handle != 0) return BLE_ERROR_INVALID_CONN_HANDLE;
+    return NRF_SUCCESS;
+}
+
+
+/****** Common ******/
+
+uint32_t sd_ble_uuid_vs_add (const ble_uuid128_t* p_vs_uuid, uint8_t* p_uuid_type) {
+    _stats.svc_calls++;
+    if (p_vs_uuid == NULL || p_uuid_type == NULL) return NRF_ERROR_INVALID_ADDR;
+
+    // The same base again gets the same type; bytes 12 and 13 don't count
+    for (uint8_t i = 0; i < _vs_count; i++) {
+        if (memcmp(_vs_uuids[i].uuid128, p_vs_uuid->uuid128, 12) == 0 &&
+            memcmp(_vs_uuids[i].uuid128 + 14, p_vs_uuid->uuid128 + 14, 2) == 0) {
+            *p_uuid_type = BLE_UUID_TYPE_VENDOR_BEGIN + i;
+            return NRF_SUCCESS;
+        }
+    }
+    if (_vs_count == _vs_max) return NRF_ERROR_NO_MEM;
+    _vs_uuids[_vs_count] = *p_vs_uuid;
+    *p_uuid_type = BLE_UUID_TYPE_VENDOR_BEGIN + _vs_count++;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_uuid_encode (const ble_uuid_t* p_uuid, uint8_t* p_uuid_le_len, uint8_t* p_uuid_le) {
+    uint8_t le[16];
+
+    _stats.svc_calls++;
+    if (p_uuid == NULL || p_uuid_le_len == NULL) return NRF_ERROR_INVALID_ADDR;
+    if (!uuid_valid(p_uuid)) return NRF_ERROR_INVALID_PARAM;
+    *p_uuid_le_len = uuid_le(p_uuid, le);
+    if (p_uuid_le != NULL) memcpy(p_uuid_le, le, *p_uuid_le_len);
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_tx_packet_count_get (uint16_t conn_handle, uint8_t* p_count) {
+    _stats.svc_calls++;
+    if (p_count == NULL) return NRF_ERROR_INVALID_ADDR;
+    if (!_connected || conn_handle != 0) return BLE_ERROR_INVALID_CONN_HANDLE;
+    *p_count = SOFTDEVICE_EMU_TX_BUFFERS;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_evt_get (uint8_t* p_dest, uint16_t* p_len) {
+    queued_event_t* q = &_events[_events_head];
+
+    _stats.svc_calls++;
+    if (p_len == NULL) return NRF_ERROR_INVALID_ADDR;
+    if (_events_count == 0) return NRF_ERROR_NOT_FOUND;
+    if (p_dest == NULL) {
+        *p_len = q->len;
+        return NRF_SUCCESS;
+    }
+    if (*p_len < q->len) return NRF_ERROR_DATA_SIZE;
+
+    memcpy(p_dest, &q->event, q->len);
+    *p_len = q->len;
+    _events_head = (_events_head + 1) % SOFTDEVICE_EMU_EVENT_QUEUE;
+    _events_count--;
+    return NRF_SUCCESS;
+}
+
+// Nothing to sleep through on the host: deliver what is waiting
+uint32_t sd_app_evt_wait (void) {
+    _stats.svc_calls++;
+    softdevice_emu_run();
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_power_system_off (void) {
+    _stats.svc_calls++;
+    _advertising = false;
+    _scanning = false;
+    return NRF_SUCCESS;
+}
+
+
+/****** GATT server ******/
+
+uint32_t sd_ble_gatts_service_add (uint8_t type, const ble_uuid_t* p_uuid, uint16_t* p_handle) {
+    attr_t* a;
+
+    _stats.svc_calls++;
+    if (p_uuid == NULL || p_handle == NULL) return NRF_ERROR_INVALID_ADDR;
+    if (type != BLE_GATTS_SRVC_TYPE_PRIMARY && type != BLE_GATTS_SRVC_TYPE_SECONDARY) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (!uuid_valid(p_uuid)) return NRF_ERROR_INVALID_PARAM;
+
+    a = add_attr(type == BLE_GATTS_SRVC_TYPE_PRIMARY ? TYPE_SERVICE : TYPE_SECONDARY, p_handle);
+    if (a == NULL) return NRF_ERROR_NO_MEM;
+    a->uuid = *p_uuid;
+    _last_service = *p_handle;
+    return NRF_SUCCESS;
+}
+
+// Fill in a value or descriptor from its ble_gatts_attr_t
+static uint32_t set_attr (attr_t* a, const ble_gatts_attr_t* p_attr) {
+    const ble_gatts_attr_md_t* md = p_attr->p_attr_md;
+    uint16_t limit;
+
+    if (md == NULL) return NRF_ERROR_INVALID_ADDR;
+    if (!uuid_valid(p_attr->p_uuid)) return NRF_ERROR_INVALID_PARAM;
+    limit = md->vlen ? BLE_GATTS_VAR_ATTR_LEN_MAX : BLE_GATTS_FIX_ATTR_LEN_MAX;
+    if (p_attr->max_len == 0 || p_attr->max_len > limit) return NRF_ERROR_INVALID_PARAM;
+    if (p_attr->init_offs + p_attr->init_len > p_attr->max_len) return NRF_ERROR_INVALID_PARAM;
+
+    a->uuid     = *p_attr->p_uuid;
+    a->vlen     = md->vlen;
+    a->rd_auth  = md->rd_auth;
+    a->wr_auth  = md->wr_auth;
+    a->readable = perm_open(md->read_perm);
+    a->writable = perm_open(md->write_perm);
+    a->max_len  = p_attr->max_len;
+    a->len      = md->vlen ? p_attr->init_len : p_attr->max_len;
+
+    if (md->vloc == BLE_GATTS_VLOC_USER) {
+        if (p_attr->p_value == NULL) return NRF_ERROR_INVALID_PARAM;
+        a->value = p_attr->p_value;
+    } else if (md->vloc == BLE_GATTS_VLOC_STACK) {
+        a->value = pool_alloc(p_attr->max_len);
+        if (a->value == NULL) return NRF_ERROR_NO_MEM;
+        if (p_attr->p_value != NULL) {
+            memcpy(a->value + p_attr->init_offs, p_attr->p_value, p_attr->init_len);
+        }
+    } else {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    return NRF_SUCCESS;
+}
+
+static attr_t* add_descriptor (uint16_t type, uint16_t value_handle, uint16_t len, uint16_t* handle) {
+    attr_t* a = add_attr(type, handle);
+
+    if (a == NULL) return NULL;
+    a->uuid.type = BLE_UUID_TYPE_BLE;
+    a->uuid.uuid = type;
+    a->value_handle = value_handle;
+    a->max_len = len;
+    a->len = len;
+    a->value = pool_alloc(len);
+    return a->value ? a : NULL;
+}
+
+uint32_t sd_ble_gatts_characteristic_add (uint16_t service_handle,
+                                          const ble_gatts_char_md_t* p_char_md,
+                                          const ble_gatts_attr_t* p_attr_char_value,
+                                          ble_gatts_char_handles_t* p_handles) {
+    const ble_gatts_char_md_t* md = p_char_md;
+    uint16_t first = _num_attrs, pool = _pool_used;
+    uint16_t decl_handle;
+    attr_t* a;
+    uint32_t err;
+
+    _stats.svc_calls++;
+    if (md == NULL || p_attr_char_value == NULL || p_handles == NULL) return NRF_ERROR_INVALID_ADDR;
+    // Characteristics go in the service added last
+    if (service_handle == BLE_GATT_HANDLE_INVALID || service_handle != _last_service) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    memset(p_handles, 0, sizeof(*p_handles));
+
+    a = add_attr(TYPE_CHAR, &decl_handle);
+    if (a == NULL) return NRF_ERROR_NO_MEM;
+    a->value_handle = decl_handle + 1;
+
+    a = add_attr(TYPE_VALUE, &p_handles->value_handle);
+    err = a ? set_attr(a, p_attr_char_value) : NRF_ERROR_NO_MEM;
+    if (err == NRF_SUCCESS) {
+        a->props = md->char_props;
+        if (md->char_props.notify || md->char_props.indicate) {
+            attr_t* cccd = add_descriptor(TYPE_CCCD, p_handles->value_handle, 2, &p_handles->cccd_handle);
+
+            if (cccd == NULL) {
+                err = NRF_ERROR_NO_MEM;
+            } else {
+                cccd->writable = md->p_cccd_md == NULL || perm_open(md->p_cccd_md->write_perm);
+                attr(p_handles->value_handle)->cccd_handle = p_handles->cccd_handle;
+            }
+        }
+    }
+    if (err == NRF_SUCCESS && md->p_char_user_desc != NULL) {
+        uint16_t max = md->char_user_desc_max_size;
+        attr_t* desc;
+
+        if (max < md->char_user_desc_size) max = md->char_user_desc_size;
+        desc = add_descriptor(BLE_UUID_DESCRIPTOR_CHAR_USER_DESC, p_handles->value_handle, max,
+                              &p_handles->user_desc_handle);
+        if (desc == NULL) {
+            err = NRF_ERROR_NO_MEM;
+        } else {
+            memcpy(desc->value, md->p_char_user_desc, md->char_user_desc_size);
+            desc->len = md->char_user_desc_size;
+            desc->vlen = 1;
+        }
+    }
+    if (err == NRF_SUCCESS && md->p_char_pf != NULL) {
+        const ble_gatts_char_pf_t* pf = md->p_char_pf;
+        attr_t* desc = add_descriptor(BLE_UUID_DESCRIPTOR_CHAR_PRESENTATION_FORMAT,
+                                      p_handles->value_handle, 7, NULL);
+
+        if (desc == NULL) {
+            err = NRF_ERROR_NO_MEM;
+        } else {
+            uint8_t v[7] = {pf->format, (uint8_t) pf->exponent, pf->unit & 0xFF, pf->unit >> 8,
+                            pf->name_space, pf->desc & 0xFF, pf->desc >> 8};
+            memcpy(desc->value, v, 7);
+        }
+    }
+
+    if (err != NRF_SUCCESS) {
+        // Nothing of a characteristic that didn't fit stays
+        _num_attrs = first;
+        _pool_used = pool;
+        memset(p_handles, 0, sizeof(*p_handles));
+    }
+    return err;
+}
+
+uint32_t sd_ble_gatts_descriptor_add (uint16_t char_handle, const ble_gatts_attr_t* p_attr, uint16_t* p_handle) {
+    attr_t* a;
+    uint32_t err;
+
+    _stats.svc_calls++;
+    if (p_attr == NULL || p_handle == NULL) return NRF_ERROR_INVALID_ADDR;
+    if (attr(char_handle) == NULL || attr(char_handle)->type != TYPE_VALUE) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    a = add_attr(TYPE_VALUE, p_handle);
+    if (a == NULL) return NRF_ERROR_NO_MEM;
+    err = set_attr(a, p_attr);
+    if (err != NRF_SUCCESS) {
+        _num_attrs--;
+        return err;
+    }
+    a->type = a->uuid.uuid;
+    a->value_handle = char_handle;
+    return NRF_SUCCESS;
+}
+
+// Values and descriptors can be set; declarations can't
+static attr_t* value_attr (uint16_t handle, uint32_t* err) {
+    attr_t* a = attr(handle);
+
+    *err = NRF_SUCCESS;
+    if (a == NULL) {
+        *err = BLE_ERROR_INVALID_ATTR_HANDLE;
+    } else if (a->type == TYPE_SERVICE || a->type == TYPE_SECONDARY || a->type == TYPE_CHAR) {
+        *err = NRF_ERROR_FORBIDDEN;
+    }
+    return *err == NRF_SUCCESS ? a : NULL;
+}
+
+// Store a value, as a set or a write
+static uint32_t store (attr_t* a, uint16_t offset, const uint8_t* data, uint16_t len) {
+    if (offset > a->max_len) return NRF_ERROR_INVALID_PARAM;
+    if (offset + len > a->max_len) return NRF_ERROR_DATA_SIZE;
+    if (data != NULL) memcpy(a->value + offset, data, len);
+    if (a->vlen) {
+        a->len = offset + len;
+    } else if (offset + len > a->len) {
+        a->len = offset + len;
+    }
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_value_set (uint16_t conn_handle, uint16_t handle, ble_gatts_value_t* p_value) {
+    uint32_t err;
+    attr_t* a = value_attr(handle, &err);
+
+    _stats.svc_calls++;
+    if (a == NULL) return err;
+    if (p_value == NULL) return NRF_ERROR_INVALID_ADDR;
+    if (a->type == TYPE_CCCD && (!_connected || conn_handle != 0)) return BLE_ERROR_INVALID_CONN_HANDLE;
+    return store(a, p_value->offset, p_value->p_value, p_value->len);
+}
+
+uint32_t sd_ble_gatts_value_get (uint16_t conn_handle, uint16_t handle, ble_gatts_value_t* p_value) {
+    uint32_t err;
+    attr_t* a = value_attr(handle, &err);
+    uint16_t len;
+
+    _stats.svc_calls++;
+    if (a == NULL) return err;
+    if (p_value == NULL) return NRF_ERROR_INVALID_ADDR;
+    if (a->type == TYPE_CCCD && (!_connected || conn_handle != 0)) return BLE_ERROR_INVALID_CONN_HANDLE;
+    if (p_value->offset > a->len) return NRF_ERROR_INVALID_PARAM;
+
+    len = a->len - p_value->offset;
+    if (p_value->p_value != NULL) {
+        if (len > p_value->len) len = p_value->len;
+        memcpy(p_value->p_value, a->value + p_value->offset, len);
+    }
+    p_value->len = len;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_sys_attr_set (uint16_t conn_handle, const uint8_t* p_sys_attr_data,
+                                    uint16_t len, uint32_t flags) {
+    (void) p_sys_attr_data;
+    (void) len;
+    (void) flags;
+
+    _stats.svc_calls++;
+    if (!_connected || conn_handle != 0) return BLE_ERROR_INVALID_CONN_HANDLE;
+
+    // Stored CCCD values aren't emulated: everything starts off
+    for (uint16_t h = 1; h <= _num_attrs; h++) {
+        attr_t* a = attr(h);
+        if (a->type == TYPE_CCCD) memset(a->value, 0, 2);
+    }
+    _sys_attrs_set = true;
+    return NRF_SUCCESS;
+}
+
+static uint16_t cccd_value (const attr_t* a) {
+    const attr_t* cccd = attr(a->cccd_handle);
+    return cccd ? cccd->value[0] | cccd->value[1] << 8 : 0;
+}
+
+uint32_t sd_ble_gatts_hvx (uint16_t conn_handle, const ble_gatts_hvx_params_t* p_hvx_params) {
+    const ble_gatts_hvx_params_t* p = p_hvx_params;
+    softdevice_emu_packet_t* packet;
+    attr_t* a;
+    uint16_t len;
+    uint32_t err;
+
+    _stats.svc_calls++;
+    if (p == NULL) return NRF_ERROR_INVALID_ADDR;
+    if (!_connected || conn_handle != 0) return BLE_ERROR_INVALID_CONN_HANDLE;
+    a = attr(p->handle);
+    if (a == NULL || a->type != TYPE_VALUE) return BLE_ERROR_INVALID_ATTR_HANDLE;
+    if (p->type == BLE_GATT_HVX_NOTIFICATION) {
+        if (!a->props.notify) return NRF_ERROR_INVALID_PARAM;
+    } else if (p->type == BLE_GATT_HVX_INDICATION) {
+        if (!a->props.indicate) return NRF_ERROR_INVALID_PARAM;
+    } else {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (!_sys_attrs_set) return BLE_ERROR_GATTS_SYS_ATTR_MISSING;
+    if (!(cccd_value(a) & (p->type == BLE_GATT_HVX_NOTIFICATION ? BLE_GATT_HVX_NOTIFICATION
+                                                                : BLE_GATT_HVX_INDICATION))) {
+        _stats.hvx_not_enabled++;
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if (p->type == BLE_GATT_HVX_NOTIFICATION && _tx_free == 0) {
+        _stats.hvx_no_buffers++;
+        return BLE_ERROR_NO_TX_PACKETS;
+    }
+    if (p->type == BLE_GATT_HVX_INDICATION && _indication_pending) return NRF_ERROR_BUSY;
+
+    // New data goes in the value first
+    if (p->p_data != NULL) {
+        if (p->p_len == NULL) return NRF_ERROR_INVALID_ADDR;
+        err = store(a, p->offset, p->p_data, *p->p_len);
+        if (err != NRF_SUCCESS) return err;
+    }
+    if (p->offset > a->len) return NRF_ERROR_INVALID_PARAM;
+    len = a->len - p->offset;
+    if (p->p_len != NULL && *p->p_len < len) len = *p->p_len;
+    if (len > SOFTDEVICE_EMU_MAX_PAYLOAD) len = SOFTDEVICE_EMU_MAX_PAYLOAD;
+
+    packet = &_out[(_out_head + _out_count) % OUT_QUEUE];
+    packet->handle = p->handle;
+    packet->type = p->type;
+    packet->len = len;
+    memcpy(packet->data, a->value + p->offset, len);
+    _out_count++;
+
+    if (p->type == BLE_GATT_HVX_NOTIFICATION) {
+        _tx_free--;
+    } else {
+        _indication_pending = true;
+    }
+    if (p->p_len != NULL) *p->p_len = len;
+    _stats.hvx++;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gatts_rw_authorize_reply (uint16_t conn_handle,
+                                          const ble_gatts_rw_authorize_reply_params_t* p_reply) {
+    attr_t* a = attr(_auth_handle);
+
+    _stats.svc_calls++;
+    if (p_reply == NULL) return NRF_ERROR_INVALID_ADDR;
+    if (!_connected || conn_handle != 0) return BLE_ERROR_INVALID_CONN_HANDLE;
+    if (_auth_handle == 0 || p_reply->type != _auth_type) return NRF_ERROR_INVALID_STATE;
+
+    if (p_reply->type == BLE_GATTS_AUTHORIZE_TYPE_READ) {
+        const ble_gatts_authorize_params_t* r = &p_reply->params.read;
+
+        _auth_status = r->gatt_status;
+        if (r->gatt_status == BLE_GATT_STATUS_SUCCESS) {
+            if (r->update) store(a, r->offset, r->p_data, r->len);
+            _auth_granted = _auth_handle;
+        }
+    } else {
+        const ble_gatts_authorize_params_t* w = &p_reply->params.write;
+
+        // The S130 2.0 stores the peer's data itself once allowed
+        _auth_status = w->gatt_status;
+        if (w->gatt_status == BLE_GATT_STATUS_SUCCESS) store(a, 0, _auth_data, _auth_len);
+    }
+    _auth_handle = 0;
+    return NRF_SUCCESS;
+}
+
+
+/****** The peer ******/
+
+bool softdevice_emu_connect (const ble_gap_conn_params_t* params) {
+    ble_gap_conn_params_t ppcp;
+    event_t event;
+    ble_gap_evt_connected_t* c;
+
+    if (_connected || !_advertising || !connectable(_adv_params.type)) return false;
+
+    _advertising = false;
+    _connected = true;
+    _sys_attrs_set = false;
+    _tx_free = SOFTDEVICE_EMU_TX_BUFFERS;
+    _indication_pending = false;
+    _auth_handle = 0;
+    _auth_granted = 0;
+    _out_count = 0;
+
+    new_event(&event, BLE_GAP_EVT_CONNECTED, sizeof(ble_gap_evt_t));
+    c = &event.evt.evt.gap_evt.params.connected;
+    c->peer_addr.addr_type = BLE_GAP_ADDR_TYPE_RANDOM_STATIC;
+    memcpy(c->peer_addr.addr, "\x01\x02\x03\x04\x05\xC0", 6);
+    c->own_addr = _address;
+    c->role = BLE_GAP_ROLE_PERIPH;
+    if (params != NULL) {
+        c->conn_params = *params;
+    } else {
+        sd_ble_gap_ppcp_get(&ppcp);
+        ppcp.min_conn_interval = (ppcp.min_conn_interval + ppcp.max_conn_interval) / 2;
+        ppcp.max_conn_interval = ppcp.min_conn_interval;
+        c->conn_params = ppcp;
+    }
+    queue_gap_event(&event);
+    return true;
+}
+
+bool softdevice_emu_disconnect (uint8_t reason) {
+    if (!_connected) return false;
+    _connected = false;
+    _out_count = 0;
+    queue_disconnected(reason);
+    return true;
+}
+
+static void queue_sys_attr_missing (void) {
+    event_t event;
+
+    new_event(&event, BLE_GATTS_EVT_SYS_ATTR_MISSING, sizeof(ble_gatts_evt_t));
+    queue_event(&event);
+}
+
+bool softdevice_emu_write (uint16_t handle, const uint8_t* data, uint16_t len) {
+    attr_t* a = attr(handle);
+    event_t event;
+    ble_gatts_evt_t* g = &event.evt.evt.gatts_evt;
+    uint16_t evt_len = offsetof(ble_gatts_evt_t, params.write.data) + len;
+
+    if (!_connected || a == NULL || !a->writable || len > SOFTDEVICE_EMU_MAX_PAYLOAD) return false;
+    if (a->type == TYPE_VALUE && !(a->props.write || a->props.write_wo_resp)) return false;
+    if (a->type == TYPE_SERVICE || a->type == TYPE_SECONDARY || a->type == TYPE_CHAR) return false;
+    if (len > a->max_len) return false;
+
+    if (a->type == TYPE_CCCD && !_sys_attrs_set) {
+        queue_sys_attr_missing();
+        return false;
+    }
+    // One request at a time
+    if (_auth_handle != 0) return false;
+
+    if (a->wr_auth) {
+        ble_gatts_evt_write_t* w = &g->params.authorize_request.request.write;
+
+        evt_len = offsetof(ble_gatts_evt_t, params.authorize_request.request.write.data) + len;
+        new_event(&event, BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST, evt_len);
+        g->conn_handle = 0;
+        g->params.authorize_request.type = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+        w->handle = handle;
+        w->uuid = a->uuid;
+        w->op = BLE_GATTS_OP_WRITE_REQ;
+        w->len = len;
+        memcpy(w->data, data, len);
+
+        _auth_handle = handle;
+        _auth_type = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+        memcpy(_auth_data, data, len);
+        _auth_len = len;
+        return queue_event(&event);
+    }
+
+    store(a, 0, data, len);
+    new_event(&event, BLE_GATTS_EVT_WRITE, evt_len);
+    g->conn_handle = 0;
+    g->params.write.handle = handle;
+    g->params.write.uuid = a->uuid;
+    g->params.write.op = BLE_GATTS_OP_WRITE_REQ;
+    g->params.write.len = len;
+    memcpy(g->params.write.data, data, len);
+    return queue_event(&event);
+}
+
+static bool write_cccd (uint16_t value_handle, uint16_t bits) {
+    attr_t* a = attr(value_handle);
+    uint8_t v[2] = {bits & 0xFF, bits >> 8};
+
+    if (a == NULL || a->cccd_handle == 0) return false;
+    return softdevice_emu_write(a->cccd_handle, v, 2);
+}
+
+bool softdevice_emu_enable_notify (uint16_t value_handle) {
+    return write_cccd(value_handle, BLE_GATT_HVX_NOTIFICATION);
+}
+
+bool softdevice_emu_enable_indicate (uint16_t value_handle) {
+    return write_cccd(value_handle, BLE_GATT_HVX_INDICATION);
+}
+
+int softdevice_emu_read (uint16_t handle, uint8_t* data, uint16_t max_len) {
+    attr_t* a = attr(handle);
+    const uint8_t* bytes;
+    uint16_t len;
+
+    if (!_connected || a == NULL || !a->readable) return -1;
+    if (a->type == TYPE_CCCD && !_sys_attrs_set) {
+        queue_sys_attr_missing();
+        return -1;
+    }
+
+    if (_auth_handle != 0) return -1;
+    if (a->rd_auth && _auth_granted != handle) {
+        event_t event;
+        ble_gatts_evt_t* g = &event.evt.evt.gatts_evt;
+
+        new_event(&event, BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST, sizeof(ble_gatts_evt_t));
+        g->conn_handle = 0;
+        g->params.authorize_request.type = BLE_GATTS_AUTHORIZE_TYPE_READ;
+        g->params.authorize_request.request.read.handle = handle;
+        g->params.authorize_request.request.read.uuid = a->uuid;
+        _auth_handle = handle;
+        _auth_type = BLE_GATTS_AUTHORIZE_TYPE_READ;
+        queue_event(&event);
+        return -1;
+    }
+    _auth_granted = 0;
+
+    bytes = attr_bytes(handle, &len);
+    if (len > max_len) len = max_len;
+    memcpy(data, bytes, len);
+    return len;
+}
+
+bool softdevice_emu_adv_report (const ble_gap_addr_t* peer, int8_t rssi, bool scan_rsp,
+                                const uint8_t* data, uint8_t len) {
+    event_t event;
+    ble_gap_evt_adv_report_t* r = &event.evt.evt.gap_evt.params.adv_report;
+
+    if (!_scanning || len > BLE_GAP_ADV_MAX_SIZE) return false;
+
+    new_event(&event, BLE_GAP_EVT_ADV_REPORT, sizeof(ble_gap_evt_t));
+    event.evt.evt.gap_evt.conn_handle = BLE_CONN_HANDLE_INVALID;
+    r->peer_addr = *peer;
+    r->rssi = rssi;
+    r->scan_rsp = scan_rsp;
+    r->type = scan_rsp ? BLE_GAP_ADV_TYPE_ADV_SCAN_IND : BLE_GAP_ADV_TYPE_ADV_IND;
+    r->dlen = len;
+    memcpy(r->data, data, len);
+    return queue_event(&event);
+}
+
+void softdevice_emu_gap_timeout (uint8_t src) {
+    event_t event;
+
+    if (src == BLE_GAP_TIMEOUT_SRC_ADVERTISING) _advertising = false;
+    if (src == BLE_GAP_TIMEOUT_SRC_SCAN) _scanning = false;
+
+    new_event(&event, BLE_GAP_EVT_TIMEOUT, sizeof(ble_gap_evt_t));
+    event.evt.evt.gap_evt.params.timeout.src = src;
+    queue_gap_event(&event);
+}
+
+bool softdevice_emu_inject (const ble_evt_t* evt) {
+    if (evt->header.evt_len > sizeof(event_t)) return false;
+    return push_event((const event_t*) evt, evt->header.evt_len);
+}
+
+
+/****** The radio and the clock ******/
+
+uint32_t softdevice_emu_run (void) {
+    static event_t event;
+    uint32_t count = 0;
+    uint16_t len = sizeof(event);
+
+    while (sd_ble_evt_get(event.bytes, &len) == NRF_SUCCESS) {
+        if (_ble_handler != NULL) _ble_handler(&event.evt);
+        _stats.events++;
+        count++;
+        len = sizeof(event);
+    }
+    return count;
+}
+
+uint32_t softdevice_emu_connection_event (void) {
+    uint32_t sent = 0, notifications = 0;
+    event_t event;
+
+    if (!_connected) return 0;
+    _stats.connection_events++;
+
+    while (_out_count > 0 && sent < SOFTDEVICE_EMU_PACKETS_PER_EVENT) {
+        softdevice_emu_packet_t* packet = &_out[_out_head];
+
+        _log[_stats.packets % SOFTDEVICE_EMU_PACKET_LOG] = *packet;
+        _stats.packets++;
+        _stats.bytes += packet->len;
+
+        if (packet->type == BLE_GATT_HVX_NOTIFICATION) {
+            notifications++;
+        } else {
+            // Confirmed straight away
+            _indication_pending = false;
+            new_event(&event, BLE_GATTS_EVT_HVC, sizeof(ble_gatts_evt_t));
+            event.evt.evt.gatts_evt.conn_handle = 0;
+            event.evt.evt.gatts_evt.params.hvc.handle = packet->handle;
+            queue_event(&event);
+        }
+        _out_head = (_out_head + 1) % OUT_QUEUE;
+        _out_count--;
+        sent++;
+    }
+
+    if (notifications > 0) {
+        _tx_free += notifications;
+        new_event(&event, BLE_EVT_TX_COMPLETE, sizeof(ble_common_evt_t));
+        event.evt.evt.common_evt.conn_handle = 0;
+        event.evt.evt.common_evt.params.tx_complete.count = notifications;
+        queue_event(&event);
+    }
+    return sent;
+}
+
+static emu_timer_t* timer (app_timer_id_t id) {
+    return (emu_timer_t*) id;
+}
+
+void softdevice_emu_advance (uint32_t ticks) {
+    uint64_t end = _now + ticks;
+
+    for (;;) {
+        emu_timer_t* next = NULL;
+
+        for (uint8_t i = 0; i < _num_timers; i++) {
+            emu_timer_t* t = _timers[i];
+            if (t->running && t->due <= end && (next == NULL || t->due < next->due)) next = t;
+        }
+        if (next == NULL) break;
+
+        _now = next->due;
+        if (next->repeated) {
+            next->due += next->period;
+        } else {
+            next->running = false;
+        }
+        _stats.timer_expiries++;
+        next->handler(next->context);
+        softdevice_emu_run();
+    }
+    _now = end;
+    softdevice_emu_run();
+}
+
+uint64_t softdevice_emu_now (void) {
+    return _now;
+}
+
+uint32_t app_timer_init (uint32_t prescaler, uint8_t op_queues_size, void* p_buffer,
+                         app_timer_evt_schedule_func_t evt_schedule_func) {
+    (void) op_queues_size;
+    (void) evt_schedule_func;
+
+    if (p_buffer == NULL) return NRF_ERROR_INVALID_PARAM;
+    // Ticks here are 1/32768 s
+    if (prescaler != 0) return NRF_ERROR_NOT_SUPPORTED;
+    _timers_initialized = true;
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_create (const app_timer_id_t* p_timer_id, app_timer_mode_t mode,
+                           app_timer_timeout_handler_t timeout_handler) {
+    emu_timer_t* t;
+    uint8_t i;
+
+    if (!_timers_initialized) return NRF_ERROR_INVALID_STATE;
+    if (p_timer_id == NULL || timeout_handler == NULL) return NRF_ERROR_INVALID_PARAM;
+
+    t = timer(*p_timer_id);
+    for (i = 0; i < _num_timers && _timers[i] != t; i++);
+    if (i == _num_timers) {
+        if (_num_timers == MAX_TIMERS) return NRF_ERROR_NO_MEM;
+        _timers[_num_timers++] = t;
+    }
+    memset(t, 0, sizeof(*t));
+    t->handler = timeout_handler;
+    t->repeated = mode == APP_TIMER_MODE_REPEATED;
+    return NRF_SUCCESS;
+}
+
+// Starting a running timer does nothing, as with SDK 11
+uint32_t app_timer_start (app_timer_id_t timer_id, uint32_t timeout_ticks, void* p_context) {
+    emu_timer_t* t = timer(timer_id);
+
+    if (timeout_ticks < APP_TIMER_MIN_TIMEOUT_TICKS) return NRF_ERROR_INVALID_PARAM;
+    if (t == NULL || t->handler == NULL) return NRF_ERROR_INVALID_STATE;
+    if (t->running) return NRF_SUCCESS;
+
+    t->context = p_context;
+    t->due = _now + timeout_ticks;
+    t->period = timeout_ticks;
+    t->running = true;
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_stop (app_timer_id_t timer_id) {
+    emu_timer_t* t = timer(timer_id);
+
+    if (t == NULL || t->handler == NULL) return NRF_ERROR_INVALID_STATE;
+    t->running = false;
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_stop_all (void) {
+    for (uint8_t i = 0; i < _num_timers; i++) _timers[i]->running = false;
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_cnt_get (uint32_t* p_ticks) {
+    *p_ticks = _now & RTC_MASK;
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_cnt_diff_compute (uint32_t ticks_to, uint32_t ticks_from, uint32_t* p_ticks_diff) {
+    *p_ticks_diff = (ticks_to - ticks_from) & RTC_MASK;
+    return NRF_SUCCESS;
+}
+
+
+/****** Looking in ******/
+
+const uint8_t* softdevice_emu_adv_data (uint8_t* len) {
+    *len = _adv_len;
+    return _adv_data;
+}
+
+const uint8_t* softdevice_emu_scan_rsp_data (uint8_t* len) {
+    *len = _sr_len;
+    return _sr_data;
+}
+
+const ble_gap_adv_params_t* softdevice_emu_advertising (void) {
+    return _advertising ? &_adv_params : NULL;
+}
+
+bool softdevice_emu_scanning (void) {
+    return _scanning;
+}
+
+bool softdevice_emu_connected (void) {
+    return _connected;
+}
+
+void softdevice_emu_address (ble_gap_addr_t* addr) {
+    *addr = _address;
+}
+
+uint16_t softdevice_emu_find (const ble_uuid_t* uuid, uint16_t from) {
+    for (uint16_t h = from + 1; h <= _num_attrs; h++) {
+        attr_t* a = attr(h);
+
+        if (a->type == TYPE_VALUE && attr(h - 1)->type == TYPE_CHAR &&
+            a->uuid.type == uuid->type && a->uuid.uuid == uuid->uuid) {
+            return h;
+        }
+    }
+    return 0;
+}
+
+uint16_t softdevice_emu_auth_status (void) {
+    return _auth_status;
+}
+
+uint8_t softdevice_emu_tx_free (void) {
+    return _tx_free;
+}
+
+const softdevice_emu_packet_t* softdevice_emu_packet (uint32_t n) {
+    if (n >= _stats.packets || _stats.packets - n > SOFTDEVICE_EMU_PACKET_LOG) return NULL;
+    return &_log[n % SOFTDEVICE_EMU_PACKET_LOG];
+}
+
+void softdevice_emu_get_stats (softdevice_emu_stats_t* stats) {
+    *stats = _stats;
+}
+
+void softdevice_emu_dump (void) {
+    for (uint16_t h = 1; h <= _num_attrs; h++) {
+        attr_t* a = attr(h);
+        const uint8_t* bytes;
+        uint16_t len;
+
+        switch (a->type) {
+            case TYPE_SERVICE:   printf("%3u service   ", h); break;
+            case TYPE_SECONDARY: printf("%3u secondary ", h); break;
+            case TYPE_CHAR:      printf("%3u   char    ", h); break;
+            case TYPE_VALUE:     printf("%3u     value ", h); break;
+            default:             printf("%3u     %04x  ", h, a->type); break;
+        }
+        printf("%u:%04x ", a->uuid.type, a->uuid.uuid);
+        bytes = attr_bytes(h, &len);
+        for (uint16_t i = 0; i < len && i < 20; i++) printf("%02x", bytes[i]);
+        printf("%s\n", len > 20 ? "..." : "");
+    }
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ble.h"
+
+// An S130 in RAM, so simple_ble.c, advertisement/ and services/ run on the
+// host unchanged. Built with SVCALL_AS_NORMAL_FUNCTION the sd_* calls are
+// plain functions, and this file provides them, the softdevice_handler and
+// app_timer calls simple_ble makes, and app_error_handler().
+//
+// What is there is what the lab11 libraries lean on: a GATT table with the
+// GAP service, user and stack values, CCCDs and authorization; notifications
+// that take a TX buffer until a connection event sends them; advertising
+// and scan response data, checked like the SoftDevice checks them; and
+// app_timer in RTC ticks that only move when the test says so.
+//
+// The test plays the radio and the peer. softdevice_emu_connect() and the
+// others queue an event, as the SoftDevice would; softdevice_emu_run()
+// hands queued events to the handler simple_ble registered, which is what
+// the SWI2 interrupt does on a chip.
+//
+//   simple_ble_init(&config);
+//   softdevice_emu_connect(NULL);
+//   softdevice_emu_enable_notify(my_char.char_handle.value_handle);
+//   softdevice_emu_run();
+//   simple_ble_notify_char(&my_char);
+//   softdevice_emu_connection_event();    // the notification goes out
+
+// Attributes in the table, the GAP service included
+#ifndef SOFTDEVICE_EMU_MAX_ATTRS
+#define SOFTDEVICE_EMU_MAX_ATTRS 96
+#endif
+
+// Events waiting for softdevice_emu_run()
+#ifndef SOFTDEVICE_EMU_EVENT_QUEUE
+#define SOFTDEVICE_EMU_EVENT_QUEUE 32
+#endif
+
+// Notifications that fit in the SoftDevice's buffers at once, and most sent
+// per connection event. 6 and 6 is the S130 with the default bandwidth.
+#ifndef SOFTDEVICE_EMU_TX_BUFFERS
+#define SOFTDEVICE_EMU_TX_BUFFERS 6
+#endif
+
+#ifndef SOFTDEVICE_EMU_PACKETS_PER_EVENT
+#define SOFTDEVICE_EMU_PACKETS_PER_EVENT 6
+#endif
+
+// Packets kept for softdevice_emu_packet()
+#ifndef SOFTDEVICE_EMU_PACKET_LOG
+#define SOFTDEVICE_EMU_PACKET_LOG 64
+#endif
+
+// Notification payload with the default ATT MTU
+#define SOFTDEVICE_EMU_MAX_PAYLOAD (GATT_MTU_SIZE_DEFAULT - 3)
+
+// Handles the GAP and GATT services take; user attributes start after them
+#define SOFTDEVICE_EMU_FIRST_USER_HANDLE 9
+
+// RTC1 ticks at prescaler 0
+#define SOFTDEVICE_EMU_TICKS(ms) ((uint32_t)((uint64_t)(ms) * 32768 / 1000))
+
+typedef struct {
+    uint16_t handle;
+    uint8_t  type;              // BLE_GATT_HVX_NOTIFICATION or _INDICATION
+    uint8_t  len;
+    uint8_t  data[SOFTDEVICE_EMU_MAX_PAYLOAD];
+} softdevice_emu_packet_t;
+
+typedef struct {
+    uint32_t svc_calls;         // sd_* calls made
+    uint32_t events;            // events handed to the application
+    uint32_t events_dropped;    // queued while the queue was full
+    uint32_t hvx;               // notifications and indications accepted
+    uint32_t hvx_no_buffers;    // refused with BLE_ERROR_NO_TX_PACKETS
+    uint32_t hvx_not_enabled;   // refused because the CCCD was off
+    uint32_t packets;           // sent in connection events
+    uint32_t bytes;             // payload of those
+    uint32_t connection_events;
+    uint32_t adv_data_sets;     // sd_ble_gap_adv_data_set() accepted
+    uint32_t adv_starts;
+    uint32_t conn_param_updates;
+    uint32_t timer_expiries;    // app_timer handlers run
+    uint32_t app_errors;        // APP_ERROR_CHECK failures
+    uint32_t last_app_error;
+} softdevice_emu_stats_t;
+
+// Where simple_ble looks for a BLE address (BLEADDR_FLASH_LOCATION).
+// Erased, so the address comes from the config.
+extern uint8_t softdevice_emu_flash[8];
+
+// Forget everything: the table, advertising, the connection, timers, events
+// and stats. Call it before simple_ble_init() to start over with a fresh
+// stack.
+void softdevice_emu_reset (void);
+
+// Zero the stats and forget the packets sent
+void softdevice_emu_reset_stats (void);
+
+/****** The peer ******/
+
+// Connect to the advertiser, with these parameters or ones in the middle of
+// its PPCP. False if not advertising connectably.
+bool softdevice_emu_connect (const ble_gap_conn_params_t* params);
+
+// The peer goes away, or the link drops
+bool softdevice_emu_disconnect (uint8_t reason);
+
+// Write Request from the peer. Writes to a CCCD work before the application
+// set the system attributes only after a SYS_ATTR_MISSING event, as with the
+// SoftDevice. Values with write authorization raise RW_AUTHORIZE_REQUEST
+// and change once the application replies. False if the attribute can't be
+// written.
+bool softdevice_emu_write (uint16_t handle, const uint8_t* data, uint16_t len);
+
+// Write 0x0001 (or 0x0002 for indications) to the CCCD of a value handle
+bool softdevice_emu_enable_notify (uint16_t value_handle);
+bool softdevice_emu_enable_indicate (uint16_t value_handle);
+
+// Read Request from the peer. Values with read authorization raise
+// RW_AUTHORIZE_REQUEST; read them again after softdevice_emu_run().
+// Returns the length read into data, or -1 if the read is refused or waits
+// for authorization.
+int softdevice_emu_read (uint16_t handle, uint8_t* data, uint16_t max_len);
+
+// An advertisement heard while scanning. False if not scanning.
+bool softdevice_emu_adv_report (const ble_gap_addr_t* peer, int8_t rssi, bool scan_rsp,
+                                const uint8_t* data, uint8_t len);
+
+// BLE_GAP_EVT_TIMEOUT; advertising and scanning stop for those sources
+void softdevice_emu_gap_timeout (uint8_t src);
+
+// Queue any event as it is
+bool softdevice_emu_inject (const ble_evt_t* evt);
+
+/****** The radio and the clock ******/
+
+// Hand every queued event to the application. Returns how many.
+uint32_t softdevice_emu_run (void);
+
+// A connection event: send up to SOFTDEVICE_EMU_PACKETS_PER_EVENT queued
+// packets, free their buffers and queue BLE_EVT_TX_COMPLETE (and
+// BLE_GATTS_EVT_HVC for an indication). Returns packets sent.
+uint32_t softdevice_emu_connection_event (void);
+
+// Let `ticks` of RTC1 pass: run app_timer handlers as they fall due, and
+// the events they cause
+void softdevice_emu_advance (uint32_t ticks);
+
+// RTC1 ticks since reset, not wrapped at 24 bits
+uint64_t softdevice_emu_now (void);
+
+/****** Looking in ******/
+
+const uint8_t* softdevice_emu_adv_data (uint8_t* len);
+const uint8_t* softdevice_emu_scan_rsp_data (uint8_t* len);
+
+// Parameters advertising runs with, NULL when not advertising
+const ble_gap_adv_params_t* softdevice_emu_advertising (void);
+
+bool softdevice_emu_scanning (void);
+bool softdevice_emu_connected (void);
+
+// Address set by sd_ble_gap_address_set()
+void softdevice_emu_address (ble_gap_addr_t* addr);
+
+// First value handle after `from` whose characteristic has this UUID, or 0
+uint16_t softdevice_emu_find (const ble_uuid_t* uuid, uint16_t from);
+
+// Status of the application's last authorization reply
+uint16_t softdevice_emu_auth_status (void);
+
+// Free notification buffers
+uint8_t softdevice_emu_tx_free (void);
+
+// The n-th packet sent since the stats were reset, NULL if it fell out of
+// the log or wasn't sent yet
+const softdevice_emu_packet_t* softdevice_emu_packet (uint32_t n);
+
+void softdevice_emu_get_stats (softdevice_emu_stats_t* stats);
+
+// Print the attribute table
+void softdevice_emu_dump (void);
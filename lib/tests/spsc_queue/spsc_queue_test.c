@@ -0,0 +1,116 @@
+// Host test for spsc_queue.h: single threaded corner cases, then a producer
+// and a consumer thread hammering one small queue. Every item must come out
+// once, in order, and intact.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "spsc_queue.h"
+
+#define ITEMS 1000000
+
+typedef struct {
+    uint32_t seq;
+    uint32_t check;
+    uint8_t  pad[8];
+} item_t;
+
+SPSC_QUEUE_DEFINE(queue, item_t, 8);
+
+static int failures = 0;
+
+#define CHECK(cond) do {                                              \
+    if (!(cond)) {                                                    \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+        failures++;                                                   \
+    }                                                                 \
+} while (0)
+
+static item_t make_item (uint32_t seq) {
+    item_t item;
+
+    item.seq   = seq;
+    item.check = seq * 2654435761u;
+    memset(item.pad, seq & 0xFF, sizeof(item.pad));
+    return item;
+}
+
+static int good_item (const item_t* item, uint32_t seq) {
+    item_t expect = make_item(seq);
+    return memcmp(item, &expect, sizeof(expect)) == 0;
+}
+
+static void test_single (void) {
+    uint16_t values[4];
+    spsc_queue_t q;
+    uint16_t v;
+
+    spsc_queue_init(&q, values, sizeof(uint16_t), 4);
+    CHECK(spsc_queue_peek(&q) == NULL);
+    CHECK(!spsc_queue_pop(&q, &v));
+
+    // Go round several times so the indices wrap at 65536
+    q.head = q.tail = 65530;
+    for (uint16_t i = 0; i < 40; i++) {
+        for (uint16_t j = 0; j < 4; j++) {
+            v = i * 4 + j;
+            CHECK(spsc_queue_push(&q, &v));
+            CHECK(spsc_queue_count(&q) == j + 1);
+        }
+        v = 9999;
+        CHECK(!spsc_queue_push(&q, &v));
+
+        CHECK(*(uint16_t*) spsc_queue_peek(&q) == i * 4);
+        spsc_queue_drop(&q);
+        for (uint16_t j = 1; j < 4; j++) {
+            CHECK(spsc_queue_pop(&q, &v) && v == i * 4 + j);
+        }
+        CHECK(spsc_queue_count(&q) == 0);
+        CHECK(!spsc_queue_pop(&q, &v));
+    }
+}
+
+static void* producer (void* arg) {
+    for (uint32_t seq = 0; seq < ITEMS; ) {
+        item_t item = make_item(seq);
+        if (spsc_queue_push(&queue, &item)) {
+            seq++;
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void test_threads (void) {
+    pthread_t thread;
+    uint32_t seq = 0, bad = 0;
+
+    pthread_create(&thread, NULL, producer, NULL);
+    while (seq < ITEMS) {
+        item_t* item = spsc_queue_peek(&queue);
+
+        if (item == NULL) {
+            sched_yield();
+            continue;
+        }
+        if (!good_item(item, seq)) bad++;
+        spsc_queue_drop(&queue);
+        seq++;
+    }
+    pthread_join(thread, NULL);
+
+    CHECK(bad == 0);
+    CHECK(spsc_queue_count(&queue) == 0);
+}
+
+int main (int argc, char** argv) {
+    test_single();
+    test_threads();
+
+    printf("spsc_queue: %s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,267 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nrf.h"
+#include "nrf_error.h"
+#include "nrf_drv_ppi.h"
+#include "sdk_errors.h"
+
+#include "adc_stream.h"
+
+#define CONCAT_(a, b, c) a##b##c
+#define CONCAT(a, b, c)  CONCAT_(a, b, c)
+
+#define SAMPLE_TIMER     CONCAT(NRF_TIMER, ADC_STREAM_TIMER_INSTANCE, )
+
+#ifdef NRF52
+#define ADC_IRQn         SAADC_IRQn
+#define ADC_IRQHandler   SAADC_IRQHandler
+#define MAX_RATE_HZ      100000
+#else
+#define MAX_RATE_HZ      10000
+#endif
+
+// Renamed in SDK 12
+#ifndef MODULE_ALREADY_INITIALIZED
+#define MODULE_ALREADY_INITIALIZED NRF_ERROR_MODULE_ALREADY_INITIALIZED
+#endif
+
+static int16_t* _buffers;
+static uint16_t _buffer_len;
+static adc_stream_handler_t _handler;
+
+static nrf_ppi_channel_t _trigger_channel;  // timer compare -> conversion
+static nrf_ppi_channel_t _capture_channel;  // conversion done -> timer capture
+#ifdef NRF52
+static nrf_ppi_channel_t _chain_channel;    // buffer end -> next buffer start
+#endif
+
+static uint8_t _filling;        // buffer the ADC is writing
+#ifndef NRF52
+static uint16_t _fill;          // samples in it
+#endif
+
+static adc_stream_stats_t _stats;
+
+static int16_t* buffer (uint8_t index) {
+    return _buffers + index * _buffer_len;
+}
+
+static void record_phase (void) {
+    uint16_t phase = SAMPLE_TIMER->CC[1];
+
+    if (phase < _stats.phase_min) _stats.phase_min = phase;
+    if (phase > _stats.phase_max) _stats.phase_max = phase;
+}
+
+#ifdef NRF52
+
+void ADC_IRQHandler (void) {
+    _stats.interrupts++;
+
+    // A buffer is full and PPI has started the other. Handle this before
+    // STARTED, which needs to know which one is filling now.
+    if (NRF_SAADC->EVENTS_END) {
+        uint8_t done = _filling;
+
+        NRF_SAADC->EVENTS_END = 0;
+        _filling ^= 1;
+        record_phase();
+        // END only comes with a full buffer. RESULT.AMOUNT can't be used,
+        // it belongs to the buffer PPI has already started.
+        _stats.samples += _buffer_len;
+        _stats.buffers++;
+        _handler(buffer(done), _buffer_len);
+
+        // The other one filled up too while the handler had this one
+        if (NRF_SAADC->EVENTS_END) _stats.overruns++;
+    }
+
+    // The pointer is latched, so the buffer after can be set up
+    if (NRF_SAADC->EVENTS_STARTED) {
+        NRF_SAADC->EVENTS_STARTED = 0;
+        NRF_SAADC->RESULT.PTR = (uint32_t) buffer(_filling ^ 1);
+    }
+}
+
+static void adc_setup (const adc_stream_config_t* config) {
+    NRF_SAADC->ENABLE = 0;
+    NRF_SAADC->CH[0].PSELP  = SAADC_CH_PSELP_PSELP_AnalogInput0 + config->input;
+    NRF_SAADC->CH[0].PSELN  = SAADC_CH_PSELN_PSELN_NC;
+    NRF_SAADC->CH[0].CONFIG = (SAADC_CH_CONFIG_GAIN_Gain1_6 << SAADC_CH_CONFIG_GAIN_Pos) |
+                              (SAADC_CH_CONFIG_REFSEL_Internal << SAADC_CH_CONFIG_REFSEL_Pos) |
+                              (SAADC_CH_CONFIG_TACQ_10us << SAADC_CH_CONFIG_TACQ_Pos) |
+                              (SAADC_CH_CONFIG_MODE_SE << SAADC_CH_CONFIG_MODE_Pos);
+    NRF_SAADC->RESOLUTION   = SAADC_RESOLUTION_VAL_12bit;
+    NRF_SAADC->OVERSAMPLE   = SAADC_OVERSAMPLE_OVERSAMPLE_Bypass;
+    NRF_SAADC->SAMPLERATE   = SAADC_SAMPLERATE_MODE_Task << SAADC_SAMPLERATE_MODE_Pos;
+    NRF_SAADC->RESULT.MAXCNT = _buffer_len;
+
+    nrf_drv_ppi_channel_assign(_trigger_channel, (uint32_t) &SAMPLE_TIMER->EVENTS_COMPARE[0], (uint32_t) &NRF_SAADC->TASKS_SAMPLE);
+    nrf_drv_ppi_channel_assign(_capture_channel, (uint32_t) &NRF_SAADC->EVENTS_DONE, (uint32_t) &SAMPLE_TIMER->TASKS_CAPTURE[1]);
+    nrf_drv_ppi_channel_assign(_chain_channel, (uint32_t) &NRF_SAADC->EVENTS_END, (uint32_t) &NRF_SAADC->TASKS_START);
+}
+
+static void adc_start (void) {
+    NRF_SAADC->ENABLE = SAADC_ENABLE_ENABLE_Enabled;
+    NRF_SAADC->RESULT.PTR = (uint32_t) buffer(0);
+    NRF_SAADC->EVENTS_END = 0;
+    NRF_SAADC->EVENTS_STARTED = 0;
+    NRF_SAADC->INTENSET = SAADC_INTENSET_END_Msk | SAADC_INTENSET_STARTED_Msk;
+    nrf_drv_ppi_channel_enable(_chain_channel);
+    NRF_SAADC->TASKS_START = 1;
+}
+
+static void adc_stop (void) {
+    nrf_drv_ppi_channel_disable(_chain_channel);
+    NRF_SAADC->INTENCLR = SAADC_INTENCLR_END_Msk | SAADC_INTENCLR_STARTED_Msk;
+    NRF_SAADC->EVENTS_STOPPED = 0;
+    NRF_SAADC->TASKS_STOP = 1;
+    while (!NRF_SAADC->EVENTS_STOPPED);
+    NRF_SAADC->EVENTS_STOPPED = 0;
+    NRF_SAADC->EVENTS_END = 0;
+    NRF_SAADC->EVENTS_STARTED = 0;
+    NRF_SAADC->ENABLE = 0;
+}
+
+#else
+
+void ADC_IRQHandler (void) {
+    NRF_ADC->EVENTS_END = 0;
+    _stats.interrupts++;
+    _stats.samples++;
+    record_phase();
+
+    buffer(_filling)[_fill++] = NRF_ADC->RESULT;
+    if (_fill == _buffer_len) {
+        uint8_t done = _filling;
+
+        _filling ^= 1;
+        _fill = 0;
+        _stats.buffers++;
+        _handler(buffer(done), _buffer_len);
+    }
+}
+
+static void adc_setup (const adc_stream_config_t* config) {
+    NRF_ADC->ENABLE = ADC_ENABLE_ENABLE_Disabled;
+    NRF_ADC->CONFIG = (ADC_CONFIG_RES_10bit << ADC_CONFIG_RES_Pos) |
+                      (ADC_CONFIG_INPSEL_AnalogInputOneThirdPrescaling << ADC_CONFIG_INPSEL_Pos) |
+                      (ADC_CONFIG_REFSEL_VBG << ADC_CONFIG_REFSEL_Pos) |
+                      ((1UL << config->input) << ADC_CONFIG_PSEL_Pos) |
+                      (ADC_CONFIG_EXTREFSEL_None << ADC_CONFIG_EXTREFSEL_Pos);
+
+    nrf_drv_ppi_channel_assign(_trigger_channel, (uint32_t) &SAMPLE_TIMER->EVENTS_COMPARE[0], (uint32_t) &NRF_ADC->TASKS_START);
+    nrf_drv_ppi_channel_assign(_capture_channel, (uint32_t) &NRF_ADC->EVENTS_END, (uint32_t) &SAMPLE_TIMER->TASKS_CAPTURE[1]);
+}
+
+static void adc_start (void) {
+    _fill = 0;
+    NRF_ADC->EVENTS_END = 0;
+    NRF_ADC->ENABLE   = ADC_ENABLE_ENABLE_Enabled;
+    NRF_ADC->INTENSET = ADC_INTENSET_END_Msk;
+}
+
+static void adc_stop (void) {
+    NRF_ADC->INTENCLR = ADC_INTENCLR_END_Msk;
+    NRF_ADC->TASKS_STOP = 1;
+    NRF_ADC->EVENTS_END = 0;
+    NRF_ADC->ENABLE = ADC_ENABLE_ENABLE_Disabled;
+}
+
+#endif
+
+/**
+ * \brief         Configure sampling. Call adc_stream_start() to begin.
+ * \return        NRF_SUCCESS, NRF_ERROR_INVALID_PARAM for a bad rate, input
+ *                or buffer, or an error from nrf_drv_ppi.
+ */
+uint32_t adc_stream_init (const adc_stream_config_t* config) {
+    uint32_t err_code;
+    uint32_t ticks;
+    uint8_t prescaler = 0;
+
+    if (config->input > 7 || config->buffer_len == 0 || config->handler == NULL ||
+        config->sample_rate_hz == 0 || config->sample_rate_hz > MAX_RATE_HZ) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+#ifdef NRF52
+    if (config->buffer_len > (SAADC_RESULT_MAXCNT_MAXCNT_Msk >> SAADC_RESULT_MAXCNT_MAXCNT_Pos)) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+#endif
+
+    _buffers    = config->buffers;
+    _buffer_len = config->buffer_len;
+    _handler    = config->handler;
+
+    // The fastest tick that fits a sample period in 16 bits, which the
+    // nRF51's TIMER1 and TIMER2 are limited to
+    ticks = 16000000UL / config->sample_rate_hz;
+    while (ticks > 0xFFFF) {
+        prescaler++;
+        ticks = (16000000UL >> prescaler) / config->sample_rate_hz;
+    }
+
+    SAMPLE_TIMER->TASKS_STOP  = 1;
+    SAMPLE_TIMER->MODE        = TIMER_MODE_MODE_Timer;
+    SAMPLE_TIMER->BITMODE     = TIMER_BITMODE_BITMODE_16Bit;
+    SAMPLE_TIMER->PRESCALER   = prescaler;
+    SAMPLE_TIMER->CC[0]       = ticks;
+    SAMPLE_TIMER->SHORTS      = TIMER_SHORTS_COMPARE0_CLEAR_Msk;
+    SAMPLE_TIMER->INTENCLR    = 0xFFFFFFFF;
+    SAMPLE_TIMER->TASKS_CLEAR = 1;
+
+    _stats.period_ticks = ticks;
+    _stats.tick_hz      = 16000000UL >> prescaler;
+
+    err_code = nrf_drv_ppi_init();
+    if (err_code != NRF_SUCCESS && err_code != MODULE_ALREADY_INITIALIZED) return err_code;
+    err_code = nrf_drv_ppi_channel_alloc(&_trigger_channel);
+    if (err_code != NRF_SUCCESS) return err_code;
+    err_code = nrf_drv_ppi_channel_alloc(&_capture_channel);
+    if (err_code != NRF_SUCCESS) return err_code;
+#ifdef NRF52
+    err_code = nrf_drv_ppi_channel_alloc(&_chain_channel);
+    if (err_code != NRF_SUCCESS) return err_code;
+#endif
+
+    adc_setup(config);
+
+    NVIC_SetPriority(ADC_IRQn, config->irq_priority);
+    NVIC_ClearPendingIRQ(ADC_IRQn);
+    NVIC_EnableIRQ(ADC_IRQn);
+    return NRF_SUCCESS;
+}
+
+void adc_stream_start (void) {
+    uint16_t period_ticks = _stats.period_ticks;
+    uint32_t tick_hz = _stats.tick_hz;
+
+    memset(&_stats, 0, sizeof(_stats));
+    _stats.phase_min    = 0xFFFF;
+    _stats.period_ticks = period_ticks;
+    _stats.tick_hz      = tick_hz;
+    _filling = 0;
+
+    adc_start();
+    nrf_drv_ppi_channel_enable(_capture_channel);
+    nrf_drv_ppi_channel_enable(_trigger_channel);
+    SAMPLE_TIMER->TASKS_CLEAR = 1;
+    SAMPLE_TIMER->TASKS_START = 1;
+}
+
+void adc_stream_stop (void) {
+    SAMPLE_TIMER->TASKS_STOP = 1;
+    nrf_drv_ppi_channel_disable(_trigger_channel);
+    nrf_drv_ppi_channel_disable(_capture_channel);
+    adc_stop();
+    NVIC_ClearPendingIRQ(ADC_IRQn);
+}
+
+void adc_stream_get_stats (adc_stream_stats_t* stats) {
+    NVIC_DisableIRQ(ADC_IRQn);
+    *stats = _stats;
+    NVIC_EnableIRQ(ADC_IRQn);
+}
@@ -0,0 +1,78 @@
+// Continuous ADC sampling, timed by hardware
+//
+// A TIMER (ADC_STREAM_TIMER_INSTANCE, 1 by default) runs at the sample rate
+// and starts every conversion through PPI, so samples are evenly spaced
+// whatever the CPU is doing. Samples fill two buffers in turn. When one is
+// full it goes to the handler, from the ADC interrupt, while the other one
+// fills; the handler has until then to be done with it.
+//
+// On the nRF52 the SAADC writes samples with EasyDMA and PPI starts the next
+// buffer when one ends, so there are two interrupts per buffer. The nRF51
+// ADC has no DMA, so there every conversion interrupts to store its result.
+//
+// Both chips measure 0 to 3.6 V on one analog input (AIN0 to AIN7): 10 bit
+// on the nRF51 (1/3 prescaling, 1.2 V bandgap), 12 bit on the nRF52 (gain
+// 1/6, 0.6 V reference). The sample rate is as accurate as HFCLK, so request
+// the crystal (sd_clock_hfclk_request()) when it matters.
+//
+//   static int16_t buffers[2][100];
+//   static const adc_stream_config_t config = {
+//       .input = 7, .sample_rate_hz = 1000,
+//       .irq_priority = APP_IRQ_PRIORITY_LOW,
+//       .buffers = buffers[0], .buffer_len = 100,
+//       .handler = samples_ready,
+//   };
+//
+//   adc_stream_init(&config);
+//   adc_stream_start();
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef ADC_STREAM_TIMER_INSTANCE
+#define ADC_STREAM_TIMER_INSTANCE 1
+#endif
+
+// Called from the ADC interrupt with a full buffer
+typedef void (*adc_stream_handler_t)(const int16_t* samples, uint16_t count);
+
+typedef struct {
+    uint8_t  input;             // AIN number, 0 to 7
+    uint32_t sample_rate_hz;    // 1 to 100000 (nRF52) or 10000 (nRF51)
+    uint8_t  irq_priority;
+
+    // Two buffers of buffer_len samples, one after the other
+    int16_t* buffers;
+    uint16_t buffer_len;
+    adc_stream_handler_t handler;
+} adc_stream_config_t;
+
+typedef struct {
+    uint32_t samples;
+    uint32_t buffers;
+    uint32_t interrupts;        // CPU wakeups for the ADC
+    uint32_t overruns;          // nRF52: a buffer ended while the handler had the other
+
+    // When conversions finish, in timer ticks after their trigger. Their
+    // spread is the sampling jitter. On the nRF52 the last sample of each
+    // buffer is measured.
+    uint16_t phase_min;
+    uint16_t phase_max;
+    uint16_t period_ticks;      // ticks per sample
+    uint32_t tick_hz;
+} adc_stream_stats_t;
+
+// Set up the ADC, the timer and the PPI channels. The actual sample rate is
+// tick_hz / period_ticks (see adc_stream_get_stats()).
+uint32_t adc_stream_init (const adc_stream_config_t* config);
+
+// Start sampling into the first buffer, and stop. A partly filled buffer is
+// dropped by adc_stream_stop().
+void adc_stream_start (void);
+void adc_stream_stop (void);
+
+// Counters since adc_stream_start(). Interrupts per 1000 samples are
+// interrupts * 1000 / samples.
+void adc_stream_get_stats (adc_stream_stats_t* stats);
@@ -1,6 +1,7 @@
 // LED Library
 
 // set LEDS_ACTIVE_LOW to 0 for active high
+// for several LEDs at once, see LED_GROUP() in pin_group.h
 
 #include <stdint.h>
 #include "nrf_gpio.h"
@@ -0,0 +1,373 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "led_pattern.h"
+
+#ifndef LED_PATTERN_HOST
+#include "nrf.h"
+#include "nrf_error.h"
+#include "nrf_gpio.h"
+#include "app_util_platform.h"
+#ifndef NRF52
+#include "app_timer.h"
+#include "nrf_drv_ppi.h"
+#include "sdk_errors.h"
+#endif
+#endif
+
+#ifndef LEDS_ACTIVE_LOW
+#define LEDS_ACTIVE_LOW 1
+#endif
+
+#define CONCAT_(a, b, c) a##b##c
+#define CONCAT(a, b, c)  CONCAT_(a, b, c)
+
+// One PWM period
+#define PERIOD_US 1000
+
+// LED_PATTERN(), but not static
+#define BUILTIN(name, repeat, ...)                                          \
+    static const led_pattern_step_t name##_steps[] = {__VA_ARGS__};         \
+    const led_pattern_t name = {                                            \
+        name##_steps, sizeof(name##_steps) / sizeof(name##_steps[0]), (repeat)}
+
+BUILTIN(led_pattern_blink, true, LED_STEP(255, 100), LED_STEP(0, 900));
+BUILTIN(led_pattern_double_blink, true, LED_STEP(255, 100), LED_STEP(0, 150), LED_STEP(255, 100), LED_STEP(0, 650));
+BUILTIN(led_pattern_breathe, true, LED_RAMP(255, 1000), LED_RAMP(0, 1000), LED_STEP(0, 500));
+BUILTIN(led_pattern_fade_in, false, LED_RAMP(255, 500));
+BUILTIN(led_pattern_fade_out, false, LED_STEP(255, 0), LED_RAMP(0, 500));
+
+
+/******************************************************************************
+ * Rendering
+ ******************************************************************************/
+
+uint32_t led_pattern_duration (const led_pattern_t* pattern) {
+    uint32_t ms = 0;
+
+    for (uint8_t i = 0; i < pattern->num_steps; i++) {
+        ms += pattern->steps[i].ms;
+    }
+    return ms;
+}
+
+uint16_t led_pattern_tick_ms (const led_pattern_t* pattern) {
+    uint32_t duration = led_pattern_duration(pattern);
+    uint32_t tick = (duration + LED_PATTERN_MAX_TICKS - 1) / LED_PATTERN_MAX_TICKS;
+
+    return tick > LED_PATTERN_TICK_MS ? tick : LED_PATTERN_TICK_MS;
+}
+
+// Brightness over the tick starting at t: a step's level from its first
+// tick, a ramp's value at the end of the tick so it arrives on its last one
+static uint8_t level_at (const led_pattern_t* pattern, uint32_t t, uint16_t tick) {
+    const led_pattern_step_t* steps = pattern->steps;
+    uint8_t previous = 0;
+    uint32_t start = 0;
+
+    if (pattern->num_steps == 0) return 0;
+    if (pattern->repeat) previous = steps[pattern->num_steps - 1].level;
+
+    for (uint8_t i = 0; i < pattern->num_steps; i++) {
+        const led_pattern_step_t* step = &steps[i];
+
+        if (t < start + step->ms) {
+            if (step->ramp) {
+                uint32_t end = t + tick < start + step->ms ? t + tick : start + step->ms;
+                int32_t delta = (int32_t) step->level - previous;
+                int32_t half = step->ms / 2;
+
+                // Rounded to nearest
+                return previous + (delta * (int32_t)(end - start) + (delta < 0 ? -half : half)) / step->ms;
+            }
+            return step->level;
+        }
+        start += step->ms;
+        previous = step->level;
+    }
+    return previous;
+}
+
+uint16_t led_pattern_render (const led_pattern_t* pattern, uint8_t* levels) {
+    uint16_t tick = led_pattern_tick_ms(pattern);
+    uint16_t count = (led_pattern_duration(pattern) + tick - 1) / tick;
+
+    if (count == 0) count = 1;
+    for (uint16_t i = 0; i < count; i++) {
+        levels[i] = level_at(pattern, (uint32_t) i * tick, tick);
+    }
+    return count;
+}
+
+// Perceived brightness goes roughly with the square root of the duty cycle
+uint8_t led_pattern_duty (uint8_t level) {
+    return ((uint16_t) level * level + 254) / 255;
+}
+
+
+#ifndef LED_PATTERN_HOST
+
+static uint32_t _pin;
+static uint8_t _levels[LED_PATTERN_MAX_TICKS];
+
+static void pin_off (void) {
+#if LEDS_ACTIVE_LOW
+    nrf_gpio_pin_set(_pin);
+#else
+    nrf_gpio_pin_clear(_pin);
+#endif
+}
+
+#ifdef NRF52
+
+/******************************************************************************
+ * nRF52: PWM sequence
+ ******************************************************************************/
+
+#define LED_PWM CONCAT(NRF_PWM, LED_PATTERN_PWM_INSTANCE, )
+
+// 250 kHz, so a 1 ms period is 250 counts
+#define PWM_TOP (PERIOD_US / 4)
+
+// Bit 15 of a value: the period starts with the pin high
+#define FALLING_EDGE 0x8000
+
+static uint16_t _sequence[LED_PATTERN_MAX_TICKS];
+static bool _playing;
+
+uint32_t led_pattern_init (uint32_t pin_number) {
+    _pin = pin_number;
+    nrf_gpio_cfg_output(_pin);
+    pin_off();
+
+    LED_PWM->PSEL.OUT[0] = _pin;
+    LED_PWM->PSEL.OUT[1] = PWM_PSEL_OUT_CONNECT_Disconnected << PWM_PSEL_OUT_CONNECT_Pos;
+    LED_PWM->PSEL.OUT[2] = PWM_PSEL_OUT_CONNECT_Disconnected << PWM_PSEL_OUT_CONNECT_Pos;
+    LED_PWM->PSEL.OUT[3] = PWM_PSEL_OUT_CONNECT_Disconnected << PWM_PSEL_OUT_CONNECT_Pos;
+    LED_PWM->MODE        = PWM_MODE_UPDOWN_Up << PWM_MODE_UPDOWN_Pos;
+    LED_PWM->PRESCALER   = PWM_PRESCALER_PRESCALER_DIV_64 << PWM_PRESCALER_PRESCALER_Pos;
+    LED_PWM->COUNTERTOP  = PWM_TOP;
+    LED_PWM->DECODER     = (PWM_DECODER_LOAD_Common << PWM_DECODER_LOAD_Pos) |
+                           (PWM_DECODER_MODE_RefreshCount << PWM_DECODER_MODE_Pos);
+    LED_PWM->INTENCLR    = 0xFFFFFFFF;
+    return NRF_SUCCESS;
+}
+
+uint32_t led_pattern_play (const led_pattern_t* pattern) {
+    uint16_t count;
+    uint16_t tick = led_pattern_tick_ms(pattern);
+
+    led_pattern_stop();
+
+    // The compare value is where the pin flips from on to off
+    count = led_pattern_render(pattern, _levels);
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t compare = (uint16_t) led_pattern_duty(_levels[i]) * PWM_TOP / 255;
+#if LEDS_ACTIVE_LOW
+        _sequence[i] = compare;
+#else
+        _sequence[i] = compare | FALLING_EDGE;
+#endif
+    }
+
+    // Each value is held for tick periods. A repeating pattern plays as
+    // both sequences, and the end of the loop starts it again.
+    for (uint8_t seq = 0; seq < 2; seq++) {
+        LED_PWM->SEQ[seq].PTR      = (uint32_t) _sequence;
+        LED_PWM->SEQ[seq].CNT      = count;
+        LED_PWM->SEQ[seq].REFRESH  = tick - 1;
+        LED_PWM->SEQ[seq].ENDDELAY = 0;
+    }
+    if (pattern->repeat) {
+        LED_PWM->LOOP   = 1;
+        LED_PWM->SHORTS = PWM_SHORTS_LOOPSDONE_SEQSTART0_Msk;
+    } else {
+        // The last value stays on the pin when the sequence ends
+        LED_PWM->LOOP   = 0;
+        LED_PWM->SHORTS = 0;
+    }
+
+    LED_PWM->ENABLE = PWM_ENABLE_ENABLE_Enabled << PWM_ENABLE_ENABLE_Pos;
+    LED_PWM->TASKS_SEQSTART[0] = 1;
+    _playing = true;
+    return NRF_SUCCESS;
+}
+
+void led_pattern_stop (void) {
+    if (!_playing) return;
+
+    LED_PWM->SHORTS = 0;
+    LED_PWM->EVENTS_STOPPED = 0;
+    LED_PWM->TASKS_STOP = 1;
+    while (!LED_PWM->EVENTS_STOPPED);
+    LED_PWM->EVENTS_STOPPED = 0;
+
+    // The pin goes back to its GPIO setting, off
+    LED_PWM->ENABLE = 0;
+    _playing = false;
+}
+
+#else
+
+/******************************************************************************
+ * nRF51: TIMER, GPIOTE and PPI
+ ******************************************************************************/
+
+#define PWM_TIMER        CONCAT(NRF_TIMER, LED_PATTERN_TIMER_INSTANCE, )
+#define PWM_IRQn         CONCAT(TIMER, LED_PATTERN_TIMER_INSTANCE, _IRQn)
+#define PWM_IRQHandler   CONCAT(TIMER, LED_PATTERN_TIMER_INSTANCE, _IRQHandler)
+
+#define STEP_TIMER_PRESCALER 0     // as simple_ble and simple_timer
+
+// Shortest on time, in us. Covers getting into PWM_IRQHandler and writing the
+// compare when nothing else is running, so the capture check below is only
+// needed when the interrupt is held off.
+#define MIN_ON_US 10
+
+// Renamed in SDK 12
+#ifndef MODULE_ALREADY_INITIALIZED
+#define MODULE_ALREADY_INITIALIZED NRF_ERROR_MODULE_ALREADY_INITIALIZED
+#endif
+
+APP_TIMER_DEF(_step_timer);
+
+static nrf_ppi_channel_t _off_channel;  // compare 0 -> toggle off
+static nrf_ppi_channel_t _on_channel;   // compare 1, end of period -> toggle on
+
+static const led_pattern_t* _pattern;
+static uint16_t _count;
+static uint16_t _tick;
+static uint16_t _index;                 // next tick to show
+static volatile uint8_t _pending_duty;
+
+// A GPIOTE task channel on the pin, set to on or off. Writing the
+// configuration sets the pin.
+static void gpiote_set (bool on) {
+    bool high = on ^ LEDS_ACTIVE_LOW;
+
+    NRF_GPIOTE->CONFIG[LED_PATTERN_GPIOTE_CHANNEL] =
+        (GPIOTE_CONFIG_MODE_Task << GPIOTE_CONFIG_MODE_Pos) |
+        (_pin << GPIOTE_CONFIG_PSEL_Pos) |
+        (GPIOTE_CONFIG_POLARITY_Toggle << GPIOTE_CONFIG_POLARITY_Pos) |
+        ((high ? GPIOTE_CONFIG_OUTINIT_High : GPIOTE_CONFIG_OUTINIT_Low) << GPIOTE_CONFIG_OUTINIT_Pos);
+}
+
+// At the start of a period. The timer is already counting, and with the
+// SoftDevice this can run late enough that it is past the new compare value:
+// that compare never happens, so the pin has to be turned off here or it
+// stays on and every toggle after is the wrong way round.
+void PWM_IRQHandler (void) {
+    uint8_t duty = _pending_duty;
+    uint32_t on_us;
+
+    PWM_TIMER->EVENTS_COMPARE[1] = 0;
+    PWM_TIMER->INTENCLR = TIMER_INTENCLR_COMPARE1_Msk;
+
+    if (duty == 0 || duty == 255) {
+        // Fully off or on is no toggling at all
+        nrf_drv_ppi_channel_disable(_off_channel);
+        nrf_drv_ppi_channel_disable(_on_channel);
+        gpiote_set(duty == 255);
+    } else {
+        on_us = (uint32_t) duty * PERIOD_US / 255;
+        if (on_us < MIN_ON_US) on_us = MIN_ON_US;
+
+        PWM_TIMER->CC[0] = on_us;
+        gpiote_set(true);
+        nrf_drv_ppi_channel_enable(_off_channel);
+        nrf_drv_ppi_channel_enable(_on_channel);
+
+        // If the compare came after the channels were enabled the pin is
+        // already off, setting it off again is harmless
+        PWM_TIMER->TASKS_CAPTURE[2] = 1;
+        if (PWM_TIMER->CC[2] >= on_us) gpiote_set(false);
+    }
+}
+
+// Show the level at _index until it changes
+static void next_change (void* context) {
+    uint8_t level = _levels[_index];
+    uint16_t run = 0;
+
+    while (_index < _count && _levels[_index] == level) {
+        _index++;
+        run++;
+    }
+
+    _pending_duty = led_pattern_duty(level);
+    PWM_TIMER->INTENSET = TIMER_INTENSET_COMPARE1_Msk;
+
+    if (_index == _count) {
+        if (!_pattern->repeat) return;
+        _index = 0;
+        if (run == _count) return;      // one level throughout
+    }
+    app_timer_start(_step_timer, APP_TIMER_TICKS((uint32_t) run * _tick, STEP_TIMER_PRESCALER), NULL);
+}
+
+uint32_t led_pattern_init (uint32_t pin_number) {
+    uint32_t err_code;
+
+    _pin = pin_number;
+    nrf_gpio_cfg_output(_pin);
+    pin_off();
+
+    // 1 MHz, cleared every period
+    PWM_TIMER->TASKS_STOP  = 1;
+    PWM_TIMER->MODE        = TIMER_MODE_MODE_Timer;
+    PWM_TIMER->BITMODE     = TIMER_BITMODE_BITMODE_16Bit;
+    PWM_TIMER->PRESCALER   = 4;
+    PWM_TIMER->CC[1]       = PERIOD_US;
+    PWM_TIMER->SHORTS      = TIMER_SHORTS_COMPARE1_CLEAR_Msk;
+    PWM_TIMER->INTENCLR    = 0xFFFFFFFF;
+    PWM_TIMER->TASKS_CLEAR = 1;
+
+    err_code = nrf_drv_ppi_init();
+    if (err_code != NRF_SUCCESS && err_code != MODULE_ALREADY_INITIALIZED) return err_code;
+    err_code = nrf_drv_ppi_channel_alloc(&_off_channel);
+    if (err_code != NRF_SUCCESS) return err_code;
+    err_code = nrf_drv_ppi_channel_alloc(&_on_channel);
+    if (err_code != NRF_SUCCESS) return err_code;
+
+    nrf_drv_ppi_channel_assign(_off_channel, (uint32_t) &PWM_TIMER->EVENTS_COMPARE[0],
+                               (uint32_t) &NRF_GPIOTE->TASKS_OUT[LED_PATTERN_GPIOTE_CHANNEL]);
+    nrf_drv_ppi_channel_assign(_on_channel, (uint32_t) &PWM_TIMER->EVENTS_COMPARE[1],
+                               (uint32_t) &NRF_GPIOTE->TASKS_OUT[LED_PATTERN_GPIOTE_CHANNEL]);
+
+    NVIC_SetPriority(PWM_IRQn, APP_IRQ_PRIORITY_LOW);
+    NVIC_ClearPendingIRQ(PWM_IRQn);
+    NVIC_EnableIRQ(PWM_IRQn);
+
+    return app_timer_create(&_step_timer, APP_TIMER_MODE_SINGLE_SHOT, next_change);
+}
+
+uint32_t led_pattern_play (const led_pattern_t* pattern) {
+    led_pattern_stop();
+
+    _pattern = pattern;
+    _tick    = led_pattern_tick_ms(pattern);
+    _count   = led_pattern_render(pattern, _levels);
+    _index   = 0;
+
+    gpiote_set(false);
+    PWM_TIMER->TASKS_CLEAR = 1;
+    PWM_TIMER->TASKS_START = 1;
+    next_change(NULL);
+    return NRF_SUCCESS;
+}
+
+void led_pattern_stop (void) {
+    app_timer_stop(_step_timer);
+    PWM_TIMER->INTENCLR = TIMER_INTENCLR_COMPARE1_Msk;
+    PWM_TIMER->TASKS_STOP = 1;
+    nrf_drv_ppi_channel_disable(_off_channel);
+    nrf_drv_ppi_channel_disable(_on_channel);
+
+    // The pin goes back to its GPIO setting, off
+    NRF_GPIOTE->CONFIG[LED_PATTERN_GPIOTE_CHANNEL] = 0;
+    NVIC_ClearPendingIRQ(PWM_IRQn);
+}
+
+#endif
+#endif
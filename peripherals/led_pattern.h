@@ -0,0 +1,104 @@
+// LED patterns played by hardware
+//
+// Blink, breathe and fade an LED from a table of steps. Each step goes to a
+// brightness, either at once or in a straight ramp, and takes some
+// milliseconds. A pattern plays once and holds its last level, or repeats.
+//
+// The pattern is rendered into one brightness per tick (LED_PATTERN_TICK_MS,
+// longer if a cycle would not fit in LED_PATTERN_MAX_TICKS) and played by a
+// 1 kHz PWM, with brightness squared to duty cycle so that ramps look even:
+//
+//   nRF52  The PWM peripheral (LED_PATTERN_PWM_INSTANCE) reads the ticks by
+//          EasyDMA, holding each for tick periods, and loops them itself.
+//          No CPU at all until the pattern changes.
+//   nRF51  A TIMER (LED_PATTERN_TIMER_INSTANCE) toggles the pin through PPI
+//          and a GPIOTE task (LED_PATTERN_GPIOTE_CHANNEL). The CPU only
+//          wakes when the brightness changes: an app_timer at the change and
+//          the TIMER interrupt to load it at the start of a period. A blink
+//          is two changes per cycle.
+//
+// tools/led_pattern_sim renders a pattern to a VCD waveform on the host.
+//
+//   LED_PATTERN(slow_blink, true, LED_STEP(255, 50), LED_STEP(0, 1950));
+//
+//   led_pattern_init(LED0);
+//   led_pattern_play(&led_pattern_breathe);
+//   ...
+//   led_pattern_play(&slow_blink);
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef LED_PATTERN_TICK_MS
+#define LED_PATTERN_TICK_MS 10
+#endif
+
+#ifndef LED_PATTERN_MAX_TICKS
+#define LED_PATTERN_MAX_TICKS 256
+#endif
+
+#ifndef LED_PATTERN_PWM_INSTANCE
+#define LED_PATTERN_PWM_INSTANCE 0
+#endif
+
+#ifndef LED_PATTERN_TIMER_INSTANCE
+#define LED_PATTERN_TIMER_INSTANCE 2
+#endif
+
+#ifndef LED_PATTERN_GPIOTE_CHANNEL
+#define LED_PATTERN_GPIOTE_CHANNEL 3
+#endif
+
+typedef struct {
+    uint8_t  level;     // brightness at the end of the step, 0 to 255
+    bool     ramp;      // from the previous level in a straight line
+    uint16_t ms;        // 0 sets the level the next ramp starts from
+} led_pattern_step_t;
+
+typedef struct {
+    const led_pattern_step_t* steps;
+    uint8_t num_steps;
+    bool    repeat;     // else hold the last level
+} led_pattern_t;
+
+#define LED_STEP(level, ms) {(level), false, (ms)}
+#define LED_RAMP(level, ms) {(level), true, (ms)}
+
+#define LED_PATTERN(name, repeat, ...)                                      \
+    static const led_pattern_step_t name##_steps[] = {__VA_ARGS__};         \
+    static const led_pattern_t name = {                                     \
+        name##_steps, sizeof(name##_steps) / sizeof(name##_steps[0]), (repeat)}
+
+extern const led_pattern_t led_pattern_blink;          // 100 ms on every second
+extern const led_pattern_t led_pattern_double_blink;   // two 100 ms blinks every second
+extern const led_pattern_t led_pattern_breathe;        // 1 s up, 1 s down, 0.5 s off
+extern const led_pattern_t led_pattern_fade_in;        // off to on in 0.5 s, and stay on
+extern const led_pattern_t led_pattern_fade_out;       // on to off in 0.5 s
+
+// Set up the pin and the peripherals. The pin should not be used with led.c
+// at the same time. Uses LEDS_ACTIVE_LOW like led.c.
+uint32_t led_pattern_init (uint32_t pin_number);
+
+// Start a pattern from its beginning, replacing the one playing
+uint32_t led_pattern_play (const led_pattern_t* pattern);
+
+// Stop and turn the LED off
+void led_pattern_stop (void);
+
+
+// Rendering, also built on the host with LED_PATTERN_HOST
+
+// Length of one cycle in ms
+uint32_t led_pattern_duration (const led_pattern_t* pattern);
+
+// The tick a pattern is rendered at
+uint16_t led_pattern_tick_ms (const led_pattern_t* pattern);
+
+// Brightness of each tick of one cycle, at most LED_PATTERN_MAX_TICKS.
+// Returns the number of ticks.
+uint16_t led_pattern_render (const led_pattern_t* pattern, uint8_t* levels);
+
+// PWM duty cycle, 0 to 255, for a brightness
+uint8_t led_pattern_duty (uint8_t level);
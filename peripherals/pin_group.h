@@ -0,0 +1,119 @@
+// Groups of GPIO pins switched together
+//
+// A group is a mask of pins and the subset of them that are active low. It
+// is plain data built by macros, so a group written with constant pin
+// numbers is a compile time constant, and turning all of its pins on or off
+// is one write to OUTSET or OUTCLR (two if it mixes polarities) however many
+// pins there are. led_on() and friends take one pin per call.
+//
+//   static const pin_group_t leds = LED_GROUP(LED_RED, LED_GREEN, LED_BLUE);
+//
+//   pin_group_init(&leds);                     // outputs, all off
+//   pin_group_on(&leds);
+//   pin_group_write(&leds, PIN_MASK(LED_RED)); // just red
+//   pin_group_write(&leds, pin_group_bits(&leds, count));
+//
+// Groups can be built from variables too (LED_GROUP(led0, led1)), they are
+// then just not constant. Up to 16 pins per macro; OR masks for more.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef PIN_GROUP_HOST
+#include "nrf.h"
+#include "nrf_gpio.h"
+#endif
+
+#ifndef LEDS_ACTIVE_LOW
+#define LEDS_ACTIVE_LOW 1
+#endif
+
+typedef struct {
+    uint32_t mask;          // pins in the group
+    uint32_t active_low;    // those of them that are on when low
+} pin_group_t;
+
+// 1 << pin, and nothing for the padding below
+#define PIN_BIT(pin) (((pin) < 32) ? (1UL << ((pin) & 31)) : 0UL)
+
+#define PIN_MASK_(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p, ...)         \
+    (PIN_BIT(a) | PIN_BIT(b) | PIN_BIT(c) | PIN_BIT(d) | PIN_BIT(e) |          \
+     PIN_BIT(f) | PIN_BIT(g) | PIN_BIT(h) | PIN_BIT(i) | PIN_BIT(j) |          \
+     PIN_BIT(k) | PIN_BIT(l) | PIN_BIT(m) | PIN_BIT(n) | PIN_BIT(o) | PIN_BIT(p))
+
+// Mask of up to 16 pins
+#define PIN_MASK(...) \
+    PIN_MASK_(__VA_ARGS__, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32)
+
+// Pins that are all active low, or all active high
+#define PIN_GROUP(active_low, ...) \
+    {PIN_MASK(__VA_ARGS__), (active_low) ? PIN_MASK(__VA_ARGS__) : 0UL}
+
+// LEDs wired like the ones led.c drives
+#define LED_GROUP(...) PIN_GROUP(LEDS_ACTIVE_LOW, __VA_ARGS__)
+
+// Pins driven high to turn on the `on` pins of the group and off the rest
+static inline uint32_t pin_group_high (const pin_group_t* group, uint32_t on) {
+    return (on ^ group->active_low) & group->mask;
+}
+
+// Set the pins of the group to on (`on` bits) or off, leaving other pins be.
+// OUTSET and OUTCLR are only written when they have something to do, which
+// for a constant group is decided when compiling.
+static inline void pin_group_write (const pin_group_t* group, uint32_t on) {
+    uint32_t high = pin_group_high(group, on);
+    uint32_t low  = group->mask & ~high;
+
+    if (high) NRF_GPIO->OUTSET = high;
+    if (low)  NRF_GPIO->OUTCLR = low;
+}
+
+static inline void pin_group_on (const pin_group_t* group) {
+    pin_group_write(group, group->mask);
+}
+
+static inline void pin_group_off (const pin_group_t* group) {
+    pin_group_write(group, 0);
+}
+
+// Pins of the group that are on now
+static inline uint32_t pin_group_read (const pin_group_t* group) {
+    return (NRF_GPIO->OUT ^ group->active_low) & group->mask;
+}
+
+// Flip every pin of the group. Pins outside it are not touched, even if an
+// interrupt changes them in between.
+static inline void pin_group_toggle (const pin_group_t* group) {
+    uint32_t out = NRF_GPIO->OUT;
+    uint32_t set = ~out & group->mask;
+    uint32_t clr = out & group->mask;
+
+    if (set) NRF_GPIO->OUTSET = set;
+    if (clr) NRF_GPIO->OUTCLR = clr;
+}
+
+// Spread the low bits of value over the group's pins, lowest pin first:
+// bit 0 of value goes to the lowest numbered pin. For pin_group_write().
+static inline uint32_t pin_group_bits (const pin_group_t* group, uint32_t value) {
+    uint32_t mask = group->mask;
+    uint32_t on = 0;
+
+    while (mask != 0) {
+        uint32_t lowest = mask & -mask;
+
+        if (value & 1) on |= lowest;
+        value >>= 1;
+        mask &= ~lowest;
+    }
+    return on;
+}
+
+// Make the pins outputs, off
+static inline void pin_group_init (const pin_group_t* group) {
+    pin_group_off(group);
+    for (uint32_t pin = 0; pin < 32; pin++) {
+        if (group->mask & (1UL << pin)) nrf_gpio_cfg_output(pin);
+    }
+}
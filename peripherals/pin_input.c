@@ -0,0 +1,379 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "spsc_queue.h"
+#include "pin_input.h"
+
+#ifndef PIN_INPUT_HOST
+#include "nrf.h"
+#include "nrf_error.h"
+#include "nrf_gpio.h"
+#include "app_timer.h"
+#include "app_util_platform.h"
+#include "nrf_drv_ppi.h"
+#include "sdk_errors.h"
+#else
+#define NRF_SUCCESS             0
+#define NRF_ERROR_INVALID_PARAM 7
+#endif
+
+#define CONCAT_(a, b, c) a##b##c
+#define CONCAT(a, b, c)  CONCAT_(a, b, c)
+
+#ifndef PIN_INPUT_HOST
+#define READ_IN()  NRF_GPIO->IN
+#define NOW()      NRF_RTC1->COUNTER
+#else
+#define READ_IN()  pin_input_host_in()
+#define NOW()      pin_input_host_now()
+#endif
+
+// What the PORT interrupt saw
+typedef struct {
+    uint32_t time;
+    uint32_t changed;       // pins that differ from what was seen before
+} port_event_t;
+
+typedef struct {
+    uint8_t  pin;
+    bool     level;         // reported
+    uint16_t edges;         // since then, 0 if not changing
+    uint32_t debounce;      // ticks
+    uint32_t first_edge;
+    uint32_t last_edge;
+} pin_state_t;
+
+SPSC_QUEUE_DEFINE(_port_events, port_event_t, PIN_INPUT_QUEUE_SIZE);
+
+static pin_state_t _pins[PIN_INPUT_MAX_PINS];
+static uint8_t _num_pins;
+static uint32_t _mask;
+static pin_input_handler_t _handler;
+static pin_input_stats_t _stats;
+
+// Level of each pin as of the last PORT interrupt, so SENSE waits for the
+// other one. Only the interrupt changes it after init.
+static uint32_t _sensed;
+
+// The debounce timer will run, set by whoever starts it
+static volatile bool _scheduled;
+
+static void start_timer (uint32_t ticks);
+
+
+/******************************************************************************
+ * Debouncing
+ ******************************************************************************/
+
+static void schedule (uint32_t ticks) {
+    _scheduled = true;
+    start_timer(ticks);
+}
+
+// From the PORT interrupt: note the pins that changed. Returns them.
+static uint32_t record (uint32_t in) {
+    port_event_t event;
+
+    event.changed = (in ^ _sensed) & _mask;
+    if (event.changed == 0) return 0;
+
+    event.time = NOW();
+    if (!spsc_queue_push(&_port_events, &event)) {
+        // Their levels are read again when the timer runs, only the
+        // bounce count and time are lost
+        _stats.overflows++;
+    }
+    _sensed ^= event.changed;
+
+    if (!_scheduled) {
+        uint32_t ticks = UINT32_MAX;
+
+        for (uint8_t i = 0; i < _num_pins; i++) {
+            if ((event.changed & (1UL << _pins[i].pin)) && _pins[i].debounce < ticks) {
+                ticks = _pins[i].debounce;
+            }
+        }
+        schedule(ticks);
+    }
+    return event.changed;
+}
+
+// The debounce timer: fold in the queued edges, report the pins that have
+// been steady long enough, and come back for the ones still bouncing
+static void timeout (void* context) {
+    pin_input_event_t events[PIN_INPUT_MAX_PINS];
+    uint8_t count = 0;
+    uint32_t next = 0;
+    port_event_t* event;
+    uint32_t in, now;
+
+    // First, so an edge queued from here on starts the timer again
+    _scheduled = false;
+    _stats.timeouts++;
+
+    while ((event = spsc_queue_peek(&_port_events)) != NULL) {
+        for (uint8_t i = 0; i < _num_pins; i++) {
+            pin_state_t* state = &_pins[i];
+
+            if (!(event->changed & (1UL << state->pin))) continue;
+            if (state->edges == 0) state->first_edge = event->time;
+            if (state->edges < UINT16_MAX) state->edges++;
+            state->last_edge = event->time;
+            _stats.edges++;
+        }
+        spsc_queue_drop(&_port_events);
+    }
+
+    // After the queue, so no edge read from it is later than now
+    in  = READ_IN();
+    now = NOW();
+
+    for (uint8_t i = 0; i < _num_pins; i++) {
+        pin_state_t* state = &_pins[i];
+        bool level = (in >> state->pin) & 1;
+        uint32_t steady;
+
+        if (state->edges == 0) {
+            if (level == state->level) continue;
+            // Changed while the queue was full
+            state->edges = 1;
+            state->first_edge = state->last_edge = now;
+        }
+
+        steady = (now - state->last_edge) & PIN_INPUT_TICKS_MASK;
+        if (steady < state->debounce) {
+            uint32_t wait = state->debounce - steady;
+            if (next == 0 || wait < next) next = wait;
+            continue;
+        }
+
+        if (level != state->level) {
+            events[count].pin   = state->pin;
+            events[count].level = level;
+            events[count].edges = state->edges;
+            events[count].time  = state->first_edge;
+            count++;
+            state->level = level;
+            _stats.events++;
+        } else {
+            // Went back before it settled
+            _stats.glitches++;
+        }
+        state->edges = 0;
+    }
+
+    if (next != 0) schedule(next);
+
+    if (count > 0 && _handler != NULL) {
+        _stats.batches++;
+        _handler(events, count);
+    }
+}
+
+static uint32_t setup (const pin_input_config_t* pins, uint8_t count, pin_input_handler_t handler) {
+    if (count > PIN_INPUT_MAX_PINS) return NRF_ERROR_INVALID_PARAM;
+
+    _num_pins = count;
+    _handler = handler;
+    _mask = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        if (pins[i].pin >= 32) return NRF_ERROR_INVALID_PARAM;
+
+        _pins[i].pin      = pins[i].pin;
+        _pins[i].edges    = 0;
+        _pins[i].debounce = ((uint32_t) pins[i].debounce_ms * PIN_INPUT_TICKS_PER_SECOND + 999) / 1000;
+        _mask |= 1UL << pins[i].pin;
+    }
+
+    memset(&_stats, 0, sizeof(_stats));
+    _port_events.head = _port_events.tail = 0;
+    _scheduled = false;
+    return NRF_SUCCESS;
+}
+
+// Pins start out reported at their level now
+static void set_levels (uint32_t in) {
+    _sensed = in & _mask;
+    for (uint8_t i = 0; i < _num_pins; i++) {
+        _pins[i].level = (in >> _pins[i].pin) & 1;
+    }
+}
+
+bool pin_input_read (uint8_t pin) {
+    for (uint8_t i = 0; i < _num_pins; i++) {
+        if (_pins[i].pin == pin) return _pins[i].level;
+    }
+    return false;
+}
+
+void pin_input_get_stats (pin_input_stats_t* stats) {
+    *stats = _stats;
+}
+
+
+#ifndef PIN_INPUT_HOST
+
+/******************************************************************************
+ * PORT event
+ ******************************************************************************/
+
+APP_TIMER_DEF(_debounce_timer);
+
+static void start_timer (uint32_t ticks) {
+    if (ticks < APP_TIMER_MIN_TIMEOUT_TICKS) ticks = APP_TIMER_MIN_TIMEOUT_TICKS;
+    app_timer_start(_debounce_timer, ticks, NULL);
+}
+
+// SENSE for the level a pin is not at
+static void sense_other (uint8_t pin, bool level) {
+    nrf_gpio_cfg_sense_set(pin, level ? NRF_GPIO_PIN_SENSE_LOW : NRF_GPIO_PIN_SENSE_HIGH);
+}
+
+void GPIOTE_IRQHandler (void) {
+    uint32_t changed;
+
+    if (NRF_GPIOTE->EVENTS_PORT) {
+        NRF_GPIOTE->EVENTS_PORT = 0;
+        _stats.interrupts++;
+    }
+
+    // PORT only fires when DETECT rises, and DETECT stays up while any pin
+    // matches its SENSE. A pin that changes again before its SENSE flips
+    // would hold it up for good, so go round until none does.
+    while ((changed = record(NRF_GPIO->IN)) != 0) {
+        for (uint8_t i = 0; i < _num_pins; i++) {
+            uint8_t pin = _pins[i].pin;
+
+            if (changed & (1UL << pin)) sense_other(pin, (_sensed >> pin) & 1);
+        }
+    }
+}
+
+uint32_t pin_input_init (const pin_input_config_t* pins, uint8_t count, pin_input_handler_t handler) {
+    uint32_t err_code;
+
+    NVIC_DisableIRQ(GPIOTE_IRQn);
+    NRF_GPIOTE->INTENCLR = GPIOTE_INTENCLR_PORT_Msk;
+
+    err_code = setup(pins, count, handler);
+    if (err_code != NRF_SUCCESS) return err_code;
+
+    err_code = app_timer_create(&_debounce_timer, APP_TIMER_MODE_SINGLE_SHOT, timeout);
+    if (err_code != NRF_SUCCESS) return err_code;
+
+    for (uint8_t i = 0; i < count; i++) {
+        nrf_gpio_cfg_input(pins[i].pin, (nrf_gpio_pin_pull_t) pins[i].pull);
+    }
+    set_levels(NRF_GPIO->IN);
+    for (uint8_t i = 0; i < count; i++) {
+        sense_other(_pins[i].pin, _pins[i].level);
+    }
+
+    NRF_GPIOTE->EVENTS_PORT = 0;
+    NRF_GPIOTE->INTENSET = GPIOTE_INTENSET_PORT_Msk;
+    NVIC_SetPriority(GPIOTE_IRQn, APP_IRQ_PRIORITY_LOW);
+    NVIC_ClearPendingIRQ(GPIOTE_IRQn);
+    NVIC_EnableIRQ(GPIOTE_IRQn);
+
+    // Catches a pin that changed while SENSE was being set
+    NVIC_SetPendingIRQ(GPIOTE_IRQn);
+    return NRF_SUCCESS;
+}
+
+
+/******************************************************************************
+ * Pulse counter
+ ******************************************************************************/
+
+#define COUNTER_TIMER CONCAT(NRF_TIMER, PIN_INPUT_COUNTER_TIMER_INSTANCE, )
+
+// The nRF51's TIMER1 and TIMER2 are 16 bits
+#ifdef NRF52
+#define COUNTER_BITMODE TIMER_BITMODE_BITMODE_32Bit
+#define COUNTER_MASK    0xFFFFFFFF
+#else
+#define COUNTER_BITMODE TIMER_BITMODE_BITMODE_16Bit
+#define COUNTER_MASK    0xFFFF
+#endif
+
+// Renamed in SDK 12
+#ifndef MODULE_ALREADY_INITIALIZED
+#define MODULE_ALREADY_INITIALIZED NRF_ERROR_MODULE_ALREADY_INITIALIZED
+#endif
+
+static nrf_ppi_channel_t _count_channel;
+static uint32_t _count_last;
+static uint32_t _count_total;
+
+uint32_t pin_input_counter_init (uint8_t pin, uint8_t pull, pin_input_polarity_t polarity) {
+    uint32_t err_code;
+
+    nrf_gpio_cfg_input(pin, (nrf_gpio_pin_pull_t) pull);
+
+    COUNTER_TIMER->TASKS_STOP  = 1;
+    COUNTER_TIMER->MODE        = TIMER_MODE_MODE_Counter;
+    COUNTER_TIMER->BITMODE     = COUNTER_BITMODE;
+    COUNTER_TIMER->SHORTS      = 0;
+    COUNTER_TIMER->INTENCLR    = 0xFFFFFFFF;
+    COUNTER_TIMER->TASKS_CLEAR = 1;
+    _count_last  = 0;
+    _count_total = 0;
+
+    NRF_GPIOTE->CONFIG[PIN_INPUT_COUNTER_GPIOTE_CHANNEL] =
+        (GPIOTE_CONFIG_MODE_Event << GPIOTE_CONFIG_MODE_Pos) |
+        ((uint32_t) pin << GPIOTE_CONFIG_PSEL_Pos) |
+        ((uint32_t) polarity << GPIOTE_CONFIG_POLARITY_Pos);
+    NRF_GPIOTE->EVENTS_IN[PIN_INPUT_COUNTER_GPIOTE_CHANNEL] = 0;
+
+    err_code = nrf_drv_ppi_init();
+    if (err_code != NRF_SUCCESS && err_code != MODULE_ALREADY_INITIALIZED) return err_code;
+    err_code = nrf_drv_ppi_channel_alloc(&_count_channel);
+    if (err_code != NRF_SUCCESS) return err_code;
+    err_code = nrf_drv_ppi_channel_assign(_count_channel,
+            (uint32_t) &NRF_GPIOTE->EVENTS_IN[PIN_INPUT_COUNTER_GPIOTE_CHANNEL],
+            (uint32_t) &COUNTER_TIMER->TASKS_COUNT);
+    if (err_code != NRF_SUCCESS) return err_code;
+    err_code = nrf_drv_ppi_channel_enable(_count_channel);
+    if (err_code != NRF_SUCCESS) return err_code;
+
+    COUNTER_TIMER->TASKS_START = 1;
+    return NRF_SUCCESS;
+}
+
+uint32_t pin_input_count (void) {
+    uint32_t now;
+
+    COUNTER_TIMER->TASKS_CAPTURE[0] = 1;
+    now = COUNTER_TIMER->CC[0];
+
+    // Carried on in software past the counter's wrap
+    _count_total += (now - _count_last) & COUNTER_MASK;
+    _count_last = now;
+    return _count_total;
+}
+
+#else
+
+static void start_timer (uint32_t ticks) {
+    pin_input_host_start_timer(ticks);
+}
+
+void pin_input_host_port_event (void) {
+    _stats.interrupts++;
+    record(pin_input_host_in());
+}
+
+void pin_input_host_timeout (void) {
+    timeout(NULL);
+}
+
+uint32_t pin_input_init (const pin_input_config_t* pins, uint8_t count, pin_input_handler_t handler) {
+    uint32_t err_code = setup(pins, count, handler);
+
+    if (err_code != NRF_SUCCESS) return err_code;
+    set_levels(pin_input_host_in());
+    return NRF_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,132 @@
+// Debounced inputs from GPIO port events
+//
+// Watches a set of input pins (buttons, switches, interrupt lines) with the
+// GPIO SENSE mechanism and the one GPIOTE PORT event instead of a GPIOTE
+// channel and a handler per pin. SENSE is what wakes the chip, costs no
+// current while waiting and works for every pin at once.
+//
+// The PORT interrupt only notes which pins changed and the RTC1 time in a
+// ring, and flips those pins' SENSE to catch the next edge. Debouncing
+// happens later, for all pins together, in an app_timer that only runs while
+// some pin is bouncing: a pin's change is reported once it has been steady
+// for its debounce time, and a pulse shorter than that is dropped. The
+// handler gets every change of that run in one call, from the app_timer
+// context, not from the GPIO interrupt.
+//
+// For pulses too fast to interrupt on at all (flow meters, anemometers,
+// encoders) pin_input_counter_init() counts edges of one pin in a TIMER
+// through a GPIOTE event and PPI, with no CPU per pulse.
+//
+// Owns GPIOTE_IRQHandler, so it can't be linked with nrf_drv_gpiote.c.
+// Needs app_timer running with prescaler 0 (simple_ble does that).
+//
+//   static const pin_input_config_t pins[] = {
+//       {BUTTON0, NRF_GPIO_PIN_PULLUP, 20},
+//       {BUTTON1, NRF_GPIO_PIN_PULLUP, 20},
+//   };
+//
+//   static void inputs (const pin_input_event_t* events, uint8_t count) {
+//       for (uint8_t i = 0; i < count; i++) {
+//           if (events[i].pin == BUTTON0 && !events[i].level) ...
+//       }
+//   }
+//
+//   pin_input_init(pins, 2, inputs);
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Most pins watched at once
+#ifndef PIN_INPUT_MAX_PINS
+#define PIN_INPUT_MAX_PINS 8
+#endif
+
+// Interrupts that can wait for the timer, a power of two
+#ifndef PIN_INPUT_QUEUE_SIZE
+#define PIN_INPUT_QUEUE_SIZE 16
+#endif
+
+#ifndef PIN_INPUT_COUNTER_TIMER_INSTANCE
+#ifdef NRF52
+#define PIN_INPUT_COUNTER_TIMER_INSTANCE 3
+#else
+#define PIN_INPUT_COUNTER_TIMER_INSTANCE 2
+#endif
+#endif
+
+#ifndef PIN_INPUT_COUNTER_GPIOTE_CHANNEL
+#define PIN_INPUT_COUNTER_GPIOTE_CHANNEL 2
+#endif
+
+// Timestamps are RTC1 ticks: 32768 per second, 24 bits
+#define PIN_INPUT_TICKS_PER_SECOND 32768
+#define PIN_INPUT_TICKS_MASK 0xFFFFFF
+
+typedef struct {
+    uint8_t  pin;
+    uint8_t  pull;          // NRF_GPIO_PIN_NOPULL, _PULLDOWN or _PULLUP
+    uint16_t debounce_ms;   // 0 reports every change at the next timer run
+} pin_input_config_t;
+
+typedef struct {
+    uint8_t  pin;
+    bool     level;         // the level the pin settled at
+    uint16_t edges;         // edges seen on the way, 1 for a clean change
+    uint32_t time;          // RTC1 ticks at the first of them
+} pin_input_event_t;
+
+// The changes of one timer run, at most one per pin
+typedef void (*pin_input_handler_t) (const pin_input_event_t* events, uint8_t count);
+
+// Edges to count in hardware; the GPIOTE POLARITY values
+typedef enum {
+    PIN_INPUT_RISING  = 1,
+    PIN_INPUT_FALLING = 2,
+    PIN_INPUT_BOTH    = 3,
+} pin_input_polarity_t;
+
+typedef struct {
+    uint32_t interrupts;    // PORT interrupts taken
+    uint32_t edges;         // pin changes they saw
+    uint32_t timeouts;      // debounce timer runs
+    uint32_t events;        // changes reported
+    uint32_t batches;       // handler calls
+    uint32_t glitches;      // changes dropped for being shorter than the debounce
+    uint32_t overflows;     // interrupts the queue had no room for
+} pin_input_stats_t;
+
+// Configure the pins as inputs and start watching them. The config is
+// copied. Returns NRF_ERROR_INVALID_PARAM for too many pins.
+uint32_t pin_input_init (const pin_input_config_t* pins, uint8_t count, pin_input_handler_t handler);
+
+// Debounced level of a watched pin, as of the last change reported
+bool pin_input_read (uint8_t pin);
+
+void pin_input_get_stats (pin_input_stats_t* stats);
+
+#ifndef PIN_INPUT_HOST
+
+// Count edges of a pin in a TIMER (PIN_INPUT_COUNTER_TIMER_INSTANCE) fed by
+// a GPIOTE event channel (PIN_INPUT_COUNTER_GPIOTE_CHANNEL) through PPI.
+// The pin should not also be watched by pin_input_init(). An event channel
+// keeps the high frequency clock running, about 0.5 mA on the nRF51.
+uint32_t pin_input_counter_init (uint8_t pin, uint8_t pull, pin_input_polarity_t polarity);
+
+// Edges counted since pin_input_counter_init(). The nRF51 counter is 16
+// bits, so call this at least every 65535 edges there.
+uint32_t pin_input_count (void);
+
+#else
+
+// The host test stands in for the hardware: it supplies these
+uint32_t pin_input_host_in (void);              // NRF_GPIO->IN
+uint32_t pin_input_host_now (void);             // NRF_RTC1->COUNTER
+void pin_input_host_start_timer (uint32_t ticks);
+
+// and calls these for the PORT interrupt and the timer running out
+void pin_input_host_port_event (void);
+void pin_input_host_timeout (void);
+
+#endif
@@ -0,0 +1,285 @@
+// Shared SPI Bus
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nrf_gpio.h"
+#include "nrf_drv_spi.h"
+#include "app_util_platform.h"
+
+#include "spi_bus.h"
+
+// nrf_drv_spi handlers do not carry a context pointer, so keep track of
+// which bus owns each driver instance.
+#define SPI_BUS_MAX_INSTANCES 3
+static spi_bus_t* _buses[SPI_BUS_MAX_INSTANCES] = {NULL};
+
+static void bus_event (spi_bus_t* bus);
+
+static void spi_bus_handler_0 (nrf_drv_spi_evt_t const* p_event) { bus_event(_buses[0]); }
+static void spi_bus_handler_1 (nrf_drv_spi_evt_t const* p_event) { bus_event(_buses[1]); }
+static void spi_bus_handler_2 (nrf_drv_spi_evt_t const* p_event) { bus_event(_buses[2]); }
+
+static const nrf_drv_spi_handler_t _handlers[SPI_BUS_MAX_INSTANCES] = {
+    spi_bus_handler_0,
+    spi_bus_handler_1,
+    spi_bus_handler_2,
+};
+
+
+static void cs_assert (spi_bus_device_t* device) {
+    if (device->cs_pin == NRF_DRV_SPI_PIN_NOT_USED) return;
+    if (device->cs_active_high) nrf_gpio_pin_set(device->cs_pin);
+    else                        nrf_gpio_pin_clear(device->cs_pin);
+}
+
+static void cs_deassert (spi_bus_device_t* device) {
+    if (device->cs_pin == NRF_DRV_SPI_PIN_NOT_USED) return;
+    if (device->cs_active_high) nrf_gpio_pin_clear(device->cs_pin);
+    else                        nrf_gpio_pin_set(device->cs_pin);
+}
+
+// Field by field: the structs have padding, which memcmp would compare too
+static bool same_config (const nrf_drv_spi_config_t* a, const nrf_drv_spi_config_t* b) {
+    return a->sck_pin      == b->sck_pin &&
+           a->mosi_pin     == b->mosi_pin &&
+           a->miso_pin     == b->miso_pin &&
+           a->irq_priority == b->irq_priority &&
+           a->orc          == b->orc &&
+           a->frequency    == b->frequency &&
+           a->mode         == b->mode &&
+           a->bit_order    == b->bit_order;
+}
+
+// Load the device's settings into the peripheral, but only if they differ
+// from what is loaded already. Two devices with identical settings share a
+// configuration since CS is not handled by the driver.
+static uint32_t configure (spi_bus_t* bus, spi_bus_device_t* device) {
+    uint32_t err;
+    nrf_drv_spi_config_t config = {
+        .sck_pin      = device->sck_pin,
+        .mosi_pin     = device->mosi_pin,
+        .miso_pin     = device->miso_pin,
+        .ss_pin       = NRF_DRV_SPI_PIN_NOT_USED,
+        .irq_priority = bus->irq_priority,
+        .orc          = device->orc,
+        .frequency    = device->frequency,
+        .mode         = device->mode,
+        .bit_order    = device->bit_order,
+    };
+
+    if (bus->initialized) {
+        if (same_config(&config, &bus->config)) {
+            return NRF_SUCCESS;
+        }
+        // This may run from inside the driver's own event handler. That is
+        // fine: the handler call is the last thing the driver's IRQ does.
+        nrf_drv_spi_uninit(bus->spi);
+        bus->initialized = false;
+    }
+
+    err = nrf_drv_spi_init(bus->spi, &config,
+                           bus->async ? _handlers[bus->spi->drv_inst_idx] : NULL);
+    if (err != NRF_SUCCESS) return err;
+
+    bus->config = config;
+    bus->initialized = true;
+    bus->reconfigurations++;
+    return NRF_SUCCESS;
+}
+
+static uint32_t start_segment (spi_bus_t* bus) {
+    spi_bus_transaction_t* t = bus->head;
+    const spi_bus_segment_t* seg = &t->segments[t->segment];
+
+    return nrf_drv_spi_transfer(bus->spi, seg->tx, seg->tx_len, seg->rx, seg->rx_len);
+}
+
+static void start_next (spi_bus_t* bus);
+
+// Retire the transaction at the head of the queue
+static void finish (spi_bus_t* bus, uint32_t result) {
+    spi_bus_transaction_t* t = bus->head;
+
+    cs_deassert(t->device);
+
+    CRITICAL_REGION_ENTER();
+    bus->head = t->next;
+    if (bus->head == NULL) bus->tail = NULL;
+    bus->active = false;
+    CRITICAL_REGION_EXIT();
+
+    t->next = NULL;
+    t->result = result;
+    t->done = true;
+
+    if (t->callback) t->callback(t);
+}
+
+// Run whatever is at the head of the queue. Blocking buses drain the whole
+// queue here, async buses start the first segment and continue in the
+// interrupt.
+//
+// Callbacks may queue the next transaction themselves, from any interrupt,
+// so claiming the head is atomic and only one caller ever starts it.
+static void start_next (spi_bus_t* bus) {
+    uint32_t err;
+
+    while (1) {
+        spi_bus_transaction_t* t;
+
+        CRITICAL_REGION_ENTER();
+        t = bus->active ? NULL : bus->head;
+        if (t) bus->active = true;
+        CRITICAL_REGION_EXIT();
+
+        if (t == NULL) return;
+
+        err = configure(bus, t->device);
+        if (err != NRF_SUCCESS) {
+            finish(bus, err);
+            continue;
+        }
+
+        cs_assert(t->device);
+        t->segment = 0;
+
+        if (t->num_segments == 0) {
+            finish(bus, NRF_SUCCESS);
+            continue;
+        }
+
+        if (bus->async) {
+            err = start_segment(bus);
+            if (err == NRF_SUCCESS) return;
+            finish(bus, err);
+            continue;
+        }
+
+        for (err = NRF_SUCCESS; t->segment < t->num_segments; t->segment++) {
+            err = start_segment(bus);
+            if (err != NRF_SUCCESS) break;
+        }
+        finish(bus, err);
+    }
+}
+
+static void bus_event (spi_bus_t* bus) {
+    spi_bus_transaction_t* t;
+    uint32_t err;
+
+    if (bus == NULL || bus->head == NULL) return;
+    t = bus->head;
+
+    t->segment++;
+    if (t->segment < t->num_segments) {
+        err = start_segment(bus);
+        if (err == NRF_SUCCESS) return;
+    } else {
+        err = NRF_SUCCESS;
+    }
+
+    finish(bus, err);
+    start_next(bus);
+}
+
+
+void spi_bus_init (spi_bus_t* bus,
+                   const nrf_drv_spi_t* spi,
+                   uint8_t irq_priority,
+                   bool async) {
+    memset(bus, 0, sizeof(spi_bus_t));
+    bus->spi          = spi;
+    bus->irq_priority = irq_priority;
+    bus->async        = async;
+
+    if (spi->drv_inst_idx < SPI_BUS_MAX_INSTANCES) {
+        _buses[spi->drv_inst_idx] = bus;
+    }
+}
+
+void spi_bus_add_device (spi_bus_t* bus, spi_bus_device_t* device) {
+    device->bus = bus;
+
+    if (device->cs_pin != NRF_DRV_SPI_PIN_NOT_USED) {
+        cs_deassert(device);
+        nrf_gpio_cfg_output(device->cs_pin);
+    }
+}
+
+uint32_t spi_bus_queue (spi_bus_transaction_t* transaction) {
+    spi_bus_t* bus = transaction->device->bus;
+    bool was_idle;
+
+    if (bus == NULL) return NRF_ERROR_INVALID_STATE;
+
+    transaction->next = NULL;
+    transaction->done = false;
+    transaction->result = NRF_SUCCESS;
+
+    CRITICAL_REGION_ENTER();
+    was_idle = (bus->head == NULL);
+    if (was_idle) {
+        bus->head = transaction;
+    } else {
+        bus->tail->next = transaction;
+    }
+    bus->tail = transaction;
+    CRITICAL_REGION_EXIT();
+
+    // If something is already running it will pick this up when it is done
+    if (was_idle) {
+        start_next(bus);
+    }
+
+    return NRF_SUCCESS;
+}
+
+uint32_t spi_bus_transfer_segments (spi_bus_device_t* device,
+                                    const spi_bus_segment_t* segments,
+                                    uint8_t num_segments) {
+    spi_bus_transaction_t t = {
+        .device       = device,
+        .segments     = segments,
+        .num_segments = num_segments,
+    };
+    uint32_t err;
+
+    err = spi_bus_queue(&t);
+    if (err != NRF_SUCCESS) return err;
+
+    while (!t.done);
+    return t.result;
+}
+
+uint32_t spi_bus_transfer (spi_bus_device_t* device,
+                           const uint8_t* tx, uint8_t tx_len,
+                           uint8_t* rx, uint8_t rx_len) {
+    spi_bus_segment_t seg = {
+        .tx     = tx,
+        .tx_len = tx_len,
+        .rx     = rx,
+        .rx_len = rx_len,
+    };
+    return spi_bus_transfer_segments(device, &seg, 1);
+}
+
+bool spi_bus_idle (spi_bus_t* bus) {
+    return bus->head == NULL;
+}
+
+void spi_bus_claim_raw (spi_bus_t* bus) {
+    while (!spi_bus_idle(bus));
+
+    if (bus->initialized) {
+        nrf_drv_spi_uninit(bus->spi);
+        bus->initialized = false;
+    }
+}
+
+void spi_bus_release_raw (spi_bus_t* bus) {
+    // Nothing to restore, the next transaction runs configure() from scratch
+    // because the bus is marked uninitialized.
+    bus->initialized = false;
+}
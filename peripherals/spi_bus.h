@@ -0,0 +1,124 @@
+// Shared SPI Bus
+//
+// Lets several SPI devices share one SPI master instance. Each device
+// registers its pins, mode and frequency once. Transactions are queued per
+// bus and the peripheral is only reconfigured when the next transaction needs
+// a different configuration than the one currently loaded. Chip select is
+// always driven here in software, so a transaction may be made of several
+// segments that all run under one CS assertion.
+//
+// A bus is either blocking (the nrf_drv_spi default) or asynchronous. In
+// asynchronous mode transfers complete in the SPI interrupt (by EasyDMA on
+// nRF52 SPIM instances) and the transaction callback is called from there.
+//
+//   static spi_bus_t        bus;
+//   static spi_bus_device_t fram = {
+//       .sck_pin = 9, .mosi_pin = 11, .miso_pin = 10, .cs_pin = 4,
+//       .frequency = NRF_DRV_SPI_FREQ_1M, .mode = NRF_DRV_SPI_MODE_3,
+//   };
+//   static nrf_drv_spi_t spi0 = NRF_DRV_SPI_INSTANCE(0);
+//
+//   spi_bus_init(&bus, &spi0, APP_IRQ_PRIORITY_LOW, false);
+//   spi_bus_add_device(&bus, &fram);
+//   spi_bus_transfer(&fram, tx, 2, rx, 2);
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "nrf_drv_spi.h"
+
+typedef struct spi_bus_s spi_bus_t;
+typedef struct spi_bus_transaction_s spi_bus_transaction_t;
+
+typedef void (*spi_bus_callback_t)(spi_bus_transaction_t* transaction);
+
+typedef struct {
+    uint8_t                 sck_pin;
+    uint8_t                 mosi_pin;
+    uint8_t                 miso_pin;
+    uint8_t                 cs_pin;         // NRF_DRV_SPI_PIN_NOT_USED if none
+    bool                    cs_active_high; // most parts are active low
+    uint8_t                 orc;            // sent while only receiving
+    nrf_drv_spi_frequency_t frequency;
+    nrf_drv_spi_mode_t      mode;
+    nrf_drv_spi_bit_order_t bit_order;
+
+    // Set by spi_bus_add_device()
+    spi_bus_t*              bus;
+} spi_bus_device_t;
+
+// One nrf_drv_spi_transfer() worth of data. As with nrf_drv_spi_transfer(),
+// rx bytes are clocked in while tx bytes are clocked out.
+typedef struct {
+    const uint8_t* tx;
+    uint8_t        tx_len;
+    uint8_t*       rx;
+    uint8_t        rx_len;
+} spi_bus_segment_t;
+
+struct spi_bus_transaction_s {
+    spi_bus_device_t*        device;
+    const spi_bus_segment_t* segments;
+    uint8_t                  num_segments;
+    spi_bus_callback_t       callback;  // optional
+    void*                    context;   // for the callback's use
+
+    // Owned by the bus while the transaction is queued
+    volatile uint32_t        result;
+    volatile bool            done;
+    uint8_t                  segment;
+    spi_bus_transaction_t*   next;
+};
+
+struct spi_bus_s {
+    const nrf_drv_spi_t*   spi;
+    uint8_t                irq_priority;
+    bool                   async;
+
+    bool                   initialized;
+    nrf_drv_spi_config_t   config;      // what the peripheral is set to now
+    spi_bus_transaction_t* volatile head; // advanced from the SPI interrupt
+    spi_bus_transaction_t* tail;
+    volatile bool          active;      // head has been started
+
+    uint32_t               reconfigurations;
+};
+
+// Set up a bus on top of an SPI master instance. The peripheral itself is
+// not touched until the first transaction.
+void spi_bus_init (spi_bus_t* bus,
+                   const nrf_drv_spi_t* spi,
+                   uint8_t irq_priority,
+                   bool async);
+
+// Attach a device to the bus and park its chip select.
+void spi_bus_add_device (spi_bus_t* bus, spi_bus_device_t* device);
+
+// Queue a transaction. On a blocking bus this runs it before returning.
+// The transaction and its segments must stay valid until it is done. Safe to
+// call from a transaction callback or any other interrupt.
+uint32_t spi_bus_queue (spi_bus_transaction_t* transaction);
+
+// Run segments under one CS assertion and wait for them to finish. Do not
+// call this on an async bus from an interrupt at or above its priority.
+uint32_t spi_bus_transfer_segments (spi_bus_device_t* device,
+                                    const spi_bus_segment_t* segments,
+                                    uint8_t num_segments);
+
+// Single segment convenience version of spi_bus_transfer_segments().
+uint32_t spi_bus_transfer (spi_bus_device_t* device,
+                           const uint8_t* tx, uint8_t tx_len,
+                           uint8_t* rx, uint8_t rx_len);
+
+// True if nothing is queued or in flight.
+bool spi_bus_idle (spi_bus_t* bus);
+
+// For drivers that program the SPI registers directly (e.g. the SD card
+// driver). Waits for the queue to drain and hands the peripheral over.
+// The next queued transaction reloads its configuration. Do not claim an
+// async bus from an interrupt at or above its priority, the queue would
+// never drain.
+void spi_bus_claim_raw (spi_bus_t* bus);
+void spi_bus_release_raw (spi_bus_t* bus);
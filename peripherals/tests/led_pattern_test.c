@@ -0,0 +1,104 @@
+// Host test for the rendering half of led_pattern.c: what brightness each
+// tick of the built-in and a few odd patterns gets, and the duty cycle
+// curve.
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "led_pattern.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do {                                              \
+    if (!(cond)) {                                                    \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+        failures++;                                                   \
+    }                                                                 \
+} while (0)
+
+static uint8_t levels[LED_PATTERN_MAX_TICKS];
+
+// Ticks from..to-1 all at level
+static int all (uint16_t from, uint16_t to, uint8_t level) {
+    for (uint16_t i = from; i < to; i++) {
+        if (levels[i] != level) return 0;
+    }
+    return 1;
+}
+
+static void test_blinks (void) {
+    CHECK(led_pattern_duration(&led_pattern_blink) == 1000);
+    CHECK(led_pattern_tick_ms(&led_pattern_blink) == 10);
+    CHECK(led_pattern_render(&led_pattern_blink, levels) == 100);
+    CHECK(all(0, 10, 255));
+    CHECK(all(10, 100, 0));
+
+    CHECK(led_pattern_render(&led_pattern_double_blink, levels) == 100);
+    CHECK(all(0, 10, 255));
+    CHECK(all(10, 25, 0));
+    CHECK(all(25, 35, 255));
+    CHECK(all(35, 100, 0));
+}
+
+static void test_breathe (void) {
+    CHECK(led_pattern_render(&led_pattern_breathe, levels) == 250);
+
+    // Up over 100 ticks from the level it loops from, down over 100, off
+    CHECK(levels[0] == 3);
+    for (int i = 1; i < 100; i++) CHECK(levels[i] > levels[i - 1]);
+    CHECK(levels[99] == 255);
+    for (int i = 101; i < 200; i++) CHECK(levels[i] < levels[i - 1]);
+    CHECK(levels[100] == 252);
+    CHECK(levels[199] == 0);
+    CHECK(all(200, 250, 0));
+}
+
+static void test_fades (void) {
+    CHECK(led_pattern_render(&led_pattern_fade_in, levels) == 50);
+    CHECK(levels[0] == 5);
+    CHECK(levels[49] == 255);
+
+    // The zero length step sets where the ramp starts
+    CHECK(led_pattern_render(&led_pattern_fade_out, levels) == 50);
+    CHECK(levels[0] == 250);
+    CHECK(levels[49] == 0);
+}
+
+static void test_odd (void) {
+    LED_PATTERN(instant, false, LED_STEP(200, 0));
+    LED_PATTERN(uneven, false, LED_STEP(255, 15), LED_STEP(0, 15));
+    LED_PATTERN(long_one, true, LED_STEP(255, 5000), LED_RAMP(0, 5000));
+
+    // No time at all is one tick at the last level
+    CHECK(led_pattern_render(&instant, levels) == 1);
+    CHECK(levels[0] == 200);
+
+    // Steps fall on tick boundaries where they start
+    CHECK(led_pattern_render(&uneven, levels) == 3);
+    CHECK(levels[0] == 255 && levels[1] == 255 && levels[2] == 0);
+
+    // Too long for LED_PATTERN_MAX_TICKS at 10 ms
+    CHECK(led_pattern_tick_ms(&long_one) == 40);
+    CHECK(led_pattern_render(&long_one, levels) == 250);
+    CHECK(all(0, 125, 255));
+    CHECK(levels[249] == 0);
+}
+
+static void test_duty (void) {
+    CHECK(led_pattern_duty(0) == 0);
+    CHECK(led_pattern_duty(1) == 1);
+    CHECK(led_pattern_duty(128) == 65);
+    CHECK(led_pattern_duty(255) == 255);
+    for (int i = 1; i < 256; i++) CHECK(led_pattern_duty(i) >= led_pattern_duty(i - 1));
+}
+
+int main (int argc, char** argv) {
+    test_blinks();
+    test_breathe();
+    test_fades();
+    test_odd();
+    test_duty();
+
+    printf("led_pattern: %s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,136 @@
+// Host test for pin_group.h, against a GPIO that remembers the last value
+// written to each register. Checks the masks the macros build at compile
+// time and which registers each call writes.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+static struct {
+    uint32_t OUT;
+    uint32_t OUTSET;
+    uint32_t OUTCLR;
+    uint32_t DIR;
+} gpio;
+
+#define NRF_GPIO (&gpio)
+
+static void nrf_gpio_cfg_output (uint32_t pin) {
+    gpio.DIR |= 1UL << pin;
+}
+
+#include "pin_group.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do {                                              \
+    if (!(cond)) {                                                    \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+        failures++;                                                   \
+    }                                                                 \
+} while (0)
+
+// Built at compile time, or these would not compile
+static const pin_group_t leds = PIN_GROUP(1, 18, 19, 20);
+static const pin_group_t bus = PIN_GROUP(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16);
+_Static_assert(PIN_MASK(18, 19, 20) == 0x1C0000, "PIN_MASK");
+_Static_assert(PIN_MASK(0) == 1 && PIN_MASK(31) == 0x80000000, "PIN_MASK ends");
+
+// Clear the set / clear registers, run an operation, then apply what it
+// wrote to OUT like the hardware does
+#define RUN(op) do {                                                  \
+    gpio.OUTSET = 0;                                                  \
+    gpio.OUTCLR = 0;                                                  \
+    op;                                                               \
+    gpio.OUT = (gpio.OUT | gpio.OUTSET) & ~gpio.OUTCLR;               \
+} while (0)
+
+static void test_masks (void) {
+    pin_group_t mixed = {PIN_MASK(3, 4), PIN_MASK(4)};
+    pin_group_t led = LED_GROUP(7);
+
+    CHECK(leds.mask == 0x1C0000 && leds.active_low == 0x1C0000);
+    CHECK(bus.mask == 0x1FFFE && bus.active_low == 0);
+    CHECK(led.mask == 0x80 && led.active_low == (LEDS_ACTIVE_LOW ? 0x80 : 0));
+    CHECK(pin_group_high(&mixed, PIN_MASK(3, 4)) == PIN_MASK(3));
+    CHECK(pin_group_high(&mixed, 0) == PIN_MASK(4));
+}
+
+// A group of one polarity is one register write
+static void test_one_write (void) {
+    gpio.OUT = 0xFFFFFFFF;
+
+    RUN(pin_group_on(&leds));
+    CHECK(gpio.OUTSET == 0 && gpio.OUTCLR == 0x1C0000);
+    CHECK(gpio.OUT == ~0x1C0000u);
+
+    RUN(pin_group_off(&leds));
+    CHECK(gpio.OUTSET == 0x1C0000 && gpio.OUTCLR == 0);
+    CHECK(gpio.OUT == 0xFFFFFFFF);
+
+    RUN(pin_group_on(&bus));
+    CHECK(gpio.OUTSET == 0x1FFFE && gpio.OUTCLR == 0);
+}
+
+static void test_write (void) {
+    gpio.OUT = 0;
+
+    // Red on, the others off: high for the off ones as they are active low
+    RUN(pin_group_write(&leds, PIN_MASK(18)));
+    CHECK(gpio.OUTSET == PIN_MASK(19, 20) && gpio.OUTCLR == PIN_MASK(18));
+    CHECK(pin_group_read(&leds) == PIN_MASK(18));
+
+    // Bits outside the group are ignored
+    RUN(pin_group_write(&leds, 0xFFFFFFFF));
+    CHECK(gpio.OUTCLR == 0x1C0000);
+    CHECK(pin_group_read(&leds) == leds.mask);
+
+    // Mixed polarity takes both registers
+    pin_group_t mixed = {PIN_MASK(3, 4), PIN_MASK(4)};
+    gpio.OUT = 0;
+    RUN(pin_group_on(&mixed));
+    CHECK(gpio.OUTSET == PIN_MASK(3) && gpio.OUTCLR == PIN_MASK(4));
+    CHECK(pin_group_read(&mixed) == mixed.mask);
+}
+
+static void test_toggle (void) {
+    gpio.OUT = PIN_MASK(18, 5);
+    RUN(pin_group_toggle(&leds));
+    CHECK(gpio.OUT == PIN_MASK(19, 20, 5));
+    RUN(pin_group_toggle(&leds));
+    CHECK(gpio.OUT == PIN_MASK(18, 5));
+}
+
+static void test_bits (void) {
+    CHECK(pin_group_bits(&leds, 0) == 0);
+    CHECK(pin_group_bits(&leds, 1) == PIN_MASK(18));
+    CHECK(pin_group_bits(&leds, 6) == PIN_MASK(19, 20));
+    CHECK(pin_group_bits(&leds, 0xFF) == leds.mask);
+    CHECK(pin_group_bits(&bus, 0xA5A5) == (0xA5A5u << 1));
+
+    // A counter on the group, as a bit-banged bus would do it
+    gpio.OUT = 0;
+    for (uint32_t value = 0; value < 8; value++) {
+        RUN(pin_group_write(&leds, pin_group_bits(&leds, value)));
+        CHECK(((~gpio.OUT >> 18) & 7) == value);
+    }
+}
+
+static void test_init (void) {
+    memset(&gpio, 0, sizeof(gpio));
+    pin_group_init(&leds);
+    CHECK(gpio.DIR == leds.mask);
+    CHECK(gpio.OUTSET == leds.mask);
+}
+
+int main (int argc, char** argv) {
+    test_masks();
+    test_one_write();
+    test_write();
+    test_toggle();
+    test_bits();
+    test_init();
+
+    printf("pin_group: %s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
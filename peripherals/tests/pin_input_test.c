@@ -0,0 +1,248 @@
+// Host test for the debouncing in pin_input.c. The test plays the GPIO and
+// RTC: it changes pin levels at given times, takes the PORT interrupt for
+// each change, and runs the debounce timer when it falls due.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "pin_input.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do {                                              \
+    if (!(cond)) {                                                    \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+        failures++;                                                   \
+    }                                                                 \
+} while (0)
+
+// RTC ticks in a ms, near enough
+#define MS(ms) ((uint32_t)(ms) * PIN_INPUT_TICKS_PER_SECOND / 1000)
+
+#define BUTTON  3
+#define SWITCH  17
+
+static uint32_t gpio_in;
+static uint32_t rtc;
+static bool timer_running;
+static uint32_t timer_due;
+static uint32_t timer_starts;
+
+uint32_t pin_input_host_in (void) {
+    return gpio_in;
+}
+
+uint32_t pin_input_host_now (void) {
+    return rtc & PIN_INPUT_TICKS_MASK;
+}
+
+// Like app_timer: starting a running timer does nothing
+void pin_input_host_start_timer (uint32_t ticks) {
+    if (timer_running) return;
+    timer_running = true;
+    timer_due = rtc + ticks;
+    timer_starts++;
+}
+
+static pin_input_event_t events[64];
+static uint32_t num_events;
+static uint32_t batches;
+static uint8_t last_batch;
+
+static void handler (const pin_input_event_t* batch, uint8_t count) {
+    for (uint8_t i = 0; i < count && num_events < 64; i++) {
+        events[num_events++] = batch[i];
+    }
+    batches++;
+    last_batch = count;
+}
+
+// Time passes, with the timer running when due
+static void run_until (uint32_t t) {
+    while (timer_running && timer_due <= t) {
+        rtc = timer_due;
+        timer_running = false;
+        pin_input_host_timeout();
+    }
+    rtc = t;
+}
+
+static void set_pins (uint32_t t, uint32_t mask, bool level) {
+    run_until(t);
+    gpio_in = level ? gpio_in | mask : gpio_in & ~mask;
+    pin_input_host_port_event();
+}
+
+static void set_pin (uint32_t t, uint8_t pin, bool level) {
+    set_pins(t, 1UL << pin, level);
+}
+
+static const pin_input_config_t config[] = {
+    {BUTTON, 3, 20},
+    {SWITCH, 3, 5},
+};
+
+static void start (uint32_t t) {
+    gpio_in = (1UL << BUTTON) | (1UL << SWITCH);
+    rtc = t;
+    timer_running = false;
+    timer_starts = 0;
+    num_events = 0;
+    batches = 0;
+    CHECK(pin_input_init(config, 2, handler) == 0);
+}
+
+static void test_clean (void) {
+    pin_input_stats_t stats;
+
+    start(1000);
+    CHECK(pin_input_read(BUTTON) == 1);
+
+    set_pin(1000, BUTTON, 0);
+    CHECK(timer_running);
+    run_until(1000 + MS(19));
+    CHECK(num_events == 0);
+    run_until(1000 + MS(21));
+    CHECK(num_events == 1);
+    CHECK(events[0].pin == BUTTON && events[0].level == 0);
+    CHECK(events[0].edges == 1 && events[0].time == 1000);
+    CHECK(pin_input_read(BUTTON) == 0);
+
+    // Nothing left to do, so no timer
+    CHECK(!timer_running);
+    CHECK(timer_starts == 1);
+
+    set_pin(MS(500), BUTTON, 1);
+    run_until(MS(600));
+    CHECK(num_events == 2 && events[1].level == 1);
+    CHECK(batches == 2);
+
+    pin_input_get_stats(&stats);
+    CHECK(stats.interrupts == 2 && stats.edges == 2 && stats.events == 2);
+    CHECK(stats.timeouts == 2 && stats.glitches == 0);
+}
+
+// A bouncing contact is one event, timed from its first edge, once it has
+// been still for the debounce time
+static void test_bounce (void) {
+    start(0);
+
+    set_pin(MS(100), BUTTON, 0);
+    set_pin(MS(101), BUTTON, 1);
+    set_pin(MS(103), BUTTON, 0);
+    set_pin(MS(110), BUTTON, 1);
+    set_pin(MS(118), BUTTON, 0);
+    set_pin(MS(125), BUTTON, 1);
+    set_pin(MS(130), BUTTON, 0);
+
+    run_until(MS(149));
+    CHECK(num_events == 0);
+    run_until(MS(151));
+    CHECK(num_events == 1);
+    CHECK(events[0].level == 0 && events[0].edges == 7);
+    CHECK(events[0].time == MS(100));
+    CHECK(!timer_running);
+}
+
+// A pulse shorter than the debounce is dropped
+static void test_glitch (void) {
+    pin_input_stats_t stats;
+
+    start(0);
+    set_pin(MS(10), BUTTON, 0);
+    set_pin(MS(12), BUTTON, 1);
+    run_until(MS(100));
+
+    pin_input_get_stats(&stats);
+    CHECK(num_events == 0 && batches == 0);
+    CHECK(stats.glitches == 1);
+    CHECK(pin_input_read(BUTTON) == 1);
+    CHECK(!timer_running);
+}
+
+// Pins that settle by the same timer run come in one call
+static void test_batch (void) {
+    pin_input_stats_t stats;
+
+    start(0);
+    set_pins(MS(10), (1UL << BUTTON) | (1UL << SWITCH), 0);
+    run_until(MS(15) + 1);
+    CHECK(num_events == 1 && events[0].pin == SWITCH);
+    run_until(MS(31));
+    CHECK(num_events == 2 && events[1].pin == BUTTON);
+
+    // One settles while the other is still waiting: a call each
+    start(0);
+    set_pin(MS(10), SWITCH, 0);
+    set_pin(MS(12), SWITCH, 1);
+    set_pin(MS(14), SWITCH, 0);
+    set_pin(MS(30), BUTTON, 0);
+    run_until(MS(31));
+    CHECK(num_events == 1 && events[0].pin == SWITCH && events[0].edges == 3);
+    run_until(MS(60));
+    CHECK(num_events == 2);
+
+    // Both due by the same run: one call
+    start(0);
+    set_pin(MS(10), BUTTON, 0);
+    set_pin(MS(24), SWITCH, 0);
+    run_until(MS(40));
+    CHECK(num_events == 2 && batches == 1 && last_batch == 2);
+
+    pin_input_get_stats(&stats);
+    CHECK(stats.interrupts == 2 && stats.events == 2 && stats.batches == 1);
+}
+
+// More interrupts than the queue holds: the levels still come out right
+static void test_overflow (void) {
+    pin_input_stats_t stats;
+
+    start(0);
+    for (int i = 0; i < 3 * PIN_INPUT_QUEUE_SIZE + 1; i++) {
+        // Too quick for the timer to run in between
+        set_pin(MS(10) + i, BUTTON, i & 1);
+    }
+    run_until(MS(100));
+
+    pin_input_get_stats(&stats);
+    CHECK(stats.overflows == 2 * PIN_INPUT_QUEUE_SIZE + 1);
+    CHECK(stats.interrupts == 3 * PIN_INPUT_QUEUE_SIZE + 1);
+    CHECK(num_events == 1 && events[0].level == 0);
+    CHECK(events[0].edges == PIN_INPUT_QUEUE_SIZE);
+    CHECK(pin_input_read(BUTTON) == 0);
+}
+
+// The RTC is 24 bits and wraps every 512 s
+static void test_wrap (void) {
+    start(PIN_INPUT_TICKS_MASK - MS(5));
+
+    set_pin(PIN_INPUT_TICKS_MASK - MS(5), BUTTON, 0);
+    run_until(PIN_INPUT_TICKS_MASK + MS(10));
+    CHECK(num_events == 0);
+    run_until(PIN_INPUT_TICKS_MASK + MS(20));
+    CHECK(num_events == 1);
+    CHECK(events[0].time == PIN_INPUT_TICKS_MASK - MS(5));
+}
+
+static void test_config (void) {
+    pin_input_config_t many[PIN_INPUT_MAX_PINS + 1];
+    pin_input_config_t bad = {32, 0, 10};
+
+    memset(many, 0, sizeof(many));
+    CHECK(pin_input_init(many, PIN_INPUT_MAX_PINS + 1, handler) != 0);
+    CHECK(pin_input_init(&bad, 1, handler) != 0);
+}
+
+int main (void) {
+    test_clean();
+    test_bounce();
+    test_glitch();
+    test_batch();
+    test_overflow();
+    test_wrap();
+    test_config();
+
+    printf("pin_input: %s\n", failures ? "FAILED" : "OK");
+    return failures != 0;
+}
@@ -0,0 +1,165 @@
+// Render an LED pattern to a waveform
+//
+// Plays a pattern the way led_pattern.c does on the chip, period by period,
+// and writes the LED pin as a VCD file that GTKWave (or anything else that
+// reads VCD) shows. `lit` is the LED, `level` the brightness of the tick.
+// A summary goes to stderr, including how often the nRF51 has to wake up.
+//
+//   ./led_pattern_sim breathe > breathe.vcd
+//   ./led_pattern_sim --nrf51 --cycles 3 double_blink > double_blink.vcd
+//   ./led_pattern_sim --repeat 255:50,0:200,r128:500,r0:500 > custom.vcd
+//
+// A pattern is one of the built-in names or a list of steps: level:ms, with
+// an r in front for a ramp.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "led_pattern.h"
+
+#define PERIOD_US 1000
+#define NRF51_MIN_ON_US 10     // MIN_ON_US in led_pattern.c
+#define MAX_STEPS 64
+
+static const struct {
+    const char* name;
+    const led_pattern_t* pattern;
+} builtins[] = {
+    {"blink",        &led_pattern_blink},
+    {"double_blink", &led_pattern_double_blink},
+    {"breathe",      &led_pattern_breathe},
+    {"fade_in",      &led_pattern_fade_in},
+    {"fade_out",     &led_pattern_fade_out},
+};
+
+static led_pattern_step_t custom_steps[MAX_STEPS];
+static led_pattern_t custom = {custom_steps, 0, false};
+
+static bool parse_steps (char* text) {
+    for (char* token = strtok(text, ","); token != NULL; token = strtok(NULL, ",")) {
+        led_pattern_step_t* step = &custom_steps[custom.num_steps];
+        unsigned level, ms;
+
+        if (custom.num_steps == MAX_STEPS) return false;
+        step->ramp = token[0] == 'r';
+        if (sscanf(token + step->ramp, "%u:%u", &level, &ms) != 2 || level > 255 || ms > 65535) {
+            return false;
+        }
+        step->level = level;
+        step->ms    = ms;
+        custom.num_steps++;
+    }
+    return custom.num_steps > 0;
+}
+
+// Microseconds a PWM period is on, as each chip ends up doing it
+static uint32_t on_us (uint8_t level, bool nrf51) {
+    uint8_t duty = led_pattern_duty(level);
+
+    if (nrf51) {
+        // TIMER compare in us, at least NRF51_MIN_ON_US; 0 and 255 stop
+        // toggling
+        uint32_t on = (uint32_t) duty * PERIOD_US / 255;
+        if (duty == 0 || duty == 255) return on;
+        return on < NRF51_MIN_ON_US ? NRF51_MIN_ON_US : on;
+    }
+    // PWM compare in 4 us counts
+    return (uint32_t) duty * (PERIOD_US / 4) / 255 * 4;
+}
+
+static int64_t last_time = -1;
+static int last_lit = -1;
+
+static void at (uint64_t t) {
+    if ((int64_t) t == last_time) return;
+    printf("#%llu\n", (unsigned long long) t);
+    last_time = t;
+}
+
+static void lit (uint64_t t, int value) {
+    if (value == last_lit) return;
+    at(t);
+    printf("%dl\n", value);
+    last_lit = value;
+}
+
+static void usage (void) {
+    fprintf(stderr, "usage: led_pattern_sim [--nrf51] [--cycles N] [--repeat] <pattern> > out.vcd\n");
+    fprintf(stderr, "  pattern: blink, double_blink, breathe, fade_in, fade_out\n");
+    fprintf(stderr, "           or steps like 255:100,0:400,r255:500 (r for a ramp)\n");
+    exit(1);
+}
+
+int main (int argc, char** argv) {
+    static uint8_t levels[LED_PATTERN_MAX_TICKS];
+    const led_pattern_t* pattern = NULL;
+    bool nrf51 = false;
+    int cycles = 0;
+    uint16_t count, tick;
+    uint32_t changes = 0;
+    uint64_t t = 0, on_total = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--nrf51") == 0) {
+            nrf51 = true;
+        } else if (strcmp(argv[i], "--repeat") == 0) {
+            custom.repeat = true;
+        } else if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+            cycles = atoi(argv[++i]);
+        } else if (pattern == NULL && argv[i][0] != '-') {
+            for (size_t b = 0; b < sizeof(builtins) / sizeof(builtins[0]); b++) {
+                if (strcmp(argv[i], builtins[b].name) == 0) pattern = builtins[b].pattern;
+            }
+            if (pattern == NULL) {
+                if (!parse_steps(argv[i])) usage();
+                pattern = &custom;
+            }
+        } else {
+            usage();
+        }
+    }
+    if (pattern == NULL) usage();
+    if (cycles <= 0) cycles = pattern->repeat ? 2 : 1;
+
+    tick  = led_pattern_tick_ms(pattern);
+    count = led_pattern_render(pattern, levels);
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t previous = i > 0 ? i - 1 : count - 1;
+        if (levels[i] != levels[previous] || (i == 0 && !pattern->repeat)) changes++;
+    }
+
+    printf("$timescale 1us $end\n");
+    printf("$scope module led $end\n");
+    printf("$var wire 1 l lit $end\n");
+    printf("$var wire 8 v level $end\n");
+    printf("$upscope $end\n$enddefinitions $end\n");
+
+    for (int cycle = 0; cycle < cycles; cycle++) {
+        for (uint16_t i = 0; i < count; i++) {
+            uint32_t on = on_us(levels[i], nrf51);
+
+            at(t);
+            putchar('b');
+            for (int bit = 7; bit >= 0; bit--) putchar('0' + ((levels[i] >> bit) & 1));
+            printf(" v\n");
+
+            for (uint16_t period = 0; period < tick; period++) {
+                lit(t, on > 0);
+                if (on > 0 && on < PERIOD_US) lit(t + on, 0);
+                on_total += on;
+                t += PERIOD_US;
+            }
+        }
+    }
+    at(t);
+
+    fprintf(stderr, "%u ms per cycle, %u ticks of %u ms (%u bytes of PWM sequence on the nRF52)\n",
+            (unsigned) led_pattern_duration(pattern), count, tick, (unsigned)(count * sizeof(uint16_t)));
+    fprintf(stderr, "mean duty %.1f%%\n", 100.0 * on_total / t);
+    fprintf(stderr, "CPU wakeups per cycle: nRF52 0, nRF51 %u (%u brightness changes)\n",
+            changes * 2, changes);
+    return 0;
+}
@@ -0,0 +1,388 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nrf.h"
+#include "nrf_error.h"
+#include "nrf_gpio.h"
+#include "nrf_drv_ppi.h"
+#include "sdk_errors.h"
+
+#include "spsc_queue.h"
+#include "uart_stream.h"
+
+#define CONCAT_(a, b, c) a##b##c
+#define CONCAT(a, b, c)  CONCAT_(a, b, c)
+
+#define IDLE_TIMER       CONCAT(NRF_TIMER, UART_STREAM_TIMER_INSTANCE, )
+#define TIMER_IRQn       CONCAT(TIMER, UART_STREAM_TIMER_INSTANCE, _IRQn)
+#define TIMER_IRQHandler CONCAT(TIMER, UART_STREAM_TIMER_INSTANCE, _IRQHandler)
+
+#ifdef NRF52
+#define UART             NRF_UARTE0
+#define UART_IRQn        UARTE0_UART0_IRQn
+#define UART_IRQHandler  UARTE0_UART0_IRQHandler
+#else
+#define UART             NRF_UART0
+#define UART_IRQn        UART0_IRQn
+#define UART_IRQHandler  UART0_IRQHandler
+#endif
+
+// Renamed in SDK 12
+#ifndef MODULE_ALREADY_INITIALIZED
+#define MODULE_ALREADY_INITIALIZED NRF_ERROR_MODULE_ALREADY_INITIALIZED
+#endif
+
+// Buffer indexes that aren't one of the application's buffers
+#define NO_BUFFER        0xFF
+#define DISCARD          0xFE
+
+typedef struct {
+    uint8_t  buffer;
+    uint8_t  flags;
+    uint16_t len;
+} queued_frame_t;
+
+// Every buffer handed out is queued exactly once, in order, so the queue's
+// consumer count says which buffers the main loop has given back.
+SPSC_QUEUE_DEFINE(_frames, queued_frame_t, UART_STREAM_MAX_BUFFERS);
+
+static uint8_t* _buffers;
+static uint16_t _buffer_size;
+static uint8_t  _num_buffers;
+
+// Interrupt side
+static uint16_t _claimed;       // buffers handed out, wraps like the queue
+static uint8_t  _next;          // next buffer to hand out
+static uint8_t  _current;       // being filled
+static uint8_t  _lost_flag;     // for the next frame
+static volatile uint32_t _lost_bytes;
+static volatile uint32_t _errors;
+#ifdef NRF52
+static uint8_t  _pending;       // set up to be filled after _current
+static uint8_t  _discard[16];   // EasyDMA needs somewhere to put bytes
+#else
+static uint16_t _fill;          // bytes in _current
+#endif
+
+// Main loop side, for uart_stream_get_line()
+static uint16_t _line_offset;
+static uint16_t _line_len;
+
+// The next buffer in the ring, or DISCARD if the main loop has them all
+static uint8_t claim_buffer (void) {
+    uint8_t buffer;
+
+    if ((uint16_t)(_claimed - SPSC_LOAD(_frames.head)) >= _num_buffers) return DISCARD;
+
+    buffer = _next;
+    _next = (_next + 1 == _num_buffers) ? 0 : _next + 1;
+    _claimed++;
+    return buffer;
+}
+
+static void finish_frame (uint8_t buffer, uint16_t len) {
+    queued_frame_t frame;
+
+    if (buffer == NO_BUFFER) return;
+    if (buffer == DISCARD) {
+        if (len > 0) {
+            _lost_bytes += len;
+            _lost_flag = UART_STREAM_LOST;
+        }
+        return;
+    }
+
+    // Empty frames still go in the queue so buffers come back in order
+    frame.buffer = buffer;
+    frame.len    = len;
+    frame.flags  = _lost_flag | ((len == _buffer_size) ? UART_STREAM_FULL : 0);
+    _lost_flag   = 0;
+    spsc_queue_push(&_frames, &frame);
+}
+
+#ifdef NRF52
+
+static void set_next_rx_buffer (void) {
+    _pending = claim_buffer();
+    if (_pending == DISCARD) {
+        UART->RXD.PTR    = (uint32_t) _discard;
+        UART->RXD.MAXCNT = sizeof(_discard);
+    } else {
+        UART->RXD.PTR    = (uint32_t) (_buffers + _pending * _buffer_size);
+        UART->RXD.MAXCNT = _buffer_size;
+    }
+}
+
+void UART_IRQHandler (void) {
+    if (UART->EVENTS_ERROR) {
+        UART->EVENTS_ERROR = 0;
+        UART->ERRORSRC = UART->ERRORSRC;
+        _errors++;
+    }
+
+    // A buffer is done, because it is full or the receiver was stopped.
+    // The shortcut has already started the pending one, if it is still on.
+    if (UART->EVENTS_ENDRX) {
+        UART->EVENTS_ENDRX = 0;
+        finish_frame(_current, UART->RXD.AMOUNT);
+        _current = _pending;
+        _pending = NO_BUFFER;
+    }
+
+    // The pointer is latched, so the one after can be set up
+    if (UART->EVENTS_RXSTARTED) {
+        UART->EVENTS_RXSTARTED = 0;
+        set_next_rx_buffer();
+    }
+
+    // Stopped after an idle gap. Start again on the buffer set up already.
+    if (UART->EVENTS_RXTO) {
+        UART->EVENTS_RXTO = 0;
+        UART->SHORTS = UARTE_SHORTS_ENDRX_STARTRX_Msk;
+        UART->TASKS_STARTRX = 1;
+    }
+}
+
+// The line went idle: stop the receiver, which ends the buffer with what
+// it has so far
+void TIMER_IRQHandler (void) {
+    IDLE_TIMER->EVENTS_COMPARE[0] = 0;
+    UART->SHORTS = 0;
+    UART->TASKS_STOPRX = 1;
+}
+
+static void uart_start (const uart_stream_config_t* config) {
+    UART->PSEL.RXD = config->rx_pin;
+    UART->PSEL.TXD = (config->tx_pin == UART_STREAM_PIN_NOT_USED) ? 0xFFFFFFFF : config->tx_pin;
+    UART->PSEL.RTS = 0xFFFFFFFF;
+    UART->PSEL.CTS = 0xFFFFFFFF;
+    UART->BAUDRATE = config->baudrate;
+    UART->CONFIG   = 0;
+    UART->ENABLE   = UARTE_ENABLE_ENABLE_Enabled;
+
+    _current = claim_buffer();
+    UART->RXD.PTR    = (uint32_t) (_buffers + _current * _buffer_size);
+    UART->RXD.MAXCNT = _buffer_size;
+    _pending = NO_BUFFER;
+
+    UART->EVENTS_ENDRX = 0;
+    UART->EVENTS_RXSTARTED = 0;
+    UART->EVENTS_RXTO = 0;
+    UART->EVENTS_ERROR = 0;
+    UART->SHORTS   = UARTE_SHORTS_ENDRX_STARTRX_Msk;
+    UART->INTENSET = UARTE_INTENSET_ENDRX_Msk | UARTE_INTENSET_RXSTARTED_Msk |
+                     UARTE_INTENSET_RXTO_Msk | UARTE_INTENSET_ERROR_Msk;
+    UART->TASKS_STARTRX = 1;
+}
+
+void uart_stream_write (const uint8_t* data, uint16_t len) {
+    // EasyDMA can't read flash, so go through RAM
+    static uint8_t tx[32];
+
+    while (len > 0) {
+        uint16_t chunk = (len > sizeof(tx)) ? sizeof(tx) : len;
+
+        memcpy(tx, data, chunk);
+        UART->TXD.PTR    = (uint32_t) tx;
+        UART->TXD.MAXCNT = chunk;
+        UART->EVENTS_ENDTX = 0;
+        UART->TASKS_STARTTX = 1;
+        while (!UART->EVENTS_ENDTX);
+
+        data += chunk;
+        len  -= chunk;
+    }
+    UART->TASKS_STOPTX = 1;
+}
+
+#else
+
+void UART_IRQHandler (void) {
+    if (UART->EVENTS_ERROR) {
+        UART->EVENTS_ERROR = 0;
+        UART->ERRORSRC = UART->ERRORSRC;
+        _errors++;
+    }
+
+    while (UART->EVENTS_RXDRDY) {
+        uint8_t c;
+
+        UART->EVENTS_RXDRDY = 0;
+        c = UART->RXD;
+
+        if (_current == NO_BUFFER) {
+            _current = claim_buffer();
+            _fill = 0;
+        }
+        if (_current == DISCARD) {
+            _lost_bytes++;
+            _lost_flag = UART_STREAM_LOST;
+            _current = NO_BUFFER;
+            continue;
+        }
+
+        _buffers[_current * _buffer_size + _fill++] = c;
+        if (_fill == _buffer_size) {
+            finish_frame(_current, _fill);
+            _current = NO_BUFFER;
+        }
+    }
+}
+
+// The line went idle, hand over what there is
+void TIMER_IRQHandler (void) {
+    IDLE_TIMER->EVENTS_COMPARE[0] = 0;
+    if (_current != NO_BUFFER) {
+        finish_frame(_current, _fill);
+        _current = NO_BUFFER;
+    }
+}
+
+static void uart_start (const uart_stream_config_t* config) {
+    UART->PSELRXD  = config->rx_pin;
+    UART->PSELTXD  = (config->tx_pin == UART_STREAM_PIN_NOT_USED) ? 0xFFFFFFFF : config->tx_pin;
+    UART->PSELRTS  = 0xFFFFFFFF;
+    UART->PSELCTS  = 0xFFFFFFFF;
+    UART->BAUDRATE = config->baudrate;
+    UART->CONFIG   = 0;
+    UART->ENABLE   = UART_ENABLE_ENABLE_Enabled;
+
+    _current = NO_BUFFER;
+
+    UART->EVENTS_RXDRDY = 0;
+    UART->EVENTS_ERROR  = 0;
+    UART->INTENSET = UART_INTENSET_RXDRDY_Msk | UART_INTENSET_ERROR_Msk;
+    UART->TASKS_STARTRX = 1;
+    UART->TASKS_STARTTX = 1;
+}
+
+void uart_stream_write (const uint8_t* data, uint16_t len) {
+    while (len--) {
+        UART->EVENTS_TXDRDY = 0;
+        UART->TXD = *data++;
+        while (!UART->EVENTS_TXDRDY);
+    }
+}
+
+#endif
+
+/**
+ * \brief         Start receiving into the configured buffers.
+ * \return        NRF_SUCCESS, NRF_ERROR_INVALID_PARAM for a bad buffer
+ *                setup, or an error from nrf_drv_ppi.
+ */
+uint32_t uart_stream_init (const uart_stream_config_t* config) {
+    nrf_ppi_channel_t clear_channel, start_channel;
+    uint32_t err_code;
+
+    if (config->num_buffers < 3 || config->num_buffers > UART_STREAM_MAX_BUFFERS ||
+        config->buffer_size == 0) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+#ifdef NRF52
+    if (config->buffer_size > (UARTE_RXD_MAXCNT_MAXCNT_Msk >> UARTE_RXD_MAXCNT_MAXCNT_Pos)) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+#endif
+
+    _buffers     = config->buffers;
+    _buffer_size = config->buffer_size;
+    _num_buffers = config->num_buffers;
+    _claimed     = _frames.head = _frames.tail = 0;
+    _next        = 0;
+    _lost_flag   = 0;
+    _line_offset = _line_len = 0;
+
+    if (config->tx_pin != UART_STREAM_PIN_NOT_USED) {
+        nrf_gpio_pin_set(config->tx_pin);
+        nrf_gpio_cfg_output(config->tx_pin);
+    }
+    nrf_gpio_cfg_input(config->rx_pin, NRF_GPIO_PIN_NOPULL);
+
+    // Idle timer: 1 MHz, stops itself when it reaches the timeout
+    IDLE_TIMER->TASKS_STOP = 1;
+    IDLE_TIMER->MODE       = TIMER_MODE_MODE_Timer;
+    IDLE_TIMER->BITMODE    = TIMER_BITMODE_BITMODE_16Bit;
+    IDLE_TIMER->PRESCALER  = 4;
+    IDLE_TIMER->CC[0]      = config->idle_timeout_us;
+    IDLE_TIMER->SHORTS     = TIMER_SHORTS_COMPARE0_CLEAR_Msk | TIMER_SHORTS_COMPARE0_STOP_Msk;
+    IDLE_TIMER->EVENTS_COMPARE[0] = 0;
+    IDLE_TIMER->INTENSET   = TIMER_INTENSET_COMPARE0_Msk;
+    IDLE_TIMER->TASKS_CLEAR = 1;
+
+    // Every byte received restarts it
+    err_code = nrf_drv_ppi_init();
+    if (err_code != NRF_SUCCESS && err_code != MODULE_ALREADY_INITIALIZED) return err_code;
+    err_code = nrf_drv_ppi_channel_alloc(&clear_channel);
+    if (err_code != NRF_SUCCESS) return err_code;
+    err_code = nrf_drv_ppi_channel_alloc(&start_channel);
+    if (err_code != NRF_SUCCESS) return err_code;
+    nrf_drv_ppi_channel_assign(clear_channel, (uint32_t) &UART->EVENTS_RXDRDY, (uint32_t) &IDLE_TIMER->TASKS_CLEAR);
+    nrf_drv_ppi_channel_assign(start_channel, (uint32_t) &UART->EVENTS_RXDRDY, (uint32_t) &IDLE_TIMER->TASKS_START);
+    nrf_drv_ppi_channel_enable(clear_channel);
+    nrf_drv_ppi_channel_enable(start_channel);
+
+    // Same priority, so neither handler interrupts the other
+    NVIC_SetPriority(TIMER_IRQn, config->irq_priority);
+    NVIC_ClearPendingIRQ(TIMER_IRQn);
+    NVIC_EnableIRQ(TIMER_IRQn);
+    NVIC_SetPriority(UART_IRQn, config->irq_priority);
+    NVIC_ClearPendingIRQ(UART_IRQn);
+    NVIC_EnableIRQ(UART_IRQn);
+
+    uart_start(config);
+    return NRF_SUCCESS;
+}
+
+bool uart_stream_get (uart_stream_frame_t* frame) {
+    queued_frame_t* queued;
+
+    while ((queued = spsc_queue_peek(&_frames)) != NULL && queued->len == 0) {
+        spsc_queue_drop(&_frames);
+    }
+    if (queued == NULL) return false;
+
+    frame->data  = _buffers + queued->buffer * _buffer_size;
+    frame->len   = queued->len;
+    frame->flags = queued->flags;
+    return true;
+}
+
+void uart_stream_release (void) {
+    spsc_queue_drop(&_frames);
+}
+
+int uart_stream_get_line (char* line, uint16_t size) {
+    uart_stream_frame_t frame;
+
+    while (uart_stream_get(&frame)) {
+        while (_line_offset < frame.len) {
+            char c = frame.data[_line_offset++];
+
+            if (c == '\n') {
+                int len = _line_len;
+
+                line[len] = '\0';
+                _line_len = 0;
+                if (_line_offset == frame.len) {
+                    uart_stream_release();
+                    _line_offset = 0;
+                }
+                return len;
+            }
+            if (c != '\r' && _line_len < size - 1) line[_line_len++] = c;
+        }
+        uart_stream_release();
+        _line_offset = 0;
+    }
+    return -1;
+}
+
+uint32_t uart_stream_lost_bytes (void) {
+    return _lost_bytes;
+}
+
+uint32_t uart_stream_errors (void) {
+    return _errors;
+}
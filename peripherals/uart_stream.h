@@ -0,0 +1,97 @@
+// UART receive in frames
+//
+// Received bytes go into a ring of buffers owned by the application. A frame
+// ends when its buffer is full or when the line has been idle for
+// `idle_timeout_us`, and is handed to the main loop through a lock free
+// queue (spsc_queue.h). The main loop reads frames in place and releases
+// them when it is done, which frees the buffer for more data.
+//
+// On the nRF52 the UARTE receives with EasyDMA: while one buffer fills, the
+// next one is already set up, and the ENDRX->STARTRX shortcut switches over
+// without the CPU. Interrupts happen once per buffer and once per idle gap,
+// not per byte. The nRF51 has no DMA, so there the UART interrupt copies
+// each byte into the same buffers.
+//
+// The idle timeout uses a TIMER (UART_STREAM_TIMER_INSTANCE, 2 by default)
+// that every received byte clears and starts again through PPI. This module
+// owns the UART(E) instance 0 and that timer, so do not use app_uart or
+// nrf_drv_uart with it.
+//
+//   static uint8_t buffers[4][128];
+//   static const uart_stream_config_t config = {
+//       .rx_pin = 24, .tx_pin = 23,
+//       .baudrate = UART_BAUDRATE_BAUDRATE_Baud1M,
+//       .irq_priority = APP_IRQ_PRIORITY_LOW,
+//       .idle_timeout_us = 100,
+//       .buffers = buffers[0], .buffer_size = 128, .num_buffers = 4,
+//   };
+//
+//   uart_stream_init(&config);
+//   while (1) {
+//       uart_stream_frame_t frame;
+//       while (uart_stream_get(&frame)) {
+//           // frame.data, frame.len
+//           uart_stream_release();
+//       }
+//       __WFE();
+//   }
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef UART_STREAM_TIMER_INSTANCE
+#define UART_STREAM_TIMER_INSTANCE 2
+#endif
+
+#define UART_STREAM_MAX_BUFFERS  16
+#define UART_STREAM_PIN_NOT_USED 0xFF
+
+// uart_stream_frame_t flags
+#define UART_STREAM_FULL  0x01  // ended because the buffer filled up
+#define UART_STREAM_LOST  0x02  // bytes were lost just before this frame
+
+typedef struct {
+    uint8_t  rx_pin;
+    uint8_t  tx_pin;            // UART_STREAM_PIN_NOT_USED to only receive
+    uint32_t baudrate;          // UART_BAUDRATE_BAUDRATE_Baud...
+    uint8_t  irq_priority;      // for both the UART and the timer
+    uint16_t idle_timeout_us;   // at least two byte times
+
+    // num_buffers (3 to UART_STREAM_MAX_BUFFERS) of buffer_size bytes each.
+    // Two are always with the UARTE on the nRF52, whose RXD.MAXCNT limits
+    // buffer_size to 255 on the nRF52832.
+    uint8_t* buffers;
+    uint16_t buffer_size;
+    uint8_t  num_buffers;
+} uart_stream_config_t;
+
+typedef struct {
+    const uint8_t* data;
+    uint16_t       len;
+    uint8_t        flags;
+} uart_stream_frame_t;
+
+// Configure the UART, the timer and the PPI channels and start receiving.
+uint32_t uart_stream_init (const uart_stream_config_t* config);
+
+// Main loop only. The oldest received frame, if there is one. It stays
+// valid until uart_stream_release().
+bool uart_stream_get (uart_stream_frame_t* frame);
+
+// Main loop only. Done with the frame from uart_stream_get().
+void uart_stream_release (void);
+
+// Main loop only. Assemble a line from the frames received, without the
+// line ending. Returns its length, or -1 if no complete line is there yet;
+// call again with the same buffer later. Longer lines are cut to size-1.
+// Do not mix with uart_stream_get().
+int uart_stream_get_line (char* line, uint16_t size);
+
+// Main loop only. Send data, waiting until it has gone out.
+void uart_stream_write (const uint8_t* data, uint16_t len);
+
+// Bytes dropped because the main loop held every buffer, and UART errors
+uint32_t uart_stream_lost_bytes (void);
+uint32_t uart_stream_errors (void);
@@ -81,7 +81,7 @@ void simple_ble_device_info_service (char* hw_rev, char* fw_rev, char* sw_rev) {
 
     // BLE address of the system
     ble_dis_sys_id_t sys_id = {0};
-    sys_id.manufacturer_id = (0xFFFE << 24) | (0x30004f);
+    sys_id.manufacturer_id = (0xFFFEULL << 24) | (0x30004f);
     sys_id.organizationally_unique_id = 0xc098e5;
     device_info.p_sys_id = &sys_id;
 